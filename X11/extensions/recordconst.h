@@ -23,7 +23,7 @@
 
 #define RECORD_NAME			"RECORD"
 #define RECORD_MAJOR_VERSION		1
-#define RECORD_MINOR_VERSION		13
+#define RECORD_MINOR_VERSION		14
 #define RECORD_LOWEST_MAJOR_VERSION	1
 #define RECORD_LOWEST_MINOR_VERSION	12
 
@@ -49,6 +49,7 @@
 #define XRecordClientDied               3
 #define XRecordStartOfData		4
 #define XRecordEndOfData		5
+#define XRecordRingData		6	/* EnableContextShm, 1.14 */
 
 
 #endif /* _RECORD_H_ */
@@ -26,6 +26,8 @@
 /* only difference between 1.12 and 1.13 is byte order of device events,
    which the library doesn't deal with. */
 
+/* 1.14 adds EnableContextShm, which needs the MIT-SHM extension. */
+
 /*********************************************************
  *
  * Protocol request constants
@@ -39,6 +41,7 @@
 #define X_RecordEnableContext   5     /* Enable interception and reporting */
 #define X_RecordDisableContext  6     /* Disable interception and reporting */
 #define X_RecordFreeContext     7     /* Free client RC */
+#define X_RecordEnableContextShm 8    /* Enable, reporting into shm, 1.14 */
 
 #define sz_XRecordRange		32
 #define sz_XRecordClientInfo 	12
@@ -298,6 +301,52 @@ typedef struct
 } xRecordFreeContextReq;
 #define sz_xRecordFreeContextReq 	8
 
+/*
+ * Enable data interception, reporting into a ring in an MIT-SHM segment
+ */
+typedef struct
+{
+    CARD8     	reqType;
+    CARD8     	recordReqType;
+    CARD16    	length;
+    RECORD_RC 	context;
+    CARD32	shmseg;
+    CARD32	offset;
+    CARD32	size;
+    CARD32	notifyBytes;
+} xRecordEnableContextShmReq;
+#define sz_xRecordEnableContextShmReq 	24
+
+typedef struct
+{
+    CARD8		type;
+    CARD8		category;	/* XRecordRingData or XRecordEndOfData */
+    CARD16		sequenceNumber;
+    CARD32		length;
+    CARD32		head;
+    CARD32		pad0;
+    CARD32		pad1;
+    CARD32		pad2;
+    CARD32		pad3;
+    CARD32		pad4;
+} xRecordRingNotifyReply;
+#define sz_xRecordRingNotifyReply 	32
+
+/*
+ * Header of the ring, at offset in the segment, followed by size bytes
+ * of data.  head and tail count the bytes written by the server and
+ * consumed by the client, modulo 2^32.
+ */
+typedef struct
+{
+    CARD32		head;		/* written by the server */
+    CARD32		size;
+    CARD32		pad0[14];
+    CARD32		tail;		/* written by the client */
+    CARD32		pad1[15];
+} xRecordRingHeader;
+#define sz_xRecordRingHeader 		128
+
 #undef RECORD_RC
 #undef RECORD_XIDBASE
 #undef RECORD_ELEMENT_HEADER
@@ -227,6 +227,29 @@ static int FASTCALL checkCharRefNumber(int);
 #include "xmltok_impl.h"
 #include "ascii.h"
 
+/* Plain UTF-8 character data is skipped 16 bytes at a time with SSE2,
+   unless XML_NO_SIMD is defined. */
+#if !defined(XML_NO_SIMD) && !defined(XML_MIN_SIZE) \
+    && ((defined(__GNUC__) && defined(__SSE2__)) \
+        || (defined(_MSC_VER) \
+            && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))))
+#define XML_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define XML_CTZ(x) __builtin_ctz(x)
+#else
+#include <intrin.h>
+static unsigned
+xmlCtz(unsigned x)
+{
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return (unsigned)i;
+}
+#define XML_CTZ(x) xmlCtz(x)
+#endif
+#endif
+
 #ifdef XML_MIN_SIZE
 #define sb_isNameMin isNever
 #define sb_isNmstrtMin isNever
@@ -296,11 +319,77 @@ sb_charMatches(const ENCODING *enc, const char *p, int c)
 #define CHAR_MATCHES(enc, p, c) (*(p) == c)
 #endif
 
+#if defined(XML_SIMD_SSE2)
+
+/* Return the first byte at or after ptr, and before end, that is not a
+   plain ASCII data character, or the start of the last partial 16-byte
+   block if there is none.  Plain means printable ASCII other than '<',
+   '&' and c; space and tab count as plain only if s is non-zero.  The
+   caller carries on from there with the type table.
+*/
+static const char *
+sb_skipDataChars(const char *ptr, const char *end, char c, int s)
+{
+  const __m128i ctl = _mm_set1_epi8(s ? 0x1F : 0x20);
+  const __m128i lt = _mm_set1_epi8(ASCII_LT);
+  const __m128i amp = _mm_set1_epi8(ASCII_AMP);
+  const __m128i other = _mm_set1_epi8(c);
+  const __m128i tab = _mm_set1_epi8(s ? ASCII_TAB : ASCII_LT);
+  while (end - ptr >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)ptr);
+    /* signed compare: bytes 0x80 and up are negative */
+    __m128i ok = _mm_or_si128(_mm_cmpgt_epi8(v, ctl), _mm_cmpeq_epi8(v, tab));
+    __m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, lt),
+                                             _mm_cmpeq_epi8(v, amp)),
+                                _mm_cmpeq_epi8(v, other));
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_andnot_si128(stop, ok));
+    if (mask != 0xFFFF)
+      return ptr + XML_CTZ(~mask);
+    ptr += 16;
+  }
+  return ptr;
+}
+
+/* The tokenizers try this once at the start of a run of data and after
+   each multi-byte character, never per byte.  Most runs in markup-heavy
+   documents are only a few bytes long, so the vector scan is only started
+   when the next byte is printable ASCII other than '<' and a whole block
+   is left. */
+#define SB_DATA_RUN_LIKELY(enc, ptr, end) \
+  ((enc)->isUtf8 && (end) - (ptr) >= 16 \
+   && (unsigned char)(*(ptr) - 0x21) < 0x5E && *(ptr) != ASCII_LT)
+
+/* Skip plain character data in content, which ends at ']' too. */
+#define SKIP_DATA_CHARS(enc, ptr, end) \
+  do { \
+    if (SB_DATA_RUN_LIKELY(enc, ptr, end)) \
+      (ptr) = sb_skipDataChars(ptr, end, ASCII_RSQB, 1); \
+  } while (0)
+
+/* Skip plain data in an attribute value, where white space is a token. */
+#define SKIP_ATTRIBUTE_DATA_CHARS(enc, ptr, end) \
+  do { \
+    if (SB_DATA_RUN_LIKELY(enc, ptr, end)) \
+      (ptr) = sb_skipDataChars(ptr, end, ASCII_LT, 0); \
+  } while (0)
+
+#else /* not XML_SIMD_SSE2 */
+
+#define SKIP_DATA_CHARS(enc, ptr, end) /* as nothing */
+#define SKIP_ATTRIBUTE_DATA_CHARS(enc, ptr, end) /* as nothing */
+
+#endif /* not XML_SIMD_SSE2 */
+
 #define PREFIX(ident) normal_ ## ident
 #define XML_TOK_IMPL_C
 #include "xmltok_impl.c"
 #undef XML_TOK_IMPL_C
 
+#undef SKIP_DATA_CHARS
+#undef SKIP_ATTRIBUTE_DATA_CHARS
+#define SKIP_DATA_CHARS(enc, ptr, end) /* as nothing */
+#define SKIP_ATTRIBUTE_DATA_CHARS(enc, ptr, end) /* as nothing */
+
 #undef MINBPC
 #undef BYTE_TYPE
 #undef BYTE_TO_ASCII
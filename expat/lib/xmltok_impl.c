@@ -348,6 +348,7 @@ PREFIX(cdataSectionTok)(const ENCODING *enc, const char *ptr,
     ptr += MINBPC(enc);
     break;
   }
+  SKIP_DATA_CHARS(enc, ptr, end);
   while (ptr != end) {
     switch (BYTE_TYPE(enc, ptr)) {
 #define LEAD_CASE(n) \
@@ -357,6 +358,7 @@ PREFIX(cdataSectionTok)(const ENCODING *enc, const char *ptr,
         return XML_TOK_DATA_CHARS; \
       } \
       ptr += n; \
+      SKIP_DATA_CHARS(enc, ptr, end); \
       break;
     LEAD_CASE(2) LEAD_CASE(3) LEAD_CASE(4)
 #undef LEAD_CASE
@@ -832,6 +834,7 @@ PREFIX(contentTok)(const ENCODING *enc, const char *ptr, const char *end,
     ptr += MINBPC(enc);
     break;
   }
+  SKIP_DATA_CHARS(enc, ptr, end);
   while (ptr != end) {
     switch (BYTE_TYPE(enc, ptr)) {
 #define LEAD_CASE(n) \
@@ -841,6 +844,7 @@ PREFIX(contentTok)(const ENCODING *enc, const char *ptr, const char *end,
         return XML_TOK_DATA_CHARS; \
       } \
       ptr += n; \
+      SKIP_DATA_CHARS(enc, ptr, end); \
       break;
     LEAD_CASE(2) LEAD_CASE(3) LEAD_CASE(4)
 #undef LEAD_CASE
@@ -1207,6 +1211,7 @@ PREFIX(attributeValueTok)(const ENCODING *enc, const char *ptr,
   if (ptr == end)
     return XML_TOK_NONE;
   start = ptr;
+  SKIP_ATTRIBUTE_DATA_CHARS(enc, ptr, end);
   while (ptr != end) {
     switch (BYTE_TYPE(enc, ptr)) {
 #define LEAD_CASE(n) \
@@ -583,6 +583,36 @@ START_TEST(test_really_long_lines)
 }
 END_TEST
 
+/* Character data runs long enough for the vectorized scan, with each
+   kind of byte that has to stop it at a different offset in a block. */
+START_TEST(test_long_data_runs)
+{
+    char *text =
+        "<e>"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ&amp;abcdefghijklmnopqrstuvwxyz]0123456789"
+        "ABCDEFGHIJKLMNOP\xC3\xA9QRSTUVWXYZabcdefghijklmnopqrstuvwxyz\t-+"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijk\r\nlmnopqrstuvwxyz\x7F 0123"
+        "</e>";
+    char *expected =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ&abcdefghijklmnopqrstuvwxyz]0123456789"
+        "ABCDEFGHIJKLMNOP\xC3\xA9QRSTUVWXYZabcdefghijklmnopqrstuvwxyz\t-+"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijk\nlmnopqrstuvwxyz\x7F 0123";
+    run_character_check(text, expected);
+}
+END_TEST
+
+START_TEST(test_long_attribute_value_runs)
+{
+    char *text =
+        "<e a='ABCDEFGHIJKLMNOPQRSTUVWXYZ&amp;abcdefghijklmnop\tqrstuvwxyz"
+        "0123456789ABCDEFGHIJ\xC3\xA9KLMNOPQRSTUVWXYZ abcdefghijklmnopqrstuvw'/>";
+    char *expected =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ&abcdefghijklmnop qrstuvwxyz"
+        "0123456789ABCDEFGHIJ\xC3\xA9KLMNOPQRSTUVWXYZ abcdefghijklmnopqrstuvw";
+    run_attribute_check(text, expected);
+}
+END_TEST
+
 
 /*
  * Element event tests.
@@ -1443,6 +1473,8 @@ make_suite(void)
     tcase_add_test(tc_basic, test_line_number_after_error);
     tcase_add_test(tc_basic, test_column_number_after_error);
     tcase_add_test(tc_basic, test_really_long_lines);
+    tcase_add_test(tc_basic, test_long_data_runs);
+    tcase_add_test(tc_basic, test_long_attribute_value_runs);
     tcase_add_test(tc_basic, test_end_element_events);
     tcase_add_test(tc_basic, test_attr_whitespace_normalization);
     tcase_add_test(tc_basic, test_xmldecl_misplaced);
@@ -1034,6 +1034,309 @@ FT_BEGIN_HEADER
   /* */
 
 
+  /*************************************************************************/
+  /*************************************************************************/
+  /*************************************************************************/
+  /*****                                                               *****/
+  /*****                     SHARDED CACHE MANAGER                     *****/
+  /*****                                                               *****/
+  /*************************************************************************/
+  /*************************************************************************/
+  /*************************************************************************/
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Type>                                                                */
+  /*    FTC_ShardedManager                                                 */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    A cache manager that can be shared by several threads.             */
+  /*                                                                       */
+  /*    Face IDs are distributed over a fixed number of `shards'.  Each    */
+  /*    shard is a regular @FTC_Manager with its own @FT_Library and its   */
+  /*    own lock, so lookups for faces living in different shards never    */
+  /*    contend, and a given face is only ever loaded (and its glyphs only */
+  /*    ever cached) once for all threads.                                 */
+  /*                                                                       */
+  /*    The `max_bytes' budget passed to @FTC_ShardedManager_New is        */
+  /*    shared by all shards.  When a lookup takes the total over it,      */
+  /*    unreferenced nodes are flushed from the face's shard first, then   */
+  /*    from the other shards.  Nodes still referenced by the caller are   */
+  /*    never flushed, so the total can exceed the budget by what is in    */
+  /*    use until those nodes are released.                                */
+  /*                                                                       */
+  typedef struct FTC_ShardedManagerRec_*  FTC_ShardedManager;
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Type>                                                                */
+  /*    FTC_ShardedImageCache                                              */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    A handle to a glyph image cache registered in every shard of an    */
+  /*    @FTC_ShardedManager.                                               */
+  /*                                                                       */
+  typedef struct FTC_ShardedImageCacheRec_*  FTC_ShardedImageCache;
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Type>                                                                */
+  /*    FTC_ShardedSBitCache                                               */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    A handle to a small bitmap cache registered in every shard of an   */
+  /*    @FTC_ShardedManager.                                               */
+  /*                                                                       */
+  typedef struct FTC_ShardedSBitCacheRec_*  FTC_ShardedSBitCache;
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Function>                                                            */
+  /*    FTC_ShardedManager_New                                             */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    Create a new thread-safe cache manager.                            */
+  /*                                                                       */
+  /* <Input>                                                               */
+  /*    library    :: The FreeType library handle whose memory manager is  */
+  /*                  used for all shards.                                 */
+  /*                                                                       */
+  /*    num_shards :: Number of independently locked shards.  Use~0 for   */
+  /*                  defaults.                                            */
+  /*                                                                       */
+  /*    max_faces  :: Maximum number of opened @FT_Face objects per shard. */
+  /*                  Use~0 for defaults.                                  */
+  /*                                                                       */
+  /*    max_sizes  :: Maximum number of opened @FT_Size objects per shard. */
+  /*                  Use~0 for defaults.                                  */
+  /*                                                                       */
+  /*    max_bytes  :: Maximum number of bytes to use for cached data nodes */
+  /*                  over all shards.  Use~0 for defaults.                */
+  /*                                                                       */
+  /*    requester  :: An application-provided callback used to translate  */
+  /*                  face IDs into real @FT_Face objects.                 */
+  /*                                                                       */
+  /*    req_data   :: A generic pointer that is passed to the requester    */
+  /*                  each time it is called (see @FTC_Face_Requester).    */
+  /*                                                                       */
+  /* <Output>                                                              */
+  /*    amanager   :: A handle to a new manager object.  0~in case of      */
+  /*                  failure.                                             */
+  /*                                                                       */
+  /* <Return>                                                              */
+  /*    FreeType error code.  0~means success.                             */
+  /*                                                                       */
+  /* <Note>                                                                */
+  /*    The requester is called with the shard's own @FT_Library, never    */
+  /*    with `library'; it must create the face with the library it        */
+  /*    receives.  The memory manager of `library' must be thread-safe.    */
+  /*                                                                       */
+  FT_EXPORT( FT_Error )
+  FTC_ShardedManager_New( FT_Library           library,
+                          FT_UInt              num_shards,
+                          FT_UInt              max_faces,
+                          FT_UInt              max_sizes,
+                          FT_ULong             max_bytes,
+                          FTC_Face_Requester   requester,
+                          FT_Pointer           req_data,
+                          FTC_ShardedManager  *amanager );
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Function>                                                            */
+  /*    FTC_ShardedManager_Reset                                           */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    Empty all shards of a sharded cache manager.                       */
+  /*                                                                       */
+  /* <InOut>                                                               */
+  /*    manager :: A handle to the manager.                                */
+  /*                                                                       */
+  FT_EXPORT( void )
+  FTC_ShardedManager_Reset( FTC_ShardedManager  manager );
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Function>                                                            */
+  /*    FTC_ShardedManager_Done                                            */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    Destroy a sharded manager, its caches, and its shard libraries.    */
+  /*    No other thread may use the manager during or after this call.     */
+  /*                                                                       */
+  /* <Input>                                                               */
+  /*    manager :: A handle to the target cache manager object.            */
+  /*                                                                       */
+  FT_EXPORT( void )
+  FTC_ShardedManager_Done( FTC_ShardedManager  manager );
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Function>                                                            */
+  /*    FTC_ShardedManager_RemoveFaceID                                    */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    The thread-safe equivalent of @FTC_Manager_RemoveFaceID.           */
+  /*                                                                       */
+  /* <Input>                                                               */
+  /*    manager :: The sharded cache manager handle.                       */
+  /*                                                                       */
+  /*    face_id :: The @FTC_FaceID to be removed.                          */
+  /*                                                                       */
+  FT_EXPORT( void )
+  FTC_ShardedManager_RemoveFaceID( FTC_ShardedManager  manager,
+                                   FTC_FaceID          face_id );
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Function>                                                            */
+  /*    FTC_ShardedManager_UnrefNode                                       */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    Release a cache node returned by @FTC_ShardedImageCache_Lookup or  */
+  /*    @FTC_ShardedSBitCache_Lookup.                                      */
+  /*                                                                       */
+  /* <Input>                                                               */
+  /*    manager :: The sharded cache manager handle.                       */
+  /*                                                                       */
+  /*    face_id :: The face ID used for the lookup that returned `node'.   */
+  /*                                                                       */
+  /*    node    :: The cache node handle.                                  */
+  /*                                                                       */
+  FT_EXPORT( void )
+  FTC_ShardedManager_UnrefNode( FTC_ShardedManager  manager,
+                                FTC_FaceID          face_id,
+                                FTC_Node            node );
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Function>                                                            */
+  /*    FTC_ShardedImageCache_New                                          */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    Create a new glyph image cache in every shard of a manager.        */
+  /*                                                                       */
+  /* <Input>                                                               */
+  /*    manager :: The parent sharded manager for the image cache.         */
+  /*                                                                       */
+  /* <Output>                                                              */
+  /*    acache  :: A handle to the new glyph image cache object.           */
+  /*                                                                       */
+  /* <Return>                                                              */
+  /*    FreeType error code.  0~means success.                             */
+  /*                                                                       */
+  FT_EXPORT( FT_Error )
+  FTC_ShardedImageCache_New( FTC_ShardedManager      manager,
+                             FTC_ShardedImageCache  *acache );
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Function>                                                            */
+  /*    FTC_ShardedImageCache_Lookup                                       */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    The thread-safe equivalent of @FTC_ImageCache_Lookup.              */
+  /*                                                                       */
+  /* <Input>                                                               */
+  /*    cache  :: A handle to the source glyph image cache.                */
+  /*                                                                       */
+  /*    type   :: A pointer to a glyph image type descriptor.              */
+  /*                                                                       */
+  /*    gindex :: The glyph index to retrieve.                             */
+  /*                                                                       */
+  /* <Output>                                                              */
+  /*    aglyph :: The corresponding @FT_Glyph object.  0~in case of        */
+  /*              failure.                                                 */
+  /*                                                                       */
+  /*    anode  :: The address of the corresponding cache node after        */
+  /*              incrementing its reference count.                        */
+  /*                                                                       */
+  /* <Return>                                                              */
+  /*    FreeType error code.  0~means success.                             */
+  /*                                                                       */
+  /* <Note>                                                                */
+  /*    Unlike @FTC_ImageCache_Lookup, `anode' must not be NULL: another   */
+  /*    thread could otherwise flush the glyph while it is being used.     */
+  /*    Release the node with @FTC_ShardedManager_UnrefNode.               */
+  /*                                                                       */
+  FT_EXPORT( FT_Error )
+  FTC_ShardedImageCache_Lookup( FTC_ShardedImageCache  cache,
+                                FTC_ImageType          type,
+                                FT_UInt                gindex,
+                                FT_Glyph              *aglyph,
+                                FTC_Node              *anode );
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Function>                                                            */
+  /*    FTC_ShardedSBitCache_New                                           */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    Create a new small bitmap cache in every shard of a manager.       */
+  /*                                                                       */
+  /* <Input>                                                               */
+  /*    manager :: The parent sharded manager for the sbit cache.          */
+  /*                                                                       */
+  /* <Output>                                                              */
+  /*    acache  :: A handle to the new sbit cache.  NULL in case of error. */
+  /*                                                                       */
+  /* <Return>                                                              */
+  /*    FreeType error code.  0~means success.                             */
+  /*                                                                       */
+  FT_EXPORT( FT_Error )
+  FTC_ShardedSBitCache_New( FTC_ShardedManager     manager,
+                            FTC_ShardedSBitCache  *acache );
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* <Function>                                                            */
+  /*    FTC_ShardedSBitCache_Lookup                                        */
+  /*                                                                       */
+  /* <Description>                                                         */
+  /*    The thread-safe equivalent of @FTC_SBitCache_Lookup.               */
+  /*                                                                       */
+  /* <Input>                                                               */
+  /*    cache  :: A handle to the source sbit cache.                       */
+  /*                                                                       */
+  /*    type   :: A pointer to the glyph image type descriptor.            */
+  /*                                                                       */
+  /*    gindex :: The glyph index.                                         */
+  /*                                                                       */
+  /* <Output>                                                              */
+  /*    sbit   :: A handle to a small bitmap descriptor.                   */
+  /*                                                                       */
+  /*    anode  :: The address of the corresponding cache node after        */
+  /*              incrementing its reference count.                        */
+  /*                                                                       */
+  /* <Return>                                                              */
+  /*    FreeType error code.  0~means success.                             */
+  /*                                                                       */
+  /* <Note>                                                                */
+  /*    As with @FTC_ShardedImageCache_Lookup, `anode' must not be NULL;   */
+  /*    release the node with @FTC_ShardedManager_UnrefNode.               */
+  /*                                                                       */
+  FT_EXPORT( FT_Error )
+  FTC_ShardedSBitCache_Lookup( FTC_ShardedSBitCache  cache,
+                               FTC_ImageType         type,
+                               FT_UInt               gindex,
+                               FTC_SBit             *sbit,
+                               FTC_Node             *anode );
+
+  /* */
+
+
 FT_END_HEADER
 
 #endif /* FTCACHE_H_ */
@@ -27,6 +27,7 @@
 #include "ftcmanag.c"
 #include "ftcmru.c"
 #include "ftcsbits.c"
+#include "ftcshard.c"
 
 
 /* END */
@@ -0,0 +1,641 @@
+/***************************************************************************/
+/*                                                                         */
+/*  ftcshard.c                                                             */
+/*                                                                         */
+/*    FreeType thread-safe sharded cache manager (body).                   */
+/*                                                                         */
+/*  Copyright 2000-2018 by                                                 */
+/*  David Turner, Robert Wilhelm, and Werner Lemberg.                      */
+/*                                                                         */
+/*  This file is part of the FreeType project, and may only be used,       */
+/*  modified, and distributed under the terms of the FreeType project      */
+/*  license, LICENSE.TXT.  By continuing to use, modify, or distribute     */
+/*  this file you indicate that you have read the license and              */
+/*  understand and accept it fully.                                        */
+/*                                                                         */
+/***************************************************************************/
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* A sharded manager is a fixed array of ordinary FTC_Manager objects.   */
+  /* Every face ID is hashed to exactly one shard, so all of its sizes and */
+  /* cached glyphs live in that shard, and the shard's lock is the only    */
+  /* one taken for a lookup.  Each shard also owns a private FT_Library,   */
+  /* so that face creation and destruction (which modify the library's     */
+  /* driver lists) never race between shards.                              */
+  /*                                                                       */
+  /* The byte budget is global: the weight of all shards is summed in a    */
+  /* counter with its own lock.  When a lookup takes the sum over the      */
+  /* budget, unreferenced nodes are flushed from the shard that grew, and  */
+  /* if that is not enough, from the other shards in turn.                 */
+  /*                                                                       */
+  /*************************************************************************/
+
+
+#include <ft2build.h>
+#include FT_CACHE_H
+#include FT_MODULE_H
+#include "ftcmanag.h"
+#include FT_INTERNAL_OBJECTS_H
+#include FT_INTERNAL_DEBUG_H
+
+#include "ftcerror.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+
+#undef  FT_COMPONENT
+#define FT_COMPONENT  trace_cache
+
+
+#define FTC_SHARDS_DEFAULT  8
+#define FTC_SHARDS_MAX      64
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* Minimal lock abstraction; the cache sub-system has no other use for   */
+  /* system services, so we don't go through `ftsystem.c' for this.        */
+  /*                                                                       */
+  /*************************************************************************/
+
+#ifdef _WIN32
+
+  typedef CRITICAL_SECTION  FTC_ShardLockRec;
+
+#define FTC_SHARD_LOCK_INIT( l )     ( InitializeCriticalSection( l ), 0 )
+#define FTC_SHARD_LOCK_DONE( l )     DeleteCriticalSection( l )
+#define FTC_SHARD_LOCK( l )          EnterCriticalSection( l )
+#define FTC_SHARD_UNLOCK( l )        LeaveCriticalSection( l )
+
+#else /* !_WIN32 */
+
+  typedef pthread_mutex_t  FTC_ShardLockRec;
+
+#define FTC_SHARD_LOCK_INIT( l )     pthread_mutex_init( l, NULL )
+#define FTC_SHARD_LOCK_DONE( l )     pthread_mutex_destroy( l )
+#define FTC_SHARD_LOCK( l )          pthread_mutex_lock( l )
+#define FTC_SHARD_UNLOCK( l )        pthread_mutex_unlock( l )
+
+#endif /* !_WIN32 */
+
+
+  typedef struct  FTC_ShardRec_
+  {
+    FTC_ShardLockRec  lock;
+    FT_Bool           lock_ok;
+    FT_Library        library;
+    FTC_Manager       manager;
+    FT_Offset         weight;    /* part of the manager's `cur_bytes' */
+
+  } FTC_ShardRec, *FTC_Shard;
+
+
+  typedef struct  FTC_ShardedManagerRec_
+  {
+    FT_Memory           memory;
+    FT_UInt             num_shards;
+    FTC_Shard           shards;
+
+    FTC_ShardLockRec    bytes_lock;
+    FT_Bool             bytes_lock_ok;
+    FT_Offset           max_bytes;
+    FT_Offset           cur_bytes;   /* weight of all shards */
+
+    /* wrapper objects returned by the `_New' functions below; the */
+    /* per-shard caches themselves are owned by the shard managers */
+    FT_UInt             num_caches;
+    FT_Pointer          caches[FTC_MAX_CACHES];
+
+  } FTC_ShardedManagerRec;
+
+
+  typedef struct  FTC_ShardedImageCacheRec_
+  {
+    FTC_ShardedManager  manager;
+    FTC_ImageCache*     caches;
+
+  } FTC_ShardedImageCacheRec;
+
+
+  typedef struct  FTC_ShardedSBitCacheRec_
+  {
+    FTC_ShardedManager  manager;
+    FTC_SBitCache*      caches;
+
+  } FTC_ShardedSBitCacheRec;
+
+
+  /* face IDs are usually pointers, so drop the low alignment bits */
+  /* and mix in the high bits before reducing                      */
+  static FT_UInt
+  ftc_shard_index( FTC_ShardedManager  manager,
+                   FTC_FaceID          face_id )
+  {
+    FT_Offset  h = (FT_Offset)(FT_PtrDist)face_id;
+
+
+    h ^= h >> 4;
+    h ^= h >> 16;
+    h *= 0x9E3779B1UL;
+    h ^= h >> 15;
+
+    return (FT_UInt)( h % manager->num_shards );
+  }
+
+
+#define FTC_SHARD_OF( m, id )  ( (m)->shards + ftc_shard_index( m, id ) )
+
+
+  /* Add the change of `shard's weight since the last call to the */
+  /* manager's total and return the new total; `shard' is locked. */
+  static FT_Offset
+  ftc_shard_account( FTC_ShardedManager  manager,
+                     FTC_Shard           shard )
+  {
+    FT_Offset  weight = shard->manager->cur_weight;
+    FT_Offset  total;
+
+
+    FTC_SHARD_LOCK( &manager->bytes_lock );
+    manager->cur_bytes = manager->cur_bytes - shard->weight + weight;
+    total              = manager->cur_bytes;
+    FTC_SHARD_UNLOCK( &manager->bytes_lock );
+
+    shard->weight = weight;
+
+    return total;
+  }
+
+
+  /* Account for `shard's weight, and if the total is over budget,    */
+  /* flush as many of its unreferenced nodes as needed to get it back */
+  /* under.  `shard' is locked.  Return the new total.                */
+  static FT_Offset
+  ftc_shard_trim( FTC_ShardedManager  manager,
+                  FTC_Shard           shard )
+  {
+    FT_Offset  total = ftc_shard_account( manager, shard );
+
+
+    if ( total > manager->max_bytes )
+    {
+      FTC_Manager  shard_manager = shard->manager;
+      FT_Offset    excess        = total - manager->max_bytes;
+
+
+      shard_manager->max_weight = shard_manager->cur_weight > excess
+                                    ? shard_manager->cur_weight - excess
+                                    : 0;
+      FTC_Manager_Compress( shard_manager );
+      shard_manager->max_weight = manager->max_bytes;
+
+      total = ftc_shard_account( manager, shard );
+    }
+
+    return total;
+  }
+
+
+  /* Finish a lookup in the locked shard `idx': unlock it, and if it */
+  /* couldn't get the total back under budget on its own, trim the   */
+  /* other shards until they have.                                   */
+  static void
+  ftc_shard_done( FTC_ShardedManager  manager,
+                  FT_UInt             idx )
+  {
+    FT_Offset  total = ftc_shard_trim( manager, manager->shards + idx );
+    FT_UInt    nn;
+
+
+    FTC_SHARD_UNLOCK( &manager->shards[idx].lock );
+
+    for ( nn = 1; nn < manager->num_shards; nn++ )
+    {
+      FTC_Shard  shard;
+
+
+      if ( total <= manager->max_bytes )
+        break;
+
+      shard = manager->shards + ( idx + nn ) % manager->num_shards;
+
+      FTC_SHARD_LOCK( &shard->lock );
+      total = ftc_shard_trim( manager, shard );
+      FTC_SHARD_UNLOCK( &shard->lock );
+    }
+  }
+
+
+  /* documentation is in ftcache.h */
+
+  FT_EXPORT_DEF( FT_Error )
+  FTC_ShardedManager_New( FT_Library           library,
+                          FT_UInt              num_shards,
+                          FT_UInt              max_faces,
+                          FT_UInt              max_sizes,
+                          FT_ULong             max_bytes,
+                          FTC_Face_Requester   requester,
+                          FT_Pointer           req_data,
+                          FTC_ShardedManager  *amanager )
+  {
+    FT_Error            error;
+    FT_Memory           memory;
+    FTC_ShardedManager  manager = NULL;
+    FT_UInt             nn;
+
+
+    if ( !library )
+      return FT_THROW( Invalid_Library_Handle );
+
+    if ( !amanager || !requester )
+      return FT_THROW( Invalid_Argument );
+
+    memory = library->memory;
+
+    if ( num_shards == 0 )
+      num_shards = FTC_SHARDS_DEFAULT;
+    if ( num_shards > FTC_SHARDS_MAX )
+      num_shards = FTC_SHARDS_MAX;
+
+    if ( max_bytes == 0 )
+      max_bytes = FTC_MAX_BYTES_DEFAULT;
+
+    if ( FT_NEW( manager ) )
+      goto Exit;
+
+    manager->memory     = memory;
+    manager->num_shards = num_shards;
+    manager->max_bytes  = max_bytes;
+
+    if ( FTC_SHARD_LOCK_INIT( &manager->bytes_lock ) != 0 )
+    {
+      error = FT_THROW( Out_Of_Memory );
+      goto Fail;
+    }
+    manager->bytes_lock_ok = 1;
+
+    if ( FT_NEW_ARRAY( manager->shards, num_shards ) )
+      goto Fail;
+
+    for ( nn = 0; nn < num_shards; nn++ )
+    {
+      FTC_Shard  shard = manager->shards + nn;
+
+
+      if ( FTC_SHARD_LOCK_INIT( &shard->lock ) != 0 )
+      {
+        error = FT_THROW( Out_Of_Memory );
+        goto Fail;
+      }
+      shard->lock_ok = 1;
+
+      error = FT_New_Library( memory, &shard->library );
+      if ( error )
+        goto Fail;
+
+      FT_Add_Default_Modules( shard->library );
+      FT_Set_Default_Properties( shard->library );
+
+      /* a single shard may use the whole budget */
+      error = FTC_Manager_New( shard->library,
+                               max_faces,
+                               max_sizes,
+                               max_bytes,
+                               requester,
+                               req_data,
+                               &shard->manager );
+      if ( error )
+        goto Fail;
+    }
+
+    *amanager = manager;
+    return FT_Err_Ok;
+
+  Fail:
+    FTC_ShardedManager_Done( manager );
+    manager = NULL;
+
+  Exit:
+    *amanager = manager;
+    return error;
+  }
+
+
+  /* documentation is in ftcache.h */
+
+  FT_EXPORT_DEF( void )
+  FTC_ShardedManager_Done( FTC_ShardedManager  manager )
+  {
+    FT_Memory  memory;
+    FT_UInt    nn;
+
+
+    if ( !manager )
+      return;
+
+    memory = manager->memory;
+
+    /* the wrapper objects all start with the manager pointer */
+    /* followed by the per-shard cache array                  */
+    for ( nn = 0; nn < manager->num_caches; nn++ )
+    {
+      FTC_ShardedImageCache  wrapper =
+        (FTC_ShardedImageCache)manager->caches[nn];
+
+
+      FT_FREE( wrapper->caches );
+      FT_FREE( wrapper );
+    }
+    manager->num_caches = 0;
+
+    if ( manager->shards )
+    {
+      for ( nn = 0; nn < manager->num_shards; nn++ )
+      {
+        FTC_Shard  shard = manager->shards + nn;
+
+
+        /* faces must be gone before their library */
+        if ( shard->manager )
+          FTC_Manager_Done( shard->manager );
+        if ( shard->library )
+          FT_Done_Library( shard->library );
+        if ( shard->lock_ok )
+          FTC_SHARD_LOCK_DONE( &shard->lock );
+      }
+
+      FT_FREE( manager->shards );
+    }
+
+    if ( manager->bytes_lock_ok )
+      FTC_SHARD_LOCK_DONE( &manager->bytes_lock );
+
+    FT_FREE( manager );
+  }
+
+
+  /* documentation is in ftcache.h */
+
+  FT_EXPORT_DEF( void )
+  FTC_ShardedManager_Reset( FTC_ShardedManager  manager )
+  {
+    FT_UInt  nn;
+
+
+    if ( !manager )
+      return;
+
+    for ( nn = 0; nn < manager->num_shards; nn++ )
+    {
+      FTC_Shard  shard = manager->shards + nn;
+
+
+      FTC_SHARD_LOCK( &shard->lock );
+      FTC_Manager_Reset( shard->manager );
+      ftc_shard_account( manager, shard );
+      FTC_SHARD_UNLOCK( &shard->lock );
+    }
+  }
+
+
+  /* documentation is in ftcache.h */
+
+  FT_EXPORT_DEF( void )
+  FTC_ShardedManager_RemoveFaceID( FTC_ShardedManager  manager,
+                                   FTC_FaceID          face_id )
+  {
+    FTC_Shard  shard;
+
+
+    if ( !manager )
+      return;
+
+    shard = FTC_SHARD_OF( manager, face_id );
+
+    FTC_SHARD_LOCK( &shard->lock );
+    FTC_Manager_RemoveFaceID( shard->manager, face_id );
+    ftc_shard_account( manager, shard );
+    FTC_SHARD_UNLOCK( &shard->lock );
+  }
+
+
+  /* documentation is in ftcache.h */
+
+  FT_EXPORT_DEF( void )
+  FTC_ShardedManager_UnrefNode( FTC_ShardedManager  manager,
+                                FTC_FaceID          face_id,
+                                FTC_Node            node )
+  {
+    FT_UInt  idx;
+
+
+    if ( !manager || !node )
+      return;
+
+    idx = ftc_shard_index( manager, face_id );
+
+    /* the node may have been kept over budget while it was in use */
+    FTC_SHARD_LOCK( &manager->shards[idx].lock );
+    FTC_Node_Unref( node, manager->shards[idx].manager );
+    ftc_shard_done( manager, idx );
+  }
+
+
+  /* Allocate a wrapper with a per-shard cache array and remember it */
+  /* in the manager so that it can be released by `_Done'.           */
+  static FT_Error
+  ftc_sharded_wrapper_new( FTC_ShardedManager  manager,
+                           FT_Pointer         *awrapper,
+                           FT_Pointer        **acaches )
+  {
+    FT_Error                error;
+    FT_Memory               memory = manager->memory;
+    FTC_ShardedImageCache   wrapper = NULL;
+
+
+    *awrapper = NULL;
+
+    if ( manager->num_caches >= FTC_MAX_CACHES )
+      return FT_THROW( Too_Many_Caches );
+
+    if ( FT_NEW( wrapper ) )
+      return error;
+
+    if ( FT_NEW_ARRAY( wrapper->caches, manager->num_shards ) )
+    {
+      FT_FREE( wrapper );
+      return error;
+    }
+
+    wrapper->manager = manager;
+
+    manager->caches[manager->num_caches++] = wrapper;
+
+    *awrapper = wrapper;
+    *acaches  = (FT_Pointer*)wrapper->caches;
+    return FT_Err_Ok;
+  }
+
+
+  /* documentation is in ftcache.h */
+
+  FT_EXPORT_DEF( FT_Error )
+  FTC_ShardedImageCache_New( FTC_ShardedManager      manager,
+                             FTC_ShardedImageCache  *acache )
+  {
+    FT_Error    error;
+    FT_Pointer  wrapper;
+    FT_Pointer* caches;
+    FT_UInt     nn;
+
+
+    if ( !acache )
+      return FT_THROW( Invalid_Argument );
+
+    *acache = NULL;
+
+    if ( !manager )
+      return FT_THROW( Invalid_Cache_Handle );
+
+    error = ftc_sharded_wrapper_new( manager, &wrapper, &caches );
+    if ( error )
+      return error;
+
+    /* no lookup can run yet: the handle hasn't been returned */
+    for ( nn = 0; nn < manager->num_shards; nn++ )
+    {
+      error = FTC_ImageCache_New( manager->shards[nn].manager,
+                                  (FTC_ImageCache*)&caches[nn] );
+      if ( error )
+        return error;
+    }
+
+    *acache = (FTC_ShardedImageCache)wrapper;
+    return FT_Err_Ok;
+  }
+
+
+  /* documentation is in ftcache.h */
+
+  FT_EXPORT_DEF( FT_Error )
+  FTC_ShardedImageCache_Lookup( FTC_ShardedImageCache  cache,
+                                FTC_ImageType          type,
+                                FT_UInt                gindex,
+                                FT_Glyph              *aglyph,
+                                FTC_Node              *anode )
+  {
+    FT_Error            error;
+    FTC_ShardedManager  manager;
+    FT_UInt             idx;
+    FTC_Shard           shard;
+
+
+    if ( !aglyph || !anode || !type )
+      return FT_THROW( Invalid_Argument );
+
+    *aglyph = NULL;
+    *anode  = NULL;
+
+    if ( !cache )
+      return FT_THROW( Invalid_Cache_Handle );
+
+    manager = cache->manager;
+    idx     = ftc_shard_index( manager, type->face_id );
+    shard   = manager->shards + idx;
+
+    FTC_SHARD_LOCK( &shard->lock );
+    error = FTC_ImageCache_Lookup( cache->caches[idx],
+                                   type,
+                                   gindex,
+                                   aglyph,
+                                   anode );
+    ftc_shard_done( manager, idx );
+
+    return error;
+  }
+
+
+  /* documentation is in ftcache.h */
+
+  FT_EXPORT_DEF( FT_Error )
+  FTC_ShardedSBitCache_New( FTC_ShardedManager     manager,
+                            FTC_ShardedSBitCache  *acache )
+  {
+    FT_Error    error;
+    FT_Pointer  wrapper;
+    FT_Pointer* caches;
+    FT_UInt     nn;
+
+
+    if ( !acache )
+      return FT_THROW( Invalid_Argument );
+
+    *acache = NULL;
+
+    if ( !manager )
+      return FT_THROW( Invalid_Cache_Handle );
+
+    error = ftc_sharded_wrapper_new( manager, &wrapper, &caches );
+    if ( error )
+      return error;
+
+    for ( nn = 0; nn < manager->num_shards; nn++ )
+    {
+      error = FTC_SBitCache_New( manager->shards[nn].manager,
+                                 (FTC_SBitCache*)&caches[nn] );
+      if ( error )
+        return error;
+    }
+
+    *acache = (FTC_ShardedSBitCache)wrapper;
+    return FT_Err_Ok;
+  }
+
+
+  /* documentation is in ftcache.h */
+
+  FT_EXPORT_DEF( FT_Error )
+  FTC_ShardedSBitCache_Lookup( FTC_ShardedSBitCache  cache,
+                               FTC_ImageType         type,
+                               FT_UInt               gindex,
+                               FTC_SBit             *sbit,
+                               FTC_Node             *anode )
+  {
+    FT_Error            error;
+    FTC_ShardedManager  manager;
+    FT_UInt             idx;
+    FTC_Shard           shard;
+
+
+    if ( !sbit || !anode || !type )
+      return FT_THROW( Invalid_Argument );
+
+    *sbit  = NULL;
+    *anode = NULL;
+
+    if ( !cache )
+      return FT_THROW( Invalid_Cache_Handle );
+
+    manager = cache->manager;
+    idx     = ftc_shard_index( manager, type->face_id );
+    shard   = manager->shards + idx;
+
+    FTC_SHARD_LOCK( &shard->lock );
+    error = FTC_SBitCache_Lookup( cache->caches[idx],
+                                  type,
+                                  gindex,
+                                  sbit,
+                                  anode );
+    ftc_shard_done( manager, idx );
+
+    return error;
+  }
+
+
+/* END */
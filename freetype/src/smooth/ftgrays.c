@@ -350,6 +350,19 @@ typedef ptrdiff_t  FT_PtrDist;
 #endif
 
 
+  /* On x86 with SSE2 (always available on x86_64), glyphs rendered     */
+  /* into a bitmap whose cells fit in the render pool as dense rows are */
+  /* accumulated into these rows instead of sorted cell lists, then     */
+  /* swept with a vectorized prefix sum.  Define FT_GRAY_NO_SIMD to     */
+  /* disable this.                                                      */
+#if !defined( FT_GRAY_NO_SIMD )                                       && \
+    ( defined( __SSE2__ ) || defined( _M_X64 ) || defined( _M_AMD64 ) || \
+      ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#define GRAY_DENSE_SSE2
+#include <emmintrin.h>
+#endif
+
+
   /* Compute `dividend / divisor' and return both its quotient and     */
   /* remainder, cast to a specific type.  This macro also ensures that */
   /* the remainder is always positive.  We use the remainder to keep   */
@@ -460,6 +473,11 @@ typedef ptrdiff_t  FT_PtrDist;
     FT_PtrDist  max_cells;
     FT_PtrDist  num_cells;
 
+#ifdef GRAY_DENSE_SSE2
+    TArea*  dense;        /* dense rows, see `gray_sweep_dense' */
+    int     dense_pitch;
+#endif
+
     TPos    x,  y;
 
     FT_Outline  outline;
@@ -527,6 +545,21 @@ typedef ptrdiff_t  FT_PtrDist;
     TCoord  x = ras.ex;
 
 
+#ifdef GRAY_DENSE_SSE2
+    if ( ras.dense )
+    {
+      /* the area is added back one pixel to the right, so that a plain */
+      /* prefix sum of the row gives the same values as `gray_sweep'    */
+      TArea*  p = ras.dense + ( ras.ey - ras.min_ey ) * ras.dense_pitch +
+                    ( x - ras.min_ex + 1 );
+
+
+      p[0] += (TArea)ras.cover * ( ONE_PIXEL * 2 ) - ras.area;
+      p[1] += ras.area;
+      return;
+    }
+#endif
+
     pcell = &ras.ycells[ras.ey - ras.min_ey];
     for (;;)
     {
@@ -1328,6 +1361,104 @@ typedef ptrdiff_t  FT_PtrDist;
   }
 
 
+#ifdef GRAY_DENSE_SSE2
+
+  /* The same as `gray_sweep' for glyphs accumulated into dense rows by */
+  /* `gray_record_cell'.  Column 0 of a row holds the cells left of the */
+  /* clip box, and columns 1 to `width' the pixels.  Eight pixels are   */
+  /* summed up and mapped to gray levels at a time.  Like `gray_hline', */
+  /* this only writes the pixels whose accumulated area is not zero, so */
+  /* that the output is also the same in bitmaps that are not cleared.  */
+
+  static void
+  gray_sweep_dense( RAS_ARG )
+  {
+    TCoord  width    = ras.max_ex - ras.min_ex;
+    int     even_odd = ras.outline.flags & FT_OUTLINE_EVEN_ODD_FILL;
+    int     y;
+
+    const __m128i  zero  = _mm_setzero_si128();
+    const __m128i  limit = _mm_set1_epi16( even_odd ? 511 : 255 );
+    const __m128i  m511  = _mm_set1_epi32( even_odd ? 511 : -1 );
+
+
+    for ( y = ras.min_ey; y < ras.max_ey; y++ )
+    {
+      const TArea*    row = ras.dense + ( y - ras.min_ey ) * ras.dense_pitch;
+      unsigned char*  q   = ras.target.origin - ras.target.pitch * y +
+                              ras.min_ex;
+      __m128i         carry = _mm_set1_epi32( row[0] );
+      TCoord          x;
+
+
+      for ( x = 0; x < width; x += 8 )
+      {
+        __m128i  v0 = _mm_loadu_si128( (const __m128i*)( row + x + 1 ) );
+        __m128i  v1 = _mm_loadu_si128( (const __m128i*)( row + x + 5 ) );
+        __m128i  c0, c1, g, skip;
+        int      mask;
+
+
+        /* prefix sums, carried over from the previous pixels */
+        v0 = _mm_add_epi32( v0, _mm_slli_si128( v0, 4 ) );
+        v1 = _mm_add_epi32( v1, _mm_slli_si128( v1, 4 ) );
+        v0 = _mm_add_epi32( v0, _mm_slli_si128( v0, 8 ) );
+        v1 = _mm_add_epi32( v1, _mm_slli_si128( v1, 8 ) );
+        v0 = _mm_add_epi32( v0, carry );
+        v1 = _mm_add_epi32( v1, _mm_shuffle_epi32( v0, 0xFF ) );
+        carry = _mm_shuffle_epi32( v1, 0xFF );
+
+        skip = _mm_packs_epi32( _mm_cmpeq_epi32( v0, zero ),
+                                _mm_cmpeq_epi32( v1, zero ) );
+        skip = _mm_packs_epi16( skip, skip );
+        mask = _mm_movemask_epi8( skip ) & 0xFF;
+        if ( mask == 0xFF )
+          continue;
+
+        /* the scaling and fill rules of `gray_hline' */
+        c0 = _mm_srai_epi32( v0, PIXEL_BITS * 2 + 1 - 8 );
+        c1 = _mm_srai_epi32( v1, PIXEL_BITS * 2 + 1 - 8 );
+        c0 = _mm_xor_si128( c0, _mm_srai_epi32( c0, 31 ) );
+        c1 = _mm_xor_si128( c1, _mm_srai_epi32( c1, 31 ) );
+        c0 = _mm_and_si128( c0, m511 );
+        c1 = _mm_and_si128( c1, m511 );
+        g  = _mm_packs_epi32( c0, c1 );
+        if ( even_odd )
+          g = _mm_min_epi16( g, _mm_sub_epi16( limit, g ) );
+        else
+          g = _mm_min_epi16( g, limit );
+        g = _mm_packus_epi16( g, g );
+
+        if ( width - x >= 8 )
+        {
+          if ( mask )
+          {
+            __m128i  old = _mm_loadl_epi64( (const __m128i*)( q + x ) );
+
+
+            g = _mm_or_si128( _mm_and_si128( skip, old ),
+                              _mm_andnot_si128( skip, g ) );
+          }
+          _mm_storel_epi64( (__m128i*)( q + x ), g );
+        }
+        else
+        {
+          unsigned char  gray[16];
+          TCoord         i;
+
+
+          _mm_storeu_si128( (__m128i*)gray, g );
+          for ( i = 0; i < width - x; i++ )
+            if ( !( mask & ( 1 << i ) ) )
+              q[x + i] = gray[i];
+        }
+      }
+    }
+  }
+
+#endif /* GRAY_DENSE_SSE2 */
+
+
 #ifdef STANDALONE_
 
   /*************************************************************************/
@@ -1752,6 +1883,34 @@ typedef ptrdiff_t  FT_PtrDist;
     TCoord*  band;
 
 
+#ifdef GRAY_DENSE_SSE2
+    /* rows padded for the eight pixel steps of `gray_sweep_dense' */
+    ras.dense_pitch = ( ( xMax - xMin + 7 ) & ~7 ) + 8;
+    ras.dense       = NULL;
+
+    if ( !ras.render_span                                             &&
+         height * (size_t)ras.dense_pitch <=
+           FT_MAX_GRAY_POOL * sizeof ( TCell ) / sizeof ( TArea )     )
+    {
+      int  error;
+
+
+      ras.dense     = (TArea*)buffer;
+      ras.num_cells = 0;
+      ras.invalid   = 1;
+      FT_MEM_ZERO( ras.dense,
+                   height * (size_t)ras.dense_pitch * sizeof ( TArea ) );
+
+      /* the rows cannot overflow, unlike the cells */
+      error = gray_convert_glyph_inner( RAS_VAR );
+      if ( error )
+        return 1;
+
+      gray_sweep_dense( RAS_VAR );
+      return 0;
+    }
+#endif
+
     /* set up vertical bands */
     if ( height > n )
     {
@@ -0,0 +1,309 @@
+/***************************************************************************/
+/*                                                                         */
+/*  ftgraybench.c                                                          */
+/*                                                                         */
+/*    Glyph rasterization benchmark for the smooth rasterizer.             */
+/*                                                                         */
+/*  Copyright 2000-2018 by                                                 */
+/*  David Turner, Robert Wilhelm, and Werner Lemberg.                      */
+/*                                                                         */
+/*  This file is part of the FreeType project, and may only be used,       */
+/*  modified, and distributed under the terms of the FreeType project      */
+/*  license, LICENSE.TXT.  By continuing to use, modify, or distribute     */
+/*  this file you indicate that you have read the license and              */
+/*  understand and accept it fully.                                        */
+/*                                                                         */
+/***************************************************************************/
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* Usage: ftgraybench [-n rounds] [-g max_glyphs] font ...               */
+  /*                                                                       */
+  /* The outlines of the first `max_glyphs' glyphs (256 by default) of     */
+  /* every given font are loaded, unhinted, at sizes from 8 to 72 pixels.  */
+  /* Each size is then rendered `rounds' times (20 by default) into 8-bit  */
+  /* gray bitmaps with FT_Outline_Get_Bitmap, as FT_Render_Glyph does, and  */
+  /* the glyph and pixel rates are printed, along with a checksum of the   */
+  /* bitmaps so that builds can be checked to render identically.  Only   */
+  /* the rasterization is timed.  The bitmaps are cleared before every     */
+  /* rendering, as FT_Render_Glyph clears them.                            */
+  /*                                                                       */
+  /*************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_OUTLINE_H
+
+
+  static const FT_UInt  sizes[] = { 8, 10, 12, 16, 24, 32, 48, 72 };
+
+
+  typedef struct  GlyphRec_
+  {
+    FT_Outline  outline;
+    FT_Bitmap   bitmap;
+
+  } GlyphRec, *Glyph;
+
+
+  static double
+  now( void )
+  {
+    struct timespec  ts;
+
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+  }
+
+
+  /* load the outlines of up to `max_glyphs' glyphs of every face at */
+  /* `pixels', moved to the origin of a bitmap of their size         */
+  static FT_Error
+  load_glyphs( FT_Library  library,
+               FT_Face*    faces,
+               int         num_faces,
+               FT_UInt     max_glyphs,
+               FT_UInt     pixels,
+               Glyph       glyphs,
+               int*        num_glyphs )
+  {
+    FT_Error  error;
+    int       nn, count = 0;
+
+
+    for ( nn = 0; nn < num_faces; nn++ )
+    {
+      FT_Face  face = faces[nn];
+      FT_UInt  gindex;
+
+
+      error = FT_Set_Pixel_Sizes( face, pixels, pixels );
+      if ( error )
+        return error;
+
+      for ( gindex = 0;
+            gindex < (FT_UInt)face->num_glyphs && gindex < max_glyphs;
+            gindex++ )
+      {
+        FT_Outline*  outline = &face->glyph->outline;
+        Glyph        glyph   = glyphs + count;
+        FT_BBox      cbox;
+
+
+        if ( FT_Load_Glyph( face, gindex,
+                            FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING ) ||
+             face->glyph->format != FT_GLYPH_FORMAT_OUTLINE       ||
+             outline->n_points == 0                               )
+          continue;
+
+        error = FT_Outline_New( library,
+                                (FT_UInt)outline->n_points,
+                                outline->n_contours,
+                                &glyph->outline );
+        if ( error )
+          return error;
+        FT_Outline_Copy( outline, &glyph->outline );
+
+        FT_Outline_Get_CBox( &glyph->outline, &cbox );
+        cbox.xMin &= -64;
+        cbox.yMin &= -64;
+        cbox.xMax  = ( cbox.xMax + 63 ) & -64;
+        cbox.yMax  = ( cbox.yMax + 63 ) & -64;
+        FT_Outline_Translate( &glyph->outline, -cbox.xMin, -cbox.yMin );
+
+        glyph->bitmap.width      = (unsigned int)( cbox.xMax -
+                                                   cbox.xMin ) >> 6;
+        glyph->bitmap.rows       = (unsigned int)( cbox.yMax -
+                                                   cbox.yMin ) >> 6;
+        glyph->bitmap.pitch      = (int)glyph->bitmap.width;
+        glyph->bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+        glyph->bitmap.num_grays  = 256;
+        glyph->bitmap.buffer     = (unsigned char*)malloc(
+                                     glyph->bitmap.rows *
+                                       glyph->bitmap.width + 1 );
+        if ( !glyph->bitmap.buffer )
+        {
+          FT_Outline_Done( library, &glyph->outline );
+          return FT_Err_Out_Of_Memory;
+        }
+
+        count++;
+      }
+    }
+
+    *num_glyphs = count;
+
+    return FT_Err_Ok;
+  }
+
+
+  static void
+  free_glyphs( FT_Library  library,
+               Glyph       glyphs,
+               int         num_glyphs )
+  {
+    int  nn;
+
+
+    for ( nn = 0; nn < num_glyphs; nn++ )
+    {
+      FT_Outline_Done( library, &glyphs[nn].outline );
+      free( glyphs[nn].bitmap.buffer );
+    }
+  }
+
+
+  /* render all glyphs `rounds' times and print the rates */
+  static int
+  run( FT_Library  library,
+       FT_UInt     pixels,
+       Glyph       glyphs,
+       int         num_glyphs,
+       int         rounds )
+  {
+    unsigned long  errors   = 0;
+    unsigned long  checksum = 0;
+    double         pixel_count = 0;
+    double         start, elapsed;
+    int            rr, nn;
+
+
+    start = now();
+    for ( rr = 0; rr < rounds; rr++ )
+      for ( nn = 0; nn < num_glyphs; nn++ )
+      {
+        FT_Bitmap*  bitmap = &glyphs[nn].bitmap;
+
+
+        memset( bitmap->buffer, 0, bitmap->rows * bitmap->width );
+        if ( FT_Outline_Get_Bitmap( library, &glyphs[nn].outline, bitmap ) )
+          errors++;
+      }
+    elapsed = now() - start;
+
+    for ( nn = 0; nn < num_glyphs; nn++ )
+    {
+      const FT_Bitmap*  bitmap = &glyphs[nn].bitmap;
+      unsigned int      ii;
+
+
+      for ( ii = 0; ii < bitmap->rows * bitmap->width; ii++ )
+        checksum = checksum * 31 + bitmap->buffer[ii];
+      pixel_count += bitmap->rows * bitmap->width;
+    }
+
+    printf( "%2upx: %9.0f glyphs/s %8.1f Mpixels/s  (%08lx)\n",
+            pixels,
+            num_glyphs * rounds / elapsed,
+            pixel_count * rounds / elapsed / 1e6,
+            checksum & 0xFFFFFFFFUL );
+
+    if ( errors )
+    {
+      fprintf( stderr, "%lu renderings failed\n", errors );
+      return 1;
+    }
+
+    return 0;
+  }
+
+
+  int
+  main( int     argc,
+        char**  argv )
+  {
+    FT_Library  library;
+    FT_Face*    faces;
+    Glyph       glyphs;
+    int         num_faces;
+    int         rounds     = 20;
+    FT_UInt     max_glyphs = 256;
+    int         status     = 0;
+    int         nn;
+    size_t      ss;
+
+
+    for ( nn = 1; nn + 1 < argc && argv[nn][0] == '-'; nn += 2 )
+    {
+      if ( !strcmp( argv[nn], "-n" ) )
+        rounds = atoi( argv[nn + 1] );
+      else if ( !strcmp( argv[nn], "-g" ) )
+        max_glyphs = (FT_UInt)atoi( argv[nn + 1] );
+      else
+        break;
+    }
+
+    if ( nn >= argc || argv[nn][0] == '-' || rounds < 1 || !max_glyphs )
+    {
+      fprintf( stderr,
+               "usage: %s [-n rounds] [-g max_glyphs] font ...\n",
+               argv[0] );
+      return 2;
+    }
+
+    if ( FT_Init_FreeType( &library ) )
+    {
+      fprintf( stderr, "can't initialize FreeType\n" );
+      return 1;
+    }
+
+    num_faces = argc - nn;
+    faces     = (FT_Face*)calloc( (size_t)num_faces, sizeof ( FT_Face ) );
+    glyphs    = (Glyph)calloc( (size_t)num_faces * max_glyphs,
+                               sizeof ( GlyphRec ) );
+    if ( !faces || !glyphs )
+    {
+      fprintf( stderr, "out of memory\n" );
+      return 1;
+    }
+
+    for ( nn = 0; nn < num_faces; nn++ )
+    {
+      if ( FT_New_Face( library, argv[argc - num_faces + nn], 0,
+                        &faces[nn] ) )
+      {
+        fprintf( stderr, "can't open `%s'\n", argv[argc - num_faces + nn] );
+        return 1;
+      }
+    }
+
+    printf( "%d fonts, up to %u glyphs each, %d rounds\n",
+            num_faces, max_glyphs, rounds );
+
+    for ( ss = 0; ss < sizeof ( sizes ) / sizeof ( sizes[0] ); ss++ )
+    {
+      int  num_glyphs = 0;
+
+
+      if ( load_glyphs( library, faces, num_faces, max_glyphs, sizes[ss],
+                        glyphs, &num_glyphs ) )
+      {
+        fprintf( stderr, "can't load the glyphs at %upx\n", sizes[ss] );
+        status = 1;
+        break;
+      }
+
+      status |= run( library, sizes[ss], glyphs, num_glyphs, rounds );
+      free_glyphs( library, glyphs, num_glyphs );
+    }
+
+    for ( nn = 0; nn < num_faces; nn++ )
+      FT_Done_Face( faces[nn] );
+    free( glyphs );
+    free( faces );
+    FT_Done_FreeType( library );
+
+    return status;
+  }
+
+
+/* END */
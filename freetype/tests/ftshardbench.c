@@ -0,0 +1,319 @@
+/***************************************************************************/
+/*                                                                         */
+/*  ftshardbench.c                                                         */
+/*                                                                         */
+/*    Multi-threaded lookup benchmark for the sharded cache manager.       */
+/*                                                                         */
+/*  Copyright 2000-2018 by                                                 */
+/*  David Turner, Robert Wilhelm, and Werner Lemberg.                      */
+/*                                                                         */
+/*  This file is part of the FreeType project, and may only be used,       */
+/*  modified, and distributed under the terms of the FreeType project      */
+/*  license, LICENSE.TXT.  By continuing to use, modify, or distribute     */
+/*  this file you indicate that you have read the license and              */
+/*  understand and accept it fully.                                        */
+/*                                                                         */
+/***************************************************************************/
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* Usage: ftshardbench [-t threads] [-s shards] [-n lookups]             */
+  /*                     [-b max_bytes] font ...                           */
+  /*                                                                       */
+  /* Every thread looks up small bitmaps for random glyphs among the first */
+  /* 128 of the given fonts at random sizes from 8 to 24 pixels, through   */
+  /* one shared FTC_ShardedManager with a budget of `max_bytes' (16MB by   */
+  /* default, enough to keep everything cached for a few fonts).  The run  */
+  /* is repeated with a single shard and with the requested number of      */
+  /* shards, each with one thread and with all threads, and the lookup     */
+  /* rate of each run is printed.  Every glyph is looked up once before    */
+  /* the clock starts, so with the default budget only hits are timed.     */
+  /*                                                                       */
+  /*************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_CACHE_H
+
+
+#define MAX_THREADS  64
+#define MAX_GLYPHS  128
+#define MIN_PIXELS    8
+#define MAX_PIXELS   24
+
+
+  typedef struct  BenchRec_
+  {
+    FTC_ShardedManager    manager;
+    FTC_ShardedSBitCache  cache;
+    int                   num_fonts;
+    FT_UInt*              num_glyphs;
+    unsigned long         lookups;
+
+  } BenchRec, *Bench;
+
+
+  typedef struct  WorkerRec_
+  {
+    Bench          bench;
+    pthread_t      thread;
+    unsigned int   seed;
+    unsigned long  errors;
+
+  } WorkerRec, *Worker;
+
+
+  static char**  font_paths;
+
+
+  static FT_Error
+  face_requester( FTC_FaceID  face_id,
+                  FT_Library  library,
+                  FT_Pointer  req_data,
+                  FT_Face*    aface )
+  {
+    (void)req_data;
+
+    return FT_New_Face( library,
+                        font_paths[(FT_PtrDist)face_id - 1],
+                        0,
+                        aface );
+  }
+
+
+  static double
+  now( void )
+  {
+    struct timespec  ts;
+
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+  }
+
+
+  static void*
+  worker_run( void*  arg )
+  {
+    Worker         worker = (Worker)arg;
+    Bench          bench  = worker->bench;
+    unsigned long  nn;
+
+
+    for ( nn = 0; nn < bench->lookups; nn++ )
+    {
+      FTC_ImageTypeRec  type;
+      FTC_SBit          sbit;
+      FTC_Node          node;
+      int               font = rand_r( &worker->seed ) % bench->num_fonts;
+
+
+      type.face_id = (FTC_FaceID)(FT_PtrDist)( font + 1 );
+      type.width   = MIN_PIXELS +
+                     rand_r( &worker->seed ) % ( MAX_PIXELS - MIN_PIXELS + 1 );
+      type.height  = type.width;
+      type.flags   = FT_LOAD_DEFAULT | FT_LOAD_RENDER;
+
+      if ( FTC_ShardedSBitCache_Lookup(
+             bench->cache,
+             &type,
+             rand_r( &worker->seed ) % bench->num_glyphs[font],
+             &sbit,
+             &node ) )
+      {
+        worker->errors++;
+        continue;
+      }
+
+      FTC_ShardedManager_UnrefNode( bench->manager, type.face_id, node );
+    }
+
+    return NULL;
+  }
+
+
+  /* look up every glyph once */
+  static unsigned long
+  warm_up( Bench  bench )
+  {
+    unsigned long  errors = 0;
+    int            font;
+    FT_UInt        pixels, gindex;
+
+
+    for ( font = 0; font < bench->num_fonts; font++ )
+      for ( pixels = MIN_PIXELS; pixels <= MAX_PIXELS; pixels++ )
+        for ( gindex = 0; gindex < bench->num_glyphs[font]; gindex++ )
+        {
+          FTC_ImageTypeRec  type;
+          FTC_SBit          sbit;
+          FTC_Node          node;
+
+
+          type.face_id = (FTC_FaceID)(FT_PtrDist)( font + 1 );
+          type.width   = pixels;
+          type.height  = pixels;
+          type.flags   = FT_LOAD_DEFAULT | FT_LOAD_RENDER;
+
+          if ( FTC_ShardedSBitCache_Lookup( bench->cache, &type, gindex,
+                                            &sbit, &node ) )
+            errors++;
+          else
+            FTC_ShardedManager_UnrefNode( bench->manager,
+                                          type.face_id,
+                                          node );
+        }
+
+    return errors;
+  }
+
+
+  /* time `num_threads' threads doing `lookups' lookups each */
+  static int
+  run( FT_Library     library,
+       Bench          bench,
+       FT_UInt        num_shards,
+       int            num_threads,
+       unsigned long  max_bytes )
+  {
+    WorkerRec      workers[MAX_THREADS];
+    unsigned long  errors = 0;
+    double         start, elapsed;
+    int            nn;
+
+
+    if ( FTC_ShardedManager_New( library, num_shards, 0, 0, max_bytes,
+                                 face_requester, NULL, &bench->manager ) ||
+         FTC_ShardedSBitCache_New( bench->manager, &bench->cache )       )
+    {
+      fprintf( stderr, "can't create the cache\n" );
+      return 1;
+    }
+
+    errors = warm_up( bench );
+
+    start = now();
+    for ( nn = 0; nn < num_threads; nn++ )
+    {
+      workers[nn].bench  = bench;
+      workers[nn].seed   = 1 + (unsigned int)nn;
+      workers[nn].errors = 0;
+      pthread_create( &workers[nn].thread, NULL, worker_run, workers + nn );
+    }
+    for ( nn = 0; nn < num_threads; nn++ )
+    {
+      pthread_join( workers[nn].thread, NULL );
+      errors += workers[nn].errors;
+    }
+    elapsed = now() - start;
+
+    FTC_ShardedManager_Done( bench->manager );
+
+    printf( "%2u shard%s, %2d thread%s: %8.0f lookups/s per thread,"
+            " %9.0f lookups/s total\n",
+            num_shards, num_shards == 1 ? " " : "s",
+            num_threads, num_threads == 1 ? " " : "s",
+            bench->lookups / elapsed,
+            bench->lookups * num_threads / elapsed );
+
+    if ( errors )
+    {
+      fprintf( stderr, "%lu lookups failed\n", errors );
+      return 1;
+    }
+
+    return 0;
+  }
+
+
+  int
+  main( int     argc,
+        char**  argv )
+  {
+    FT_Library     library;
+    BenchRec       bench;
+    int            num_threads = 4;
+    FT_UInt        num_shards  = 8;
+    unsigned long  max_bytes   = 16 * 1024 * 1024;
+    int            status      = 0;
+    int            nn;
+
+
+    bench.lookups = 1000000;
+
+    for ( nn = 1; nn + 1 < argc && argv[nn][0] == '-'; nn += 2 )
+    {
+      if ( !strcmp( argv[nn], "-t" ) )
+        num_threads = atoi( argv[nn + 1] );
+      else if ( !strcmp( argv[nn], "-s" ) )
+        num_shards = (FT_UInt)atoi( argv[nn + 1] );
+      else if ( !strcmp( argv[nn], "-n" ) )
+        bench.lookups = strtoul( argv[nn + 1], NULL, 10 );
+      else if ( !strcmp( argv[nn], "-b" ) )
+        max_bytes = strtoul( argv[nn + 1], NULL, 10 );
+      else
+        break;
+    }
+
+    if ( nn >= argc || argv[nn][0] == '-'                   ||
+         num_threads < 1 || num_threads > MAX_THREADS || !num_shards )
+    {
+      fprintf( stderr,
+               "usage: %s [-t threads] [-s shards] [-n lookups]"
+               " [-b max_bytes] font ...\n",
+               argv[0] );
+      return 2;
+    }
+
+    if ( FT_Init_FreeType( &library ) )
+    {
+      fprintf( stderr, "can't initialize FreeType\n" );
+      return 1;
+    }
+
+    font_paths       = argv + nn;
+    bench.num_fonts  = argc - nn;
+    bench.num_glyphs = (FT_UInt*)calloc( (size_t)bench.num_fonts,
+                                         sizeof ( FT_UInt ) );
+
+    for ( nn = 0; nn < bench.num_fonts; nn++ )
+    {
+      FT_Face  face;
+
+
+      if ( FT_New_Face( library, font_paths[nn], 0, &face ) )
+      {
+        fprintf( stderr, "can't open `%s'\n", font_paths[nn] );
+        return 1;
+      }
+      bench.num_glyphs[nn] = face->num_glyphs < MAX_GLYPHS
+                               ? (FT_UInt)face->num_glyphs
+                               : MAX_GLYPHS;
+      FT_Done_Face( face );
+    }
+
+    printf( "%d fonts, %lu lookups per thread\n",
+            bench.num_fonts, bench.lookups );
+
+    status |= run( library, &bench, 1, 1, max_bytes );
+    status |= run( library, &bench, 1, num_threads, max_bytes );
+    status |= run( library, &bench, num_shards, 1, max_bytes );
+    status |= run( library, &bench, num_shards, num_threads, max_bytes );
+
+    free( bench.num_glyphs );
+    FT_Done_FreeType( library );
+
+    return status;
+  }
+
+
+/* END */
@@ -202,6 +202,9 @@ struct draw_context
          struct draw_pt_front_end *vsplit;
       } front;
 
+      /** Threads for the general middle end, NULL if there are none */
+      struct pt_threads *threads;
+
       struct pipe_vertex_buffer vertex_buffer[PIPE_MAX_ATTRIBS];
       unsigned nr_vertex_buffers;
 
@@ -203,6 +203,10 @@ draw_pt_init(struct draw_context *draw)
       draw->pt.middle.llvm = draw_pt_fetch_pipeline_or_emit_llvm(draw);
 #endif
 
+   /* Not having any is fine, the vertices are then processed serially */
+   if (!draw->llvm)
+      draw->pt.threads = draw_pt_threads_create(draw);
+
    return TRUE;
 }
 
@@ -210,6 +214,11 @@ draw_pt_init(struct draw_context *draw)
 void
 draw_pt_destroy(struct draw_context *draw)
 {
+   if (draw->pt.threads) {
+      draw_pt_threads_destroy(draw->pt.threads);
+      draw->pt.threads = NULL;
+   }
+
    if (draw->pt.middle.llvm) {
       draw->pt.middle.llvm->destroy(draw->pt.middle.llvm);
       draw->pt.middle.llvm = NULL;
@@ -39,6 +39,8 @@ struct draw_pt_middle_end;
 struct draw_context;
 struct draw_prim_info;
 struct draw_vertex_info;
+struct draw_fetch_info;
+struct tgsi_token;
 
 
 #define PT_SHADE      0x1
@@ -259,6 +261,40 @@ void
 draw_pt_post_vs_destroy(struct pt_post_vs *pvs);
 
 
+/*******************************************************************************
+ * Fetch, vertex shading and cliptest on several threads:
+ */
+struct pt_threads;
+
+struct pt_threads *
+draw_pt_threads_create(struct draw_context *draw);
+
+void
+draw_pt_threads_destroy(struct pt_threads *threads);
+
+void
+draw_pt_threads_prepare(struct pt_threads *threads,
+                        unsigned vertex_input_count,
+                        unsigned vertex_size,
+                        unsigned instance_id_index);
+
+boolean
+draw_pt_threads_can_run(const struct pt_threads *threads, unsigned count);
+
+boolean
+draw_pt_threads_run(struct pt_threads *threads,
+                    const struct draw_fetch_info *fetch_info,
+                    const struct draw_prim_info *prim_info,
+                    struct pt_post_vs *post_vs,
+                    struct vertex_header *fetched,
+                    struct vertex_header *shaded,
+                    unsigned vertex_size);
+
+void
+draw_pt_threads_unbind_shader(struct pt_threads *threads,
+                              const struct tgsi_token *tokens);
+
+
 /*******************************************************************************
  * Utils:
  */
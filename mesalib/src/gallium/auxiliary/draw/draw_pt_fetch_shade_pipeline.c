@@ -136,6 +136,13 @@ fetch_pipeline_prepare(struct draw_pt_middle_end *middle,
     */
    vs->prepare(vs, draw);
 
+   if (draw->pt.threads && (opt & PT_SHADE)) {
+      draw_pt_threads_prepare(draw->pt.threads,
+                              vs->info.num_inputs,
+                              fpme->vertex_size,
+                              instance_id_index);
+   }
+
    /* Make sure that the vertex size didn't change at any point above */
    assert(nr_vs_outputs == draw_total_vs_outputs(draw));
 }
@@ -219,6 +226,26 @@ draw_vertex_shader_run(struct draw_vertex_shader *vshader,
 }
 
 
+/**
+ * Whether the vertices can be clip tested right after the vertex shader,
+ * which is what the threads do, rather than after the stages which may
+ * still need them in clip space.  The viewport index is tracked from the
+ * first vertex of each primitive, which the threads' ranges need not
+ * start with.
+ */
+static boolean
+can_cliptest_after_vs(struct draw_context *draw,
+                      const struct draw_vertex_info *vert_info,
+                      const struct draw_prim_info *prim_info)
+{
+   return !draw->gs.geometry_shader &&
+          !draw->so.num_targets &&
+          !draw_prim_assembler_is_required(draw, prim_info, vert_info) &&
+          !draw_current_shader_uses_viewport_index(draw) &&
+          draw_current_shader_position_output(draw) != -1;
+}
+
+
 static void
 fetch_pipeline_generic(struct draw_pt_middle_end *middle,
                        const struct draw_fetch_info *fetch_info,
@@ -237,6 +264,8 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
    struct draw_vertex_info ia_vert_info;
    const struct draw_prim_info *prim_info = in_prim_info;
    boolean free_prim_info = FALSE;
+   boolean cliptested = FALSE;
+   boolean need_pipeline = FALSE;
    unsigned opt = fpme->opt;
    int num_vertex_streams = 1;
 
@@ -258,17 +287,48 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
       draw->statistics.vs_invocations += fetch_info->count;
    }
 
-   /* Fetch into our vertex buffer.
+   vert_info = &fetched_vert_info;
+
+   /* Fetch, shade and maybe clip test large runs on several threads,
+    * each into its part of the same buffers as below.
     */
-   fetch(fpme->fetch, fetch_info, (char *)fetched_vert_info.verts);
+   if ((fpme->opt & PT_SHADE) &&
+       draw_pt_threads_can_run(draw->pt.threads, fetch_info->count)) {
+      struct pt_post_vs *post_vs =
+         can_cliptest_after_vs(draw, vert_info, prim_info) ?
+            fpme->post_vs : NULL;
+
+      vs_vert_info = fetched_vert_info;
+      vs_vert_info.verts =
+         (struct vertex_header *)MALLOC(fpme->vertex_size *
+                                        align(fetch_info->count, 4) +
+                                        DRAW_EXTRA_VERTICES_PADDING);
+      if (!vs_vert_info.verts) {
+         FREE(fetched_vert_info.verts);
+         return;
+      }
 
-   vert_info = &fetched_vert_info;
+      need_pipeline = draw_pt_threads_run(draw->pt.threads,
+                                          fetch_info, prim_info, post_vs,
+                                          fetched_vert_info.verts,
+                                          vs_vert_info.verts,
+                                          fpme->vertex_size);
+      cliptested = post_vs != NULL;
+
+      FREE(vert_info->verts);
+      vert_info = &vs_vert_info;
+   }
+   else {
+      /* Fetch into our vertex buffer.
+       */
+      fetch(fpme->fetch, fetch_info, (char *)fetched_vert_info.verts);
+   }
 
    /* Run the shader, note that this overwrites the data[] parts of
     * the pipeline verts.
     * Need fetch info to get vertex id correct.
     */
-   if (fpme->opt & PT_SHADE) {
+   if ((fpme->opt & PT_SHADE) && vert_info == &fetched_vert_info) {
       draw_vertex_shader_run(vshader,
                              draw->pt.user.vs_constants,
                              draw->pt.user.vs_constants_size,
@@ -346,7 +406,10 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
     * will try to access non-existent position output.
     */
    if (draw_current_shader_position_output(draw) != -1) {
-      if (draw_pt_post_vs_run(fpme->post_vs, vert_info, prim_info)) {
+      if (!cliptested)
+         need_pipeline = draw_pt_post_vs_run(fpme->post_vs, vert_info,
+                                             prim_info);
+      if (need_pipeline) {
          opt |= PT_PIPELINE;
       }
 
@@ -0,0 +1,409 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Vertex fetch, shading and clip testing on several threads.
+ *
+ * The general middle end (draw_pt_fetch_shade_pipeline.c) hands large
+ * runs of vertices to draw_pt_threads_run(), which splits them into
+ * contiguous ranges, one per thread.  Every thread fetches its range
+ * with its own translate objects, shades it with its own TGSI machine
+ * and, if asked to, clip tests it, writing straight into the buffers of
+ * the middle end.  The vertices thus end up just where a single thread
+ * would have put them, and primitive assembly and everything after it
+ * runs on the calling thread in submission order as before.
+ *
+ * Thread 0 is the calling thread and shades with the draw context's own
+ * machine.  Vertex shaders that access samplers, images, buffers or
+ * shared memory always run on the calling thread only, as the driver's
+ * callbacks for those needn't be thread safe.
+ *
+ * This is only used with the TGSI interpreter; llvm builds its own
+ * vertex fetch and shader and doesn't use the general middle end.
+ */
+
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_thread.h"
+#include "os/os_thread.h"
+#include "tgsi/tgsi_exec.h"
+
+#include "draw/draw_context.h"
+#include "draw/draw_private.h"
+#include "draw/draw_pt.h"
+#include "draw/draw_vs.h"
+
+
+#define DRAW_PT_MAX_THREADS 8
+
+/** Fewest vertices worth handing to a thread */
+#define DRAW_PT_THREADS_MIN_VERTICES 256
+
+
+struct pt_thread {
+   struct pt_threads *threads;
+   unsigned index;
+
+   thrd_t thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+
+   struct pt_fetch *fetch;
+   /** The draw context's own for thread 0 */
+   struct tgsi_exec_machine *machine;
+
+   /** The vertices of the job this thread does */
+   unsigned first, count;
+   boolean need_pipeline;
+};
+
+
+struct pt_threads {
+   struct draw_context *draw;
+
+   unsigned num_threads;         /**< including the calling thread */
+   boolean exit_flag;
+   struct pt_thread threads[DRAW_PT_MAX_THREADS];
+
+   /** Whether the bound vertex shader may run on other threads */
+   boolean shader_is_thread_safe;
+
+   /* The job */
+   const struct draw_fetch_info *fetch_info;
+   const struct draw_prim_info *prim_info;
+   struct pt_post_vs *post_vs;   /**< NULL if not clip testing */
+   char *fetched;
+   char *shaded;
+   unsigned vertex_size;
+};
+
+
+static void
+run_range(struct pt_thread *thread)
+{
+   struct pt_threads *threads = thread->threads;
+   struct draw_context *draw = threads->draw;
+   struct draw_vertex_shader *vs = draw->vs.vertex_shader;
+   const struct draw_fetch_info *fetch_info = threads->fetch_info;
+   const unsigned offset = thread->first * threads->vertex_size;
+   struct vertex_header *fetched =
+      (struct vertex_header *)(threads->fetched + offset);
+   struct vertex_header *shaded =
+      (struct vertex_header *)(threads->shaded + offset);
+
+   if (fetch_info->linear) {
+      draw_pt_fetch_run_linear(thread->fetch,
+                               fetch_info->start + thread->first,
+                               thread->count, (char *)fetched);
+   }
+   else {
+      draw_pt_fetch_run(thread->fetch, fetch_info->elts + thread->first,
+                        thread->count, (char *)fetched);
+   }
+
+   draw_vs_exec_run_machine(vs, thread->machine,
+                            (const float (*)[4])fetched->data,
+                            (      float (*)[4])shaded->data,
+                            draw->pt.user.vs_constants,
+                            draw->pt.user.vs_constants_size,
+                            thread->count,
+                            threads->vertex_size,
+                            threads->vertex_size,
+                            fetch_info->elts ?
+                               fetch_info->elts + thread->first : NULL,
+                            thread->first);
+
+   if (threads->post_vs) {
+      struct draw_vertex_info vert_info;
+
+      vert_info.verts = shaded;
+      vert_info.vertex_size = threads->vertex_size;
+      vert_info.stride = threads->vertex_size;
+      vert_info.count = thread->count;
+
+      thread->need_pipeline = draw_pt_post_vs_run(threads->post_vs,
+                                                  &vert_info,
+                                                  threads->prim_info);
+   }
+}
+
+
+static int
+thread_function(void *init_data)
+{
+   struct pt_thread *thread = (struct pt_thread *) init_data;
+   struct pt_threads *threads = thread->threads;
+   char thread_name[16];
+
+   snprintf(thread_name, sizeof thread_name, "draw-%u", thread->index);
+   u_thread_setname(thread_name);
+
+   while (1) {
+      pipe_semaphore_wait(&thread->work_ready);
+
+      if (threads->exit_flag)
+         break;
+
+      run_range(thread);
+
+      pipe_semaphore_signal(&thread->work_done);
+   }
+
+   return 0;
+}
+
+
+static boolean
+vs_is_thread_safe(const struct tgsi_shader_info *info)
+{
+   return !info->file_count[TGSI_FILE_SAMPLER] &&
+          !info->file_count[TGSI_FILE_SAMPLER_VIEW] &&
+          !info->file_count[TGSI_FILE_IMAGE] &&
+          !info->file_count[TGSI_FILE_BUFFER] &&
+          !info->file_count[TGSI_FILE_MEMORY] &&
+          !info->file_count[TGSI_FILE_HW_ATOMIC];
+}
+
+
+/**
+ * Prepare the threads' vertex fetch the same way as the middle end's and
+ * bind the vertex shader to their machines.  Called after the shader was
+ * prepared, which binds it to the draw context's machine.
+ */
+void
+draw_pt_threads_prepare(struct pt_threads *threads,
+                        unsigned vertex_input_count,
+                        unsigned vertex_size,
+                        unsigned instance_id_index)
+{
+   struct draw_context *draw = threads->draw;
+   struct draw_vertex_shader *vs = draw->vs.vertex_shader;
+   unsigned i;
+
+   threads->shader_is_thread_safe = vs_is_thread_safe(&vs->info);
+   if (!threads->shader_is_thread_safe)
+      return;
+
+   threads->threads[0].machine = draw->vs.tgsi.machine;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct pt_thread *thread = &threads->threads[i];
+
+      draw_pt_fetch_prepare(thread->fetch, vertex_input_count,
+                            vertex_size, instance_id_index);
+
+      /* Avoid rebinding, which parses and compiles the shader again */
+      if (thread->machine->Tokens != vs->state.tokens) {
+         tgsi_exec_machine_bind_shader(thread->machine, vs->state.tokens,
+                                       draw->vs.tgsi.sampler,
+                                       draw->vs.tgsi.image,
+                                       draw->vs.tgsi.buffer);
+      }
+   }
+}
+
+
+/**
+ * Whether draw_pt_threads_run() would take count vertices.
+ */
+boolean
+draw_pt_threads_can_run(const struct pt_threads *threads, unsigned count)
+{
+   return threads && threads->shader_is_thread_safe &&
+          count >= 2 * DRAW_PT_THREADS_MIN_VERTICES;
+}
+
+
+/**
+ * Fetch the vertices of fetch_info into fetched, shade them into shaded,
+ * both with the middle end's vertex size as stride, and if post_vs isn't
+ * NULL clip test them too.
+ * \return whether any vertex needs the pipeline, if clip tested
+ */
+boolean
+draw_pt_threads_run(struct pt_threads *threads,
+                    const struct draw_fetch_info *fetch_info,
+                    const struct draw_prim_info *prim_info,
+                    struct pt_post_vs *post_vs,
+                    struct vertex_header *fetched,
+                    struct vertex_header *shaded,
+                    unsigned vertex_size)
+{
+   const unsigned count = fetch_info->count;
+   unsigned num_threads = MIN2(threads->num_threads,
+                               count / DRAW_PT_THREADS_MIN_VERTICES);
+   unsigned step, i;
+   boolean need_pipeline = FALSE;
+
+   assert(draw_pt_threads_can_run(threads, count));
+
+   step = DIV_ROUND_UP(count, num_threads);
+   num_threads = DIV_ROUND_UP(count, step);
+
+   threads->fetch_info = fetch_info;
+   threads->prim_info = prim_info;
+   threads->post_vs = post_vs;
+   threads->fetched = (char *)fetched;
+   threads->shaded = (char *)shaded;
+   threads->vertex_size = vertex_size;
+
+   for (i = 0; i < num_threads; i++) {
+      struct pt_thread *thread = &threads->threads[i];
+
+      thread->first = i * step;
+      thread->count = MIN2(step, count - thread->first);
+      thread->need_pipeline = FALSE;
+   }
+
+   for (i = 1; i < num_threads; i++)
+      pipe_semaphore_signal(&threads->threads[i].work_ready);
+
+   run_range(&threads->threads[0]);
+   need_pipeline = threads->threads[0].need_pipeline;
+
+   for (i = 1; i < num_threads; i++) {
+      pipe_semaphore_wait(&threads->threads[i].work_done);
+      need_pipeline |= threads->threads[i].need_pipeline;
+   }
+
+   return need_pipeline;
+}
+
+
+/**
+ * Unbind a vertex shader about to be deleted from the threads' machines.
+ */
+void
+draw_pt_threads_unbind_shader(struct pt_threads *threads,
+                              const struct tgsi_token *tokens)
+{
+   unsigned i;
+
+   if (!threads)
+      return;
+
+   for (i = 1; i < threads->num_threads; i++) {
+      struct tgsi_exec_machine *machine = threads->threads[i].machine;
+
+      if (machine->Tokens == tokens)
+         tgsi_exec_machine_bind_shader(machine, NULL, NULL, NULL, NULL);
+   }
+}
+
+
+static void
+fini_thread(struct pt_thread *thread)
+{
+   if (thread->fetch)
+      draw_pt_fetch_destroy(thread->fetch);
+   if (thread->index && thread->machine)
+      tgsi_exec_machine_destroy(thread->machine);
+}
+
+
+/**
+ * Start the threads, as many as DRAW_NUM_THREADS says including the
+ * calling one.  By default there is only the calling one.
+ * \return NULL if fewer than two threads could be started
+ */
+struct pt_threads *
+draw_pt_threads_create(struct draw_context *draw)
+{
+   struct pt_threads *threads;
+   unsigned num_threads, i;
+
+   num_threads = debug_get_num_option("DRAW_NUM_THREADS", 1);
+   num_threads = MIN2(num_threads, DRAW_PT_MAX_THREADS);
+   if (num_threads < 2)
+      return NULL;
+
+   threads = CALLOC_STRUCT(pt_threads);
+   if (!threads)
+      return NULL;
+
+   threads->draw = draw;
+   threads->threads[0].threads = threads;
+   threads->threads[0].fetch = draw_pt_fetch_create(draw);
+   if (!threads->threads[0].fetch) {
+      FREE(threads);
+      return NULL;
+   }
+   threads->num_threads = 1;
+
+   for (i = 1; i < num_threads; i++) {
+      struct pt_thread *thread = &threads->threads[i];
+
+      thread->threads = threads;
+      thread->index = i;
+
+      thread->fetch = draw_pt_fetch_create(draw);
+      thread->machine = tgsi_exec_machine_create(PIPE_SHADER_VERTEX);
+      if (!thread->fetch || !thread->machine) {
+         fini_thread(thread);
+         break;
+      }
+
+      pipe_semaphore_init(&thread->work_ready, 0);
+      pipe_semaphore_init(&thread->work_done, 0);
+      if (thrd_success != u_thread_create(&thread->thread, thread_function,
+                                          thread)) {
+         pipe_semaphore_destroy(&thread->work_ready);
+         pipe_semaphore_destroy(&thread->work_done);
+         fini_thread(thread);
+         break;
+      }
+
+      threads->num_threads++;
+   }
+
+   if (threads->num_threads < 2) {
+      draw_pt_threads_destroy(threads);
+      return NULL;
+   }
+
+   return threads;
+}
+
+
+void
+draw_pt_threads_destroy(struct pt_threads *threads)
+{
+   unsigned i;
+
+   threads->exit_flag = TRUE;
+   for (i = 1; i < threads->num_threads; i++)
+      pipe_semaphore_signal(&threads->threads[i].work_ready);
+
+   for (i = 1; i < threads->num_threads; i++) {
+      thrd_join(threads->threads[i].thread, NULL);
+      pipe_semaphore_destroy(&threads->threads[i].work_ready);
+      pipe_semaphore_destroy(&threads->threads[i].work_done);
+   }
+
+   for (i = 0; i < threads->num_threads; i++)
+      fini_thread(&threads->threads[i]);
+
+   FREE(threads);
+}
@@ -161,6 +161,19 @@ struct draw_vertex_shader *
 draw_create_vs_exec(struct draw_context *draw,
 		    const struct pipe_shader_state *templ);
 
+void
+draw_vs_exec_run_machine(struct draw_vertex_shader *shader,
+                         struct tgsi_exec_machine *machine,
+                         const float (*input)[4],
+                         float (*output)[4],
+                         const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                         const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                         unsigned count,
+                         unsigned input_stride,
+                         unsigned output_stride,
+                         const unsigned *fetch_elts,
+                         unsigned first);
+
 struct draw_vs_variant_key;
 struct draw_vertex_shader;
 
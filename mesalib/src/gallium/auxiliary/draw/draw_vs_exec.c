@@ -41,6 +41,7 @@
 #include "draw_private.h"
 #include "draw_context.h"
 #include "draw_vs.h"
+#include "draw_pt.h"
 
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_scan.h"
@@ -84,23 +85,24 @@ vs_exec_prepare(struct draw_vertex_shader *shader,
 
 
 /**
- * Simplified vertex shader interface for the pt paths.  Given the
- * complexity of code-generating all the above operations together,
- * it's time to try doing all the other stuff separately.
+ * Run the shader on count vertices with the given machine, which must
+ * have the shader bound.  first is the index of the first of them in the
+ * vertices being drawn, for the vertex ID when they are fetched linearly;
+ * fetch_elts otherwise points at the fetch elements of the first.
  */
-static void
-vs_exec_run_linear(struct draw_vertex_shader *shader,
-                   const float (*input)[4],
-                   float (*output)[4],
-                   const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
-                    const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
-                   unsigned count,
-                   unsigned input_stride,
-                   unsigned output_stride,
-                   const unsigned *fetch_elts)
+void
+draw_vs_exec_run_machine(struct draw_vertex_shader *shader,
+                         struct tgsi_exec_machine *machine,
+                         const float (*input)[4],
+                         float (*output)[4],
+                         const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                         const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                         unsigned count,
+                         unsigned input_stride,
+                         unsigned output_stride,
+                         const unsigned *fetch_elts,
+                         unsigned first)
 {
-   struct exec_vertex_shader *evs = exec_vertex_shader(shader);
-   struct tgsi_exec_machine *machine = evs->machine;
    unsigned int i, j;
    unsigned slot;
    boolean clamp_vertex_color = shader->draw->rasterizer->clamp_vertex_color;
@@ -137,7 +139,7 @@ vs_exec_run_linear(struct draw_vertex_shader *shader,
          if (shader->info.uses_vertexid) {
             unsigned vid = machine->SysSemanticToIndex[TGSI_SEMANTIC_VERTEXID];
             assert(vid < ARRAY_SIZE(machine->SystemValue));
-            machine->SystemValue[vid].xyzw[0].i[j] = fetch_elts ? fetch_elts[i + j] : (i + j + basevertex);
+            machine->SystemValue[vid].xyzw[0].i[j] = fetch_elts ? fetch_elts[i + j] : (first + i + j + basevertex);
          }
          if (shader->info.uses_basevertex) {
             unsigned vid = machine->SysSemanticToIndex[TGSI_SEMANTIC_BASEVERTEX];
@@ -147,7 +149,7 @@ vs_exec_run_linear(struct draw_vertex_shader *shader,
          if (shader->info.uses_vertexid_nobase) {
             unsigned vid = machine->SysSemanticToIndex[TGSI_SEMANTIC_VERTEXID_NOBASE];
             assert(vid < ARRAY_SIZE(machine->SystemValue));
-            machine->SystemValue[vid].xyzw[0].i[j] = fetch_elts ? (fetch_elts[i + j] - basevertex) : (i + j);
+            machine->SystemValue[vid].xyzw[0].i[j] = fetch_elts ? (fetch_elts[i + j] - basevertex) : (first + i + j);
          }
 
          for (slot = 0; slot < shader->info.num_inputs; slot++) {
@@ -207,9 +209,36 @@ vs_exec_run_linear(struct draw_vertex_shader *shader,
 }
 
 
+/**
+ * Simplified vertex shader interface for the pt paths.  Given the
+ * complexity of code-generating all the above operations together,
+ * it's time to try doing all the other stuff separately.
+ */
+static void
+vs_exec_run_linear(struct draw_vertex_shader *shader,
+                   const float (*input)[4],
+                   float (*output)[4],
+                   const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                   const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                   unsigned count,
+                   unsigned input_stride,
+                   unsigned output_stride,
+                   const unsigned *fetch_elts)
+{
+   struct exec_vertex_shader *evs = exec_vertex_shader(shader);
+
+   draw_vs_exec_run_machine(shader, evs->machine, input, output,
+                            constants, const_size, count,
+                            input_stride, output_stride, fetch_elts, 0);
+}
+
+
 static void
 vs_exec_delete(struct draw_vertex_shader *dvs)
 {
+   /* The tokens may be reallocated for another shader */
+   draw_pt_threads_unbind_shader(dvs->draw->pt.threads, dvs->state.tokens);
+
    FREE((void*) dvs->state.tokens);
    FREE(dvs);
 }
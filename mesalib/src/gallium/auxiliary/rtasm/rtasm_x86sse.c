@@ -627,6 +627,17 @@ void x86_dec( struct x86_function *p,
    emit_modrm_noreg(p, 1, reg);
 }
 
+/* Indirect branch target marker, for functions with several entry points.
+ */
+void x86_endbr( struct x86_function *p )
+{
+#if defined(PIPE_ARCH_X86)
+   emit_1i(p, 0xfb1e0ff3);
+#else
+   emit_1i(p, 0xfa1e0ff3);
+#endif
+}
+
 void x86_ret( struct x86_function *p )
 {
    DUMP();
@@ -1005,6 +1016,15 @@ void sse_divss( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+void sse_divps( struct x86_function *p,
+		struct x86_reg dst,
+		struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_2ub(p, X86_TWOB, 0x5E);
+   emit_modrm( p, dst, src );
+}
+
 void sse_minps( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
@@ -1086,6 +1106,15 @@ void sse_rsqrtps( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+void sse_sqrtps( struct x86_function *p,
+                 struct x86_reg dst,
+                 struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_2ub(p, X86_TWOB, 0x51);
+   emit_modrm( p, dst, src );
+}
+
 void sse_rsqrtss( struct x86_function *p,
 		  struct x86_reg dst,
 		  struct x86_reg src )
@@ -1517,6 +1546,25 @@ void sse2_pcmpgtd(struct x86_function *p,
    emit_modrm(p, dst, src);
 }
 
+/***********************************************************************
+ * SSE4.1 instructions
+ */
+
+/* Round to integral values, imm is the rounding mode: 0 = nearest even,
+ * 1 = down, 2 = up, 3 = towards zero.
+ */
+void sse41_roundps( struct x86_function *p,
+                    struct x86_reg dst,
+                    struct x86_reg src,
+                    uint8_t imm )
+{
+   DUMP_RRI( dst, src, imm );
+   emit_1ub(p, 0x66);
+   emit_3ub(p, X86_TWOB, 0x3A, 0x08);
+   emit_modrm( p, dst, src );
+   emit_1ub(p, imm);
+}
+
 /***********************************************************************
  * x87 instructions
  */
@@ -2173,11 +2221,7 @@ static void x86_init_func_common( struct x86_function *p )
    if(util_get_cpu_caps()->has_sse4_1)
       p->caps |= X86_SSE4_1;
    p->csr = p->store;
-#if defined(PIPE_ARCH_X86)
-   emit_1i(p, 0xfb1e0ff3);
-#else
-   emit_1i(p, 0xfa1e0ff3);
-#endif
+   x86_endbr(p);
    DUMP_START();
 }
 
@@ -58,7 +58,9 @@
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_util.h"
 #include "tgsi_exec.h"
+#include "tgsi_sse.h"
 #include "util/compiler.h"
+#include "util/u_debug.h"
 #include "util/half_float.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
@@ -67,6 +69,8 @@
 
 #define DEBUG_EXECUTION 0
 
+DEBUG_GET_ONCE_BOOL_OPTION(tgsi_no_jit, "TGSI_NO_JIT", FALSE)
+
 
 #define TILE_TOP_LEFT     0
 #define TILE_TOP_RIGHT    1
@@ -1049,6 +1053,9 @@ tgsi_exec_machine_bind_shader(
 
    if (!tokens) {
       /* unbind and free all */
+      tgsi_sse_destroy(mach->Jit);
+      mach->Jit = NULL;
+
       FREE(mach->Declarations);
       mach->Declarations = NULL;
       mach->NumDeclarations = 0;
@@ -1207,6 +1214,13 @@ tgsi_exec_machine_bind_shader(
    FREE(mach->Instructions);
    mach->Instructions = instructions;
    mach->NumInstructions = numInstructions;
+
+   tgsi_sse_destroy(mach->Jit);
+   mach->Jit = NULL;
+   if ((mach->ShaderType == PIPE_SHADER_VERTEX ||
+        mach->ShaderType == PIPE_SHADER_FRAGMENT) &&
+       !mach->NoJit && !debug_get_option_tgsi_no_jit())
+      mach->Jit = tgsi_sse_compile(mach);
 }
 
 
@@ -1259,6 +1273,7 @@ void
 tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
 {
    if (mach) {
+      tgsi_sse_destroy(mach->Jit);
       FREE(mach->Instructions);
       FREE(mach->Declarations);
       FREE(mach->Imms);
@@ -6005,6 +6020,18 @@ tgsi_exec_machine_setup_masks(struct tgsi_exec_machine *mach)
    assert(mach->CallStackTop == 0);
 }
 
+/**
+ * Execute the instruction at pc, returning the pc of the next one.  This is
+ * how the code compiled by tgsi_sse.c runs the instructions it leaves to
+ * the interpreter.
+ */
+int
+tgsi_exec_machine_step(struct tgsi_exec_machine *mach, int pc)
+{
+   exec_instruction(mach, mach->Instructions + pc, &pc);
+   return pc;
+}
+
 /**
  * Run TGSI interpreter.
  * \return bitmask of "alive" quad components
@@ -6040,6 +6067,10 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach, int start_pc )
       }
 #endif
 
+      /* run the compiled code if there is any, which leaves pc at -1 */
+      if (!DEBUG_EXECUTION && mach->Jit)
+         tgsi_sse_run(mach->Jit, mach);
+
       /* execute instructions, until pc is set to -1 */
       while (mach->pc != -1) {
          boolean barrier_hit;
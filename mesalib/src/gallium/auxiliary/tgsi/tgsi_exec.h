@@ -274,6 +274,7 @@ enum tgsi_break_type {
 typedef float float4[4];
 
 struct tgsi_exec_machine;
+struct tgsi_sse_program;
 
 typedef void (* apply_sample_offset_func)(
    const struct tgsi_exec_machine *mach,
@@ -398,6 +399,11 @@ struct ALIGN16 tgsi_exec_machine
    boolean UsedGeometryShader;
 
    int pc;
+
+   /** Compiled code of the bound shader, see tgsi_sse.c */
+   struct tgsi_sse_program *Jit;
+   /** Only interpret the shader, e.g. to check the compiled code against */
+   boolean NoJit;
 };
 
 struct tgsi_exec_machine *
@@ -419,6 +425,9 @@ uint
 tgsi_exec_machine_run(
    struct tgsi_exec_machine *mach, int start_pc );
 
+int
+tgsi_exec_machine_step(struct tgsi_exec_machine *mach, int pc);
+
 
 void
 tgsi_exec_machine_free_data(struct tgsi_exec_machine *mach);
@@ -0,0 +1,1100 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * SSE code generation for TGSI vertex and fragment shaders.
+ *
+ * The instructions of a shader are split into blocks: runs of float
+ * arithmetic, IF/ELSE/ENDIF and TEX/TXP/TXB with no indirect addressing.
+ * Each block is compiled to a function that works on the four lanes of a
+ * quad at once, honouring the machine's ExecMask the way store_dest() does,
+ * and returns the pc of the instruction after it.  IF and ELSE update the
+ * condition mask stack as the interpreter does and return the pc of their
+ * label when no lane takes the branch.  Texture instructions call the
+ * machine's sampler.  Everything else, including loops and subroutines, is
+ * left to the interpreter one instruction at a time.
+ *
+ * Results match the interpreter bit for bit, except for MIN and MAX with
+ * NaN or zeros of different sign, where minps/maxps return the second
+ * operand.
+ */
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+#include "pipe/p_shader_tokens.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_util.h"
+#include "tgsi_sse.h"
+
+
+#if defined(PIPE_ARCH_X86_64) && !defined(EMBEDDED_DEVICE)
+
+#include "rtasm/rtasm_x86sse.h"
+
+
+/**
+ * Constants the generated code reads, passed to each block.
+ */
+struct tgsi_sse_tex_args;
+
+struct ALIGN16 tgsi_sse_data {
+   uint32_t lanes[4];   /**< ExecMask bit of each lane */
+   float zero[4];
+   float one[4];
+   uint32_t abs[4];
+   uint32_t sign[4];
+   void (*sample)(struct tgsi_exec_machine *mach,
+                  struct tgsi_sse_tex_args *args);
+};
+
+/**
+ * What a texture instruction passes to sse_sample(), on the stack.
+ */
+struct ALIGN16 tgsi_sse_tex_args {
+   float coords[5][TGSI_QUAD_SIZE];   /**< s, t, p, c0 and c1 */
+   float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+   int pc;
+};
+
+/**
+ * Sample as exec_tex() does for TEX, TXP and TXB, with the coordinates,
+ * projected already, and the LOD bias the generated code fetched.
+ */
+static void
+sse_sample(struct tgsi_exec_machine *mach, struct tgsi_sse_tex_args *args)
+{
+   static const int8_t offsets[3] = { 0, 0, 0 };
+   const struct tgsi_full_instruction *inst = &mach->Instructions[args->pc];
+   const unsigned unit = inst->Src[1].Register.Index;
+
+   mach->Sampler->get_samples(mach->Sampler, unit, unit,
+                              args->coords[0], args->coords[1],
+                              args->coords[2], args->coords[3],
+                              args->coords[4], NULL, offsets,
+                              inst->Instruction.Opcode == TGSI_OPCODE_TXB ?
+                                 TGSI_SAMPLER_LOD_BIAS : TGSI_SAMPLER_LOD_NONE,
+                              args->rgba);
+}
+
+static const struct tgsi_sse_data sse_data = {
+   { 1, 2, 4, 8 },
+   { 0.0f, 0.0f, 0.0f, 0.0f },
+   { 1.0f, 1.0f, 1.0f, 1.0f },
+   { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff },
+   { 0x80000000, 0x80000000, 0x80000000, 0x80000000 },
+   sse_sample,
+};
+
+/* The stack frame of a block, below rbp.  The bottom 32 bytes are the
+ * space the Windows ABI has callers reserve for the callee's arguments.
+ */
+#define FRAME_XMM7     -16   /**< xmm7, callee-saved in the Windows ABI */
+#define FRAME_RDI      -24
+#define FRAME_RSI      -32
+#define FRAME_TEX      (FRAME_RSI - (int) sizeof(struct tgsi_sse_tex_args))
+#define FRAME_SIZE     (32 - FRAME_TEX)
+
+typedef int (*tgsi_sse_block)(struct tgsi_exec_machine *mach,
+                              const struct tgsi_sse_data *data);
+
+struct tgsi_sse_program {
+   struct x86_function func;
+
+   /** Compiled block starting at each pc, or NULL to interpret it */
+   tgsi_sse_block *block;
+
+   /** Bytes of each constant buffer the blocks read */
+   unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS];
+   unsigned num_const_bufs;
+};
+
+/* Rounding modes of roundps */
+#define ROUND_NEAREST  0
+#define ROUND_DOWN     1
+#define ROUND_UP       2
+#define ROUND_TRUNC    3
+
+typedef void (*sse_binary_op)(struct x86_function *p,
+                              struct x86_reg dst,
+                              struct x86_reg src);
+
+struct sse_compile {
+   struct x86_function *func;
+   struct tgsi_sse_program *prog;
+
+   struct x86_reg mach;    /**< the first argument, in rdi */
+   struct x86_reg data;    /**< the second argument, in rsi */
+   struct x86_reg ptr;     /**< rax, a pointer loaded from the machine */
+   int ptr_offset;         /**< which one, or -1 */
+
+   /** Jumps to the end of the block from IF and ELSE, to fix up */
+   int *returns;
+   unsigned num_returns;
+};
+
+
+static inline struct x86_reg
+xmm(unsigned i)
+{
+   return x86_make_reg(file_XMM, (enum x86_reg_name) i);
+}
+
+static inline struct x86_reg
+data_field(const struct sse_compile *c, unsigned offset)
+{
+   return x86_make_disp(c->data, offset);
+}
+
+#define DATA(c, field) data_field(c, offsetof(struct tgsi_sse_data, field))
+
+/** Offset of a channel of a vector in an array of them */
+static inline unsigned
+vec_offset(unsigned base, unsigned index, unsigned chan)
+{
+   return base + index * sizeof(struct tgsi_exec_vector) +
+          chan * sizeof(union tgsi_exec_channel);
+}
+
+/**
+ * Load a pointer member of the machine into rax, unless it is there already.
+ */
+static struct x86_reg
+get_ptr(struct sse_compile *c, unsigned offset)
+{
+   if (c->ptr_offset != (int) offset) {
+      x64_mov64(c->func, c->ptr, x86_make_disp(c->mach, offset));
+      c->ptr_offset = offset;
+   }
+   return c->ptr;
+}
+
+
+static boolean
+src_is_native(const struct tgsi_full_src_register *src)
+{
+   if (src->Register.Indirect)
+      return FALSE;
+
+   switch (src->Register.File) {
+   case TGSI_FILE_CONSTANT:
+      return !src->Register.Dimension ||
+             (!src->Dimension.Indirect &&
+              src->Dimension.Index < PIPE_MAX_CONSTANT_BUFFERS);
+   case TGSI_FILE_TEMPORARY:
+   case TGSI_FILE_INPUT:
+   case TGSI_FILE_OUTPUT:
+   case TGSI_FILE_SYSTEM_VALUE:
+   case TGSI_FILE_IMMEDIATE:
+      return !src->Register.Dimension;
+   default:
+      return FALSE;
+   }
+}
+
+/**
+ * Texture instructions the generated code can set up for sse_sample(): the
+ * ones exec_tex() handles with a sampler unit known up front and no texel
+ * offsets.
+ */
+static boolean
+tex_is_native(const struct tgsi_full_instruction *inst)
+{
+   const int dim = tgsi_util_get_texture_coord_dim(inst->Texture.Texture);
+   const int shadow_ref =
+      tgsi_util_get_shadow_ref_src_index(inst->Texture.Texture);
+
+   if (inst->Texture.Texture == TGSI_TEXTURE_BUFFER ||
+       inst->Texture.NumOffsets ||
+       inst->Src[1].Register.File != TGSI_FILE_SAMPLER ||
+       inst->Src[1].Register.Indirect ||
+       !src_is_native(&inst->Src[0]))
+      return FALSE;
+
+   /* the reference value must come from src0 too, and TXP and TXB need
+    * src0.w for themselves
+    */
+   if (shadow_ref >= TGSI_NUM_CHANNELS)
+      return FALSE;
+   if (inst->Instruction.Opcode != TGSI_OPCODE_TEX &&
+       (dim > TGSI_CHAN_W || shadow_ref == TGSI_CHAN_W))
+      return FALSE;
+
+   return TRUE;
+}
+
+static boolean
+inst_is_native(const struct tgsi_full_instruction *inst)
+{
+   const struct tgsi_full_dst_register *dst = &inst->Dst[0];
+   unsigned i;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_IF:
+      return src_is_native(&inst->Src[0]);
+   case TGSI_OPCODE_ELSE:
+   case TGSI_OPCODE_ENDIF:
+      return TRUE;
+   case TGSI_OPCODE_TEX:
+   case TGSI_OPCODE_TXP:
+   case TGSI_OPCODE_TXB:
+      if (!tex_is_native(inst))
+         return FALSE;
+      break;
+   case TGSI_OPCODE_MOV:
+   case TGSI_OPCODE_ADD:
+   case TGSI_OPCODE_MUL:
+   case TGSI_OPCODE_DIV:
+   case TGSI_OPCODE_MAD:
+   case TGSI_OPCODE_LRP:
+   case TGSI_OPCODE_DP2:
+   case TGSI_OPCODE_DP3:
+   case TGSI_OPCODE_DP4:
+   case TGSI_OPCODE_MIN:
+   case TGSI_OPCODE_MAX:
+   case TGSI_OPCODE_SLT:
+   case TGSI_OPCODE_SGE:
+   case TGSI_OPCODE_SEQ:
+   case TGSI_OPCODE_SNE:
+   case TGSI_OPCODE_CMP:
+   case TGSI_OPCODE_RCP:
+   case TGSI_OPCODE_RSQ:
+   case TGSI_OPCODE_SQRT:
+      break;
+   case TGSI_OPCODE_FLR:
+   case TGSI_OPCODE_FRC:
+   case TGSI_OPCODE_CEIL:
+   case TGSI_OPCODE_TRUNC:
+   case TGSI_OPCODE_ROUND:
+      if (!util_get_cpu_caps()->has_sse4_1)
+         return FALSE;
+      break;
+   default:
+      return FALSE;
+   }
+
+   if (inst->Instruction.NumDstRegs != 1 ||
+       dst->Register.Indirect || dst->Register.Dimension)
+      return FALSE;
+
+   if (dst->Register.File == TGSI_FILE_TEMPORARY) {
+      if (dst->Register.Index >= TGSI_EXEC_NUM_TEMPS)
+         return FALSE;
+   }
+   else if (dst->Register.File != TGSI_FILE_OUTPUT)
+      return FALSE;
+
+   for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+      if (inst->Src[i].Register.File != TGSI_FILE_SAMPLER &&
+          !src_is_native(&inst->Src[i]))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Load a channel of a source register into an xmm register, as
+ * fetch_source() does.
+ */
+static void
+emit_fetch(struct sse_compile *c, struct x86_reg dst,
+           const struct tgsi_full_src_register *src, unsigned chan)
+{
+   struct x86_function *func = c->func;
+   const unsigned swizzle = tgsi_util_get_full_src_register_swizzle(src, chan);
+   const unsigned index = src->Register.Index;
+
+   switch (src->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+      sse_movups(func, dst,
+                 x86_make_disp(c->mach,
+                               vec_offset(offsetof(struct tgsi_exec_machine, Temps),
+                                          index, swizzle)));
+      break;
+
+   case TGSI_FILE_SYSTEM_VALUE:
+      sse_movups(func, dst,
+                 x86_make_disp(c->mach,
+                               vec_offset(offsetof(struct tgsi_exec_machine, SystemValue),
+                                          index, swizzle)));
+      break;
+
+   case TGSI_FILE_INPUT:
+      sse_movups(func, dst,
+                 x86_make_disp(get_ptr(c, offsetof(struct tgsi_exec_machine, Inputs)),
+                               vec_offset(0, index, swizzle)));
+      break;
+
+   case TGSI_FILE_OUTPUT:
+      sse_movups(func, dst,
+                 x86_make_disp(get_ptr(c, offsetof(struct tgsi_exec_machine, Outputs)),
+                               vec_offset(0, index, swizzle)));
+      break;
+
+   case TGSI_FILE_CONSTANT: {
+      const unsigned buf = src->Register.Dimension ? src->Dimension.Index : 0;
+      const unsigned pos = index * 4 + swizzle;
+
+      /* tgsi_sse_run() checks the buffers are this large */
+      c->prog->const_size[buf] = MAX2(c->prog->const_size[buf],
+                                      (pos + 1) * sizeof(float));
+      c->prog->num_const_bufs = MAX2(c->prog->num_const_bufs, buf + 1);
+
+      sse_movss(func, dst,
+                x86_make_disp(get_ptr(c, offsetof(struct tgsi_exec_machine, Consts) +
+                                         buf * sizeof(void *)),
+                              pos * sizeof(float)));
+      sse_shufps(func, dst, dst, SHUF(0, 0, 0, 0));
+      break;
+   }
+
+   case TGSI_FILE_IMMEDIATE:
+      sse_movss(func, dst,
+                x86_make_disp(get_ptr(c, offsetof(struct tgsi_exec_machine, Imms)),
+                              (index * 4 + swizzle) * sizeof(float)));
+      sse_shufps(func, dst, dst, SHUF(0, 0, 0, 0));
+      break;
+
+   default:
+      assert(0);
+   }
+
+   if (src->Register.Absolute)
+      sse_andps(func, dst, DATA(c, abs));
+   if (src->Register.Negate)
+      sse_xorps(func, dst, DATA(c, sign));
+}
+
+/**
+ * Store an xmm register to a channel of the destination register in the
+ * lanes enabled in xmm7, as store_dest() does.  Clobbers xmm4 and xmm5.
+ */
+static void
+emit_store(struct sse_compile *c, const struct tgsi_full_instruction *inst,
+           unsigned chan, struct x86_reg src)
+{
+   struct x86_function *func = c->func;
+   const struct tgsi_full_dst_register *reg = &inst->Dst[0];
+   struct x86_reg dst;
+
+   if (reg->Register.File == TGSI_FILE_TEMPORARY)
+      dst = x86_make_disp(c->mach,
+                          vec_offset(offsetof(struct tgsi_exec_machine, Temps),
+                                     reg->Register.Index, chan));
+   else
+      dst = x86_make_disp(get_ptr(c, offsetof(struct tgsi_exec_machine, Outputs)),
+                          vec_offset(0, reg->Register.Index, chan));
+
+   if (inst->Instruction.Saturate) {
+      sse_maxps(func, src, DATA(c, zero));
+      sse_minps(func, src, DATA(c, one));
+   }
+
+   sse_movups(func, xmm(5), dst);
+   sse_movaps(func, xmm(4), xmm(7));
+   sse_andnps(func, xmm(4), xmm(5));
+   sse_andps(func, src, xmm(7));
+   sse_orps(func, src, xmm(4));
+   sse_movups(func, dst, src);
+}
+
+static void
+emit_binary(struct sse_compile *c, const struct tgsi_full_instruction *inst,
+            unsigned chan, sse_binary_op op)
+{
+   emit_fetch(c, xmm(chan), &inst->Src[0], chan);
+   emit_fetch(c, xmm(4), &inst->Src[1], chan);
+   op(c->func, xmm(chan), xmm(4));
+}
+
+/** SLT, SGE, SEQ and SNE: 1.0 where src0 cc src1 holds, else 0.0 */
+static void
+emit_set(struct sse_compile *c, const struct tgsi_full_instruction *inst,
+         unsigned chan, enum sse_cc cc, boolean swap)
+{
+   emit_fetch(c, xmm(chan), &inst->Src[swap ? 1 : 0], chan);
+   emit_fetch(c, xmm(4), &inst->Src[swap ? 0 : 1], chan);
+   sse_cmpps(c->func, xmm(chan), xmm(4), cc);
+   sse_andps(c->func, xmm(chan), DATA(c, one));
+}
+
+static void
+emit_round(struct sse_compile *c, const struct tgsi_full_instruction *inst,
+           unsigned chan, unsigned mode)
+{
+   emit_fetch(c, xmm(chan), &inst->Src[0], chan);
+   sse41_roundps(c->func, xmm(chan), xmm(chan), mode);
+}
+
+/** DP2, DP3 and DP4 into xmm0, in the order exec_dp4() adds them */
+static void
+emit_dot(struct sse_compile *c, const struct tgsi_full_instruction *inst,
+         unsigned n)
+{
+   unsigned chan;
+
+   emit_fetch(c, xmm(0), &inst->Src[0], TGSI_CHAN_X);
+   emit_fetch(c, xmm(4), &inst->Src[1], TGSI_CHAN_X);
+   sse_mulps(c->func, xmm(0), xmm(4));
+   for (chan = 1; chan < n; chan++) {
+      emit_fetch(c, xmm(4), &inst->Src[0], chan);
+      emit_fetch(c, xmm(5), &inst->Src[1], chan);
+      sse_mulps(c->func, xmm(4), xmm(5));
+      sse_addps(c->func, xmm(0), xmm(4));
+   }
+}
+
+static inline struct x86_reg
+reg32(enum x86_reg_name name)
+{
+   return x86_make_reg(file_REG32, name);
+}
+
+static inline struct x86_reg
+mach_field(const struct sse_compile *c, unsigned offset)
+{
+   return x86_make_disp(c->mach, offset);
+}
+
+#define MACH(c, field) \
+   mach_field(c, offsetof(struct tgsi_exec_machine, field))
+
+/**
+ * Set xmm7 to the lanes enabled in ExecMask, as all ones.
+ */
+static void
+emit_exec_mask(struct sse_compile *c)
+{
+   sse2_movd(c->func, xmm(7), MACH(c, ExecMask));
+   sse2_pshufd(c->func, xmm(7), xmm(7), SHUF(0, 0, 0, 0));
+   sse_andps(c->func, xmm(7), DATA(c, lanes));
+   sse2_pcmpgtd(c->func, xmm(7), DATA(c, zero));
+}
+
+/**
+ * Return \p pc from the block, and resolve the jumps to here of the IF and
+ * ELSE instructions in it, which set eax already.
+ */
+static void
+emit_epilogue(struct sse_compile *c, unsigned pc)
+{
+   struct x86_function *func = c->func;
+   struct x86_reg rbp = reg32(reg_BP);
+   unsigned i;
+
+   x86_mov_reg_imm(func, reg32(reg_AX), pc);
+   for (i = 0; i < c->num_returns; i++)
+      x86_fixup_fwd_jump(func, c->returns[i]);
+
+   if (x86_target(func) == X86_64_WIN64_ABI) {
+      sse_movups(func, xmm(7), x86_make_disp(rbp, FRAME_XMM7));
+      x64_mov64(func, c->mach, x86_make_disp(rbp, FRAME_RDI));
+      x64_mov64(func, c->data, x86_make_disp(rbp, FRAME_RSI));
+   }
+   x64_mov64(func, reg32(reg_SP), rbp);
+   x86_pop(func, rbp);
+   x86_ret(func);
+}
+
+/**
+ * ExecMask = CondMask & LoopMask & ContMask & Switch.mask & FuncMask, as
+ * UPDATE_EXEC_MASK() does, and the same in xmm7.
+ */
+static void
+emit_update_exec_mask(struct sse_compile *c)
+{
+   struct x86_function *func = c->func;
+   struct x86_reg eax = reg32(reg_AX);
+
+   x86_mov(func, eax, MACH(c, CondMask));
+   x86_and(func, eax, MACH(c, LoopMask));
+   x86_and(func, eax, MACH(c, ContMask));
+   x86_and(func, eax, mach_field(c, offsetof(struct tgsi_exec_machine, Switch) +
+                                    offsetof(struct tgsi_switch_record, mask)));
+   x86_and(func, eax, MACH(c, FuncMask));
+   x86_mov(func, MACH(c, ExecMask), eax);
+   emit_exec_mask(c);
+}
+
+/**
+ * Return the pc of the instruction's label if no lane is left in CondMask.
+ */
+static void
+emit_skip_if_cond_clear(struct sse_compile *c,
+                        const struct tgsi_full_instruction *inst)
+{
+   struct x86_reg eax = reg32(reg_AX);
+   int fixup;
+
+   x86_mov(c->func, eax, MACH(c, CondMask));
+   x86_test(c->func, eax, eax);
+   fixup = x86_jcc_forward(c->func, cc_NZ);
+   x86_mov_reg_imm(c->func, eax, inst->Label.Label);
+   c->returns[c->num_returns++] = x86_jmp_forward(c->func);
+   x86_fixup_fwd_jump(c->func, fixup);
+}
+
+/**
+ * Point rax at CondStack[ecx], less the offset of CondStack.
+ */
+static void
+emit_cond_stack_addr(struct sse_compile *c)
+{
+   struct x86_reg rax = reg32(reg_AX);
+
+   x86_mov(c->func, rax, reg32(reg_CX));
+   x86_shl_imm(c->func, rax, 2);
+   x64_rexw(c->func);
+   x86_add(c->func, rax, c->mach);
+   c->ptr_offset = -1;
+}
+
+#define COND_STACK(offset) \
+   x86_make_disp(reg32(reg_AX), \
+                 offsetof(struct tgsi_exec_machine, CondStack) + (offset))
+
+/** IF: push CondMask and clear the lanes where src0.x is zero */
+static void
+emit_if(struct sse_compile *c, const struct tgsi_full_instruction *inst)
+{
+   struct x86_function *func = c->func;
+   struct x86_reg eax = reg32(reg_AX);
+   struct x86_reg ecx = reg32(reg_CX);
+   struct x86_reg edx = reg32(reg_DX);
+
+   emit_fetch(c, xmm(0), &inst->Src[0], TGSI_CHAN_X);
+   sse_cmpps(func, xmm(0), DATA(c, zero), cc_NotEqual);
+
+   x86_mov(func, ecx, MACH(c, CondStackTop));
+   emit_cond_stack_addr(c);
+   x86_mov(func, edx, MACH(c, CondMask));
+   x86_mov(func, COND_STACK(0), edx);
+   x86_inc(func, ecx);
+   x86_mov(func, MACH(c, CondStackTop), ecx);
+
+   sse_movmskps(func, eax, xmm(0));
+   x86_and(func, eax, edx);
+   x86_mov(func, MACH(c, CondMask), eax);
+
+   emit_update_exec_mask(c);
+   emit_skip_if_cond_clear(c, inst);
+}
+
+/** ELSE: invert CondMask within the one pushed by IF */
+static void
+emit_else(struct sse_compile *c, const struct tgsi_full_instruction *inst)
+{
+   struct x86_function *func = c->func;
+   struct x86_reg eax = reg32(reg_AX);
+   struct x86_reg edx = reg32(reg_DX);
+
+   x86_mov(func, reg32(reg_CX), MACH(c, CondStackTop));
+   emit_cond_stack_addr(c);
+   x86_mov(func, edx, COND_STACK(-(int) sizeof(uint)));
+
+   x86_mov(func, eax, MACH(c, CondMask));
+   x86_xor_imm(func, eax, ~0);
+   x86_and(func, eax, edx);
+   x86_mov(func, MACH(c, CondMask), eax);
+
+   emit_update_exec_mask(c);
+   emit_skip_if_cond_clear(c, inst);
+}
+
+/** ENDIF: pop CondMask */
+static void
+emit_endif(struct sse_compile *c)
+{
+   struct x86_function *func = c->func;
+   struct x86_reg eax = reg32(reg_AX);
+   struct x86_reg ecx = reg32(reg_CX);
+
+   x86_mov(func, ecx, MACH(c, CondStackTop));
+   x86_dec(func, ecx);
+   x86_mov(func, MACH(c, CondStackTop), ecx);
+   emit_cond_stack_addr(c);
+   x86_mov(func, eax, COND_STACK(0));
+   x86_mov(func, MACH(c, CondMask), eax);
+
+   emit_update_exec_mask(c);
+}
+
+/**
+ * TEX, TXP and TXB: fetch the coordinates as exec_tex() does, call
+ * sse_sample() and store the color it returns.
+ */
+static void
+emit_tex(struct sse_compile *c, const struct tgsi_full_instruction *inst,
+         unsigned pc)
+{
+   struct x86_function *func = c->func;
+   const unsigned opcode = inst->Instruction.Opcode;
+   const unsigned writemask = inst->Dst[0].Register.WriteMask;
+   const int dim = tgsi_util_get_texture_coord_dim(inst->Texture.Texture);
+   const int shadow_ref =
+      tgsi_util_get_shadow_ref_src_index(inst->Texture.Texture);
+   struct x86_reg rax = reg32(reg_AX);
+   struct x86_reg args = x86_make_disp(reg32(reg_BP), FRAME_TEX);
+   int i;
+
+   for (i = 0; i < TGSI_NUM_CHANNELS; i++) {
+      if (i < dim || i == shadow_ref)
+         emit_fetch(c, xmm(i), &inst->Src[0], i);
+   }
+
+   if (opcode == TGSI_OPCODE_TXP) {
+      emit_fetch(c, xmm(4), &inst->Src[0], TGSI_CHAN_W);
+      for (i = 0; i < TGSI_NUM_CHANNELS; i++) {
+         if (i < dim || i == shadow_ref)
+            sse_divps(func, xmm(i), xmm(4));
+      }
+   }
+
+   /* unused arguments are zero, the last is the LOD bias of TXB */
+   sse_xorps(func, xmm(5), xmm(5));
+   for (i = 0; i < TGSI_NUM_CHANNELS; i++) {
+      sse_movaps(func,
+                 x86_make_disp(args, offsetof(struct tgsi_sse_tex_args,
+                                              coords[i])),
+                 i < dim || i == shadow_ref ? xmm(i) : xmm(5));
+   }
+   if (opcode == TGSI_OPCODE_TXB)
+      emit_fetch(c, xmm(5), &inst->Src[0], TGSI_CHAN_W);
+   sse_movaps(func,
+              x86_make_disp(args, offsetof(struct tgsi_sse_tex_args,
+                                           coords[4])),
+              xmm(5));
+   x86_mov_imm(func,
+               x86_make_disp(args, offsetof(struct tgsi_sse_tex_args, pc)),
+               pc);
+
+   /* mach and data live in callee-saved registers on Windows only */
+   x64_mov64(func, rax, DATA(c, sample));
+   if (x86_target(func) == X86_64_WIN64_ABI) {
+      x64_mov64(func, reg32(reg_CX), c->mach);
+      x64_rexw(func);
+      x86_lea(func, reg32(reg_DX), args);
+      x86_call(func, rax);
+   }
+   else {
+      x64_rexw(func);
+      x86_lea(func, c->data, args);
+      x86_call(func, rax);
+      x64_mov64(func, c->mach, x86_make_disp(reg32(reg_BP), FRAME_RDI));
+      x64_mov64(func, c->data, x86_make_disp(reg32(reg_BP), FRAME_RSI));
+   }
+   c->ptr_offset = -1;
+   emit_exec_mask(c);
+
+   for (i = 0; i < TGSI_NUM_CHANNELS; i++) {
+      if (writemask & (1 << i)) {
+         sse_movaps(func, xmm(i),
+                    x86_make_disp(args, offsetof(struct tgsi_sse_tex_args,
+                                                 rgba[i])));
+      }
+   }
+   for (i = 0; i < TGSI_NUM_CHANNELS; i++) {
+      if (writemask & (1 << i))
+         emit_store(c, inst, i, xmm(i));
+   }
+}
+
+/**
+ * Compute the enabled channels of the result into xmm0-3, then store them.
+ * All sources are read before anything is written, as in the interpreter.
+ */
+static void
+emit_instruction(struct sse_compile *c,
+                 const struct tgsi_full_instruction *inst, unsigned pc)
+{
+   struct x86_function *func = c->func;
+   const unsigned writemask = inst->Dst[0].Register.WriteMask;
+   boolean scalar = FALSE;
+   unsigned chan;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_IF:
+      emit_if(c, inst);
+      return;
+   case TGSI_OPCODE_ELSE:
+      emit_else(c, inst);
+      return;
+   case TGSI_OPCODE_ENDIF:
+      emit_endif(c);
+      return;
+   case TGSI_OPCODE_TEX:
+   case TGSI_OPCODE_TXP:
+   case TGSI_OPCODE_TXB:
+      emit_tex(c, inst, pc);
+      return;
+   case TGSI_OPCODE_DP2:
+      emit_dot(c, inst, 2);
+      scalar = TRUE;
+      break;
+   case TGSI_OPCODE_DP3:
+      emit_dot(c, inst, 3);
+      scalar = TRUE;
+      break;
+   case TGSI_OPCODE_DP4:
+      emit_dot(c, inst, 4);
+      scalar = TRUE;
+      break;
+   case TGSI_OPCODE_RCP:
+      emit_fetch(c, xmm(4), &inst->Src[0], TGSI_CHAN_X);
+      sse_movaps(func, xmm(0), DATA(c, one));
+      sse_divps(func, xmm(0), xmm(4));
+      scalar = TRUE;
+      break;
+   case TGSI_OPCODE_RSQ:
+      emit_fetch(c, xmm(4), &inst->Src[0], TGSI_CHAN_X);
+      sse_sqrtps(func, xmm(4), xmm(4));
+      sse_movaps(func, xmm(0), DATA(c, one));
+      sse_divps(func, xmm(0), xmm(4));
+      scalar = TRUE;
+      break;
+   case TGSI_OPCODE_SQRT:
+      emit_fetch(c, xmm(0), &inst->Src[0], TGSI_CHAN_X);
+      sse_sqrtps(func, xmm(0), xmm(0));
+      scalar = TRUE;
+      break;
+   default:
+      break;
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (!(writemask & (1 << chan)))
+         continue;
+
+      if (scalar) {
+         if (chan != 0)
+            sse_movaps(func, xmm(chan), xmm(0));
+         continue;
+      }
+
+      switch (inst->Instruction.Opcode) {
+      case TGSI_OPCODE_MOV:
+         emit_fetch(c, xmm(chan), &inst->Src[0], chan);
+         break;
+      case TGSI_OPCODE_ADD:
+         emit_binary(c, inst, chan, sse_addps);
+         break;
+      case TGSI_OPCODE_MUL:
+         emit_binary(c, inst, chan, sse_mulps);
+         break;
+      case TGSI_OPCODE_DIV:
+         emit_binary(c, inst, chan, sse_divps);
+         break;
+      case TGSI_OPCODE_MIN:
+         emit_binary(c, inst, chan, sse_minps);
+         break;
+      case TGSI_OPCODE_MAX:
+         emit_binary(c, inst, chan, sse_maxps);
+         break;
+      case TGSI_OPCODE_SLT:
+         emit_set(c, inst, chan, cc_LessThan, FALSE);
+         break;
+      case TGSI_OPCODE_SGE:
+         emit_set(c, inst, chan, cc_LessThanEqual, TRUE);
+         break;
+      case TGSI_OPCODE_SEQ:
+         emit_set(c, inst, chan, cc_Equal, FALSE);
+         break;
+      case TGSI_OPCODE_SNE:
+         emit_set(c, inst, chan, cc_NotEqual, FALSE);
+         break;
+      case TGSI_OPCODE_MAD:
+         emit_binary(c, inst, chan, sse_mulps);
+         emit_fetch(c, xmm(4), &inst->Src[2], chan);
+         sse_addps(func, xmm(chan), xmm(4));
+         break;
+      case TGSI_OPCODE_LRP:
+         /* src0 * (src1 - src2) + src2 */
+         emit_fetch(c, xmm(chan), &inst->Src[1], chan);
+         emit_fetch(c, xmm(4), &inst->Src[2], chan);
+         sse_subps(func, xmm(chan), xmm(4));
+         emit_fetch(c, xmm(5), &inst->Src[0], chan);
+         sse_mulps(func, xmm(chan), xmm(5));
+         sse_addps(func, xmm(chan), xmm(4));
+         break;
+      case TGSI_OPCODE_CMP:
+         /* src0 < 0 ? src1 : src2 */
+         emit_fetch(c, xmm(4), &inst->Src[0], chan);
+         sse_cmpps(func, xmm(4), DATA(c, zero), cc_LessThan);
+         emit_fetch(c, xmm(chan), &inst->Src[1], chan);
+         sse_andps(func, xmm(chan), xmm(4));
+         emit_fetch(c, xmm(5), &inst->Src[2], chan);
+         sse_andnps(func, xmm(4), xmm(5));
+         sse_orps(func, xmm(chan), xmm(4));
+         break;
+      case TGSI_OPCODE_FLR:
+         emit_round(c, inst, chan, ROUND_DOWN);
+         break;
+      case TGSI_OPCODE_CEIL:
+         emit_round(c, inst, chan, ROUND_UP);
+         break;
+      case TGSI_OPCODE_TRUNC:
+         emit_round(c, inst, chan, ROUND_TRUNC);
+         break;
+      case TGSI_OPCODE_ROUND:
+         emit_round(c, inst, chan, ROUND_NEAREST);
+         break;
+      case TGSI_OPCODE_FRC:
+         /* src - floor(src) */
+         emit_fetch(c, xmm(chan), &inst->Src[0], chan);
+         sse41_roundps(func, xmm(4), xmm(chan), ROUND_DOWN);
+         sse_subps(func, xmm(chan), xmm(4));
+         break;
+      default:
+         assert(0);
+      }
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (writemask & (1 << chan))
+         emit_store(c, inst, chan, xmm(chan));
+   }
+}
+
+/**
+ * Emit the function running instructions [start, end), which returns end.
+ */
+static void
+emit_block(struct sse_compile *c, const struct tgsi_exec_machine *mach,
+           unsigned start, unsigned end)
+{
+   struct x86_function *func = c->func;
+   struct x86_reg rbp = reg32(reg_BP);
+   struct x86_reg rsp = reg32(reg_SP);
+   unsigned pc;
+
+   x86_endbr(func);
+   c->ptr_offset = -1;
+   c->num_returns = 0;
+
+   /* A frame aligned for calls to sse_sample().  rdi, rsi and xmm6-15 are
+    * callee-saved in the Windows ABI, where the arguments come in rcx and
+    * rdx.
+    */
+   x86_push(func, rbp);
+   x64_mov64(func, rbp, rsp);
+   x64_rexw(func);
+   x86_sub_imm(func, rsp, FRAME_SIZE);
+   x64_mov64(func, x86_make_disp(rbp, FRAME_RDI), c->mach);
+   x64_mov64(func, x86_make_disp(rbp, FRAME_RSI), c->data);
+   if (x86_target(func) == X86_64_WIN64_ABI) {
+      sse_movups(func, x86_make_disp(rbp, FRAME_XMM7), xmm(7));
+      x64_mov64(func, c->mach, reg32(reg_CX));
+      x64_mov64(func, c->data, reg32(reg_DX));
+   }
+
+   emit_exec_mask(c);
+
+   for (pc = start; pc < end; pc++)
+      emit_instruction(c, &mach->Instructions[pc], pc);
+
+   emit_epilogue(c, end);
+}
+
+
+static inline tgsi_sse_block
+voidptr_to_block(void *v)
+{
+   union {
+      void *v;
+      tgsi_sse_block f;
+   } u;
+   STATIC_ASSERT(sizeof(u.v) == sizeof(u.f));
+   u.v = v;
+   return u.f;
+}
+
+
+/**
+ * Compile the blocks of the shader bound to the machine.  Returns NULL if
+ * there is nothing worth compiling or the CPU lacks SSE2.
+ */
+struct tgsi_sse_program *
+tgsi_sse_compile(const struct tgsi_exec_machine *mach)
+{
+   const unsigned num_instructions = mach->NumInstructions;
+   struct tgsi_sse_program *prog;
+   struct sse_compile c;
+   boolean *native = NULL, *leader = NULL;
+   int *entry = NULL;
+   unsigned pc, num_blocks = 0;
+
+   if (!util_get_cpu_caps()->has_sse2 || !num_instructions)
+      return NULL;
+
+   prog = CALLOC_STRUCT(tgsi_sse_program);
+   if (!prog)
+      return NULL;
+
+   prog->block = CALLOC(num_instructions, sizeof(tgsi_sse_block));
+   native = CALLOC(num_instructions, sizeof(boolean));
+   leader = CALLOC(num_instructions + 1, sizeof(boolean));
+   entry = MALLOC(num_instructions * sizeof(int));
+   c.returns = MALLOC(num_instructions * sizeof(int));
+   if (!prog->block || !native || !leader || !entry || !c.returns)
+      goto fail;
+
+   /* A block starts at pc 0, at branch targets and after every instruction
+    * left to the interpreter, which is where all flow control happens.
+    */
+   leader[0] = TRUE;
+   for (pc = 0; pc < num_instructions; pc++) {
+      const struct tgsi_full_instruction *inst = &mach->Instructions[pc];
+
+      native[pc] = inst_is_native(inst);
+      if (!native[pc])
+         leader[pc + 1] = TRUE;
+      if (inst->Instruction.Label &&
+          inst->Label.Label < num_instructions)
+         leader[inst->Label.Label] = TRUE;
+      entry[pc] = -1;
+   }
+
+   x86_init_func(&prog->func);
+   c.func = &prog->func;
+   c.prog = prog;
+   c.mach = reg32(reg_DI);
+   c.data = reg32(reg_SI);
+   c.ptr = reg32(reg_AX);
+
+   pc = 0;
+   while (pc < num_instructions) {
+      unsigned end = pc + 1;
+
+      if (!native[pc]) {
+         pc++;
+         continue;
+      }
+
+      while (end < num_instructions && native[end] && !leader[end])
+         end++;
+
+      entry[pc] = x86_get_label(&prog->func);
+      emit_block(&c, mach, pc, end);
+      num_blocks++;
+      pc = end;
+   }
+
+   if (!num_blocks || !x86_get_func(&prog->func))
+      goto fail;
+
+   /* the code buffer may have moved while growing, so resolve the entry
+    * points only now
+    */
+   for (pc = 0; pc < num_instructions; pc++) {
+      if (entry[pc] >= 0)
+         prog->block[pc] = voidptr_to_block(prog->func.store + entry[pc]);
+   }
+
+   FREE(native);
+   FREE(leader);
+   FREE(entry);
+   FREE(c.returns);
+   return prog;
+
+fail:
+   FREE(native);
+   FREE(leader);
+   FREE(entry);
+   FREE(c.returns);
+   tgsi_sse_destroy(prog);
+   return NULL;
+}
+
+
+void
+tgsi_sse_destroy(struct tgsi_sse_program *prog)
+{
+   if (prog) {
+      x86_release_func(&prog->func);
+      FREE(prog->block);
+      FREE(prog);
+   }
+}
+
+
+/**
+ * Run the shader from mach->pc to its end, the compiled blocks natively
+ * and the rest through the interpreter.  Returns FALSE without running
+ * anything if the bound constant buffers are smaller than the blocks
+ * assume, as only the interpreter bounds-checks constants.
+ */
+boolean
+tgsi_sse_run(const struct tgsi_sse_program *prog,
+             struct tgsi_exec_machine *mach)
+{
+   unsigned i;
+
+   if (mach->OutputVertexOffset)
+      return FALSE;
+
+   for (i = 0; i < prog->num_const_bufs; i++) {
+      if (mach->ConstsSize[i] < prog->const_size[i])
+         return FALSE;
+   }
+
+   while (mach->pc != -1) {
+      const tgsi_sse_block block = prog->block[mach->pc];
+
+      assert(mach->pc < (int) mach->NumInstructions);
+      if (block)
+         mach->pc = block(mach, &sse_data);
+      else
+         mach->pc = tgsi_exec_machine_step(mach, mach->pc);
+   }
+
+   return TRUE;
+}
+
+
+#else
+
+struct tgsi_sse_program *
+tgsi_sse_compile(const struct tgsi_exec_machine *mach)
+{
+   return NULL;
+}
+
+void
+tgsi_sse_destroy(struct tgsi_sse_program *prog)
+{
+}
+
+boolean
+tgsi_sse_run(const struct tgsi_sse_program *prog,
+             struct tgsi_exec_machine *mach)
+{
+   return FALSE;
+}
+
+#endif
@@ -31,12 +31,15 @@
 #include "util/format/u_format.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "util/os_time.h"
 #include "util/u_simple_shaders.h"
 #include "util/u_surface.h"
 #include "util/u_string.h"
 #include "util/u_tile.h"
+#include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_strings.h"
 #include "tgsi/tgsi_text.h"
+#include "nir/tgsi_to_nir.h"
 #include "cso_cache/cso_context.h"
 #include "frontend/winsys_handle.h"
 #include <stdio.h>
@@ -299,6 +302,28 @@ util_report_result_helper(int status, const char *name, ...)
 
 #define util_report_result(status) util_report_result_helper(status, __func__)
 
+/**
+ * Print how long each of \p count repetitions of a benchmark took, or that
+ * it can't be timed because it rendered the wrong thing.
+ */
+static void
+util_report_bench_helper(bool valid, int64_t elapsed, unsigned count,
+                         const char *unit, const char *name, ...)
+{
+   char buf[256];
+   va_list ap;
+
+   va_start(ap, name);
+   vsnprintf(buf, sizeof(buf), name, ap);
+   va_end(ap);
+
+   if (valid)
+      printf("Bench(%s) = %.3f ms per %s\n", buf,
+             elapsed / 1e6 / count, unit);
+   else
+      printf("Bench(%s) = invalid result\n", buf);
+}
+
 /**
  * Test TGSI_PROPERTY_VS_WINDOW_SPACE_POSITION.
  *
@@ -516,6 +541,531 @@ disabled_fragment_shader(struct pipe_context *ctx)
    util_report_result(qresult.u64 == 2);
 }
 
+/**
+ * Fill rate: clear a large color buffer and draw full-screen quads over
+ * it a number of times, and report the time per frame.  The last quad
+ * must cover every tile, however the driver splits up the work.
+ */
+static void
+bench_fullscreen_fill_rate(struct pipe_context *ctx, unsigned width,
+                           unsigned height)
+{
+   static const unsigned num_frames = 4, num_quads = 16;
+   static const float clear_color[] = {0.1, 0.1, 0.1, 0.1};
+   static const float expected[] = {0, 0.5, 1, 1};
+   struct cso_context *cso;
+   struct pipe_resource *cb;
+   void *fs, *vs;
+   int64_t start, elapsed;
+   unsigned f, q;
+   bool pass;
+
+   cso = cso_create_context(ctx, 0);
+   cb = util_create_texture2d(ctx->screen, width, height,
+                              PIPE_FORMAT_R8G8B8A8_UNORM, 0);
+   util_set_common_states_and_clear(cso, ctx, cb);
+
+   fs = util_make_fragment_passthrough_shader(ctx, TGSI_SEMANTIC_GENERIC,
+                                       TGSI_INTERPOLATE_LINEAR, TRUE);
+   cso_set_fragment_shader_handle(cso, fs);
+   vs = util_set_passthrough_vertex_shader(cso, ctx, false);
+
+   start = os_time_get_nano();
+   for (f = 0; f < num_frames; f++) {
+      ctx->clear(ctx, PIPE_CLEAR_COLOR0, NULL, (void*)clear_color, 0, 0);
+      for (q = 0; q < num_quads; q++) {
+         util_draw_fullscreen_quad_fill(cso,
+                                        (float)(num_quads - 1 - q) / num_quads,
+                                        0.5, 1, 1);
+      }
+      ctx->flush(ctx, NULL, 0);
+   }
+   elapsed = os_time_get_nano() - start;
+
+   pass = util_probe_rect_rgba(ctx, cb, 0, 0, width, height, expected);
+
+   /* Cleanup. */
+   cso_destroy_context(cso);
+   ctx->delete_vs_state(ctx, vs);
+   ctx->delete_fs_state(ctx, fs);
+   pipe_resource_reference(&cb, NULL);
+
+   util_report_bench_helper(pass, elapsed, num_frames, "frame",
+                            "%s(%ux%u)", __func__, width, height);
+}
+
+static struct pipe_resource *
+textured_fill_rate_texture(struct pipe_context *ctx, enum pipe_format format,
+                           unsigned width, unsigned height, const void *data)
+{
+   struct pipe_resource templ = {0}, *tex;
+   struct pipe_box box;
+
+   templ.target = PIPE_TEXTURE_2D;
+   templ.width0 = width;
+   templ.height0 = height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.format = format;
+   templ.usage = PIPE_USAGE_DEFAULT;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW;
+
+   tex = ctx->screen->resource_create(ctx->screen, &templ);
+   if (tex) {
+      u_box_2d(0, 0, width, height, &box);
+      ctx->texture_subdata(ctx, tex, 0, 0, &box, data,
+                           width * util_format_get_blocksize(format), 0);
+   }
+   return tex;
+}
+
+/**
+ * Draw \p num_frames frames of full-screen quads that repeat a small 8 bit
+ * texture a few times, and return how long that took in \p elapsed.  Then
+ * draw the same with a float texture holding the same texels, which
+ * drivers sample with their generic code, and check that both give the
+ * same picture.
+ */
+static bool
+draw_textured_quads(struct pipe_context *ctx, enum pipe_format format,
+                    enum pipe_tex_filter filter, unsigned size,
+                    unsigned num_frames, int64_t *elapsed)
+{
+   static const unsigned tex_width = 61, tex_height = 37, num_quads = 4;
+   static const float vertices[] = {
+     -1, -1, 0, 1,   -1.25, -1.25, 0, 1,
+     -1,  1, 0, 1,   -1.25,  2.75, 0, 1,
+      1,  1, 0, 1,    2.75,  2.75, 0, 1,
+      1, -1, 0, 1,    2.75, -1.25, 0, 1
+   };
+   const enum pipe_format formats[2] = {
+      format, PIPE_FORMAT_R32G32B32A32_FLOAT
+   };
+   const unsigned blocksize = util_format_get_blocksize(format);
+   struct pipe_sampler_state sampler = {0};
+   const struct pipe_sampler_state *samplers[] = {&sampler};
+   struct pipe_resource *cb[2] = {NULL}, *tex[2] = {NULL};
+   struct cso_context *cso;
+   uint8_t *texels;
+   float *rgba, *pixels[2];
+   float max_error = 0;
+   void *fs, *vs;
+   unsigned i, f, q;
+
+   texels = malloc(tex_width * tex_height * blocksize);
+   rgba = malloc(tex_width * tex_height * 4 * sizeof(float));
+   for (i = 0; i < tex_width * tex_height * blocksize; i++)
+      texels[i] = (i * 37 + (i >> 5) * 11) & 0xff;
+   util_format_unpack_rgba(format, rgba, texels, tex_width * tex_height);
+
+   tex[0] = textured_fill_rate_texture(ctx, format, tex_width, tex_height,
+                                       texels);
+   tex[1] = textured_fill_rate_texture(ctx, formats[1], tex_width,
+                                       tex_height, rgba);
+
+   sampler.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_t = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   sampler.min_img_filter = filter;
+   sampler.mag_img_filter = filter;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler.normalized_coords = 1;
+
+   cso = cso_create_context(ctx, 0);
+   fs = util_make_fragment_tex_shader(ctx, TGSI_TEXTURE_2D,
+                                      TGSI_RETURN_TYPE_FLOAT,
+                                      TGSI_RETURN_TYPE_FLOAT, false, false);
+
+   for (i = 0; i < 2; i++) {
+      struct pipe_sampler_view templ = {0}, *view;
+
+      cb[i] = util_create_texture2d(ctx->screen, size, size,
+                                    PIPE_FORMAT_R32G32B32A32_FLOAT, 0);
+      util_set_common_states_and_clear(cso, ctx, cb[i]);
+      cso_set_fragment_shader_handle(cso, fs);
+      vs = util_set_passthrough_vertex_shader(cso, ctx, false);
+      cso_set_samplers(cso, PIPE_SHADER_FRAGMENT, 1, samplers);
+
+      templ.format = formats[i];
+      templ.target = PIPE_TEXTURE_2D;
+      templ.swizzle_r = PIPE_SWIZZLE_X;
+      templ.swizzle_g = PIPE_SWIZZLE_Y;
+      templ.swizzle_b = PIPE_SWIZZLE_Z;
+      templ.swizzle_a = PIPE_SWIZZLE_W;
+      view = ctx->create_sampler_view(ctx, tex[i], &templ);
+      ctx->set_sampler_views(ctx, PIPE_SHADER_FRAGMENT, 0, 1, 0, false,
+                             &view);
+      util_set_interleaved_vertex_elements(cso, 2);
+
+      int64_t start = os_time_get_nano();
+      for (f = 0; f < (i == 0 ? num_frames : 1); f++) {
+         for (q = 0; q < num_quads; q++)
+            util_draw_user_vertex_buffer(cso, (void *)vertices,
+                                         PIPE_PRIM_QUADS, 4, 2);
+         ctx->flush(ctx, NULL, 0);
+      }
+      if (i == 0)
+         *elapsed = os_time_get_nano() - start;
+
+      ctx->set_sampler_views(ctx, PIPE_SHADER_FRAGMENT, 0, 0, 1, false,
+                             NULL);
+      pipe_sampler_view_reference(&view, NULL);
+      cso_set_vertex_shader_handle(cso, NULL);
+      ctx->delete_vs_state(ctx, vs);
+   }
+
+   for (i = 0; i < 2; i++) {
+      struct pipe_transfer *transfer;
+      void *map;
+
+      pixels[i] = malloc(size * size * 4 * sizeof(float));
+      map = pipe_texture_map(ctx, cb[i], 0, 0, PIPE_MAP_READ,
+                             0, 0, size, size, &transfer);
+      pipe_get_tile_rgba(transfer, map, 0, 0, size, size, cb[i]->format,
+                         pixels[i]);
+      pipe_texture_unmap(ctx, transfer);
+   }
+   for (i = 0; i < size * size * 4; i++)
+      max_error = MAX2(max_error, fabsf(pixels[0][i] - pixels[1][i]));
+
+   /* Cleanup. */
+   cso_destroy_context(cso);
+   ctx->delete_fs_state(ctx, fs);
+   for (i = 0; i < 2; i++) {
+      pipe_resource_reference(&cb[i], NULL);
+      pipe_resource_reference(&tex[i], NULL);
+      free(pixels[i]);
+   }
+   free(texels);
+   free(rgba);
+
+   return max_error < TOLERANCE;
+}
+
+/**
+ * Check that sampling an 8 bit texture gives the same picture as sampling
+ * a float texture with the same texels.
+ */
+static void
+textured_8bit_sampling(struct pipe_context *ctx, enum pipe_format format,
+                       enum pipe_tex_filter filter)
+{
+   int64_t elapsed;
+   int status = SKIP;
+
+   if (ctx->screen->is_format_supported(ctx->screen, format,
+                                        PIPE_TEXTURE_2D, 0, 0,
+                                        PIPE_BIND_SAMPLER_VIEW))
+      status = draw_textured_quads(ctx, format, filter, 64, 1, &elapsed);
+
+   util_report_result_helper(status, "%s(%s, %s)", __func__,
+                             util_format_short_name(format),
+                             filter == PIPE_TEX_FILTER_LINEAR ?
+                                "linear" : "nearest");
+}
+
+/**
+ * Textured fill rate: report the time per frame of full-screen quads that
+ * repeat a small 8 bit texture.
+ */
+static void
+bench_textured_fill_rate(struct pipe_context *ctx, enum pipe_format format,
+                         enum pipe_tex_filter filter)
+{
+   static const unsigned num_frames = 4;
+   int64_t elapsed;
+   bool pass;
+
+   if (!ctx->screen->is_format_supported(ctx->screen, format,
+                                         PIPE_TEXTURE_2D, 0, 0,
+                                         PIPE_BIND_SAMPLER_VIEW))
+      return;
+
+   pass = draw_textured_quads(ctx, format, filter, 512, num_frames,
+                              &elapsed);
+
+   util_report_bench_helper(pass, elapsed, num_frames, "frame",
+                            "%s(%s, %s)", __func__,
+                            util_format_short_name(format),
+                            filter == PIPE_TEX_FILTER_LINEAR ?
+                               "linear" : "nearest");
+}
+
+/**
+ * Draw \p num_verts vertices of small triangles, some of which need
+ * clipping, in one draw call, and return how long that took in
+ * \p elapsed.  Then draw the same triangles in draw calls too small for
+ * the draw module to split across threads, and check that both give the
+ * same picture.
+ */
+static bool
+draw_small_triangles(struct pipe_context *ctx, unsigned num_verts,
+                     int64_t *elapsed)
+{
+   static const char *text =
+         "VERT\n"
+         "DCL IN[0]\n"
+         "DCL IN[1]\n"
+         "DCL OUT[0], POSITION\n"
+         "DCL OUT[1], GENERIC[0]\n"
+         "DCL TEMP[0..1]\n"
+         "IMM[0] FLT32 { 0.5, 0.25, 2.0, 1.0 }\n"
+         "MAD TEMP[0], IN[1], IMM[0].xxxx, IMM[0].yyyy\n"
+         "DP4 TEMP[1].x, TEMP[0], IN[0]\n"
+         "MAD TEMP[0], TEMP[1].xxxx, IMM[0].yyyy, TEMP[0]\n"
+         "MOV OUT[0], IN[0]\n"
+         "MOV_SAT OUT[1], TEMP[0]\n"
+         "END\n";
+   static const unsigned size = 256, small_draw = 510;
+   struct pipe_shader_state state = {0};
+   struct tgsi_token tokens[1000];
+   struct pipe_resource *cb[2] = {NULL}, *vbuf;
+   struct cso_context *cso;
+   float *vertices, *pixels[2];
+   float max_error = 0;
+   void *fs, *vs;
+   unsigned i, v;
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+      assert(0);
+      return false;
+   }
+
+   /* Tiny triangles all over the window, and every 97th a large one
+    * sticking out of it.
+    */
+   vertices = malloc(num_verts * 8 * sizeof(float));
+   for (v = 0; v < num_verts; v++) {
+      const unsigned t = v / 3, cell = t % (128 * 128);
+      const float scale = t % 97 ? 1 : 100;
+      float *vert = &vertices[v * 8];
+
+      vert[0] = (cell % 128) / 64.0f - 1 +
+                (v % 3 == 1) * scale * ((t * 37) % 11 + 1) / 1024.0f;
+      vert[1] = (cell / 128) / 64.0f - 1 +
+                (v % 3 == 2) * scale * ((t * 53) % 13 + 1) / 1024.0f;
+      vert[2] = ((v * 29) % 101) / 100.0f;
+      vert[3] = 1;
+      vert[4] = ((v * 7) % 256) / 255.0f;
+      vert[5] = ((v * 13) % 256) / 255.0f;
+      vert[6] = (t % 64) / 63.0f;
+      vert[7] = 1;
+   }
+   vbuf = pipe_buffer_create_with_data(ctx, PIPE_BIND_VERTEX_BUFFER,
+                                       PIPE_USAGE_IMMUTABLE,
+                                       num_verts * 8 * sizeof(float),
+                                       vertices);
+   free(vertices);
+
+   cso = cso_create_context(ctx, 0);
+   fs = util_make_fragment_passthrough_shader(ctx, TGSI_SEMANTIC_GENERIC,
+                                       TGSI_INTERPOLATE_LINEAR, TRUE);
+   pipe_shader_state_from_tgsi(&state, tokens);
+   vs = ctx->create_vs_state(ctx, &state);
+
+   for (i = 0; i < 2; i++) {
+      cb[i] = util_create_texture2d(ctx->screen, size, size,
+                                    PIPE_FORMAT_R32G32B32A32_FLOAT, 0);
+      util_set_common_states_and_clear(cso, ctx, cb[i]);
+      cso_set_fragment_shader_handle(cso, fs);
+      cso_set_vertex_shader_handle(cso, vs);
+      util_set_interleaved_vertex_elements(cso, 2);
+
+      int64_t start = os_time_get_nano();
+      if (i == 0) {
+         util_draw_vertex_buffer(ctx, cso, vbuf, 0, 0, PIPE_PRIM_TRIANGLES,
+                                 num_verts, 2);
+      }
+      else {
+         for (v = 0; v < num_verts; v += small_draw) {
+            util_draw_vertex_buffer(ctx, cso, vbuf, 0,
+                                    v * 8 * sizeof(float),
+                                    PIPE_PRIM_TRIANGLES,
+                                    MIN2(small_draw, num_verts - v), 2);
+         }
+      }
+      ctx->flush(ctx, NULL, 0);
+      if (i == 0)
+         *elapsed = os_time_get_nano() - start;
+   }
+
+   for (i = 0; i < 2; i++) {
+      struct pipe_transfer *transfer;
+      void *map;
+
+      pixels[i] = malloc(size * size * 4 * sizeof(float));
+      map = pipe_texture_map(ctx, cb[i], 0, 0, PIPE_MAP_READ,
+                             0, 0, size, size, &transfer);
+      pipe_get_tile_rgba(transfer, map, 0, 0, size, size, cb[i]->format,
+                         pixels[i]);
+      pipe_texture_unmap(ctx, transfer);
+   }
+   for (i = 0; i < size * size * 4; i++)
+      max_error = MAX2(max_error, fabsf(pixels[0][i] - pixels[1][i]));
+
+   /* Cleanup. */
+   cso_destroy_context(cso);
+   ctx->delete_vs_state(ctx, vs);
+   ctx->delete_fs_state(ctx, fs);
+   for (i = 0; i < 2; i++) {
+      pipe_resource_reference(&cb[i], NULL);
+      free(pixels[i]);
+   }
+   pipe_resource_reference(&vbuf, NULL);
+
+   return max_error == 0;
+}
+
+/**
+ * Check that triangles drawn in one large draw call, which the draw module
+ * may split across threads, give the same picture as in small ones.
+ */
+static void
+large_draw_call(struct pipe_context *ctx)
+{
+   int64_t elapsed;
+
+   util_report_result(draw_small_triangles(ctx, 30003, &elapsed));
+}
+
+/**
+ * Triangle throughput: report the time of a draw call of a million
+ * vertices of small triangles.
+ */
+static void
+bench_triangle_throughput(struct pipe_context *ctx)
+{
+   static const unsigned num_verts = 1000002;
+   int64_t elapsed;
+   bool pass;
+
+   pass = draw_small_triangles(ctx, num_verts, &elapsed);
+
+   util_report_bench_helper(pass, elapsed, 1, "draw call", "%s(%u vertices)",
+                            __func__, num_verts);
+}
+
+static const char *format_conversion_names[] = {
+   "unpack to 8unorm", "unpack to float",
+   "pack from 8unorm", "pack from float",
+};
+
+/**
+ * Convert an image of the format to and from R8G8B8A8_UNORM and
+ * R32G32B32A32_FLOAT a row at a time, like glReadPixels and glTexImage do,
+ * with the generated code and with what util_format_[un]pack_description()
+ * picks for the CPU.  Return the time of each in \p elapsed, and whether
+ * both gave the same result.
+ */
+static bool
+convert_format_rows(enum pipe_format format, unsigned width, unsigned height,
+                    int64_t elapsed[][2])
+{
+   const struct util_format_unpack_description *unpack[2] = {
+      util_format_unpack_description_generic(format),
+      util_format_unpack_description(format),
+   };
+   const struct util_format_pack_description *pack[2] = {
+      util_format_pack_description_generic(format),
+      util_format_pack_description(format),
+   };
+   const size_t size = width * height * 4 * sizeof(float);
+   uint8_t *src_8unorm, *out[2];
+   float *src_float;
+   unsigned c, i, x, y;
+   bool pass = true;
+
+   /* Floats from -0.1 to 1.1 to exercise the clamping too */
+   src_8unorm = malloc(width * height * 4);
+   src_float = malloc(size);
+   for (x = 0; x < width * height * 4; x++) {
+      src_8unorm[x] = (x * 7919) >> 3;
+      src_float[x] = (x * 7919 % 1201) / 1000.0f - 0.1f;
+   }
+   out[0] = malloc(size);
+   out[1] = malloc(size);
+
+   for (c = 0; c < ARRAY_SIZE(format_conversion_names); c++) {
+      for (i = 0; i < 2; i++) {
+         memset(out[i], 0, size);
+
+         int64_t start = os_time_get_nano();
+         for (y = 0; y < height; y++) {
+            const unsigned row = y * width * 4;
+
+            switch (c) {
+            case 0:
+               unpack[i]->unpack_rgba_8unorm(out[i] + row, src_8unorm + row,
+                                             width);
+               break;
+            case 1:
+               unpack[i]->unpack_rgba((float *)out[i] + row,
+                                      src_8unorm + row, width);
+               break;
+            case 2:
+               pack[i]->pack_rgba_8unorm(out[i] + row, 0, src_8unorm + row, 0,
+                                         width, 1);
+               break;
+            case 3:
+               pack[i]->pack_rgba_float(out[i] + row, 0, src_float + row, 0,
+                                        width, 1);
+               break;
+            }
+         }
+         elapsed[c][i] = os_time_get_nano() - start;
+      }
+
+      if (memcmp(out[0], out[1], size))
+         pass = false;
+   }
+
+   free(src_8unorm);
+   free(src_float);
+   free(out[0]);
+   free(out[1]);
+
+   return pass;
+}
+
+/**
+ * Check that the pack and unpack code picked for the CPU gives the same
+ * result as the generated code, on rows of an odd width.
+ */
+static void
+format_conversion(enum pipe_format format)
+{
+   int64_t elapsed[ARRAY_SIZE(format_conversion_names)][2];
+
+   util_report_result_helper(convert_format_rows(format, 67, 13, elapsed),
+                             "%s(%s)", __func__,
+                             util_format_short_name(format));
+}
+
+/**
+ * Pack and unpack throughput: report the time to convert a full HD image
+ * of the format with the generated code and with the code for the CPU.
+ */
+static void
+bench_format_conversion(enum pipe_format format)
+{
+   int64_t elapsed[ARRAY_SIZE(format_conversion_names)][2];
+   unsigned c;
+   bool pass;
+
+   pass = convert_format_rows(format, 1920, 1080, elapsed);
+
+   for (c = 0; c < ARRAY_SIZE(format_conversion_names); c++) {
+      util_report_bench_helper(pass, elapsed[c][0], 1, "image",
+                               "%s(%s, %s, generic)", __func__,
+                               util_format_short_name(format),
+                               format_conversion_names[c]);
+      util_report_bench_helper(pass, elapsed[c][1], 1, "image",
+                               "%s(%s, %s, this CPU)", __func__,
+                               util_format_short_name(format),
+                               format_conversion_names[c]);
+   }
+}
+
 #if defined(PIPE_OS_LINUX) && defined(HAVE_LIBDRM)
 #include <libsync.h>
 #else
@@ -884,6 +1434,224 @@ nv12_validate_resource_fields(struct pipe_resource *tex)
          tex->next->usage == tex->usage;
 }
 
+static const char *tgsi_exec_jit_arith_text =
+      "VERT\n"
+      "DCL IN[0]\n"
+      "DCL IN[1]\n"
+      "DCL OUT[0], POSITION\n"
+      "DCL OUT[1], GENERIC[0]\n"
+      "DCL OUT[2], GENERIC[1]\n"
+      "DCL OUT[3], GENERIC[2]\n"
+      "DCL OUT[4], GENERIC[3]\n"
+      "DCL CONST[0][0..2]\n"
+      "DCL TEMP[0..3]\n"
+      "IMM[0] FLT32 { 0.5, 2.0, -1.0, 0.25}\n"
+
+      "  0: MAD TEMP[0], IN[0], CONST[0][0], IN[1].yzwx\n"
+      "  1: DP4 TEMP[1].x, TEMP[0], CONST[0][1]\n"
+      "  2: DP3 TEMP[1].y, -TEMP[0], IN[1]\n"
+      "  3: DP2 TEMP[1].zw, TEMP[0].wzyx, |IN[0]|\n"
+      "  4: LRP TEMP[2], IMM[0].xxxx, IN[0], -IN[1]\n"
+      "  5: CMP TEMP[3], IN[0].wzyx, TEMP[2], |TEMP[0]|\n"
+      "  6: MUL_SAT OUT[1], TEMP[3], IMM[0].yyyy\n"
+      "  7: SLT TEMP[2].x, IN[0].xxxx, IN[1].yyyy\n"
+      "  8: SGE TEMP[2].y, IN[0].yyyy, IN[1].xxxx\n"
+      "  9: SEQ TEMP[2].z, IN[0].zzzz, TEMP[0].zzzz\n"
+      " 10: SNE TEMP[2].w, IN[0].wwww, IN[1].wwww\n"
+      " 11: IF TEMP[2].xxxx :15\n"
+      " 12:   RSQ TEMP[3].x, |TEMP[1].xxxx|\n"
+      " 13:   RCP TEMP[3].y, TEMP[1].yyyy\n"
+      " 14:   SQRT TEMP[3].zw, |TEMP[1].zzzz|\n"
+      " 15: ELSE :18\n"
+      " 16:   MIN TEMP[3], TEMP[1], TEMP[2]\n"
+      " 17:   MAX TEMP[3].xy, TEMP[3], -TEMP[0]\n"
+      " 18: ENDIF\n"
+      " 19: ADD TEMP[0], TEMP[0], TEMP[3]\n"
+      " 20: DIV TEMP[1], TEMP[1], CONST[0][2]\n"
+      " 21: MOV OUT[0], TEMP[0]\n"
+      " 22: FLR OUT[2].x, TEMP[1].xxxx\n"
+      " 23: FRC OUT[2].y, TEMP[1].yyyy\n"
+      " 24: ROUND OUT[2].z, TEMP[1].zzzz\n"
+      " 25: TRUNC OUT[2].w, TEMP[1].wwww\n"
+      " 26: CEIL OUT[3], TEMP[1]\n"
+      " 27: MOV OUT[4], TEMP[2]\n"
+      " 28: END\n";
+
+static const char *tgsi_exec_jit_tex_text =
+      "VERT\n"
+      "DCL IN[0]\n"
+      "DCL IN[1]\n"
+      "DCL OUT[0], POSITION\n"
+      "DCL OUT[1], GENERIC[0]\n"
+      "DCL OUT[2], GENERIC[1]\n"
+      "DCL OUT[3], GENERIC[2]\n"
+      "DCL OUT[4], GENERIC[3]\n"
+      "DCL SAMP[0]\n"
+      "DCL SAMP[1]\n"
+      "DCL TEMP[0..3]\n"
+      "IMM[0] FLT32 { 0.5, 2.0, -1.0, 0.25}\n"
+
+      "  0: MAD TEMP[0], IN[0], IMM[0].xxxx, IN[1]\n"
+      "  1: MAD TEMP[0].w, |IN[1].wwww|, IMM[0].yyyy, IMM[0].xxxx\n"
+      "  2: TEX TEMP[1], TEMP[0], SAMP[0], 2D\n"
+      "  3: SLT TEMP[2], IN[0], IN[1]\n"
+      "  4: IF TEMP[2].xxxx :10\n"
+      "  5:   TXP TEMP[3], TEMP[0], SAMP[1], 2D\n"
+      "  6:   IF TEMP[2].yyyy :8\n"
+      "  7:     TXB TEMP[1].xzw, TEMP[3].yxzw, SAMP[0], SHADOW2D\n"
+      "  8:   ENDIF\n"
+      "  9:   MUL TEMP[1], TEMP[1], TEMP[3]\n"
+      " 10: ELSE :13\n"
+      " 11:   TEX_SAT TEMP[3].yz, -TEMP[0], SAMP[1], 3D\n"
+      " 12:   ADD TEMP[1], TEMP[1], TEMP[3]\n"
+      " 13: ENDIF\n"
+      " 14: MOV OUT[0], TEMP[0]\n"
+      " 15: MOV OUT[1], TEMP[1]\n"
+      " 16: MOV OUT[2], TEMP[2]\n"
+      " 17: MOV OUT[3], TEMP[3]\n"
+      " 18: MOV OUT[4], IN[1]\n"
+      " 19: END\n";
+
+/**
+ * Sampler for tgsi_exec_jit: the color depends on everything the machine
+ * passes, so that any difference in it shows.
+ */
+static void
+tgsi_exec_jit_get_samples(struct tgsi_sampler *sampler,
+                          const unsigned sview_index,
+                          const unsigned sampler_index,
+                          const float s[TGSI_QUAD_SIZE],
+                          const float t[TGSI_QUAD_SIZE],
+                          const float r[TGSI_QUAD_SIZE],
+                          const float c0[TGSI_QUAD_SIZE],
+                          const float c1[TGSI_QUAD_SIZE],
+                          float derivs[3][2][TGSI_QUAD_SIZE],
+                          const int8_t offset[3],
+                          enum tgsi_sampler_control control,
+                          float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   unsigned j;
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      rgba[0][j] = s[j] * 2.0f + sview_index;
+      rgba[1][j] = t[j] - r[j] * 0.5f + offset[0];
+      rgba[2][j] = c0[j] + c1[j] * 3.0f + control;
+      rgba[3][j] = s[j] * t[j] + sampler_index + (derivs != NULL);
+   }
+}
+
+/**
+ * Run a vertex shader through tgsi_exec with and without the code
+ * tgsi_sse.c compiles for it, on random inputs, and return the time each
+ * took in \p time.  The outputs must be identical.
+ */
+static bool
+run_tgsi_exec_jit(const char *text, unsigned num_quads, int64_t time[2],
+                  bool *compiled)
+{
+   static const unsigned num_outputs = 5;
+   struct tgsi_sampler sampler = {0};
+   struct tgsi_exec_machine *mach[2];
+   struct tgsi_token tokens[1000];
+   float consts[12];
+   const void *bufs[1] = { consts };
+   const unsigned sizes[1] = { sizeof(consts) };
+   bool pass = true;
+   unsigned i, q, m;
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+      assert(0);
+      return false;
+   }
+
+   sampler.get_samples = tgsi_exec_jit_get_samples;
+
+   srand(0x5eed);
+   for (i = 0; i < ARRAY_SIZE(consts); i++)
+      consts[i] = (rand() % 8000 + 1) / 1000.0f - 4.0005f;
+
+   for (m = 0; m < 2; m++) {
+      mach[m] = tgsi_exec_machine_create(PIPE_SHADER_VERTEX);
+      mach[m]->NoJit = m == 1;
+      tgsi_exec_machine_bind_shader(mach[m], tokens, &sampler, NULL, NULL);
+      tgsi_exec_set_constant_buffers(mach[m], 1, bufs, sizes);
+      time[m] = 0;
+   }
+   *compiled = mach[0]->Jit != NULL;
+
+   for (q = 0; q < num_quads && pass; q++) {
+      for (i = 0; i < 2 * 4 * 4; i++) {
+         float f = (rand() % 8000 + 1) / 1000.0f - 4.0005f;
+
+         for (m = 0; m < 2; m++)
+            mach[m]->Inputs[i / 16].xyzw[i / 4 % 4].f[i % 4] = f;
+      }
+
+      for (m = 0; m < 2; m++) {
+         int64_t start = os_time_get_nano();
+
+         tgsi_exec_machine_run(mach[m], 0);
+         time[m] += os_time_get_nano() - start;
+      }
+
+      pass = !memcmp(mach[0]->Outputs, mach[1]->Outputs,
+                     num_outputs * sizeof(struct tgsi_exec_vector));
+   }
+
+   for (m = 0; m < 2; m++) {
+      tgsi_exec_machine_bind_shader(mach[m], NULL, NULL, NULL, NULL);
+      tgsi_exec_machine_destroy(mach[m]);
+   }
+
+   return pass;
+}
+
+/**
+ * Check that the code tgsi_sse.c compiles gives the same outputs as the
+ * interpreter, for a vertex shader mixing arithmetic, flow control,
+ * constants and immediates, and one mixing texturing and flow control.
+ */
+static void
+tgsi_exec_jit(void)
+{
+   int64_t time[2];
+   bool compiled;
+
+   util_report_result_helper(run_tgsi_exec_jit(tgsi_exec_jit_arith_text,
+                                               10000, time, &compiled),
+                             "%s(arithmetic)", __func__);
+   util_report_result_helper(run_tgsi_exec_jit(tgsi_exec_jit_tex_text,
+                                               10000, time, &compiled),
+                             "%s(texturing)", __func__);
+}
+
+/**
+ * Shader throughput: report the time per quad of the tgsi_exec_jit shaders
+ * with the code tgsi_sse.c compiles for them, and in the interpreter.
+ */
+static void
+bench_tgsi_exec(void)
+{
+   static const unsigned num_quads = 100000;
+   const char *texts[2] = {
+      tgsi_exec_jit_arith_text, tgsi_exec_jit_tex_text
+   };
+   const char *names[2] = { "arithmetic", "texturing" };
+   int64_t time[2];
+   bool pass, compiled;
+   unsigned i;
+
+   for (i = 0; i < 2; i++) {
+      pass = run_tgsi_exec_jit(texts[i], num_quads, time, &compiled);
+
+      util_report_bench_helper(pass, time[0] * 1000, num_quads, "1000 quads",
+                               "%s(%s, %s)", __func__, names[i],
+                               compiled ? "compiled" : "not compiled");
+      util_report_bench_helper(pass, time[1] * 1000, num_quads, "1000 quads",
+                               "%s(%s, interpreter)", __func__, names[i]);
+   }
+}
+
 /* This test enforces the behavior of NV12 allocation and exports. */
 static void
 test_nv12(struct pipe_screen *screen)
@@ -1022,6 +1790,87 @@ cleanup:
    pipe_resource_reference(&tex, NULL);
 }
 
+/**
+ * Shader compile startup time: create the same set of distinct NIR
+ * fragment shaders in two contexts one after the other, the way a shader
+ * heavy program started twice would, and report the time each context
+ * spent in create_fs_state.  Drivers that cache their compiled shaders
+ * across contexts should be a lot faster the second time.
+ */
+static void
+bench_shader_compile_startup(struct pipe_screen *screen)
+{
+   static const unsigned num_shaders = 200;
+   struct pipe_shader_state state = {0};
+   struct tgsi_token tokens[1000];
+   char text[1024];
+   int64_t elapsed[2];
+   bool pass = true;
+   unsigned i, c;
+
+   if (screen->get_shader_param(screen, PIPE_SHADER_FRAGMENT,
+                                PIPE_SHADER_CAP_PREFERRED_IR) !=
+       PIPE_SHADER_IR_NIR)
+      return;
+
+   for (c = 0; c < 2; c++) {
+      struct pipe_context *ctx = screen->context_create(screen, NULL, 0);
+      void **fs = CALLOC(num_shaders, sizeof(void *));
+      nir_shader **nir = CALLOC(num_shaders, sizeof(nir_shader *));
+
+      /* Translate up front, so that only create_fs_state is timed. */
+      for (i = 0; i < num_shaders; i++) {
+         snprintf(text, sizeof(text),
+                  "FRAG\n"
+                  "DCL OUT[0], COLOR\n"
+                  "DCL TEMP[0..1]\n"
+                  "IMM[0] FLT32 { %f, %f, %f, %f }\n"
+                  "MAD TEMP[0], IMM[0], IMM[0].yzwx, IMM[0].zwxy\n"
+                  "SIN TEMP[1].x, TEMP[0].xxxx\n"
+                  "COS TEMP[1].y, TEMP[0].yyyy\n"
+                  "MAD TEMP[0], TEMP[1].xyxy, TEMP[0], IMM[0]\n"
+                  "EX2 TEMP[1].z, TEMP[0].zzzz\n"
+                  "LG2 TEMP[1].w, TEMP[0].wwww\n"
+                  "DP4 TEMP[0].x, TEMP[0], TEMP[1]\n"
+                  "MAD TEMP[0], TEMP[0].xxxx, IMM[0].wzyx, TEMP[1]\n"
+                  "MOV_SAT OUT[0], TEMP[0]\n"
+                  "END\n",
+                  i * 0.25, i * 0.5 + 1, 2.0 - i, i * 0.125 + 0.5);
+         if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+            assert(0);
+            pass = false;
+            break;
+         }
+         nir[i] = tgsi_to_nir(tokens, screen, false);
+      }
+
+      int64_t start = os_time_get_nano();
+      for (i = 0; pass && i < num_shaders; i++) {
+         state.type = PIPE_SHADER_IR_NIR;
+         state.ir.nir = nir[i];
+         nir[i] = NULL;
+         fs[i] = ctx->create_fs_state(ctx, &state);
+         pass = fs[i] != NULL;
+      }
+      elapsed[c] = os_time_get_nano() - start;
+
+      for (i = 0; i < num_shaders; i++) {
+         if (fs[i])
+            ctx->delete_fs_state(ctx, fs[i]);
+         ralloc_free(nir[i]);
+      }
+      FREE(fs);
+      FREE(nir);
+      ctx->destroy(ctx);
+   }
+
+   for (c = 0; c < 2; c++) {
+      util_report_bench_helper(pass, elapsed[c], num_shaders, "shader",
+                               "%s(%s context)", __func__,
+                               c == 0 ? "first" : "second");
+   }
+}
+
 /**
  * Run all tests. This should be run with a clean context after
  * context_create.
@@ -1037,6 +1886,18 @@ util_run_tests(struct pipe_screen *screen)
    null_sampler_view(ctx, TGSI_TEXTURE_BUFFER);
    util_test_constant_buffer(ctx, NULL);
    test_sync_file_fences(ctx);
+   textured_8bit_sampling(ctx, PIPE_FORMAT_B8G8R8A8_UNORM,
+                          PIPE_TEX_FILTER_LINEAR);
+   textured_8bit_sampling(ctx, PIPE_FORMAT_B8G8R8A8_UNORM,
+                          PIPE_TEX_FILTER_NEAREST);
+   textured_8bit_sampling(ctx, PIPE_FORMAT_R8G8B8A8_UNORM,
+                          PIPE_TEX_FILTER_LINEAR);
+   textured_8bit_sampling(ctx, PIPE_FORMAT_L8_UNORM, PIPE_TEX_FILTER_LINEAR);
+   textured_8bit_sampling(ctx, PIPE_FORMAT_A8_UNORM, PIPE_TEX_FILTER_NEAREST);
+   large_draw_call(ctx);
+   format_conversion(PIPE_FORMAT_B8G8R8A8_UNORM);
+   format_conversion(PIPE_FORMAT_B8G8R8X8_UNORM);
+   format_conversion(PIPE_FORMAT_R8G8B8A8_UNORM);
 
    for (int i = 1; i <= 8; i = i * 2)
       test_texture_barrier(ctx, false, i);
@@ -1049,6 +1910,42 @@ util_run_tests(struct pipe_screen *screen)
    ctx->destroy(ctx);
 
    test_nv12(screen);
+   tgsi_exec_jit();
+
+   puts("Done. Exiting..");
+   exit(0);
+}
+
+/**
+ * Run all benchmarks.  Unlike the tests, they take a while and only
+ * report timings.  This should be run with a clean context after
+ * context_create.
+ */
+void
+util_run_benchmarks(struct pipe_screen *screen)
+{
+   struct pipe_context *ctx = screen->context_create(screen, NULL, 0);
+
+   bench_fullscreen_fill_rate(ctx, 1920, 1080);
+   bench_fullscreen_fill_rate(ctx, 3840, 2160);
+   bench_textured_fill_rate(ctx, PIPE_FORMAT_B8G8R8A8_UNORM,
+                            PIPE_TEX_FILTER_LINEAR);
+   bench_textured_fill_rate(ctx, PIPE_FORMAT_B8G8R8A8_UNORM,
+                            PIPE_TEX_FILTER_NEAREST);
+   bench_textured_fill_rate(ctx, PIPE_FORMAT_R8G8B8A8_UNORM,
+                            PIPE_TEX_FILTER_LINEAR);
+   bench_textured_fill_rate(ctx, PIPE_FORMAT_L8_UNORM,
+                            PIPE_TEX_FILTER_LINEAR);
+   bench_textured_fill_rate(ctx, PIPE_FORMAT_A8_UNORM,
+                            PIPE_TEX_FILTER_NEAREST);
+   bench_triangle_throughput(ctx);
+   ctx->destroy(ctx);
+
+   bench_format_conversion(PIPE_FORMAT_B8G8R8A8_UNORM);
+   bench_format_conversion(PIPE_FORMAT_B8G8R8X8_UNORM);
+   bench_format_conversion(PIPE_FORMAT_R8G8B8A8_UNORM);
+   bench_shader_compile_startup(screen);
+   bench_tgsi_exec();
 
    puts("Done. Exiting..");
    exit(0);
@@ -38,12 +38,14 @@
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
 #include "util/u_debug_cb.h"
+#include "util/u_threaded_context.h"
 #include "tgsi/tgsi_exec.h"
 #include "sp_buffer.h"
 #include "sp_clear.h"
 #include "sp_context.h"
 #include "sp_flush.h"
 #include "sp_prim_vbuf.h"
+#include "sp_rast.h"
 #include "sp_state.h"
 #include "sp_surface.h"
 #include "sp_tile_cache.h"
@@ -67,6 +69,9 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
+   if (softpipe->rast)
+      sp_rast_destroy(softpipe->rast);
+
    if (softpipe->quad.shade)
       softpipe->quad.shade->destroy( softpipe->quad.shade );
 
@@ -180,6 +185,81 @@ softpipe_render_condition(struct pipe_context *pipe,
 }
 
 
+/**
+ * Called by u_threaded_context, in the order of the other calls, when it
+ * invalidated a buffer that queued calls still use: from now on dst is
+ * to use the storage of src, the new buffer the frontend has been
+ * writing to since.  The old storage goes with src.
+ */
+static void
+softpipe_replace_buffer_storage(struct pipe_context *pipe,
+                                struct pipe_resource *dst,
+                                struct pipe_resource *src,
+                                unsigned num_rebinds,
+                                uint32_t rebind_mask,
+                                uint32_t delete_buffer_id)
+{
+   struct softpipe_context *softpipe = softpipe_context(pipe);
+   struct softpipe_resource *dst_spr = softpipe_resource(dst);
+   struct softpipe_resource *src_spr = softpipe_resource(src);
+   const char *old_data = dst_spr->data;
+   void *data = src_spr->data;
+   boolean user_buffer = src_spr->userBuffer;
+   unsigned sh, i;
+
+   assert(dst->target == PIPE_BUFFER && !dst_spr->dt && !src_spr->dt);
+
+   src_spr->data = dst_spr->data;
+   src_spr->userBuffer = dst_spr->userBuffer;
+   dst_spr->data = data;
+   dst_spr->userBuffer = user_buffer;
+
+   /* Draws are done by the time they return, so only the state that
+    * caches pointers into the storage has to follow it.
+    */
+   draw_flush(softpipe->draw);
+
+   for (sh = 0; sh < ARRAY_SIZE(softpipe->constants); sh++) {
+      for (i = 0; i < ARRAY_SIZE(softpipe->constants[0]); i++) {
+         const char *mapped = softpipe->mapped_constants[sh][i];
+
+         if (softpipe->constants[sh][i] != dst || !mapped)
+            continue;
+
+         mapped = (const char *)data + (mapped - old_data);
+         softpipe->mapped_constants[sh][i] = mapped;
+         if (sh == PIPE_SHADER_VERTEX || sh == PIPE_SHADER_GEOMETRY)
+            draw_set_mapped_constant_buffer(softpipe->draw, sh, i, mapped,
+                                            softpipe->const_buffer_size[sh][i]);
+         softpipe->dirty |= SP_NEW_CONSTANTS;
+      }
+   }
+
+   for (i = 0; i < softpipe->num_so_targets; i++) {
+      if (softpipe->so_targets[i] &&
+          softpipe->so_targets[i]->target.buffer == dst) {
+         softpipe->so_targets[i]->mapping = data;
+         draw_set_mapped_so_targets(softpipe->draw, softpipe->num_so_targets,
+                                    softpipe->so_targets);
+      }
+   }
+
+   /* Buffer textures are read through the texture tile caches */
+   dst_spr->timestamp++;
+   softpipe->dirty |= SP_NEW_TEXTURE;
+}
+
+
+static bool
+softpipe_is_resource_busy(struct pipe_screen *screen,
+                          struct pipe_resource *resource,
+                          unsigned usage)
+{
+   /* Nothing is pending once the calls that use it have returned */
+   return false;
+}
+
+
 struct pipe_context *
 softpipe_create_context(struct pipe_screen *screen,
 			void *priv, unsigned flags)
@@ -251,10 +331,21 @@ softpipe_create_context(struct pipe_screen *screen,
    softpipe->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
 
    /* setup quad rendering stages */
+   softpipe->quad.state.fs_machine = softpipe->fs_machine;
+   softpipe->quad.state.cbuf_cache = softpipe->cbuf_cache;
+   softpipe->quad.state.zsbuf_cache = softpipe->zsbuf_cache;
+   softpipe->quad.state.occlusion_count = &softpipe->occlusion_count;
+   softpipe->quad.state.ps_invocations =
+      &softpipe->pipeline_statistics.ps_invocations;
    softpipe->quad.shade = sp_quad_shade_stage(softpipe);
    softpipe->quad.depth_test = sp_quad_depth_test_stage(softpipe);
    softpipe->quad.blend = sp_quad_blend_stage(softpipe);
 
+   if (sp_screen->num_threads > 1) {
+      /* carry on rasterizing on this thread alone if this fails */
+      softpipe->rast = sp_rast_create(softpipe, sp_screen->num_threads);
+   }
+
    softpipe->pipe.stream_uploader = u_upload_create_default(&softpipe->pipe);
    if (!softpipe->pipe.stream_uploader)
       goto fail;
@@ -330,7 +421,18 @@ softpipe_create_context(struct pipe_screen *screen,
 
    sp_init_surface_functions(softpipe);
 
-   return &softpipe->pipe;
+   if (!sp_screen->threaded || !(flags & PIPE_CONTEXT_PREFER_THREADED) ||
+       (flags & PIPE_CONTEXT_COMPUTE_ONLY))
+      return &softpipe->pipe;
+
+   /* This destroys the context if it fails */
+   return threaded_context_create(&softpipe->pipe, &sp_screen->transfer_pool,
+                                  softpipe_replace_buffer_storage,
+                                  &(struct threaded_context_options){
+                                     .is_resource_busy =
+                                        softpipe_is_resource_busy,
+                                  },
+                                  NULL);
 
  fail:
    softpipe_destroy(&softpipe->pipe);
@@ -49,6 +49,7 @@ struct sp_fragment_shader;
 struct sp_vertex_shader;
 struct sp_velems_state;
 struct sp_so_state;
+struct sp_rast;
 
 struct softpipe_context {
    struct pipe_context pipe;  /**< base class */
@@ -151,8 +152,12 @@ struct softpipe_context {
       struct quad_stage *depth_test;
       struct quad_stage *blend;
       struct quad_stage *first; /**< points to one of the above stages */
+      struct quad_pipe_state state; /**< the above stages render to this */
    } quad;
 
+   /** Binned rasterizer threads, NULL if rasterizing on this thread only */
+   struct sp_rast *rast;
+
    /** TGSI exec things */
    struct {
       struct sp_tgsi_sampler *sampler[PIPE_SHADER_TYPES];
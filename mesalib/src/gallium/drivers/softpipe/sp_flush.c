@@ -35,6 +35,7 @@
 #include "draw/draw_context.h"
 #include "sp_flush.h"
 #include "sp_context.h"
+#include "sp_rast.h"
 #include "sp_state.h"
 #include "sp_tile_cache.h"
 #include "sp_tex_tile_cache.h"
@@ -53,6 +54,9 @@ softpipe_flush( struct pipe_context *pipe,
 
    draw_flush(softpipe->draw);
 
+   if (softpipe->rast)
+      sp_rast_finish(softpipe->rast);
+
    if (flags & SP_FLUSH_TEXTURE_CACHE) {
       unsigned sh;
 
@@ -61,6 +65,9 @@ softpipe_flush( struct pipe_context *pipe,
             sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
          }
       }
+
+      if (softpipe->rast)
+         sp_rast_flush_texture_caches(softpipe->rast);
    }
 
    /* If this is a swapbuffers, just flush color buffers.
@@ -180,6 +187,11 @@ void softpipe_texture_barrier(struct pipe_context *pipe, unsigned flags)
       }
    }
 
+   if (softpipe->rast) {
+      sp_rast_flush_texture_caches(softpipe->rast);
+      sp_rast_finish(softpipe->rast);
+   }
+
    for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
       if (softpipe->cbuf_cache[i])
          sp_flush_tile_cache(softpipe->cbuf_cache[i]);
@@ -60,10 +60,16 @@ exec_prepare( const struct sp_fragment_shader_variant *var,
 {
    /*
     * Bind tokens/shader to the interpreter's machine state.
+    * Avoid rebinding, which parses and compiles the shader again.
     */
-   tgsi_exec_machine_bind_shader(machine,
-                                 var->tokens,
-                                 sampler, image, buffer);
+   if (machine->Tokens != var->tokens ||
+       machine->Sampler != sampler ||
+       machine->Image != image ||
+       machine->Buffer != buffer) {
+      tgsi_exec_machine_bind_shader(machine,
+                                    var->tokens,
+                                    sampler, image, buffer);
+   }
 }
 
 
@@ -40,6 +40,7 @@
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "sp_prim_vbuf.h"
+#include "sp_rast.h"
 #include "draw/draw_context.h"
 #include "draw/draw_vbuf.h"
 #include "util/u_memory.h"
@@ -345,6 +346,10 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   /* shade the binned triangles before anything can change the state */
+   if (softpipe->rast)
+      sp_rast_flush(softpipe->rast);
 }
 
 
@@ -585,6 +590,10 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   /* shade the binned triangles before anything can change the state */
+   if (softpipe->rast)
+      sp_rast_flush(softpipe->rast);
 }
 
 /*
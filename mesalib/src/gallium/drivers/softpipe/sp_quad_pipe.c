@@ -31,11 +31,36 @@
 #include "pipe/p_shader_tokens.h"
 
 
-static void
-insert_stage_at_head(struct softpipe_context *sp, struct quad_stage *quad)
+static struct quad_stage *
+insert_stage_at_head(struct quad_stage *first, struct quad_stage *quad)
 {
-   quad->next = sp->quad.first;
-   sp->quad.first = quad;
+   quad->next = first;
+   return quad;
+}
+
+
+/**
+ * Link the shade, depth test and blend stages in the order the current
+ * state needs and return the first one.
+ */
+struct quad_stage *
+sp_chain_quad_stages(struct softpipe_context *sp,
+                     struct quad_stage *shade,
+                     struct quad_stage *depth_test,
+                     struct quad_stage *blend)
+{
+   struct quad_stage *first = blend;
+
+   if (sp->early_depth) {
+      first = insert_stage_at_head( first, shade );
+      first = insert_stage_at_head( first, depth_test );
+   }
+   else {
+      first = insert_stage_at_head( first, depth_test );
+      first = insert_stage_at_head( first, shade );
+   }
+
+   return first;
 }
 
 
@@ -51,16 +76,8 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
        !sp->fs_variant->info.writes_stencil) ||
       sp->fs_variant->info.properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL];
 
-   sp->quad.first = sp->quad.blend;
-
    sp->early_depth = early_depth_test;
-   if (early_depth_test) {
-      insert_stage_at_head( sp, sp->quad.shade );
-      insert_stage_at_head( sp, sp->quad.depth_test );
-   }
-   else {
-      insert_stage_at_head( sp, sp->quad.depth_test );
-      insert_stage_at_head( sp, sp->quad.shade );
-   }
+   sp->quad.first = sp_chain_quad_stages(sp, sp->quad.shade,
+                                         sp->quad.depth_test,
+                                         sp->quad.blend);
 }
-
@@ -32,10 +32,30 @@
 #define SP_QUAD_PIPE_H
 
 
+#include "pipe/p_state.h"
+
+
 struct softpipe_context;
+struct softpipe_tile_cache;
+struct tgsi_exec_machine;
 struct quad_header;
 
 
+/**
+ * What the quad stages render with and count into: the fragment shader
+ * machine, the framebuffer tile caches and the query counters.  The
+ * context's stages use the context's own; each thread of the binned
+ * rasterizer (see sp_rast.c) has a set of its own.
+ */
+struct quad_pipe_state {
+   struct tgsi_exec_machine *fs_machine;
+   struct softpipe_tile_cache **cbuf_cache;
+   struct softpipe_tile_cache *zsbuf_cache;
+   uint64_t *occlusion_count;
+   uint64_t *ps_invocations;
+};
+
+
 /**
  * Fragment processing is performed on 2x2 blocks of pixels called "quads".
  * Quad processing is performed with a pipeline of stages represented by
@@ -43,6 +63,7 @@ struct quad_header;
  */
 struct quad_stage {
    struct softpipe_context *softpipe;
+   const struct quad_pipe_state *state;
 
    struct quad_stage *next;
 
@@ -68,4 +89,10 @@ struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
 void sp_build_quad_pipeline(struct softpipe_context *sp);
 
+struct quad_stage *
+sp_chain_quad_stages(struct softpipe_context *sp,
+                     struct quad_stage *shade,
+                     struct quad_stage *depth_test,
+                     struct quad_stage *blend);
+
 #endif /* SP_QUAD_PIPE_H */
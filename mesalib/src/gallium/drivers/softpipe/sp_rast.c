@@ -0,0 +1,833 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Binned, tile-parallel rasterization of triangles.
+ *
+ * Setup still walks each triangle's edges on the calling thread, but
+ * instead of running the quad pipeline on each 16x2 span it finds, it
+ * appends the span to the bin of the framebuffer tile the span falls in.
+ * A span never straddles two tiles.  When the vbuf draw call is done
+ * (see sp_prim_vbuf.c) the bins are shaded: every thread takes the bins
+ * of the tiles it is given and runs the same quads as setup would have,
+ * in the same order, through its own quad stages, fragment shader
+ * machine, texture caches and framebuffer tile caches.  As no two threads
+ * touch the same tile, the results are the same as rasterizing on one
+ * thread.
+ *
+ * That includes the rounding of colors, which the tile caches keep as
+ * floats until a tile is written back to the surface.  A tile is always
+ * given to the same thread, and its color tiles stay in that thread's
+ * caches from one scene to the next; when another thread needs them, they
+ * are moved over as they are.  sp_rast_finish() moves them all back to
+ * the context's caches before the context renders, clears or flushes on
+ * its own, so they are written back exactly where they would be with one
+ * thread.  Depth and stencil are cached as they are stored and are simply
+ * written back after every threaded scene.
+ *
+ * Thread 0 is the calling thread and renders with the context's own quad
+ * stages; the other threads get copies of the state they need when a
+ * scene is flushed.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_thread.h"
+#include "os/os_thread.h"
+#include "tgsi/tgsi_exec.h"
+
+#include "sp_context.h"
+#include "sp_limits.h"
+#include "sp_quad.h"
+#include "sp_quad_pipe.h"
+#include "sp_rast.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+
+
+/** Scenes with fewer spans than this are shaded on the calling thread */
+#define SP_RAST_MIN_SPANS 256
+
+/** Size of the blocks the binned triangles are stored in */
+#define SP_RAST_BLOCK_SIZE (64 * 1024)
+
+/** Quads in a span, as built by flush_spans() in sp_setup.c */
+#define SP_RAST_MAX_QUADS 8
+
+
+/**
+ * Up to 16x2 pixels of a triangle, as setup found them.
+ */
+struct sp_rast_span {
+   const struct sp_rast_prim *prim;
+   unsigned short x, y;
+   unsigned short mask0, mask1;   /**< two bits per quad, as in sp_setup.c */
+};
+
+
+/**
+ * The spans that fall in one framebuffer tile, in submission order.
+ */
+struct sp_rast_bin {
+   struct sp_rast_span *spans;
+   unsigned count;
+   unsigned size;
+   unsigned holder;   /**< thread whose caches hold the color tiles */
+};
+
+
+struct sp_rast_block {
+   struct sp_rast_block *next;
+   uint64_t used;
+   char data[];
+};
+
+
+struct sp_rast_thread {
+   struct sp_rast *rast;
+   unsigned index;
+
+   thrd_t thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+
+   /** Not used by thread 0, which renders with the context's own */
+   struct quad_pipe_state state;
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct tgsi_exec_machine *fs_machine;
+   struct sp_tgsi_sampler *sampler;
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct pipe_surface *cbuf[PIPE_MAX_COLOR_BUFS];
+   struct pipe_surface *zsbuf;
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+
+   struct quad_stage *first;     /**< points to one of the above stages */
+
+   unsigned first_bin;           /**< the bins to shade, in thread_bins */
+   unsigned num_bins;
+
+   struct quad_header quad[SP_RAST_MAX_QUADS];
+   struct quad_header *quad_ptrs[SP_RAST_MAX_QUADS];
+};
+
+
+struct sp_rast {
+   struct softpipe_context *softpipe;
+
+   unsigned num_threads;         /**< including the calling thread */
+   boolean exit_flag;
+   struct sp_rast_thread threads[SP_MAX_THREADS];
+
+   /** The scene: spans binned by tile */
+   struct sp_rast_bin *bins;
+   unsigned tiles_x, tiles_y;
+   unsigned max_bins;
+   unsigned *active_bins;        /**< indexes of the bins with spans */
+   unsigned num_active_bins;
+   unsigned *thread_bins;        /**< active_bins, sorted by thread */
+   unsigned num_spans;
+   unsigned num_prims;
+
+   /** The binned triangles */
+   struct sp_rast_block *blocks;
+   struct sp_rast_block *block;  /**< the one being filled, or NULL */
+};
+
+
+/**
+ * Allow binning to begin: size the bins to the framebuffer.
+ */
+static boolean
+begin_scene(struct sp_rast *rast)
+{
+   const struct pipe_framebuffer_state *fb = &rast->softpipe->framebuffer;
+   unsigned tiles_x = MAX2(DIV_ROUND_UP(fb->width, TILE_SIZE), 1);
+   unsigned tiles_y = MAX2(DIV_ROUND_UP(fb->height, TILE_SIZE), 1);
+   unsigned i;
+
+   if (tiles_x * tiles_y > rast->max_bins) {
+      for (i = 0; i < rast->max_bins; i++)
+         FREE(rast->bins[i].spans);
+      FREE(rast->bins);
+      FREE(rast->active_bins);
+      FREE(rast->thread_bins);
+
+      rast->bins = CALLOC(tiles_x * tiles_y, sizeof(*rast->bins));
+      rast->active_bins = MALLOC(tiles_x * tiles_y * sizeof(unsigned));
+      rast->thread_bins = MALLOC(tiles_x * tiles_y * sizeof(unsigned));
+      if (!rast->bins || !rast->active_bins || !rast->thread_bins) {
+         FREE(rast->bins);
+         FREE(rast->active_bins);
+         FREE(rast->thread_bins);
+         rast->bins = NULL;
+         rast->active_bins = NULL;
+         rast->thread_bins = NULL;
+         rast->max_bins = 0;
+         rast->tiles_x = 0;
+         rast->tiles_y = 0;
+         return FALSE;
+      }
+      rast->max_bins = tiles_x * tiles_y;
+   }
+
+   rast->tiles_x = tiles_x;
+   rast->tiles_y = tiles_y;
+   return TRUE;
+}
+
+
+static void
+reset_scene(struct sp_rast *rast)
+{
+   unsigned i;
+
+   for (i = 0; i < rast->num_active_bins; i++)
+      rast->bins[rast->active_bins[i]].count = 0;
+
+   rast->num_active_bins = 0;
+   rast->num_spans = 0;
+   rast->num_prims = 0;
+   rast->block = NULL;
+}
+
+
+/**
+ * Whether the triangles of the next draw can be binned.  Shaders with
+ * side effects run in primitive order on the calling thread.
+ */
+boolean
+sp_rast_can_bin(const struct softpipe_context *softpipe)
+{
+   return softpipe->rast &&
+          softpipe->fs_variant &&
+          !softpipe->fs_variant->info.writes_memory;
+}
+
+
+/**
+ * Make room in the scene for a triangle with \p num_inputs coefficients.
+ * \return NULL if out of memory
+ */
+struct sp_rast_prim *
+sp_rast_add_prim(struct sp_rast *rast, unsigned num_inputs)
+{
+   unsigned size = align(sizeof(struct sp_rast_prim) +
+                         num_inputs * sizeof(struct tgsi_interp_coef), 16);
+   struct sp_rast_block *block = rast->block;
+   struct sp_rast_prim *prim;
+
+   assert(size <= SP_RAST_BLOCK_SIZE);
+
+   if (rast->num_prims == 0 && !begin_scene(rast))
+      return NULL;
+
+   if (!block || block->used + size > SP_RAST_BLOCK_SIZE) {
+      struct sp_rast_block *next = block ? block->next : rast->blocks;
+
+      if (!next) {
+         next = align_malloc(sizeof(*next) + SP_RAST_BLOCK_SIZE, 16);
+         if (!next)
+            return NULL;
+         next->next = NULL;
+         if (block)
+            block->next = next;
+         else
+            rast->blocks = next;
+      }
+
+      next->used = 0;
+      rast->block = block = next;
+   }
+
+   prim = (struct sp_rast_prim *) (block->data + block->used);
+   block->used += size;
+   rast->num_prims++;
+
+   return prim;
+}
+
+
+/**
+ * Bin the span setup found at \p x, \p y for \p prim.  The quads are
+ * built from the masks when the span is shaded.
+ */
+void
+sp_rast_bin_span(struct sp_rast *rast, const struct sp_rast_prim *prim,
+                 int x, int y, unsigned mask0, unsigned mask1)
+{
+   unsigned tx = x / TILE_SIZE, ty = y / TILE_SIZE;
+   unsigned index = ty * rast->tiles_x + tx;
+   struct sp_rast_bin *bin;
+   struct sp_rast_span *span;
+
+   assert(x >= 0 && y >= 0);
+   assert(x % TILE_SIZE + 16 <= TILE_SIZE);
+   if (tx >= rast->tiles_x || ty >= rast->tiles_y)
+      return;
+
+   bin = &rast->bins[index];
+   if (bin->count == bin->size) {
+      unsigned size = MAX2(bin->size * 2, 64);
+      struct sp_rast_span *spans =
+         REALLOC(bin->spans, bin->size * sizeof(*spans),
+                 size * sizeof(*spans));
+
+      if (!spans)
+         return;   /* out of memory: drop it */
+
+      bin->spans = spans;
+      bin->size = size;
+   }
+
+   if (bin->count == 0)
+      rast->active_bins[rast->num_active_bins++] = index;
+
+   span = &bin->spans[bin->count++];
+   span->prim = prim;
+   span->x = x;
+   span->y = y;
+   span->mask0 = mask0;
+   span->mask1 = mask1;
+
+   rast->num_spans++;
+}
+
+
+/**
+ * Run the quads of one span down the pipeline, exactly as flush_spans()
+ * in sp_setup.c does.
+ */
+static void
+rasterize_span(struct sp_rast_thread *thread, const struct sp_rast_span *span)
+{
+   const struct sp_rast_prim *prim = span->prim;
+   unsigned mask0 = span->mask0;
+   unsigned mask1 = span->mask1;
+   unsigned lx = span->x;
+   unsigned q = 0;
+
+   do {
+      unsigned quadmask = (mask0 & 3) | ((mask1 & 3) << 2);
+      if (quadmask) {
+         struct quad_header *quad = &thread->quad[q];
+
+         quad->input.x0 = lx;
+         quad->input.y0 = span->y;
+         quad->input.facing = prim->facing;
+         quad->inout.mask = quadmask;
+         quad->posCoef = &prim->posCoef;
+         quad->coef = prim->coef;
+         thread->quad_ptrs[q] = quad;
+         q++;
+      }
+      mask0 >>= 2;
+      mask1 >>= 2;
+      lx += 2;
+   } while (mask0 | mask1);
+
+   thread->quad[0].input.layer = prim->layer;
+   thread->quad[0].input.viewport_index = prim->viewport_index;
+
+   thread->first->run(thread->first, thread->quad_ptrs, q);
+}
+
+
+/**
+ * Shade the bins given to the thread.
+ */
+static void
+rasterize_bins(struct sp_rast_thread *thread)
+{
+   struct sp_rast *rast = thread->rast;
+   unsigned i, j;
+
+   for (i = 0; i < thread->num_bins; i++) {
+      const struct sp_rast_bin *bin =
+         &rast->bins[rast->thread_bins[thread->first_bin + i]];
+
+      for (j = 0; j < bin->count; j++)
+         rasterize_span(thread, &bin->spans[j]);
+   }
+}
+
+
+static struct softpipe_tile_cache *
+color_cache(struct sp_rast *rast, unsigned thread, unsigned cbuf)
+{
+   return thread ? rast->threads[thread].cbuf_cache[cbuf] :
+                   rast->softpipe->cbuf_cache[cbuf];
+}
+
+
+/**
+ * Move the color tiles of a bin from one thread's caches to another's.
+ */
+static void
+move_tiles(struct sp_rast *rast, unsigned index, unsigned from, unsigned to)
+{
+   const struct pipe_framebuffer_state *fb = &rast->softpipe->framebuffer;
+   unsigned x = index % rast->tiles_x * TILE_SIZE;
+   unsigned y = index / rast->tiles_x * TILE_SIZE;
+   unsigned i;
+
+   for (i = 0; i < fb->nr_cbufs; i++) {
+      if (fb->cbufs[i])
+         sp_tile_cache_move_tiles(color_cache(rast, to, i),
+                                  color_cache(rast, from, i), x, y);
+   }
+}
+
+
+/**
+ * Give every active bin to a thread, the same one in every scene shaded
+ * on \p num_threads threads, and move its color tiles to that thread.
+ */
+static void
+assign_bins(struct sp_rast *rast, unsigned num_threads)
+{
+   unsigned i, n = 0;
+
+   for (i = 0; i < num_threads; i++)
+      rast->threads[i].num_bins = 0;
+
+   for (i = 0; i < rast->num_active_bins; i++) {
+      unsigned index = rast->active_bins[i];
+      struct sp_rast_bin *bin = &rast->bins[index];
+      unsigned t = (index % rast->tiles_x + index / rast->tiles_x) %
+                   num_threads;
+
+      if (bin->holder != t) {
+         move_tiles(rast, index, bin->holder, t);
+         bin->holder = t;
+      }
+      rast->threads[t].num_bins++;
+   }
+
+   for (i = 0; i < num_threads; i++) {
+      rast->threads[i].first_bin = n;
+      n += rast->threads[i].num_bins;
+      rast->threads[i].num_bins = 0;
+   }
+
+   for (i = 0; i < rast->num_active_bins; i++) {
+      unsigned index = rast->active_bins[i];
+      struct sp_rast_thread *thread = &rast->threads[rast->bins[index].holder];
+
+      rast->thread_bins[thread->first_bin + thread->num_bins++] = index;
+   }
+}
+
+
+static void
+sync_surface(struct softpipe_tile_cache *tc, struct pipe_surface **cached,
+             struct pipe_surface *ps, const struct softpipe_tile_cache *src)
+{
+   if (*cached != ps) {
+      sp_tile_cache_set_surface(tc, ps);
+      pipe_surface_reference(cached, ps);
+   }
+
+   if (ps)
+      sp_tile_cache_copy_clears(tc, src);
+}
+
+
+/**
+ * Bring a thread's copy of the state the quad stages use up to date with
+ * the context's.
+ * \return FALSE if out of memory
+ */
+static boolean
+sync_thread(struct sp_rast_thread *thread)
+{
+   struct softpipe_context *sp = thread->rast->softpipe;
+   const struct pipe_framebuffer_state *fb = &sp->framebuffer;
+   const struct sp_tgsi_sampler *sampler =
+      sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   const struct sp_fragment_shader_variant *var = sp->fs_variant;
+   unsigned i;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      sync_surface(thread->cbuf_cache[i], &thread->cbuf[i],
+                   i < fb->nr_cbufs ? fb->cbufs[i] : NULL,
+                   sp->cbuf_cache[i]);
+   }
+   sync_surface(thread->zsbuf_cache, &thread->zsbuf, fb->zsbuf,
+                sp->zsbuf_cache);
+
+   memcpy(thread->sampler->sp_sampler, sampler->sp_sampler,
+          sizeof(sampler->sp_sampler));
+
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+      struct pipe_sampler_view *view =
+         i < sp->num_sampler_views[PIPE_SHADER_FRAGMENT] ?
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i] : NULL;
+      struct softpipe_tex_tile_cache *tc = thread->tex_cache[i];
+
+      if (view && !tc) {
+         tc = thread->tex_cache[i] = sp_create_tex_tile_cache(&sp->pipe);
+         if (!tc)
+            return FALSE;
+      }
+
+      if (tc) {
+         sp_tex_tile_cache_set_sampler_view(tc, view);
+
+         if (tc->texture) {
+            struct softpipe_resource *spt = softpipe_resource(tc->texture);
+            if (spt->timestamp != tc->timestamp) {
+               sp_tex_tile_cache_validate_texture(tc);
+               tc->timestamp = spt->timestamp;
+            }
+         }
+      }
+
+      thread->sampler->sp_sview[i] = sampler->sp_sview[i];
+      if (view)
+         thread->sampler->sp_sview[i].cache = tc;
+   }
+
+   if (thread->fs_machine->Tokens != var->tokens) {
+      var->prepare(var, thread->fs_machine,
+                   (struct tgsi_sampler *) thread->sampler,
+                   (struct tgsi_image *) sp->tgsi.image[PIPE_SHADER_FRAGMENT],
+                   (struct tgsi_buffer *) sp->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+   }
+
+   thread->occlusion_count = 0;
+   thread->ps_invocations = 0;
+
+   thread->first = sp_chain_quad_stages(sp, thread->shade,
+                                        thread->depth_test, thread->blend);
+   thread->first->begin(thread->first);
+
+   return TRUE;
+}
+
+
+/**
+ * Shade everything binned so far and empty the scene.
+ */
+void
+sp_rast_flush(struct sp_rast *rast)
+{
+   struct softpipe_context *sp = rast->softpipe;
+   unsigned i, num_threads = rast->num_threads;
+
+   if (rast->num_prims == 0)
+      return;
+
+   if (rast->num_spans < SP_RAST_MIN_SPANS || rast->num_active_bins < 2)
+      num_threads = 1;
+
+   for (i = 1; i < num_threads; i++) {
+      if (!sync_thread(&rast->threads[i])) {
+         num_threads = 1;
+         break;
+      }
+   }
+
+   /* the other threads read the depth tiles from the surface */
+   if (num_threads > 1)
+      sp_tile_cache_write_back(sp->zsbuf_cache);
+
+   assign_bins(rast, num_threads);
+   rast->threads[0].first = sp->quad.first;
+
+   for (i = 1; i < num_threads; i++)
+      pipe_semaphore_signal(&rast->threads[i].work_ready);
+
+   rasterize_bins(&rast->threads[0]);
+
+   for (i = 1; i < num_threads; i++) {
+      struct sp_rast_thread *thread = &rast->threads[i];
+      unsigned j;
+
+      pipe_semaphore_wait(&thread->work_done);
+
+      /* tiles the thread loaded are no longer cleared */
+      for (j = 0; j < sp->framebuffer.nr_cbufs; j++) {
+         if (thread->cbuf[j])
+            sp_tile_cache_merge_clears(sp->cbuf_cache[j],
+                                       thread->cbuf_cache[j]);
+      }
+      if (thread->zsbuf)
+         sp_tile_cache_merge_clears(sp->zsbuf_cache, thread->zsbuf_cache);
+
+      sp->occlusion_count += thread->occlusion_count;
+      sp->pipeline_statistics.ps_invocations += thread->ps_invocations;
+   }
+
+   reset_scene(rast);
+}
+
+
+/**
+ * Shade everything binned so far and move the color tiles the other
+ * threads hold to the context's tile caches, for the context to render
+ * to, clear or flush them itself.
+ */
+void
+sp_rast_finish(struct sp_rast *rast)
+{
+   unsigned i;
+
+   sp_rast_flush(rast);
+
+   for (i = 0; i < rast->tiles_x * rast->tiles_y; i++) {
+      if (rast->bins[i].holder) {
+         move_tiles(rast, i, rast->bins[i].holder, 0);
+         rast->bins[i].holder = 0;
+      }
+   }
+}
+
+
+static int
+thread_function(void *init_data)
+{
+   struct sp_rast_thread *thread = (struct sp_rast_thread *) init_data;
+   struct sp_rast *rast = thread->rast;
+   char thread_name[16];
+
+   snprintf(thread_name, sizeof thread_name, "softpipe-%u", thread->index);
+   u_thread_setname(thread_name);
+
+   while (1) {
+      pipe_semaphore_wait(&thread->work_ready);
+
+      if (rast->exit_flag)
+         break;
+
+      rasterize_bins(thread);
+      sp_tile_cache_write_back(thread->zsbuf_cache);
+
+      pipe_semaphore_signal(&thread->work_done);
+   }
+
+   return 0;
+}
+
+
+static void
+fini_thread(struct sp_rast_thread *thread)
+{
+   unsigned i;
+
+   if (thread->shade)
+      thread->shade->destroy(thread->shade);
+   if (thread->depth_test)
+      thread->depth_test->destroy(thread->depth_test);
+   if (thread->blend)
+      thread->blend->destroy(thread->blend);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      sp_destroy_tile_cache(thread->cbuf_cache[i]);
+      pipe_surface_reference(&thread->cbuf[i], NULL);
+   }
+   sp_destroy_tile_cache(thread->zsbuf_cache);
+   pipe_surface_reference(&thread->zsbuf, NULL);
+
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+      if (thread->tex_cache[i])
+         sp_tex_tile_cache_set_sampler_view(thread->tex_cache[i], NULL);
+      sp_destroy_tex_tile_cache(thread->tex_cache[i]);
+   }
+
+   tgsi_exec_machine_destroy(thread->fs_machine);
+   FREE(thread->sampler);
+}
+
+
+/**
+ * Create the state of a thread other than the calling one.
+ */
+static boolean
+init_thread(struct sp_rast *rast, struct sp_rast_thread *thread)
+{
+   struct softpipe_context *sp = rast->softpipe;
+   unsigned i;
+
+   thread->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+   thread->sampler = sp_create_tgsi_sampler();
+   if (!thread->fs_machine || !thread->sampler)
+      return FALSE;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      thread->cbuf_cache[i] = sp_create_tile_cache(&sp->pipe);
+      if (!thread->cbuf_cache[i])
+         return FALSE;
+   }
+   thread->zsbuf_cache = sp_create_tile_cache(&sp->pipe);
+   if (!thread->zsbuf_cache)
+      return FALSE;
+
+   thread->state.fs_machine = thread->fs_machine;
+   thread->state.cbuf_cache = thread->cbuf_cache;
+   thread->state.zsbuf_cache = thread->zsbuf_cache;
+   thread->state.occlusion_count = &thread->occlusion_count;
+   thread->state.ps_invocations = &thread->ps_invocations;
+
+   thread->shade = sp_quad_shade_stage(sp);
+   thread->depth_test = sp_quad_depth_test_stage(sp);
+   thread->blend = sp_quad_blend_stage(sp);
+   if (!thread->shade || !thread->depth_test || !thread->blend)
+      return FALSE;
+
+   thread->shade->state = &thread->state;
+   thread->depth_test->state = &thread->state;
+   thread->blend->state = &thread->state;
+
+   return TRUE;
+}
+
+
+/**
+ * Start the rasterizer threads.
+ * \param num_threads  number of threads to shade on, including the
+ *                     calling thread
+ * \return NULL if fewer than two threads could be started
+ */
+struct sp_rast *
+sp_rast_create(struct softpipe_context *softpipe, unsigned num_threads)
+{
+   struct sp_rast *rast = CALLOC_STRUCT(sp_rast);
+   unsigned i;
+
+   if (!rast)
+      return NULL;
+
+   rast->softpipe = softpipe;
+   rast->threads[0].rast = rast;
+   rast->num_threads = 1;
+
+   for (i = 1; i < MIN2(num_threads, SP_MAX_THREADS); i++) {
+      struct sp_rast_thread *thread = &rast->threads[i];
+
+      thread->rast = rast;
+      thread->index = i;
+
+      if (!init_thread(rast, thread)) {
+         fini_thread(thread);
+         break;
+      }
+
+      pipe_semaphore_init(&thread->work_ready, 0);
+      pipe_semaphore_init(&thread->work_done, 0);
+      if (thrd_success != u_thread_create(&thread->thread, thread_function,
+                                          thread)) {
+         pipe_semaphore_destroy(&thread->work_ready);
+         pipe_semaphore_destroy(&thread->work_done);
+         fini_thread(thread);
+         break;
+      }
+
+      rast->num_threads++;
+   }
+
+   if (rast->num_threads < 2) {
+      sp_rast_destroy(rast);
+      return NULL;
+   }
+
+   return rast;
+}
+
+
+void
+sp_rast_destroy(struct sp_rast *rast)
+{
+   struct sp_rast_block *block, *next;
+   unsigned i;
+
+   rast->exit_flag = TRUE;
+   for (i = 1; i < rast->num_threads; i++)
+      pipe_semaphore_signal(&rast->threads[i].work_ready);
+
+   for (i = 1; i < rast->num_threads; i++) {
+      thrd_join(rast->threads[i].thread, NULL);
+      pipe_semaphore_destroy(&rast->threads[i].work_ready);
+      pipe_semaphore_destroy(&rast->threads[i].work_done);
+      fini_thread(&rast->threads[i]);
+   }
+
+   for (i = 0; i < rast->max_bins; i++)
+      FREE(rast->bins[i].spans);
+   FREE(rast->bins);
+   FREE(rast->active_bins);
+   FREE(rast->thread_bins);
+
+   for (block = rast->blocks; block; block = next) {
+      next = block->next;
+      align_free(block);
+   }
+
+   FREE(rast);
+}
+
+
+/**
+ * Flush the threads' texture caches, along with the context's.
+ */
+void
+sp_rast_flush_texture_caches(struct sp_rast *rast)
+{
+   unsigned i, j;
+
+   for (i = 1; i < rast->num_threads; i++) {
+      for (j = 0; j < PIPE_MAX_SHADER_SAMPLER_VIEWS; j++) {
+         if (rast->threads[i].tex_cache[j])
+            sp_flush_tex_tile_cache(rast->threads[i].tex_cache[j]);
+      }
+   }
+}
+
+
+/**
+ * Unbind a fragment shader variant about to be deleted from the threads'
+ * machines, as its delete function does for the context's.
+ */
+void
+sp_rast_release_fs_variant(struct sp_rast *rast,
+                           const struct sp_fragment_shader_variant *var)
+{
+   unsigned i;
+
+   for (i = 1; i < rast->num_threads; i++) {
+      struct tgsi_exec_machine *machine = rast->threads[i].fs_machine;
+
+      if (machine->Tokens == var->tokens)
+         tgsi_exec_machine_bind_shader(machine, NULL, NULL, NULL, NULL);
+   }
+}
@@ -0,0 +1,81 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Binned, tile-parallel rasterization of triangles.
+ */
+
+#ifndef SP_RAST_H
+#define SP_RAST_H
+
+#include "tgsi/tgsi_exec.h"
+
+
+struct softpipe_context;
+struct sp_fragment_shader_variant;
+struct sp_rast;
+
+
+/**
+ * A binned triangle: what the quads of its spans point at.
+ */
+struct sp_rast_prim {
+   struct tgsi_interp_coef posCoef;  /* For Z, W */
+   unsigned facing;
+   unsigned layer;
+   unsigned viewport_index;
+   struct tgsi_interp_coef coef[];   /* one per fragment shader input */
+};
+
+
+struct sp_rast *
+sp_rast_create(struct softpipe_context *softpipe, unsigned num_threads);
+
+void
+sp_rast_destroy(struct sp_rast *rast);
+
+boolean
+sp_rast_can_bin(const struct softpipe_context *softpipe);
+
+struct sp_rast_prim *
+sp_rast_add_prim(struct sp_rast *rast, unsigned num_inputs);
+
+void
+sp_rast_bin_span(struct sp_rast *rast, const struct sp_rast_prim *prim,
+                 int x, int y, unsigned mask0, unsigned mask1);
+
+void
+sp_rast_flush(struct sp_rast *rast);
+
+void
+sp_rast_finish(struct sp_rast *rast);
+
+void
+sp_rast_flush_texture_caches(struct sp_rast *rast);
+
+void
+sp_rast_release_fs_variant(struct sp_rast *rast,
+                           const struct sp_fragment_shader_variant *var);
+
+#endif /* SP_RAST_H */
@@ -46,6 +46,7 @@
 #include "sp_context.h"
 #include "sp_fence.h"
 #include "sp_public.h"
+#include "sp_shader_cache.h"
 
 static const struct debug_named_value sp_debug_options[] = {
    {"vs",        SP_DBG_VS,         "dump vertex shader assembly to stderr"},
@@ -55,6 +56,8 @@ static const struct debug_named_value sp_debug_options[] = {
    {"no_rast",   SP_DBG_NO_RAST,    "no-ops rasterization, for profiling purposes"},
    {"use_llvm",  SP_DBG_USE_LLVM,   "Use LLVM if available for shaders"},
    {"use_tgsi",  SP_DBG_USE_TGSI,   "Request TGSI from the API instead of NIR"},
+   {"cache_stats", SP_DBG_CACHE_STATS, "print shader cache statistics at exit"},
+   {"no_simd_tex", SP_DBG_NO_SIMD_TEX, "sample all textures with the generic C code"},
    DEBUG_NAMED_VALUE_END
 };
 
@@ -494,6 +497,9 @@ softpipe_destroy_screen( struct pipe_screen *screen )
    struct softpipe_screen *sp_screen = softpipe_screen(screen);
    struct sw_winsys *winsys = sp_screen->winsys;
 
+   sp_shader_cache_destroy(sp_screen);
+   slab_destroy_parent(&sp_screen->transfer_pool);
+
    if(winsys->destroy)
       winsys->destroy(winsys);
 
@@ -501,6 +507,13 @@ softpipe_destroy_screen( struct pipe_screen *screen )
 }
 
 
+static struct disk_cache *
+softpipe_get_disk_shader_cache(struct pipe_screen *pscreen)
+{
+   return softpipe_screen(pscreen)->disk_shader_cache;
+}
+
+
 /* This is often overriden by the co-state tracker.
  */
 static void
@@ -609,10 +622,26 @@ softpipe_create_screen(struct sw_winsys *winsys)
    screen->base.flush_frontbuffer = softpipe_flush_frontbuffer;
    screen->base.get_compute_param = softpipe_get_compute_param;
    screen->base.get_compiler_options = softpipe_get_compiler_options;
+   screen->base.get_disk_shader_cache = softpipe_get_disk_shader_cache;
    screen->use_llvm = sp_debug & SP_DBG_USE_LLVM;
+   /* The tile-parallel rasterizer is opt-in for now */
+   screen->num_threads = debug_get_num_option("SP_NUM_THREADS", 1);
+   screen->num_threads = CLAMP(screen->num_threads, 1, SP_MAX_THREADS);
+   screen->threaded = debug_get_bool_option("SOFTPIPE_THREADED", FALSE);
+   slab_create_parent(&screen->transfer_pool,
+                      sizeof(struct threaded_transfer), 16);
+
+   sp_shader_cache_init(screen);
 
    softpipe_init_screen_texture_funcs(&screen->base);
    softpipe_init_screen_fence_funcs(&screen->base);
 
+   /* Mapping a front buffer calls back into the loader (drisw's get_image
+    * and put_image), which mustn't happen on the thread of a threaded
+    * context.  Without this the frontend presents front buffers itself.
+    */
+   if (screen->threaded)
+      screen->base.resource_create_front = NULL;
+
    return &screen->base;
 }
@@ -33,8 +33,11 @@
 
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
+#include "util/slab.h"
 
 
+struct disk_cache;
+struct sp_shader_cache;
 struct sw_winsys;
 
 struct softpipe_screen {
@@ -47,6 +50,22 @@ struct softpipe_screen {
     */
    unsigned timestamp;
    boolean use_llvm;
+
+   /* Number of threads triangles are rasterized on, including the
+    * context's own.  Set with SP_NUM_THREADS.
+    */
+   unsigned num_threads;
+
+   /* NIR to TGSI translations, shared by all contexts (sp_shader_cache.c) */
+   struct sp_shader_cache *shader_cache;
+   struct disk_cache *disk_shader_cache;
+
+   /* Wrap contexts created with PIPE_CONTEXT_PREFER_THREADED in
+    * u_threaded_context, so that the frontend records commands while
+    * this context executes them.  Set with SOFTPIPE_THREADED.
+    */
+   boolean threaded;
+   struct slab_parent_pool transfer_pool;  /* for u_threaded_context */
 };
 
 static inline struct softpipe_screen *
@@ -65,6 +84,8 @@ enum sp_debug_flag {
    SP_DBG_USE_LLVM        = BITFIELD_BIT(6),
    SP_DBG_NO_RAST         = BITFIELD_BIT(7),
    SP_DBG_USE_TGSI        = BITFIELD_BIT(8),
+   SP_DBG_CACHE_STATS     = BITFIELD_BIT(9),
+   SP_DBG_NO_SIMD_TEX     = BITFIELD_BIT(10),
 };
 
 extern int sp_debug;
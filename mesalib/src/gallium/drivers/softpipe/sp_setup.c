@@ -36,6 +36,7 @@
 #include "sp_screen.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast.h"
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "draw/draw_context.h"
@@ -114,6 +115,9 @@ struct setup_context {
 
    unsigned cull_face;		/* which faces cull */
    unsigned nr_vertex_attrs;
+
+   boolean binning;             /**< bin triangles for sp_rast? */
+   struct sp_rast_prim *prim;   /**< the triangle being binned */
 };
 
 
@@ -231,6 +235,13 @@ flush_spans(struct setup_context *setup)
       unsigned mask1 = ~skipmask_left1 & ~skipmask_right1;
 
       if (mask0 | mask1) {
+         if (setup->prim) {
+            /* sp_rast builds the same quads when it gets to the tile */
+            sp_rast_bin_span(setup->softpipe->rast, setup->prim,
+                             x, setup->span.y, mask0, mask1);
+            continue;
+         }
+
          do {
             unsigned quadmask = (mask0 & 3) | ((mask1 & 3) << 2);
             if (quadmask) {
@@ -740,6 +751,36 @@ calc_det(const float (*v0)[4],
 }
 
 
+/**
+ * Copy the triangle's coefficients into the binned rasterizer's scene,
+ * to be shaded along with its spans later.
+ * \return NULL if the triangle must be rendered right away instead
+ */
+static struct sp_rast_prim *
+setup_bin_tri(struct setup_context *setup,
+              unsigned layer,
+              unsigned viewport_index)
+{
+   struct sp_rast *rast = setup->softpipe->rast;
+   const uint num_inputs = setup->softpipe->fs_variant->info.num_inputs;
+   struct sp_rast_prim *prim = sp_rast_add_prim(rast, num_inputs);
+
+   if (!prim) {
+      /* out of memory: render what is binned so far, then this one */
+      sp_rast_finish(rast);
+      return NULL;
+   }
+
+   prim->posCoef = setup->posCoef;
+   prim->facing = setup->facing;
+   prim->layer = layer;
+   prim->viewport_index = viewport_index;
+   memcpy(prim->coef, setup->coef, num_inputs * sizeof(prim->coef[0]));
+
+   return prim;
+}
+
+
 /**
  * Do setup for triangle rasterization, then render the triangle.
  */
@@ -797,6 +838,9 @@ sp_setup_tri(struct setup_context *setup,
    }
    setup->quad[0].input.viewport_index = viewport_index;
 
+   if (setup->binning)
+      setup->prim = setup_bin_tri(setup, layer, viewport_index);
+
    /*   init_constant_attribs( setup ); */
 
    if (setup->oneoverarea < 0.0) {
@@ -813,6 +857,7 @@ sp_setup_tri(struct setup_context *setup,
    }
 
    flush_spans( setup );
+   setup->prim = NULL;
 
    if (setup->softpipe->active_statistics_queries) {
       setup->softpipe->pipeline_statistics.c_primitives++;
@@ -1022,6 +1067,10 @@ sp_setup_line(struct setup_context *setup,
    if (dx == 0 && dy == 0)
       return;
 
+   /* keep to primitive order with any triangles binned before */
+   if (setup->binning)
+      sp_rast_finish(setup->softpipe->rast);
+
    if (!setup_line_coefficients(setup, v0, v1))
       return;
 
@@ -1169,6 +1218,10 @@ sp_setup_point(struct setup_context *setup,
 
    assert(setup->softpipe->reduced_prim == PIPE_PRIM_POINTS);
 
+   /* keep to primitive order with any triangles binned before */
+   if (setup->binning)
+      sp_rast_finish(softpipe->rast);
+
    if (setup->softpipe->layer_slot > 0) {
       layer = *(unsigned *)v0[setup->softpipe->layer_slot];
       layer = MIN2(layer, setup->max_layer);
@@ -1403,6 +1456,10 @@ sp_setup_prepare(struct setup_context *setup)
 
    sp->quad.first->begin( sp->quad.first );
 
+   setup->binning = sp_rast_can_bin(sp);
+   if (!setup->binning && sp->rast)
+      sp_rast_finish(sp->rast);
+
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
        sp->rasterizer->fill_back == PIPE_POLYGON_MODE_FILL) {
@@ -0,0 +1,305 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Cache of NIR to TGSI translations.
+ *
+ * Every context compiles the same shaders again: the state tracker hands
+ * softpipe NIR, and nir_to_tgsi() optimizes and translates it from scratch
+ * each time.  The translation only depends on the NIR and on the screen,
+ * so it is looked up by the SHA-1 of the serialized NIR, first in a
+ * size-capped, least recently used cache in memory shared by all contexts
+ * of the screen, then in the on-disk shader cache if Mesa was built with
+ * one.  Only on a miss in both is nir_to_tgsi() run, and its tokens are
+ * then stored in both.
+ *
+ * SP_SHADER_CACHE_MB sets the size of the memory cache (0 disables it),
+ * and the usual MESA_SHADER_CACHE_* variables control the disk cache.
+ * SOFTPIPE_DEBUG=cache_stats prints the hit and miss counts when the
+ * screen is destroyed.
+ */
+
+#include "nir.h"
+#include "nir_serialize.h"
+#include "nir/nir_to_tgsi.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/blob.h"
+#include "util/disk_cache.h"
+#include "util/hash_table.h"
+#include "util/list.h"
+#include "util/mesa-sha1.h"
+#include "util/os_time.h"
+#include "util/simple_mtx.h"
+#include "util/u_debug.h"
+#include "util/u_memory.h"
+
+#include <stdio.h>
+
+#include "sp_screen.h"
+#include "sp_shader_cache.h"
+
+
+struct sp_shader_cache_entry {
+   unsigned char sha1[20];
+   struct list_head lru;        /* most recently used first */
+   unsigned size;               /* in bytes */
+   struct tgsi_token tokens[];
+};
+
+struct sp_shader_cache {
+   simple_mtx_t mutex;
+   struct hash_table *entries;  /* sha1 -> sp_shader_cache_entry */
+   struct list_head lru;
+   uint64_t size, max_size;
+
+   struct disk_cache *disk_cache;
+
+   unsigned memory_hits;
+   unsigned disk_hits;
+   unsigned misses;
+   uint64_t compile_nsec;       /* spent in nir_to_tgsi() on misses */
+};
+
+
+static uint32_t
+sha1_hash(const void *key)
+{
+   uint32_t hash;
+
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+static bool
+sha1_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, 20) == 0;
+}
+
+static void
+sp_disk_cache_create(struct sp_shader_cache *cache)
+{
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char cache_id[20 * 2 + 1];
+
+   _mesa_sha1_init(&ctx);
+   if (!disk_cache_get_function_identifier(sp_disk_cache_create, &ctx))
+      return;
+   _mesa_sha1_final(&ctx, sha1);
+   disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
+
+   cache->disk_cache = disk_cache_create("softpipe", cache_id, 0);
+}
+
+
+void
+sp_shader_cache_init(struct softpipe_screen *screen)
+{
+   struct sp_shader_cache *cache = CALLOC_STRUCT(sp_shader_cache);
+
+   if (!cache)
+      return;
+
+   simple_mtx_init(&cache->mutex, mtx_plain);
+   cache->entries = _mesa_hash_table_create(NULL, sha1_hash, sha1_equal);
+   list_inithead(&cache->lru);
+   cache->max_size = debug_get_num_option("SP_SHADER_CACHE_MB", 16) << 20;
+
+   sp_disk_cache_create(cache);
+
+   screen->shader_cache = cache;
+   screen->disk_shader_cache = cache->disk_cache;
+}
+
+
+void
+sp_shader_cache_destroy(struct softpipe_screen *screen)
+{
+   struct sp_shader_cache *cache = screen->shader_cache;
+
+   if (!cache)
+      return;
+
+   if (sp_debug & SP_DBG_CACHE_STATS)
+      printf("softpipe shader cache: %u memory hits, %u disk hits, "
+             "%u misses (%.1f ms compiling), %u entries, %u KiB\n",
+             cache->memory_hits, cache->disk_hits, cache->misses,
+             cache->compile_nsec / 1e6,
+             cache->entries ? cache->entries->entries : 0,
+             (unsigned)(cache->size >> 10));
+
+   list_for_each_entry_safe(struct sp_shader_cache_entry, entry,
+                            &cache->lru, lru)
+      FREE(entry);
+   _mesa_hash_table_destroy(cache->entries, NULL);
+   disk_cache_destroy(cache->disk_cache);
+   simple_mtx_destroy(&cache->mutex);
+   FREE(cache);
+
+   screen->shader_cache = NULL;
+   screen->disk_shader_cache = NULL;
+}
+
+
+static const struct tgsi_token *
+dup_tokens(const struct tgsi_token *tokens, unsigned size)
+{
+   struct tgsi_token *copy = MALLOC(size);
+
+   if (copy)
+      memcpy(copy, tokens, size);
+   return copy;
+}
+
+
+/**
+ * Add tokens to the memory cache, evicting the least recently used
+ * entries to stay under the size limit.  Called with the mutex held.
+ */
+static void
+memory_cache_insert(struct sp_shader_cache *cache,
+                    const unsigned char sha1[20],
+                    const struct tgsi_token *tokens, unsigned size)
+{
+   struct sp_shader_cache_entry *entry;
+
+   if (size > cache->max_size || !cache->entries ||
+       _mesa_hash_table_search(cache->entries, sha1))
+      return;
+
+   while (cache->size + size > cache->max_size) {
+      struct sp_shader_cache_entry *old =
+         list_last_entry(&cache->lru, struct sp_shader_cache_entry, lru);
+
+      _mesa_hash_table_remove_key(cache->entries, old->sha1);
+      list_del(&old->lru);
+      cache->size -= old->size;
+      FREE(old);
+   }
+
+   entry = MALLOC(sizeof(*entry) + size);
+   if (!entry)
+      return;
+
+   memcpy(entry->sha1, sha1, 20);
+   entry->size = size;
+   memcpy(entry->tokens, tokens, size);
+   list_add(&entry->lru, &cache->lru);
+   _mesa_hash_table_insert(cache->entries, entry->sha1, entry);
+   cache->size += size;
+}
+
+
+/**
+ * Translate s to TGSI like nir_to_tgsi(), which this calls on a miss.
+ * Takes ownership of s.  The tokens are to be freed with
+ * tgsi_free_tokens().
+ */
+const struct tgsi_token *
+sp_shader_cache_nir_to_tgsi(struct softpipe_screen *screen,
+                            struct nir_shader *s)
+{
+   struct sp_shader_cache *cache = screen->shader_cache;
+   const struct tgsi_token *tokens = NULL;
+   unsigned char sha1[20], key[CACHE_KEY_SIZE];
+   struct mesa_sha1 ctx;
+   struct blob blob;
+   size_t size;
+   int64_t start;
+
+   if (!cache || (!cache->max_size && !cache->disk_cache))
+      return nir_to_tgsi(s, &screen->base);
+
+   /* The translation also depends on the caps, which depend on this */
+   blob_init(&blob);
+   nir_serialize(&blob, s, false);
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, &screen->use_llvm, sizeof(screen->use_llvm));
+   _mesa_sha1_update(&ctx, blob.data, blob.size);
+   _mesa_sha1_final(&ctx, sha1);
+   blob_finish(&blob);
+
+   simple_mtx_lock(&cache->mutex);
+   if (cache->entries) {
+      struct hash_entry *he = _mesa_hash_table_search(cache->entries, sha1);
+
+      if (he) {
+         struct sp_shader_cache_entry *entry = he->data;
+
+         list_del(&entry->lru);
+         list_add(&entry->lru, &cache->lru);
+         tokens = dup_tokens(entry->tokens, entry->size);
+         if (tokens)
+            cache->memory_hits++;
+      }
+   }
+   simple_mtx_unlock(&cache->mutex);
+
+   if (tokens) {
+      ralloc_free(s);
+      return tokens;
+   }
+
+   if (cache->disk_cache) {
+      void *data;
+
+      disk_cache_compute_key(cache->disk_cache, sha1, 20, key);
+      data = disk_cache_get(cache->disk_cache, key, &size);
+
+      /* Don't trust what we read back beyond its length adding up */
+      if (data && size >= sizeof(struct tgsi_header) &&
+          size % sizeof(struct tgsi_token) == 0 &&
+          tgsi_num_tokens(data) * sizeof(struct tgsi_token) == size)
+         tokens = dup_tokens(data, size);
+      free(data);
+
+      if (tokens) {
+         simple_mtx_lock(&cache->mutex);
+         cache->disk_hits++;
+         memory_cache_insert(cache, sha1, tokens, size);
+         simple_mtx_unlock(&cache->mutex);
+
+         ralloc_free(s);
+         return tokens;
+      }
+   }
+
+   start = os_time_get_nano();
+   tokens = nir_to_tgsi(s, &screen->base);
+   if (!tokens)
+      return NULL;
+   size = tgsi_num_tokens(tokens) * sizeof(struct tgsi_token);
+
+   simple_mtx_lock(&cache->mutex);
+   cache->misses++;
+   cache->compile_nsec += os_time_get_nano() - start;
+   memory_cache_insert(cache, sha1, tokens, size);
+   simple_mtx_unlock(&cache->mutex);
+
+   if (cache->disk_cache)
+      disk_cache_put(cache->disk_cache, key, tokens, size, NULL);
+
+   return tokens;
+}
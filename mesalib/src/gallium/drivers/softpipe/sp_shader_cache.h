@@ -0,0 +1,51 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Cache of NIR to TGSI translations, shared by all contexts of a screen
+ * and backed by the on-disk shader cache where there is one.
+ */
+
+#ifndef SP_SHADER_CACHE_H
+#define SP_SHADER_CACHE_H
+
+#include "pipe/p_compiler.h"
+
+
+struct nir_shader;
+struct softpipe_screen;
+struct tgsi_token;
+
+
+void
+sp_shader_cache_init(struct softpipe_screen *screen);
+
+void
+sp_shader_cache_destroy(struct softpipe_screen *screen);
+
+const struct tgsi_token *
+sp_shader_cache_nir_to_tgsi(struct softpipe_screen *screen,
+                            struct nir_shader *s);
+
+#endif /* SP_SHADER_CACHE_H */
@@ -29,10 +29,11 @@
 #include "sp_screen.h"
 #include "sp_state.h"
 #include "sp_fs.h"
+#include "sp_rast.h"
+#include "sp_shader_cache.h"
 #include "sp_texture.h"
 
 #include "nir.h"
-#include "nir/nir_to_tgsi.h"
 #include "pipe/p_defines.h"
 #include "util/ralloc.h"
 #include "util/u_memory.h"
@@ -130,7 +131,9 @@ softpipe_create_shader_state(struct pipe_context *pipe,
       if (debug)
          nir_print_shader(templ->ir.nir, stderr);
 
-      shader->tokens = nir_to_tgsi(templ->ir.nir, pipe->screen);
+      shader->tokens =
+         sp_shader_cache_nir_to_tgsi(softpipe_screen(pipe->screen),
+                                     templ->ir.nir);
    } else {
       assert(templ->type == PIPE_SHADER_IR_TGSI);
       /* we need to keep a local copy of the tokens */
@@ -218,6 +221,9 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
+      if (softpipe->rast)
+         sp_rast_release_fs_variant(softpipe->rast, var);
+
       var->delete(var, softpipe->fs_machine);
    }
 
@@ -417,7 +423,8 @@ softpipe_create_compute_state(struct pipe_context *pipe,
       if (sp_debug & SP_DBG_CS)
          nir_print_shader(s, stderr);
 
-      state->tokens = (void *)nir_to_tgsi(s, pipe->screen);
+      state->tokens = (void *)
+         sp_shader_cache_nir_to_tgsi(softpipe_screen(pipe->screen), s);
    } else {
       assert(templ->ir_type == PIPE_SHADER_IR_TGSI);
       /* we need to keep a local copy of the tokens */
@@ -0,0 +1,427 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Render the same scene with the tile-parallel rasterizer (sp_rast.c) and
+ * on the calling thread alone, and check that the color and depth buffers
+ * come out identical.  The threaded rendering must also give the same
+ * result every time.
+ *
+ * The tile caches keep colors as floats, so a tile blended to more than
+ * once while it stays cached blends with unrounded colors: the threads
+ * must keep their tiles cached for as long as the calling thread alone
+ * would.  The framebuffer is small enough for all of its tiles to stay
+ * cached until the flush.
+ *
+ * The scene has large triangles crossing many tiles, drawn with a depth
+ * test, then with blending on top, then textured, with clears and state
+ * changes in between and both small and large draw calls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "cso_cache/cso_context.h"
+#include "util/format/u_format.h"
+#include "util/u_box.h"
+#include "util/u_draw_quad.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "sp_context.h"
+#include "sp_public.h"
+#include "sp_screen.h"
+
+
+#define SIZE            300     /* not a multiple of the 64x64 tiles */
+#define NUM_TRIANGLES   600
+#define NUM_THREADS     4
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, enum pipe_format format,
+               unsigned width, unsigned height, unsigned bind)
+{
+   struct pipe_resource templ = {0};
+
+   templ.target = PIPE_TEXTURE_2D;
+   templ.width0 = width;
+   templ.height0 = height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.format = format;
+   templ.usage = PIPE_USAGE_DEFAULT;
+   templ.bind = bind;
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+static void
+set_framebuffer(struct cso_context *cso, struct pipe_context *ctx,
+                struct pipe_resource *cb, struct pipe_resource *zs)
+{
+   struct pipe_surface templ = {{0}}, *cbuf, *zsbuf;
+   struct pipe_framebuffer_state fb = {0};
+
+   templ.format = cb->format;
+   cbuf = ctx->create_surface(ctx, cb, &templ);
+   templ.format = zs->format;
+   zsbuf = ctx->create_surface(ctx, zs, &templ);
+
+   fb.width = cb->width0;
+   fb.height = cb->height0;
+   fb.cbufs[0] = cbuf;
+   fb.nr_cbufs = 1;
+   fb.zsbuf = zsbuf;
+
+   cso_set_framebuffer(cso, &fb);
+   pipe_surface_reference(&cbuf, NULL);
+   pipe_surface_reference(&zsbuf, NULL);
+}
+
+
+static void
+set_blend(struct cso_context *cso, bool enable)
+{
+   struct pipe_blend_state blend = {0};
+
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   blend.rt[0].blend_enable = enable;
+   blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   cso_set_blend(cso, &blend);
+}
+
+
+static void
+set_depth(struct cso_context *cso, enum pipe_compare_func func, bool write)
+{
+   struct pipe_depth_stencil_alpha_state dsa = {0};
+
+   dsa.depth_enabled = 1;
+   dsa.depth_func = func;
+   dsa.depth_writemask = write;
+   cso_set_depth_stencil_alpha(cso, &dsa);
+}
+
+
+static void
+set_common_states(struct cso_context *cso, struct pipe_resource *cb)
+{
+   struct pipe_rasterizer_state rs = {0};
+   struct pipe_viewport_state viewport = {0};
+   struct cso_velems_state velem = {0};
+   unsigned i;
+
+   rs.half_pixel_center = 1;
+   rs.bottom_edge_rule = 1;
+   rs.depth_clip_near = 1;
+   rs.depth_clip_far = 1;
+   cso_set_rasterizer(cso, &rs);
+
+   viewport.scale[0] = 0.5f * cb->width0;
+   viewport.scale[1] = 0.5f * cb->height0;
+   viewport.scale[2] = 0.5f;
+   viewport.translate[0] = 0.5f * cb->width0;
+   viewport.translate[1] = 0.5f * cb->height0;
+   viewport.translate[2] = 0.5f;
+   viewport.swizzle_x = PIPE_VIEWPORT_SWIZZLE_POSITIVE_X;
+   viewport.swizzle_y = PIPE_VIEWPORT_SWIZZLE_POSITIVE_Y;
+   viewport.swizzle_z = PIPE_VIEWPORT_SWIZZLE_POSITIVE_Z;
+   viewport.swizzle_w = PIPE_VIEWPORT_SWIZZLE_POSITIVE_W;
+   cso_set_viewport(cso, &viewport);
+
+   velem.count = 2;
+   for (i = 0; i < 2; i++) {
+      velem.velems[i].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+      velem.velems[i].src_offset = i * 16;
+   }
+   cso_set_vertex_elements(cso, &velem);
+}
+
+
+/**
+ * Position and color of NUM_TRIANGLES triangles.  Most are a few tiles
+ * wide, every 16th covers most of the framebuffer and every 32nd is
+ * partly outside of it.  The colors double as texture coordinates.
+ */
+static float *
+make_triangles(void)
+{
+   float *vertices = MALLOC(NUM_TRIANGLES * 3 * 8 * sizeof(float));
+   unsigned seed = 1, v;
+
+   for (v = 0; v < NUM_TRIANGLES * 3; v++) {
+      const unsigned t = v / 3;
+      const float scale = t % 16 ? 0.5f : t % 32 ? 1.5f : 2.5f;
+      float *vert = &vertices[v * 8];
+      unsigned c;
+
+      for (c = 0; c < 8; c++) {
+         seed = seed * 1103515245 + 12345;
+         vert[c] = ((seed >> 8) & 0xffff) / 65535.0f;
+      }
+      /* centre each triangle somewhere in the framebuffer */
+      vert[0] = (vert[0] - 0.5f) * scale + ((t * 37) % 17) / 8.0f - 1;
+      vert[1] = (vert[1] - 0.5f) * scale + ((t * 53) % 19) / 9.0f - 1;
+      vert[2] = vert[2] * 2 - 1;
+      vert[3] = 1;
+      vert[7] = 0.25f + vert[7] * 0.5f;
+   }
+   return vertices;
+}
+
+
+static struct pipe_sampler_view *
+create_sampler_view(struct pipe_context *ctx)
+{
+   static const unsigned width = 61, height = 37;
+   struct pipe_sampler_view templ = {0};
+   struct pipe_resource *tex;
+   struct pipe_sampler_view *view;
+   struct pipe_box box;
+   uint8_t *texels;
+   unsigned i;
+
+   tex = create_texture(ctx->screen, PIPE_FORMAT_B8G8R8A8_UNORM, width,
+                        height, PIPE_BIND_SAMPLER_VIEW);
+   texels = MALLOC(width * height * 4);
+   for (i = 0; i < width * height * 4; i++)
+      texels[i] = (i * 37 + (i >> 5) * 11) & 0xff;
+   u_box_2d(0, 0, width, height, &box);
+   ctx->texture_subdata(ctx, tex, 0, 0, &box, texels, width * 4, 0);
+   FREE(texels);
+
+   u_sampler_view_default_template(&templ, tex, tex->format);
+   view = ctx->create_sampler_view(ctx, tex, &templ);
+   pipe_resource_reference(&tex, NULL);
+   return view;
+}
+
+
+/**
+ * Render the scene on a new context of the screen and read the color
+ * and depth buffers back into cb_data and zs_data.
+ */
+static bool
+render_scene(struct pipe_screen *screen, const float *vertices,
+             unsigned num_threads, uint8_t *cb_data, uint8_t *zs_data)
+{
+   static const float clear_color[] = {0.1, 0.2, 0.3, 0.4};
+   static const enum tgsi_semantic vs_attribs[] = {
+      TGSI_SEMANTIC_POSITION,
+      TGSI_SEMANTIC_GENERIC
+   };
+   static const uint vs_indices[] = {0, 0};
+   struct pipe_sampler_state sampler = {0};
+   const struct pipe_sampler_state *samplers[] = {&sampler};
+   struct pipe_sampler_view *view;
+   struct pipe_resource *cb, *zs;
+   struct pipe_context *ctx;
+   struct cso_context *cso;
+   struct pipe_transfer *transfer;
+   void *vs, *fs, *tex_fs, *map;
+   bool threaded;
+   unsigned t, y;
+
+   softpipe_screen(screen)->num_threads = num_threads;
+   ctx = screen->context_create(screen, NULL, 0);
+   threaded = softpipe_context(ctx)->rast != NULL;
+
+   cb = create_texture(screen, PIPE_FORMAT_R8G8B8A8_UNORM, SIZE, SIZE,
+                       PIPE_BIND_RENDER_TARGET);
+   zs = create_texture(screen, PIPE_FORMAT_Z24_UNORM_S8_UINT, SIZE, SIZE,
+                       PIPE_BIND_DEPTH_STENCIL);
+
+   cso = cso_create_context(ctx, 0);
+   set_framebuffer(cso, ctx, cb, zs);
+   set_common_states(cso, cb);
+   vs = util_make_vertex_passthrough_shader(ctx, 2, vs_attribs, vs_indices,
+                                            false);
+   fs = util_make_fragment_passthrough_shader(ctx, TGSI_SEMANTIC_GENERIC,
+                                              TGSI_INTERPOLATE_PERSPECTIVE,
+                                              true);
+   tex_fs = util_make_fragment_tex_shader(ctx, TGSI_TEXTURE_2D,
+                                          TGSI_RETURN_TYPE_FLOAT,
+                                          TGSI_RETURN_TYPE_FLOAT,
+                                          false, false);
+   cso_set_vertex_shader_handle(cso, vs);
+   cso_set_fragment_shader_handle(cso, fs);
+
+   ctx->clear(ctx, PIPE_CLEAR_COLOR0 | PIPE_CLEAR_DEPTHSTENCIL, NULL,
+              (void *)clear_color, 1.0, 0);
+
+   /* Opaque, depth tested and written, in one draw call */
+   set_blend(cso, false);
+   set_depth(cso, PIPE_FUNC_LESS, true);
+   util_draw_user_vertex_buffer(cso, (void *)vertices, PIPE_PRIM_TRIANGLES,
+                                NUM_TRIANGLES * 3 / 2, 2);
+
+   /* Blended on top, depth tested only, a few triangles per draw call */
+   set_blend(cso, true);
+   set_depth(cso, PIPE_FUNC_LEQUAL, false);
+   for (t = NUM_TRIANGLES / 2; t < NUM_TRIANGLES; t += 8) {
+      util_draw_user_vertex_buffer(cso, (void *)&vertices[t * 3 * 8],
+                                   PIPE_PRIM_TRIANGLES,
+                                   MIN2(8, NUM_TRIANGLES - t) * 3, 2);
+   }
+
+   /* Textured and blended, after clearing the depth buffer only */
+   ctx->clear(ctx, PIPE_CLEAR_DEPTHSTENCIL, NULL, NULL, 1.0, 0);
+   sampler.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_t = PIPE_TEX_WRAP_MIRROR_REPEAT;
+   sampler.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   sampler.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler.normalized_coords = 1;
+   cso_set_samplers(cso, PIPE_SHADER_FRAGMENT, 1, samplers);
+   view = create_sampler_view(ctx);
+   ctx->set_sampler_views(ctx, PIPE_SHADER_FRAGMENT, 0, 1, 0, false, &view);
+   cso_set_fragment_shader_handle(cso, tex_fs);
+   set_depth(cso, PIPE_FUNC_LESS, true);
+   util_draw_user_vertex_buffer(cso, (void *)&vertices[NUM_TRIANGLES * 8],
+                                PIPE_PRIM_TRIANGLES,
+                                NUM_TRIANGLES * 3 * 2 / 3, 2);
+   ctx->flush(ctx, NULL, 0);
+
+   map = pipe_texture_map(ctx, cb, 0, 0, PIPE_MAP_READ, 0, 0, SIZE, SIZE,
+                          &transfer);
+   for (y = 0; y < SIZE; y++)
+      memcpy(cb_data + y * SIZE * 4, (uint8_t *)map + y * transfer->stride,
+             SIZE * 4);
+   pipe_texture_unmap(ctx, transfer);
+   map = pipe_texture_map(ctx, zs, 0, 0, PIPE_MAP_READ, 0, 0, SIZE, SIZE,
+                          &transfer);
+   for (y = 0; y < SIZE; y++)
+      memcpy(zs_data + y * SIZE * 4, (uint8_t *)map + y * transfer->stride,
+             SIZE * 4);
+   pipe_texture_unmap(ctx, transfer);
+
+   ctx->set_sampler_views(ctx, PIPE_SHADER_FRAGMENT, 0, 0, 1, false, NULL);
+   pipe_sampler_view_reference(&view, NULL);
+   cso_destroy_context(cso);
+   ctx->delete_vs_state(ctx, vs);
+   ctx->delete_fs_state(ctx, fs);
+   ctx->delete_fs_state(ctx, tex_fs);
+   pipe_resource_reference(&cb, NULL);
+   pipe_resource_reference(&zs, NULL);
+   ctx->destroy(ctx);
+
+   return threaded;
+}
+
+
+/**
+ * Count the pixels that differ, and return the largest difference of a
+ * byte in \p max_diff.
+ */
+static unsigned
+count_differences(const uint8_t *a, const uint8_t *b, unsigned *max_diff)
+{
+   unsigned i, c, count = 0;
+
+   *max_diff = 0;
+   for (i = 0; i < SIZE * SIZE * 4; i += 4) {
+      if (memcmp(&a[i], &b[i], 4) == 0)
+         continue;
+
+      for (c = 0; c < 4; c++)
+         *max_diff = MAX2(*max_diff, (unsigned)abs(a[i + c] - b[i + c]));
+      count++;
+   }
+   return count;
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   uint8_t *cb_data[3], *zs_data[3];
+   unsigned cb_diff, zs_diff, cb_max_diff, zs_max_diff, cleared = 0, i;
+   unsigned rerun_diff, rerun_max_diff;
+   float *vertices;
+   bool threaded;
+
+   screen = softpipe_create_screen(null_sw_create());
+   if (!screen) {
+      fprintf(stderr, "cannot create a softpipe screen\n");
+      return 1;
+   }
+
+   vertices = make_triangles();
+   for (i = 0; i < 3; i++) {
+      cb_data[i] = MALLOC(SIZE * SIZE * 4);
+      zs_data[i] = MALLOC(SIZE * SIZE * 4);
+   }
+
+   render_scene(screen, vertices, 1, cb_data[0], zs_data[0]);
+   threaded = render_scene(screen, vertices, NUM_THREADS, cb_data[1],
+                           zs_data[1]);
+   render_scene(screen, vertices, NUM_THREADS, cb_data[2], zs_data[2]);
+
+   cb_diff = count_differences(cb_data[0], cb_data[1], &cb_max_diff);
+   zs_diff = count_differences(zs_data[0], zs_data[1], &zs_max_diff);
+   rerun_diff = count_differences(cb_data[1], cb_data[2], &rerun_max_diff) +
+                count_differences(zs_data[1], zs_data[2], &rerun_max_diff);
+
+   /* make sure the scene did cover most of the framebuffer */
+   for (i = 0; i < SIZE * SIZE; i++)
+      cleared += zs_data[0][i * 4] == 0xff && zs_data[0][i * 4 + 1] == 0xff;
+
+   printf("%u threads: %u color pixels differ by up to %u, "
+          "%u depth pixels differ, %u of %u pixels not drawn\n",
+          NUM_THREADS, cb_diff, cb_max_diff, zs_diff, cleared, SIZE * SIZE);
+   if (rerun_diff)
+      printf("%u pixels differ between two threaded runs\n", rerun_diff);
+
+   for (i = 0; i < 3; i++) {
+      FREE(cb_data[i]);
+      FREE(zs_data[i]);
+   }
+   FREE(vertices);
+   screen->destroy(screen);
+
+   if (!threaded) {
+      printf("the tile-parallel rasterizer could not be created\n");
+      return 77;
+   }
+   return cb_diff == 0 && zs_diff == 0 && rerun_diff == 0 &&
+          cleared < SIZE * SIZE / 4 ? 0 : 1;
+}
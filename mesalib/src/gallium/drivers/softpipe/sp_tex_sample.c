@@ -2732,6 +2732,118 @@ mip_filter_linear_2d_linear_repeat_POT(
    }
 }
 
+/**
+ * Mip filters for views with a simd_format: choose the level of each
+ * pixel like mip_filter_none(), mip_filter_nearest() and
+ * mip_filter_linear() do, then sample the whole quad with
+ * sp_simd_img_filter_2d().  The min and mag filters are the same.
+ */
+static void
+mip_filter_simd_none(const struct sp_sampler_view *sp_sview,
+                     const struct sp_sampler *sp_samp,
+                     img_filter_func min_filter,
+                     img_filter_func mag_filter,
+                     const float s[TGSI_QUAD_SIZE],
+                     const float t[TGSI_QUAD_SIZE],
+                     const float p[TGSI_QUAD_SIZE],
+                     int gather_comp,
+                     const float lod[TGSI_QUAD_SIZE],
+                     const struct filter_args *filt_args,
+                     float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const int first = sp_sview->base.u.tex.first_level;
+   const int level[TGSI_QUAD_SIZE] = { first, first, first, first };
+
+   sp_simd_img_filter_2d(sp_sview, sp_samp, s, t, level, filt_args->offset,
+                         rgba);
+}
+
+static void
+mip_filter_simd_nearest(const struct sp_sampler_view *sp_sview,
+                        const struct sp_sampler *sp_samp,
+                        img_filter_func min_filter,
+                        img_filter_func mag_filter,
+                        const float s[TGSI_QUAD_SIZE],
+                        const float t[TGSI_QUAD_SIZE],
+                        const float p[TGSI_QUAD_SIZE],
+                        int gather_comp,
+                        const float lod[TGSI_QUAD_SIZE],
+                        const struct filter_args *filt_args,
+                        float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const int first = sp_sview->base.u.tex.first_level;
+   const int last = sp_sview->base.u.tex.last_level;
+   int level[TGSI_QUAD_SIZE];
+   int j;
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      /* The texels are read without bounds checks, so keep the level in
+       * range, even for NaNs and huge lods.
+       */
+      if (!(lod[j] > 0.0f))
+         level[j] = first;
+      else
+         level[j] = first + (int)(MIN2(lod[j], (float)(last - first)) + 0.5F);
+   }
+
+   sp_simd_img_filter_2d(sp_sview, sp_samp, s, t, level, filt_args->offset,
+                         rgba);
+}
+
+static void
+mip_filter_simd_linear(const struct sp_sampler_view *sp_sview,
+                       const struct sp_sampler *sp_samp,
+                       img_filter_func min_filter,
+                       img_filter_func mag_filter,
+                       const float s[TGSI_QUAD_SIZE],
+                       const float t[TGSI_QUAD_SIZE],
+                       const float p[TGSI_QUAD_SIZE],
+                       int gather_comp,
+                       const float lod[TGSI_QUAD_SIZE],
+                       const struct filter_args *filt_args,
+                       float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const int first = sp_sview->base.u.tex.first_level;
+   const int last = sp_sview->base.u.tex.last_level;
+   int level0[TGSI_QUAD_SIZE], level1[TGSI_QUAD_SIZE];
+   bool blend[TGSI_QUAD_SIZE];
+   bool any_blend = false;
+   int j, c;
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      if (!(lod[j] > 0.0f))
+         level0[j] = first;
+      else
+         level0[j] = first + (int)MIN2(lod[j], (float)(last - first));
+
+      blend[j] = level0[j] < last && lod[j] > 0.0f;
+      level1[j] = blend[j] ? level0[j] + 1 : level0[j];
+      any_blend |= blend[j];
+   }
+
+   sp_simd_img_filter_2d(sp_sview, sp_samp, s, t, level0, filt_args->offset,
+                         rgba);
+
+   if (any_blend) {
+      float rgbax[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+
+      sp_simd_img_filter_2d(sp_sview, sp_samp, s, t, level1,
+                            filt_args->offset, rgbax);
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         if (blend[j]) {
+            const float levelBlend = frac(lod[j]);
+
+            for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+               rgba[c][j] = lerp(levelBlend, rgba[c][j], rgbax[c][j]);
+         }
+      }
+   }
+
+   if (DEBUG_TEX) {
+      print_sample_4(__FUNCTION__, rgba);
+   }
+}
+
 static const struct sp_filter_funcs funcs_linear = {
    mip_rel_level_linear,
    mip_filter_linear
@@ -2762,6 +2874,21 @@ static const struct sp_filter_funcs funcs_linear_2d_linear_repeat_POT = {
    mip_filter_linear_2d_linear_repeat_POT
 };
 
+static const struct sp_filter_funcs funcs_simd_none = {
+   mip_rel_level_none,
+   mip_filter_simd_none
+};
+
+static const struct sp_filter_funcs funcs_simd_nearest = {
+   mip_rel_level_nearest,
+   mip_filter_simd_nearest
+};
+
+static const struct sp_filter_funcs funcs_simd_linear = {
+   mip_rel_level_linear,
+   mip_filter_simd_linear
+};
+
 /**
  * Do shadow/depth comparisons.
  */
@@ -3158,6 +3285,8 @@ get_filters(const struct sp_sampler_view *sp_sview,
          *min = get_img_filter(sp_sview, &sp_samp->base,
                                PIPE_TEX_FILTER_LINEAR, true);
       }
+   } else if (sp_sview->simd_format && sp_samp->simd_filter_funcs) {
+      *funcs = sp_samp->simd_filter_funcs;
    } else if (sp_sview->pot2d & sp_samp->min_mag_equal_repeat_linear) {
       *funcs = &funcs_linear_2d_linear_repeat_POT;
    } else {
@@ -3548,6 +3677,26 @@ softpipe_create_sampler_state(struct pipe_context *pipe,
       samp->min_mag_equal = TRUE;
    }
 
+   if (samp->min_mag_equal &&
+       sampler->normalized_coords &&
+       sampler->max_anisotropy <= 1 &&
+       (sampler->wrap_s == PIPE_TEX_WRAP_REPEAT ||
+        sampler->wrap_s == PIPE_TEX_WRAP_CLAMP_TO_EDGE) &&
+       (sampler->wrap_t == PIPE_TEX_WRAP_REPEAT ||
+        sampler->wrap_t == PIPE_TEX_WRAP_CLAMP_TO_EDGE)) {
+      switch (sampler->min_mip_filter) {
+      case PIPE_TEX_MIPFILTER_NONE:
+         samp->simd_filter_funcs = &funcs_simd_none;
+         break;
+      case PIPE_TEX_MIPFILTER_NEAREST:
+         samp->simd_filter_funcs = &funcs_simd_nearest;
+         break;
+      case PIPE_TEX_MIPFILTER_LINEAR:
+         samp->simd_filter_funcs = &funcs_simd_linear;
+         break;
+      }
+   }
+
    return (void *)samp;
 }
 
@@ -3640,6 +3789,8 @@ softpipe_create_sampler_view(struct pipe_context *pipe,
       sview->ypot = util_logbase2( resource->height0 );
 
       sview->oneval = util_format_is_pure_integer(view->format) ? uif(1) : 1.0f;
+
+      sview->simd_format = sp_simd_sampler_format(view);
    }
 
    return (struct pipe_sampler_view *) sview;
@@ -97,6 +97,20 @@ typedef void (*mip_level_func)(const struct sp_sampler_view *sp_sview,
                                const float lod[TGSI_QUAD_SIZE],
                                float level[TGSI_QUAD_SIZE]);
 
+/**
+ * 8 bit texel layouts that sp_tex_sample_sse.c samples directly out of the
+ * resource, bypassing the texture tile cache.
+ */
+enum sp_simd_format {
+   SP_SIMD_FORMAT_NONE = 0,
+   SP_SIMD_FORMAT_RGBA8,
+   SP_SIMD_FORMAT_RGBX8,
+   SP_SIMD_FORMAT_BGRA8,
+   SP_SIMD_FORMAT_BGRX8,
+   SP_SIMD_FORMAT_A8,
+   SP_SIMD_FORMAT_L8,
+};
+
 typedef void (*fetch_func)(struct sp_sampler_view *sp_sview,
                            const int i[TGSI_QUAD_SIZE],
                            const int j[TGSI_QUAD_SIZE], const int k[TGSI_QUAD_SIZE],
@@ -117,6 +131,9 @@ struct sp_sampler_view
    boolean pot2d;
    boolean need_cube_convert;
 
+   /* For the SIMD sampler, or SP_SIMD_FORMAT_NONE */
+   enum sp_simd_format simd_format;
+
    /* these are different per shader type */
    struct softpipe_tex_tile_cache *cache;
    compute_lambda_func compute_lambda;
@@ -147,6 +164,11 @@ struct sp_sampler {
    wrap_linear_func linear_texcoord_p;
 
    const struct sp_filter_funcs *filter_funcs;
+
+   /* Used instead of the above with views that have a simd_format, if
+    * the SIMD sampler supports this state, otherwise NULL.
+    */
+   const struct sp_filter_funcs *simd_filter_funcs;
 };
 
 
@@ -184,4 +206,17 @@ struct sp_tgsi_sampler *
 sp_create_tgsi_sampler(void);
 
 
+enum sp_simd_format
+sp_simd_sampler_format(const struct pipe_sampler_view *view);
+
+void
+sp_simd_img_filter_2d(const struct sp_sampler_view *sp_sview,
+                      const struct sp_sampler *sp_samp,
+                      const float s[TGSI_QUAD_SIZE],
+                      const float t[TGSI_QUAD_SIZE],
+                      const int level[TGSI_QUAD_SIZE],
+                      const int8_t *offset,
+                      float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE]);
+
+
 #endif /* SP_TEX_SAMPLE_H */
@@ -0,0 +1,442 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * SIMD sampling of 2D textures with 8 bit unorm texels.
+ *
+ * The generic sampler in sp_tex_sample.c filters one pixel at a time, and
+ * gets every texel through the texture tile cache, which converts whole
+ * tiles to floats first.  For the common 8 bit formats below that is
+ * mostly overhead: this reads the texels of all four pixels of a quad
+ * straight out of the resource, which is already in the layout we want,
+ * and converts and filters the quad in SSE registers, one channel of four
+ * pixels at a time.  The gathers use AVX2 where the compiler targets it.
+ *
+ * The arithmetic is that of the generic code, in the same order: texels
+ * are converted with ubyte_to_float(), wrapped like wrap_linear_repeat()
+ * and friends, and filtered with lerp_2d(), so both give the same results.
+ */
+
+#include "pipe/p_config.h"
+#include "pipe/p_defines.h"
+#include "util/u_math.h"
+#include "util/u_inlines.h"
+
+#include "sp_screen.h"
+#include "sp_texture.h"
+#include "sp_tex_sample.h"
+
+#if defined(PIPE_ARCH_SSE)
+
+#include "util/u_sse.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+/**
+ * Which SIMD texel layout, if any, the view can be sampled with.
+ */
+enum sp_simd_format
+sp_simd_sampler_format(const struct pipe_sampler_view *view)
+{
+   const struct softpipe_resource *spr = softpipe_resource(view->texture);
+
+   if (sp_debug & SP_DBG_NO_SIMD_TEX)
+      return SP_SIMD_FORMAT_NONE;
+
+   if ((view->target != PIPE_TEXTURE_2D &&
+        view->target != PIPE_TEXTURE_RECT) ||
+       spr->dt || !spr->data || spr->base.b.nr_samples > 1)
+      return SP_SIMD_FORMAT_NONE;
+
+   switch (view->format) {
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+      return SP_SIMD_FORMAT_RGBA8;
+   case PIPE_FORMAT_R8G8B8X8_UNORM:
+      return SP_SIMD_FORMAT_RGBX8;
+   case PIPE_FORMAT_B8G8R8A8_UNORM:
+      return SP_SIMD_FORMAT_BGRA8;
+   case PIPE_FORMAT_B8G8R8X8_UNORM:
+      return SP_SIMD_FORMAT_BGRX8;
+   case PIPE_FORMAT_A8_UNORM:
+      return SP_SIMD_FORMAT_A8;
+   case PIPE_FORMAT_L8_UNORM:
+      return SP_SIMD_FORMAT_L8;
+   default:
+      return SP_SIMD_FORMAT_NONE;
+   }
+}
+
+
+/**
+ * floor() of each element as ints, and as floats in *fl.  Exact for
+ * magnitudes below 2^31.
+ */
+static inline __m128i
+floor_epi32(__m128 x, __m128 *fl)
+{
+   __m128i i = _mm_cvttps_epi32(x);
+   __m128 f = _mm_cvtepi32_ps(i);
+   const __m128 adjust = _mm_cmpgt_ps(f, x);
+
+   /* adjust is all ones, ie. -1, where truncating rounded up */
+   i = _mm_add_epi32(i, _mm_castps_si128(adjust));
+   *fl = _mm_sub_ps(f, _mm_and_ps(adjust, _mm_set1_ps(1.0f)));
+   return i;
+}
+
+
+/**
+ * Clamp each element to [0, max].
+ */
+static inline __m128i
+clamp_epi32(__m128i v, __m128i max)
+{
+   const __m128i over = _mm_cmpgt_epi32(v, max);
+
+   v = _mm_andnot_si128(_mm_srai_epi32(v, 31), v);
+   return _mm_or_si128(_mm_and_si128(over, max),
+                       _mm_andnot_si128(over, v));
+}
+
+
+/**
+ * Like repeat() for each element.  Texture sizes are powers of two if
+ * pot is set, and we can mask.  Otherwise this does the modulo the
+ * slow way, and clamps as repeat() goes wrong for very negative coords.
+ */
+static inline __m128i
+repeat_epi32(__m128i coord, __m128i size, bool pot)
+{
+   union m128i c, s;
+   int j;
+
+   if (pot)
+      return _mm_and_si128(coord, _mm_sub_epi32(size, _mm_set1_epi32(1)));
+
+   c.m = coord;
+   s.m = size;
+   for (j = 0; j < TGSI_QUAD_SIZE; j++)
+      c.ui[j] = ((int64_t)(int)c.ui[j] + s.ui[j] * 1024) % (int)s.ui[j];
+   return clamp_epi32(c.m, _mm_sub_epi32(size, _mm_set1_epi32(1)));
+}
+
+
+/**
+ * wrap_nearest_repeat() or wrap_nearest_clamp_to_edge().
+ */
+static inline __m128i
+wrap_nearest(unsigned wrap, bool pot, __m128 s, __m128i size, int offset)
+{
+   const __m128 fsize = _mm_cvtepi32_ps(size);
+   __m128 fl;
+
+   if (wrap == PIPE_TEX_WRAP_REPEAT) {
+      __m128i i = floor_epi32(_mm_mul_ps(s, fsize), &fl);
+      return repeat_epi32(_mm_add_epi32(i, _mm_set1_epi32(offset)),
+                          size, pot);
+   }
+   else {
+      const __m128 u = _mm_add_ps(_mm_mul_ps(s, fsize),
+                                  _mm_set1_ps((float)offset));
+      return clamp_epi32(floor_epi32(u, &fl),
+                         _mm_sub_epi32(size, _mm_set1_epi32(1)));
+   }
+}
+
+
+/**
+ * wrap_linear_repeat() or wrap_linear_clamp_to_edge().
+ */
+static inline __m128
+wrap_linear(unsigned wrap, bool pot, __m128 s, __m128i size, int offset,
+            __m128i *i0, __m128i *i1)
+{
+   const __m128 fsize = _mm_cvtepi32_ps(size);
+   const __m128 half = _mm_set1_ps(0.5f);
+   const __m128i one = _mm_set1_epi32(1);
+   __m128 u, fl;
+
+   if (wrap == PIPE_TEX_WRAP_REPEAT) {
+      u = _mm_sub_ps(_mm_mul_ps(s, fsize), half);
+      *i0 = floor_epi32(u, &fl);
+      *i0 = repeat_epi32(_mm_add_epi32(*i0, _mm_set1_epi32(offset)),
+                         size, pot);
+      *i1 = repeat_epi32(_mm_add_epi32(*i0, one), size, pot);
+   }
+   else {
+      /* max, then min, returns 0 for NaNs, so i0 and i1 stay in range */
+      u = _mm_add_ps(_mm_mul_ps(s, fsize), _mm_set1_ps((float)offset));
+      u = _mm_min_ps(_mm_max_ps(u, _mm_setzero_ps()), fsize);
+      u = _mm_sub_ps(u, half);
+      *i0 = floor_epi32(u, &fl);
+      *i1 = _mm_add_epi32(*i0, one);
+      *i0 = _mm_andnot_si128(_mm_srai_epi32(*i0, 31), *i0);
+      *i1 = clamp_epi32(*i1, _mm_sub_epi32(size, one));
+   }
+
+   return _mm_sub_ps(u, fl);
+}
+
+
+/**
+ * Like img_filter_2d_nearest_repeat_POT(), which adds the offset before
+ * rounding down rather than after.
+ */
+static inline __m128i
+wrap_nearest_repeat_pot(__m128 s, __m128i size, int offset)
+{
+   const __m128 u = _mm_add_ps(_mm_mul_ps(s, _mm_cvtepi32_ps(size)),
+                               _mm_set1_ps((float)offset));
+   __m128 fl;
+
+   return _mm_and_si128(floor_epi32(u, &fl),
+                        _mm_sub_epi32(size, _mm_set1_epi32(1)));
+}
+
+
+/**
+ * Like img_filter_2d_linear_repeat_POT(), likewise.
+ */
+static inline __m128
+wrap_linear_repeat_pot(__m128 s, __m128i size, int offset,
+                       __m128i *i0, __m128i *i1)
+{
+   const __m128i mask = _mm_sub_epi32(size, _mm_set1_epi32(1));
+   __m128 u, fl;
+
+   u = _mm_sub_ps(_mm_mul_ps(s, _mm_cvtepi32_ps(size)), _mm_set1_ps(0.5f));
+   u = _mm_add_ps(u, _mm_set1_ps((float)offset));
+   *i0 = _mm_and_si128(floor_epi32(u, &fl), mask);
+   *i1 = _mm_and_si128(_mm_add_epi32(*i0, _mm_set1_epi32(1)), mask);
+   return _mm_sub_ps(u, fl);
+}
+
+
+/**
+ * Load the texels at the four byte offsets into data.
+ */
+static inline __m128i
+fetch_texels(enum sp_simd_format format, const uint8_t *data,
+             __m128i offset)
+{
+   union m128i o;
+
+   o.m = offset;
+
+   if (format == SP_SIMD_FORMAT_A8 || format == SP_SIMD_FORMAT_L8)
+      return _mm_setr_epi32(data[o.ui[0]], data[o.ui[1]],
+                            data[o.ui[2]], data[o.ui[3]]);
+
+#if defined(__AVX2__)
+   return _mm_i32gather_epi32((const int *)data, offset, 1);
+#else
+   return _mm_setr_epi32(*(const int32_t *)(data + o.ui[0]),
+                         *(const int32_t *)(data + o.ui[1]),
+                         *(const int32_t *)(data + o.ui[2]),
+                         *(const int32_t *)(data + o.ui[3]));
+#endif
+}
+
+
+static inline __m128
+ubyte_to_float_ps(__m128i ub)
+{
+   return _mm_mul_ps(_mm_cvtepi32_ps(ub), _mm_set1_ps(1.0f / 255.0f));
+}
+
+
+/**
+ * Convert four texels to four floats for each of R, G, B and A, the same
+ * as util_format_unpack_rgba() would.
+ */
+static inline void
+unpack_texels(enum sp_simd_format format, __m128i texels, __m128 rgba[4])
+{
+   const __m128i mask = _mm_set1_epi32(0xff);
+   const __m128 one = _mm_set1_ps(1.0f);
+
+   switch (format) {
+   case SP_SIMD_FORMAT_RGBA8:
+   case SP_SIMD_FORMAT_RGBX8:
+      rgba[0] = ubyte_to_float_ps(_mm_and_si128(texels, mask));
+      rgba[1] = ubyte_to_float_ps(_mm_and_si128(_mm_srli_epi32(texels, 8),
+                                                mask));
+      rgba[2] = ubyte_to_float_ps(_mm_and_si128(_mm_srli_epi32(texels, 16),
+                                                mask));
+      rgba[3] = format == SP_SIMD_FORMAT_RGBA8 ?
+         ubyte_to_float_ps(_mm_srli_epi32(texels, 24)) : one;
+      break;
+   case SP_SIMD_FORMAT_BGRA8:
+   case SP_SIMD_FORMAT_BGRX8:
+      rgba[2] = ubyte_to_float_ps(_mm_and_si128(texels, mask));
+      rgba[1] = ubyte_to_float_ps(_mm_and_si128(_mm_srli_epi32(texels, 8),
+                                                mask));
+      rgba[0] = ubyte_to_float_ps(_mm_and_si128(_mm_srli_epi32(texels, 16),
+                                                mask));
+      rgba[3] = format == SP_SIMD_FORMAT_BGRA8 ?
+         ubyte_to_float_ps(_mm_srli_epi32(texels, 24)) : one;
+      break;
+   case SP_SIMD_FORMAT_A8:
+      rgba[0] = rgba[1] = rgba[2] = _mm_setzero_ps();
+      rgba[3] = ubyte_to_float_ps(texels);
+      break;
+   case SP_SIMD_FORMAT_L8:
+      rgba[0] = rgba[1] = rgba[2] = ubyte_to_float_ps(texels);
+      rgba[3] = one;
+      break;
+   default:
+      unreachable("unexpected SIMD texel format");
+   }
+}
+
+
+static inline __m128
+lerp_ps(__m128 a, __m128 v0, __m128 v1)
+{
+   return _mm_add_ps(v0, _mm_mul_ps(a, _mm_sub_ps(v1, v0)));
+}
+
+
+/**
+ * Sample a quad of a 2D texture, each pixel from the given mipmap level,
+ * with the sampler's (equal) min and mag filter.
+ */
+void
+sp_simd_img_filter_2d(const struct sp_sampler_view *sp_sview,
+                      const struct sp_sampler *sp_samp,
+                      const float s[TGSI_QUAD_SIZE],
+                      const float t[TGSI_QUAD_SIZE],
+                      const int level[TGSI_QUAD_SIZE],
+                      const int8_t *offset,
+                      float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const struct softpipe_resource *spr =
+      softpipe_resource(sp_sview->base.texture);
+   const enum sp_simd_format format = sp_sview->simd_format;
+   const unsigned cpp =
+      format == SP_SIMD_FORMAT_A8 || format == SP_SIMD_FORMAT_L8 ? 1 : 4;
+   const unsigned layer = sp_sview->base.u.tex.first_layer;
+   const unsigned wrap_s = sp_samp->base.wrap_s;
+   const unsigned wrap_t = sp_samp->base.wrap_t;
+   const bool pot = sp_sview->pot2d;
+   /* where get_img_filter() picks the _repeat_POT filters */
+   const bool pot_repeat = pot && wrap_s == PIPE_TEX_WRAP_REPEAT &&
+                           wrap_t == PIPE_TEX_WRAP_REPEAT;
+   const uint8_t *data = spr->data;
+   union m128i width, height, stride, base;
+   __m128 color[4];
+   int j, c;
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      const unsigned l = level[j];
+
+      width.ui[j] = u_minify(spr->base.b.width0, l);
+      height.ui[j] = u_minify(spr->base.b.height0, l);
+      stride.ui[j] = spr->stride[l];
+      base.ui[j] = spr->level_offset[l] + layer * spr->img_stride[l];
+   }
+
+   if (sp_samp->base.min_img_filter == PIPE_TEX_FILTER_NEAREST) {
+      __m128i x, y, texels;
+
+      if (pot_repeat) {
+         x = wrap_nearest_repeat_pot(_mm_loadu_ps(s), width.m, offset[0]);
+         y = wrap_nearest_repeat_pot(_mm_loadu_ps(t), height.m, offset[1]);
+      }
+      else {
+         x = wrap_nearest(wrap_s, pot, _mm_loadu_ps(s), width.m, offset[0]);
+         y = wrap_nearest(wrap_t, pot, _mm_loadu_ps(t), height.m, offset[1]);
+      }
+
+      texels = fetch_texels(format, data,
+                            _mm_add_epi32(_mm_add_epi32(base.m,
+                                             mm_mullo_epi32(y, stride.m)),
+                                          mm_mullo_epi32(x, _mm_set1_epi32(cpp))));
+      unpack_texels(format, texels, color);
+   }
+   else {
+      __m128i x0, x1, y0, y1, row0, row1, col0, col1;
+      __m128 xw, yw;
+      __m128 c00[4], c10[4], c01[4], c11[4];
+
+      if (pot_repeat) {
+         xw = wrap_linear_repeat_pot(_mm_loadu_ps(s), width.m, offset[0],
+                                     &x0, &x1);
+         yw = wrap_linear_repeat_pot(_mm_loadu_ps(t), height.m, offset[1],
+                                     &y0, &y1);
+      }
+      else {
+         xw = wrap_linear(wrap_s, pot, _mm_loadu_ps(s), width.m, offset[0],
+                          &x0, &x1);
+         yw = wrap_linear(wrap_t, pot, _mm_loadu_ps(t), height.m, offset[1],
+                          &y0, &y1);
+      }
+
+      row0 = _mm_add_epi32(base.m, mm_mullo_epi32(y0, stride.m));
+      row1 = _mm_add_epi32(base.m, mm_mullo_epi32(y1, stride.m));
+      col0 = mm_mullo_epi32(x0, _mm_set1_epi32(cpp));
+      col1 = mm_mullo_epi32(x1, _mm_set1_epi32(cpp));
+
+      unpack_texels(format, fetch_texels(format, data,
+                                         _mm_add_epi32(row0, col0)), c00);
+      unpack_texels(format, fetch_texels(format, data,
+                                         _mm_add_epi32(row0, col1)), c10);
+      unpack_texels(format, fetch_texels(format, data,
+                                         _mm_add_epi32(row1, col0)), c01);
+      unpack_texels(format, fetch_texels(format, data,
+                                         _mm_add_epi32(row1, col1)), c11);
+
+      /* lerp_2d() */
+      for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+         color[c] = lerp_ps(yw, lerp_ps(xw, c00[c], c10[c]),
+                                lerp_ps(xw, c01[c], c11[c]));
+   }
+
+   for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+      _mm_storeu_ps(rgba[c], color[c]);
+}
+
+#else /* !PIPE_ARCH_SSE */
+
+enum sp_simd_format
+sp_simd_sampler_format(const struct pipe_sampler_view *view)
+{
+   return SP_SIMD_FORMAT_NONE;
+}
+
+void
+sp_simd_img_filter_2d(const struct sp_sampler_view *sp_sview,
+                      const struct sp_sampler *sp_samp,
+                      const float s[TGSI_QUAD_SIZE],
+                      const float t[TGSI_QUAD_SIZE],
+                      const int level[TGSI_QUAD_SIZE],
+                      const int8_t *offset,
+                      float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   unreachable("no SIMD sampler on this architecture");
+}
+
+#endif /* !PIPE_ARCH_SSE */
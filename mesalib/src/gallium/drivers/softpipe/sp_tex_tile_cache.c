@@ -100,6 +100,15 @@ sp_tex_tile_cache_validate_texture(struct softpipe_tex_tile_cache *tc)
    for (i = 0; i < ARRAY_SIZE(tc->entries); i++) {
       tc->entries[i].addr.bits.invalid = 1;
    }
+
+   /* The storage itself may have been replaced (softpipe_replace_buffer_storage),
+    * so map it again on the next miss.
+    */
+   if (tc->tex_trans_map) {
+      tc->pipe->texture_unmap(tc->pipe, tc->tex_trans);
+      tc->tex_trans = NULL;
+      tc->tex_trans_map = NULL;
+   }
 }
 
 static boolean
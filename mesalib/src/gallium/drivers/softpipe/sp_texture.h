@@ -30,6 +30,7 @@
 
 
 #include "pipe/p_state.h"
+#include "util/u_threaded_context.h"
 #include "sp_limits.h"
 
 
@@ -39,11 +40,12 @@ struct softpipe_context;
 
 
 /**
- * Subclass of pipe_resource.
+ * Subclass of pipe_resource, by way of threaded_resource so that contexts
+ * can be wrapped with u_threaded_context.
  */
 struct softpipe_resource
 {
-   struct pipe_resource base;
+   struct threaded_resource base;
 
    unsigned long level_offset[SP_MAX_TEXTURE_2D_LEVELS];
    unsigned stride[SP_MAX_TEXTURE_2D_LEVELS];
@@ -70,11 +72,11 @@ struct softpipe_resource
 
 
 /**
- * Subclass of pipe_transfer.
+ * Subclass of pipe_transfer, by way of threaded_transfer.
  */
 struct softpipe_transfer
 {
-   struct pipe_transfer base;
+   struct threaded_transfer base;
 
    unsigned long offset;
 };
@@ -445,6 +445,107 @@ sp_flush_tile_cache(struct softpipe_tile_cache *tc)
 #endif
 }
 
+/**
+ * Write all dirty tiles back to the transfer and empty the cache, but
+ * leave the tiles flagged as cleared alone.  Used when other caches of the
+ * same surface are about to render to it, see sp_rast.c.
+ */
+void
+sp_tile_cache_write_back(struct softpipe_tile_cache *tc)
+{
+   int pos;
+
+   if (tc->num_maps) {
+      for (pos = 0; pos < ARRAY_SIZE(tc->entries); pos++) {
+         if (tc->entries[pos])
+            sp_flush_tile(tc, pos);
+      }
+
+      tc->last_tile_addr.bits.invalid = 1;
+   }
+}
+
+
+/**
+ * Flag the same tiles as cleared, to the same value, in \p dst as in
+ * \p src.  Both must be caching the same surface.
+ */
+void
+sp_tile_cache_copy_clears(struct softpipe_tile_cache *dst,
+                          const struct softpipe_tile_cache *src)
+{
+   assert(dst->surface == src->surface);
+   assert(dst->clear_flags_size == src->clear_flags_size);
+
+   if (src->num_maps) {
+      memcpy(dst->clear_flags, src->clear_flags, src->clear_flags_size);
+      dst->clear_color = src->clear_color;
+      dst->clear_val = src->clear_val;
+   }
+}
+
+
+/**
+ * Tiles \p src loaded after sp_tile_cache_copy_clears() are no longer
+ * cleared; unflag them in \p dst as well.
+ */
+void
+sp_tile_cache_merge_clears(struct softpipe_tile_cache *dst,
+                           const struct softpipe_tile_cache *src)
+{
+   uint i;
+
+   assert(dst->surface == src->surface);
+   assert(dst->clear_flags_size == src->clear_flags_size);
+
+   if (src->num_maps) {
+      for (i = 0; i < src->clear_flags_size / sizeof(uint); i++)
+         dst->clear_flags[i] &= src->clear_flags[i];
+   }
+}
+
+
+/**
+ * Move the tiles at \p x, \p y (in pixels) of every layer from \p src to
+ * \p dst as they are, without writing them back: \p dst then carries on
+ * with the same unrounded colors.  Both must be caching the same surface.
+ * Used to hand tiles from one thread to another, see sp_rast.c.
+ */
+void
+sp_tile_cache_move_tiles(struct softpipe_tile_cache *dst,
+                         struct softpipe_tile_cache *src,
+                         unsigned x, unsigned y)
+{
+   unsigned pos;
+
+   assert(dst->surface == src->surface);
+
+   for (pos = 0; pos < ARRAY_SIZE(src->tile_addrs); pos++) {
+      union tile_address addr = src->tile_addrs[pos];
+      struct softpipe_cached_tile *tile;
+
+      if (addr.bits.invalid ||
+          addr.bits.x != x / TILE_SIZE || addr.bits.y != y / TILE_SIZE)
+         continue;
+
+      /* the tile has the same position in both caches */
+      if (dst->entries[pos])
+         sp_flush_tile(dst, pos);
+
+      tile = dst->entries[pos];
+      dst->entries[pos] = src->entries[pos];
+      dst->tile_addrs[pos] = addr;
+      src->entries[pos] = tile;
+      src->tile_addrs[pos].bits.invalid = 1;
+
+      clear_clear_flag(dst->clear_flags, addr, dst->clear_flags_size);
+   }
+
+   src->last_tile_addr.bits.invalid = 1;
+   dst->last_tile_addr.bits.invalid = 1;
+}
+
+
 static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc)
 {
@@ -118,6 +118,22 @@ sp_tile_cache_get_surface(struct softpipe_tile_cache *tc);
 extern void
 sp_flush_tile_cache(struct softpipe_tile_cache *tc);
 
+extern void
+sp_tile_cache_write_back(struct softpipe_tile_cache *tc);
+
+extern void
+sp_tile_cache_copy_clears(struct softpipe_tile_cache *dst,
+                          const struct softpipe_tile_cache *src);
+
+extern void
+sp_tile_cache_merge_clears(struct softpipe_tile_cache *dst,
+                           const struct softpipe_tile_cache *src);
+
+extern void
+sp_tile_cache_move_tiles(struct softpipe_tile_cache *dst,
+                         struct softpipe_tile_cache *src,
+                         unsigned x, unsigned y);
+
 extern void
 sp_tile_cache_clear(struct softpipe_tile_cache *tc,
                     const union pipe_color_union *color,
@@ -0,0 +1,271 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * SSE2 versions of the pack and unpack functions of the 8 bit RGBA and BGRA
+ * formats, which is what glReadPixels and glTexImage convert between most:
+ * GL_RGBA and GL_BGRA with GL_UNSIGNED_BYTE or GL_UNSIGNED_INT_8_8_8_8_REV
+ * and GL_FLOAT, from and to the usual window and texture formats.
+ *
+ * They give exactly the same results as the generated ones in
+ * u_format_table.c, which they fall back to for the last few pixels of a row.
+ */
+
+#include "u_format.h"
+
+#if defined(PIPE_ARCH_SSE) && !defined(NO_FORMAT_ASM)
+
+#include <emmintrin.h>
+#include "u_format_pack.h"
+#include "util/u_cpu_detect.h"
+
+/* Swap the R and B bytes of each 32 bit pixel */
+static inline __m128i
+swap_rb(__m128i pixels)
+{
+   const __m128i ga = _mm_set1_epi32(0xff00ff00);
+   __m128i rb = _mm_andnot_si128(ga, pixels);
+
+   rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+   return _mm_or_si128(_mm_and_si128(pixels, ga), rb);
+}
+
+static inline void
+unpack_rgba_8unorm(uint8_t *restrict dst, const uint8_t *restrict src,
+                   unsigned width, bool swap, bool has_alpha)
+{
+   for (; width >= 4; width -= 4) {
+      __m128i pixels = _mm_loadu_si128((const __m128i *)src);
+
+      if (swap)
+         pixels = swap_rb(pixels);
+      if (!has_alpha)
+         pixels = _mm_or_si128(pixels, _mm_set1_epi32(0xff000000));
+      _mm_storeu_si128((__m128i *)dst, pixels);
+      src += 16;
+      dst += 16;
+   }
+}
+
+/* Four 8 bit pixels to four RGBA float pixels, like ubyte_to_float() */
+static inline void
+unpack_rgba_float(float *restrict dst, const uint8_t *restrict src,
+                  unsigned width, bool swap, bool has_alpha)
+{
+   const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+   const __m128i zero = _mm_setzero_si128();
+
+   for (; width >= 4; width -= 4) {
+      __m128i pixels = _mm_loadu_si128((const __m128i *)src);
+      __m128i lo, hi;
+
+      if (swap)
+         pixels = swap_rb(pixels);
+      if (!has_alpha)
+         pixels = _mm_or_si128(pixels, _mm_set1_epi32(0xff000000));
+
+      /* 255 / 255.0f is exactly 1 */
+      lo = _mm_unpacklo_epi8(pixels, zero);
+      hi = _mm_unpackhi_epi8(pixels, zero);
+      _mm_storeu_ps(dst + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+      _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+      _mm_storeu_ps(dst + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+      _mm_storeu_ps(dst + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+      src += 16;
+      dst += 16;
+   }
+}
+
+static inline void
+pack_rgba_8unorm(uint8_t *restrict dst, const uint8_t *restrict src,
+                 unsigned width, bool swap, bool has_alpha)
+{
+   for (; width >= 4; width -= 4) {
+      __m128i pixels = _mm_loadu_si128((const __m128i *)src);
+
+      if (swap)
+         pixels = swap_rb(pixels);
+      if (!has_alpha)
+         pixels = _mm_and_si128(pixels, _mm_set1_epi32(0x00ffffff));
+      _mm_storeu_si128((__m128i *)dst, pixels);
+      src += 16;
+      dst += 16;
+   }
+}
+
+/*
+ * float_to_ubyte() of four channels: the same clamping, NaN to 0, and the
+ * same rounding by adding 32768 so that the result ends up in the low byte.
+ */
+static inline __m128i
+float_to_ubyte4(__m128 f)
+{
+   f = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+   f = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f / 256.0f)),
+                  _mm_set1_ps(32768.0f));
+   return _mm_and_si128(_mm_castps_si128(f), _mm_set1_epi32(0xff));
+}
+
+static inline void
+pack_rgba_float(uint8_t *restrict dst, const float *restrict src,
+                unsigned width, bool swap, bool has_alpha)
+{
+   for (; width >= 4; width -= 4) {
+      __m128i p0 = float_to_ubyte4(_mm_loadu_ps(src + 0));
+      __m128i p1 = float_to_ubyte4(_mm_loadu_ps(src + 4));
+      __m128i p2 = float_to_ubyte4(_mm_loadu_ps(src + 8));
+      __m128i p3 = float_to_ubyte4(_mm_loadu_ps(src + 12));
+      __m128i pixels = _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+                                        _mm_packs_epi32(p2, p3));
+
+      if (swap)
+         pixels = swap_rb(pixels);
+      if (!has_alpha)
+         pixels = _mm_and_si128(pixels, _mm_set1_epi32(0x00ffffff));
+      _mm_storeu_si128((__m128i *)dst, pixels);
+      src += 16;
+      dst += 16;
+   }
+}
+
+#define UNPACK_FUNCS(name, swap, has_alpha) \
+static void \
+util_format_##name##_unpack_rgba_8unorm_sse2(uint8_t *restrict dst, const uint8_t *restrict src, unsigned width) \
+{ \
+   unpack_rgba_8unorm(dst, src, width, swap, has_alpha); \
+   util_format_##name##_unpack_rgba_8unorm(dst + (width & ~3) * 4, src + (width & ~3) * 4, width & 3); \
+} \
+\
+static void \
+util_format_##name##_unpack_rgba_float_sse2(void *restrict dst, const uint8_t *restrict src, unsigned width) \
+{ \
+   unpack_rgba_float(dst, src, width, swap, has_alpha); \
+   util_format_##name##_unpack_rgba_float((float *)dst + (width & ~3) * 4, src + (width & ~3) * 4, width & 3); \
+}
+
+#define PACK_8UNORM_FUNC(name, swap, has_alpha) \
+static void \
+util_format_##name##_pack_rgba_8unorm_sse2(uint8_t *restrict dst_row, unsigned dst_stride, const uint8_t *restrict src_row, unsigned src_stride, unsigned width, unsigned height) \
+{ \
+   for (unsigned y = 0; y < height; y++) { \
+      pack_rgba_8unorm(dst_row, src_row, width, swap, has_alpha); \
+      util_format_##name##_pack_rgba_8unorm(dst_row + (width & ~3) * 4, 0, src_row + (width & ~3) * 4, 0, width & 3, 1); \
+      dst_row += dst_stride; \
+      src_row += src_stride; \
+   } \
+}
+
+#define PACK_FLOAT_FUNC(name, swap, has_alpha) \
+static void \
+util_format_##name##_pack_rgba_float_sse2(uint8_t *restrict dst_row, unsigned dst_stride, const float *restrict src_row, unsigned src_stride, unsigned width, unsigned height) \
+{ \
+   for (unsigned y = 0; y < height; y++) { \
+      pack_rgba_float(dst_row, src_row, width, swap, has_alpha); \
+      util_format_##name##_pack_rgba_float(dst_row + (width & ~3) * 4, 0, src_row + (width & ~3) * 4, 0, width & 3, 1); \
+      dst_row += dst_stride; \
+      src_row += src_stride / sizeof(*src_row); \
+   } \
+}
+
+UNPACK_FUNCS(b8g8r8a8_unorm, true, true)
+UNPACK_FUNCS(b8g8r8x8_unorm, true, false)
+UNPACK_FUNCS(r8g8b8a8_unorm, false, true)
+UNPACK_FUNCS(r8g8b8x8_unorm, false, false)
+
+/* Packing R8G8B8A8 from R8G8B8A8 is a copy, which the compiler does better */
+PACK_8UNORM_FUNC(b8g8r8a8_unorm, true, true)
+PACK_8UNORM_FUNC(b8g8r8x8_unorm, true, false)
+PACK_8UNORM_FUNC(r8g8b8x8_unorm, false, false)
+
+PACK_FLOAT_FUNC(b8g8r8a8_unorm, true, true)
+PACK_FLOAT_FUNC(b8g8r8x8_unorm, true, false)
+PACK_FLOAT_FUNC(r8g8b8a8_unorm, false, true)
+PACK_FLOAT_FUNC(r8g8b8x8_unorm, false, false)
+
+static const struct util_format_unpack_description util_format_unpack_descriptions_sse2[] = {
+   [PIPE_FORMAT_B8G8R8A8_UNORM] = {
+      .unpack_rgba_8unorm = &util_format_b8g8r8a8_unorm_unpack_rgba_8unorm_sse2,
+      .unpack_rgba = &util_format_b8g8r8a8_unorm_unpack_rgba_float_sse2,
+   },
+   [PIPE_FORMAT_B8G8R8X8_UNORM] = {
+      .unpack_rgba_8unorm = &util_format_b8g8r8x8_unorm_unpack_rgba_8unorm_sse2,
+      .unpack_rgba = &util_format_b8g8r8x8_unorm_unpack_rgba_float_sse2,
+   },
+   [PIPE_FORMAT_R8G8B8A8_UNORM] = {
+      .unpack_rgba_8unorm = &util_format_r8g8b8a8_unorm_unpack_rgba_8unorm_sse2,
+      .unpack_rgba = &util_format_r8g8b8a8_unorm_unpack_rgba_float_sse2,
+   },
+   [PIPE_FORMAT_R8G8B8X8_UNORM] = {
+      .unpack_rgba_8unorm = &util_format_r8g8b8x8_unorm_unpack_rgba_8unorm_sse2,
+      .unpack_rgba = &util_format_r8g8b8x8_unorm_unpack_rgba_float_sse2,
+   },
+};
+
+static const struct util_format_pack_description util_format_pack_descriptions_sse2[] = {
+   [PIPE_FORMAT_B8G8R8A8_UNORM] = {
+      .pack_rgba_8unorm = &util_format_b8g8r8a8_unorm_pack_rgba_8unorm_sse2,
+      .pack_rgba_float = &util_format_b8g8r8a8_unorm_pack_rgba_float_sse2,
+   },
+   [PIPE_FORMAT_B8G8R8X8_UNORM] = {
+      .pack_rgba_8unorm = &util_format_b8g8r8x8_unorm_pack_rgba_8unorm_sse2,
+      .pack_rgba_float = &util_format_b8g8r8x8_unorm_pack_rgba_float_sse2,
+   },
+   [PIPE_FORMAT_R8G8B8A8_UNORM] = {
+      .pack_rgba_8unorm = &util_format_r8g8b8a8_unorm_pack_rgba_8unorm,
+      .pack_rgba_float = &util_format_r8g8b8a8_unorm_pack_rgba_float_sse2,
+   },
+   [PIPE_FORMAT_R8G8B8X8_UNORM] = {
+      .pack_rgba_8unorm = &util_format_r8g8b8x8_unorm_pack_rgba_8unorm_sse2,
+      .pack_rgba_float = &util_format_r8g8b8x8_unorm_pack_rgba_float_sse2,
+   },
+};
+
+const struct util_format_unpack_description *
+util_format_unpack_description_sse2(enum pipe_format format)
+{
+   if (!util_get_cpu_caps()->has_sse2)
+      return NULL;
+
+   if (format >= ARRAY_SIZE(util_format_unpack_descriptions_sse2))
+      return NULL;
+
+   if (!util_format_unpack_descriptions_sse2[format].unpack_rgba)
+      return NULL;
+
+   return &util_format_unpack_descriptions_sse2[format];
+}
+
+const struct util_format_pack_description *
+util_format_pack_description_sse2(enum pipe_format format)
+{
+   if (!util_get_cpu_caps()->has_sse2)
+      return NULL;
+
+   if (format >= ARRAY_SIZE(util_format_pack_descriptions_sse2))
+      return NULL;
+
+   if (!util_format_pack_descriptions_sse2[format].pack_rgba_float)
+      return NULL;
+
+   return &util_format_pack_descriptions_sse2[format];
+}
+
+#endif /* PIPE_ARCH_SSE */
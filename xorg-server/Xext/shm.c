@@ -467,6 +467,22 @@ ShmDetachSegment(void *value, /* must conform to DeleteType */
     return Success;
 }
 
+/* Keep a segment mapped for users other than pixmaps and the resource
+ * itself, such as RECORD contexts streaming into it, after the client
+ * detaches it.
+ */
+void
+ShmReferenceSegment(ShmDescPtr shmdesc)
+{
+    shmdesc->refcnt++;
+}
+
+void
+ShmReleaseSegment(ShmDescPtr shmdesc)
+{
+    ShmDetachSegment(shmdesc, 0);
+}
+
 static int
 ProcShmDetach(ClientPtr client)
 {
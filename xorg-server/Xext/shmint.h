@@ -86,6 +86,12 @@ extern _X_EXPORT void
 extern _X_EXPORT void
  ShmRegisterFbFuncs(ScreenPtr pScreen);
 
+extern _X_EXPORT void
+ ShmReferenceSegment(ShmDescPtr shmdesc);
+
+extern _X_EXPORT void
+ ShmReleaseSegment(ShmDescPtr shmdesc);
+
 extern _X_EXPORT RESTYPE ShmSegType;
 extern _X_EXPORT int ShmCompletionCode;
 extern _X_EXPORT int BadShmSegCode;
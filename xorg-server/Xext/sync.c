@@ -110,6 +110,10 @@ static const char *WARN_INVALID_COUNTER_ALARM =
 
 static void SyncComputeBracketValues(SyncCounter *);
 
+static Bool SyncIndexTrigger(SyncCounter *, SyncTrigger *);
+
+static void SyncUnindexTrigger(SyncCounter *, SyncTrigger *);
+
 static void SyncInitServerTime(void);
 
 static void SyncInitIdleTime(void);
@@ -139,7 +143,9 @@ SyncCheckWarnIsCounter(const SyncObject * pSync, const char *warning)
 
 /*  Each counter maintains a simple linked list of triggers that are
  *  interested in the counter.  The two functions below are used to
- *  delete and add triggers on this list.
+ *  delete and add triggers on this list.  Counters additionally file
+ *  their triggers in an index ordered by test value, see
+ *  SyncIndexTrigger below.
  */
 void
 SyncDeleteTriggerFromSyncObject(SyncTrigger * pTrigger)
@@ -164,6 +170,8 @@ SyncDeleteTriggerFromSyncObject(SyncTrigger * pTrigger)
                 pTrigger->pSync->pTriglist = pCur->next;
 
             free(pCur);
+            if (SYNC_COUNTER == pTrigger->pSync->type)
+                SyncUnindexTrigger((SyncCounter *) pTrigger->pSync, pTrigger);
             break;
         }
 
@@ -204,6 +212,13 @@ SyncAddTriggerToSyncObject(SyncTrigger * pTrigger)
 
     pCur->pTrigger = pTrigger;
     pCur->next = pTrigger->pSync->pTriglist;
+    pTrigger->indexed_type = -1;
+
+    if (SYNC_COUNTER == pTrigger->pSync->type &&
+        !SyncIndexTrigger((SyncCounter *) pTrigger->pSync, pTrigger)) {
+        free(pCur);
+        return BadAlloc;
+    }
     pTrigger->pSync->pTriglist = pCur;
 
     if (SYNC_COUNTER == pTrigger->pSync->type) {
@@ -310,6 +325,147 @@ SyncCheckTriggerFence(SyncTrigger * pTrigger, int64_t unused)
     return (pFence == NULL || pFence->funcs.CheckTriggered(pFence));
 }
 
+/*  Besides the trigger list, a counter files its triggers in one array
+ *  per test type, sorted by test value and then by trigger address so
+ *  every key is unique.  A counter change then only has to look at the
+ *  triggers whose test value lies in the range its test type fires for,
+ *  rather than at every trigger on the counter, and the bracket values
+ *  of system counters are found by binary search.
+ *
+ *  The test type a trigger is filed under follows its CheckTrigger
+ *  function, which is what decides whether it fires.  The type and value
+ *  it was filed under are kept in the trigger, so it can be found again
+ *  after SyncInitTrigger or an alarm changed them; whoever changes the
+ *  test value of a trigger on a counter must call SyncReindexTrigger.
+ */
+typedef struct _SyncTriggerKey {
+    int64_t value;
+    SyncTrigger *pTrigger;
+} SyncTriggerKey;
+
+static int
+SyncTriggerTestType(SyncTrigger * pTrigger)
+{
+    if (pTrigger->CheckTrigger == SyncCheckTriggerPositiveTransition)
+        return XSyncPositiveTransition;
+    if (pTrigger->CheckTrigger == SyncCheckTriggerNegativeTransition)
+        return XSyncNegativeTransition;
+    if (pTrigger->CheckTrigger == SyncCheckTriggerPositiveComparison)
+        return XSyncPositiveComparison;
+    if (pTrigger->CheckTrigger == SyncCheckTriggerNegativeComparison)
+        return XSyncNegativeComparison;
+    return -1;
+}
+
+/* position of the first key at or after (value, pTrigger); NULL sorts first */
+static int
+SyncTriggerIndexFind(SyncTriggerIndex * pIndex, int64_t value,
+                     SyncTrigger * pTrigger)
+{
+    int lo = 0, hi = pIndex->num;
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        SyncTriggerKey *key = &pIndex->keys[mid];
+
+        if (key->value < value ||
+            (key->value == value &&
+             (uintptr_t) key->pTrigger < (uintptr_t) pTrigger))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* position of the first key with a test value above value */
+static int
+SyncTriggerIndexAbove(SyncTriggerIndex * pIndex, int64_t value)
+{
+    int lo = 0, hi = pIndex->num;
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+
+        if (pIndex->keys[mid].value <= value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static Bool
+SyncIndexTrigger(SyncCounter * pCounter, SyncTrigger * pTrigger)
+{
+    int type = SyncTriggerTestType(pTrigger);
+    SyncTriggerIndex *pIndex;
+    int i;
+
+    pTrigger->indexed_type = -1;
+    if (type < 0)
+        return TRUE;
+
+    pIndex = &pCounter->triggers[type];
+    if (pIndex->num == pIndex->size) {
+        int size = pIndex->size ? pIndex->size * 2 : 8;
+        SyncTriggerKey *keys;
+
+        keys = reallocarray(pIndex->keys, size, sizeof(SyncTriggerKey));
+        if (!keys)
+            return FALSE;
+        pIndex->keys = keys;
+        pIndex->size = size;
+    }
+
+    i = SyncTriggerIndexFind(pIndex, pTrigger->test_value, pTrigger);
+    memmove(&pIndex->keys[i + 1], &pIndex->keys[i],
+            (pIndex->num - i) * sizeof(SyncTriggerKey));
+    pIndex->keys[i].value = pTrigger->test_value;
+    pIndex->keys[i].pTrigger = pTrigger;
+    pIndex->num++;
+
+    pTrigger->indexed_type = type;
+    pTrigger->indexed_value = pTrigger->test_value;
+    return TRUE;
+}
+
+static void
+SyncUnindexTrigger(SyncCounter * pCounter, SyncTrigger * pTrigger)
+{
+    SyncTriggerIndex *pIndex;
+    int i;
+
+    if (pTrigger->indexed_type < 0)
+        return;
+
+    pIndex = &pCounter->triggers[pTrigger->indexed_type];
+    i = SyncTriggerIndexFind(pIndex, pTrigger->indexed_value, pTrigger);
+    if (i < pIndex->num && pIndex->keys[i].pTrigger == pTrigger) {
+        pIndex->num--;
+        memmove(&pIndex->keys[i], &pIndex->keys[i + 1],
+                (pIndex->num - i) * sizeof(SyncTriggerKey));
+    }
+    pTrigger->indexed_type = -1;
+}
+
+/*  Refile a trigger on pCounter after its test type or value changed.
+ *  Triggers that are not on the counter are left alone.
+ */
+static Bool
+SyncReindexTrigger(SyncCounter * pCounter, SyncTrigger * pTrigger)
+{
+    if (!pCounter || pTrigger->indexed_type < 0)
+        return TRUE;
+
+    if (pTrigger->indexed_type == SyncTriggerTestType(pTrigger) &&
+        pTrigger->indexed_value == pTrigger->test_value)
+        return TRUE;
+
+    SyncUnindexTrigger(pCounter, pTrigger);
+    return SyncIndexTrigger(pCounter, pTrigger);
+}
+
 static int
 SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
                 RESTYPE resType, Mask changes)
@@ -395,6 +551,7 @@ SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
             overflow = checked_int64_add(&pTrigger->test_value,
                                          pCounter->value, pTrigger->wait_value);
             if (overflow) {
+                SyncReindexTrigger(pCounter, pTrigger);
                 client->errorValue = pTrigger->wait_value >> 32;
                 return BadValue;
             }
@@ -408,8 +565,11 @@ SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
         if ((rc = SyncAddTriggerToSyncObject(pTrigger)) != Success)
             return rc;
     }
-    else if (pCounter && IsSystemCounter(pCounter)) {
-        SyncComputeBracketValues(pCounter);
+    else if (pCounter) {
+        if (!SyncReindexTrigger(pCounter, pTrigger))
+            return BadAlloc;
+        if (IsSystemCounter(pCounter))
+            SyncComputeBracketValues(pCounter);
     }
 
     return Success;
@@ -599,6 +759,7 @@ SyncAlarmTriggerFired(SyncTrigger * pTrigger)
      */
     SyncSendAlarmNotifyEvents(pAlarm);
     pTrigger->test_value = new_test_value;
+    SyncReindexTrigger(pCounter, pTrigger);
 }
 
 /*  This function is called when an Await unblocks, either as a result
@@ -704,22 +865,129 @@ SyncUpdateCounter(SyncCounter *pCounter, int64_t newval)
     return oldval;
 }
 
+/*  The positions [*first, *end) of the keys filed under type on pCounter
+ *  whose test value lies in the range that type can fire for, now that the
+ *  counter went from oldval to its current value.
+ */
+static void
+SyncTriggerRange(SyncCounter * pCounter, int type, int64_t oldval,
+                 int *first, int *end)
+{
+    SyncTriggerIndex *pIndex = &pCounter->triggers[type];
+    int64_t newval = pCounter->value;
+
+    *first = *end = 0;
+    switch (type) {
+    case XSyncPositiveComparison:
+        *end = SyncTriggerIndexAbove(pIndex, newval);
+        break;
+    case XSyncNegativeComparison:
+        *first = SyncTriggerIndexFind(pIndex, newval, NULL);
+        *end = pIndex->num;
+        break;
+    case XSyncPositiveTransition:
+        if (newval > oldval) {
+            *first = SyncTriggerIndexAbove(pIndex, oldval);
+            *end = SyncTriggerIndexAbove(pIndex, newval);
+        }
+        break;
+    case XSyncNegativeTransition:
+        if (newval < oldval) {
+            *first = SyncTriggerIndexFind(pIndex, newval, NULL);
+            *end = SyncTriggerIndexFind(pIndex, oldval, NULL);
+        }
+        break;
+    }
+}
+
+/*  Whether any trigger on pCounter became true when it went from oldval
+ *  to its current value.
+ */
+static Bool
+SyncCounterTriggerPending(SyncCounter * pCounter, int64_t oldval)
+{
+    int type, i, end;
+
+    for (type = 0; type < SYNC_NUM_TEST_TYPES; type++) {
+        SyncTriggerIndex *pIndex = &pCounter->triggers[type];
+
+        SyncTriggerRange(pCounter, type, oldval, &i, &end);
+        for (; i < end; i++) {
+            SyncTrigger *pTrigger = pIndex->keys[i].pTrigger;
+
+            if ((*pTrigger->CheckTrigger) (pTrigger, oldval))
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
 /*  This function should always be used to change a counter's value so that
  *  any triggers depending on the counter will be checked.
  */
 void
 SyncChangeCounter(SyncCounter * pCounter, int64_t newval)
 {
-    SyncTriggerList *ptl, *pnext;
+    SyncTriggerKey stack_keys[32], *keys = stack_keys;
+    int first[SYNC_NUM_TEST_TYPES], end[SYNC_NUM_TEST_TYPES];
     int64_t oldval;
+    int type, i, num = 0;
 
     oldval = SyncUpdateCounter(pCounter, newval);
 
-    /* run through triggers to see if any become true */
-    for (ptl = pCounter->sync.pTriglist; ptl; ptl = pnext) {
-        pnext = ptl->next;
-        if ((*ptl->pTrigger->CheckTrigger) (ptl->pTrigger, oldval))
-            (*ptl->pTrigger->TriggerFired) (ptl->pTrigger);
+    /*  Only the triggers whose test value was crossed need to be looked
+     *  at.  Firing one may add, move or free any number of triggers, so
+     *  take a copy of their keys first and skip those that are no longer
+     *  filed under the same key by the time we get to them; that also
+     *  keeps an alarm whose new test value is still in range from firing
+     *  twice.
+     */
+    for (type = 0; type < SYNC_NUM_TEST_TYPES; type++) {
+        SyncTriggerRange(pCounter, type, oldval, &first[type], &end[type]);
+        num += end[type] - first[type];
+    }
+
+    if (num > ARRAY_SIZE(stack_keys))
+        keys = xallocarray(num, sizeof(SyncTriggerKey));
+
+    if (!keys) {
+        SyncTriggerList *ptl, *pnext;
+
+        /* run through all triggers to see if any become true */
+        for (ptl = pCounter->sync.pTriglist; ptl; ptl = pnext) {
+            pnext = ptl->next;
+            if ((*ptl->pTrigger->CheckTrigger) (ptl->pTrigger, oldval))
+                (*ptl->pTrigger->TriggerFired) (ptl->pTrigger);
+        }
+    }
+    else {
+        for (num = 0, type = 0; type < SYNC_NUM_TEST_TYPES; type++) {
+            memcpy(&keys[num], &pCounter->triggers[type].keys[first[type]],
+                   (end[type] - first[type]) * sizeof(SyncTriggerKey));
+            num += end[type] - first[type];
+            end[type] = num;
+        }
+
+        for (i = 0, type = 0; type < SYNC_NUM_TEST_TYPES; type++) {
+            SyncTriggerIndex *pIndex = &pCounter->triggers[type];
+
+            for (; i < end[type]; i++) {
+                SyncTrigger *pTrigger = keys[i].pTrigger;
+                int pos = SyncTriggerIndexFind(pIndex, keys[i].value, pTrigger);
+
+                if (pos == pIndex->num ||
+                    pIndex->keys[pos].pTrigger != pTrigger ||
+                    pIndex->keys[pos].value != keys[i].value)
+                    continue;
+
+                if ((*pTrigger->CheckTrigger) (pTrigger, oldval))
+                    (*pTrigger->TriggerFired) (pTrigger);
+            }
+        }
+
+        if (keys != stack_keys)
+            free(keys);
     }
 
     if (IsSystemCounter(pCounter)) {
@@ -961,6 +1229,7 @@ SyncCreateCounter(ClientPtr client, XSyncCounter id, int64_t initialvalue)
 
     pCounter->value = initialvalue;
     pCounter->pSysCounterInfo = NULL;
+    memset(pCounter->triggers, 0, sizeof(pCounter->triggers));
 
     pCounter->sync.initialized = TRUE;
 
@@ -1015,11 +1284,33 @@ SyncDestroySystemCounter(void *pSysCounter)
     FreeResource(pCounter->sync.id, RT_NONE);
 }
 
+/*  Narrow the brackets of a system counter to the nearest test values in
+ *  pIndex below and above value.  less_equal and greater_equal say whether
+ *  a test value equal to value counts as below or above it.
+ */
+static void
+SyncBracketTriggers(SysCounterInfo * psci, SyncTriggerIndex * pIndex,
+                    int64_t value, Bool less_equal, Bool greater_equal,
+                    int64_t **pnewltval, int64_t **pnewgtval)
+{
+    int at = SyncTriggerIndexFind(pIndex, value, NULL);
+    int above = SyncTriggerIndexAbove(pIndex, value);
+    int lt = (less_equal ? above : at) - 1;
+    int gt = greater_equal ? at : above;
+
+    if (lt >= 0 && pIndex->keys[lt].value > psci->bracket_less) {
+        psci->bracket_less = pIndex->keys[lt].value;
+        *pnewltval = &psci->bracket_less;
+    }
+    if (gt < pIndex->num && pIndex->keys[gt].value < psci->bracket_greater) {
+        psci->bracket_greater = pIndex->keys[gt].value;
+        *pnewgtval = &psci->bracket_greater;
+    }
+}
+
 static void
 SyncComputeBracketValues(SyncCounter * pCounter)
 {
-    SyncTriggerList *pCur;
-    SyncTrigger *pTrigger;
     SysCounterInfo *psci;
     int64_t *pnewgtval = NULL;
     int64_t *pnewltval = NULL;
@@ -1036,73 +1327,32 @@ SyncComputeBracketValues(SyncCounter * pCounter)
     psci->bracket_greater = LLONG_MAX;
     psci->bracket_less = LLONG_MIN;
 
-    for (pCur = pCounter->sync.pTriglist; pCur; pCur = pCur->next) {
-        pTrigger = pCur->pTrigger;
-
-        if (pTrigger->test_type == XSyncPositiveComparison &&
-            ct != XSyncCounterNeverIncreases) {
-            if (pCounter->value < pTrigger->test_value &&
-                pTrigger->test_value < psci->bracket_greater) {
-                psci->bracket_greater = pTrigger->test_value;
-                pnewgtval = &psci->bracket_greater;
-            }
-            else if (pCounter->value > pTrigger->test_value &&
-                     pTrigger->test_value > psci->bracket_less) {
-                    psci->bracket_less = pTrigger->test_value;
-                    pnewltval = &psci->bracket_less;
-            }
-        }
-        else if (pTrigger->test_type == XSyncNegativeComparison &&
-                 ct != XSyncCounterNeverDecreases) {
-            if (pCounter->value > pTrigger->test_value &&
-                pTrigger->test_value > psci->bracket_less) {
-                psci->bracket_less = pTrigger->test_value;
-                pnewltval = &psci->bracket_less;
-            }
-            else if (pCounter->value < pTrigger->test_value &&
-                     pTrigger->test_value < psci->bracket_greater) {
-                    psci->bracket_greater = pTrigger->test_value;
-                    pnewgtval = &psci->bracket_greater;
-            }
-        }
-        else if (pTrigger->test_type == XSyncNegativeTransition &&
-                 ct != XSyncCounterNeverIncreases) {
-            if (pCounter->value >= pTrigger->test_value &&
-                pTrigger->test_value > psci->bracket_less) {
-                    /*
-                     * If the value is exactly equal to our threshold, we want one
-                     * more event in the negative direction to ensure we pick up
-                     * when the value is less than this threshold.
-                     */
-                    psci->bracket_less = pTrigger->test_value;
-                    pnewltval = &psci->bracket_less;
-            }
-            else if (pCounter->value < pTrigger->test_value &&
-                     pTrigger->test_value < psci->bracket_greater) {
-                    psci->bracket_greater = pTrigger->test_value;
-                    pnewgtval = &psci->bracket_greater;
-            }
-        }
-        else if (pTrigger->test_type == XSyncPositiveTransition &&
-                 ct != XSyncCounterNeverDecreases) {
-            if (pCounter->value <= pTrigger->test_value &&
-                pTrigger->test_value < psci->bracket_greater) {
-                    /*
-                     * If the value is exactly equal to our threshold, we
-                     * want one more event in the positive direction to
-                     * ensure we pick up when the value *exceeds* this
-                     * threshold.
-                     */
-                    psci->bracket_greater = pTrigger->test_value;
-                    pnewgtval = &psci->bracket_greater;
-            }
-            else if (pCounter->value > pTrigger->test_value &&
-                     pTrigger->test_value > psci->bracket_less) {
-                    psci->bracket_less = pTrigger->test_value;
-                    pnewltval = &psci->bracket_less;
-            }
-        }
-    }                           /* end for each trigger */
+    if (ct != XSyncCounterNeverIncreases) {
+        SyncBracketTriggers(psci, &pCounter->triggers[XSyncPositiveComparison],
+                            pCounter->value, FALSE, FALSE,
+                            &pnewltval, &pnewgtval);
+        /*
+         * If the value is exactly equal to a NegativeTransition threshold,
+         * we want one more event in the negative direction to ensure we
+         * pick up when the value is less than this threshold.
+         */
+        SyncBracketTriggers(psci, &pCounter->triggers[XSyncNegativeTransition],
+                            pCounter->value, TRUE, FALSE,
+                            &pnewltval, &pnewgtval);
+    }
+    if (ct != XSyncCounterNeverDecreases) {
+        SyncBracketTriggers(psci, &pCounter->triggers[XSyncNegativeComparison],
+                            pCounter->value, FALSE, FALSE,
+                            &pnewltval, &pnewgtval);
+        /*
+         * Likewise, a PositiveTransition threshold equal to the value wants
+         * one more event in the positive direction to ensure we pick up
+         * when the value *exceeds* it.
+         */
+        SyncBracketTriggers(psci, &pCounter->triggers[XSyncPositiveTransition],
+                            pCounter->value, FALSE, TRUE,
+                            &pnewltval, &pnewgtval);
+    }
 
     (*psci->BracketValues) ((void *) pCounter, pnewltval, pnewgtval);
 
@@ -1141,6 +1391,7 @@ static int
 FreeCounter(void *env, XID id)
 {
     SyncCounter *pCounter = (SyncCounter *) env;
+    int i;
 
     pCounter->sync.beingDestroyed = TRUE;
 
@@ -1153,6 +1404,8 @@ FreeCounter(void *env, XID id)
             pnext = ptl->next;
             free(ptl); /* destroy the trigger list as we go */
         }
+        for (i = 0; i < SYNC_NUM_TEST_TYPES; i++)
+            free(pCounter->triggers[i].keys);
         if (IsSystemCounter(pCounter)) {
             xorg_list_del(&pCounter->pSysCounterInfo->entry);
             free(pCounter->pSysCounterInfo->name);
@@ -1602,6 +1855,7 @@ ProcSyncAwait(ClientPtr client)
 
         /* sanity checks are in SyncInitTrigger */
         pAwait->trigger.pSync = NULL;
+        pAwait->trigger.indexed_type = -1;
         pAwait->trigger.value_type = pProtocolWaitConds->value_type;
         pAwait->trigger.wait_value =
             ((int64_t)pProtocolWaitConds->wait_value_hi << 32) |
@@ -1706,6 +1960,7 @@ ProcSyncCreateAlarm(ClientPtr client)
 
     pTrigger = &pAlarm->trigger;
     pTrigger->pSync = NULL;
+    pTrigger->indexed_type = -1;
     pTrigger->value_type = XSyncAbsolute;
     pTrigger->wait_value = 0;
     pTrigger->test_type = XSyncPositiveComparison;
@@ -2066,6 +2321,7 @@ ProcSyncAwaitFence(ClientPtr client)
         }
 
         pAwait->trigger.pSync = NULL;
+        pAwait->trigger.indexed_type = -1;
         /* Provide acceptable values for these unused fields to
          * satisfy SyncInitTrigger's validation logic
          */
@@ -2665,8 +2921,6 @@ IdleTimeBlockHandler(void *pCounter, void *wt)
     int64_t *less = priv->value_less;
     int64_t *greater = priv->value_greater;
     int64_t idle, old_idle;
-    SyncTriggerList *list = counter->sync.pTriglist;
-    SyncTrigger *trig;
 
     if (!less && !greater)
         return;
@@ -2693,13 +2947,8 @@ IdleTimeBlockHandler(void *pCounter, void *wt)
          * immediately so we can reschedule.
          */
 
-        for (list = counter->sync.pTriglist; list; list = list->next) {
-            trig = list->pTrigger;
-            if (trig->CheckTrigger(trig, old_idle)) {
-                AdjustWaitForDelay(wt, 0);
-                break;
-            }
-        }
+        if (SyncCounterTriggerPending(counter, old_idle))
+            AdjustWaitForDelay(wt, 0);
         /*
          * We've been called exactly on the idle time, but we have a
          * NegativeTransition trigger which requires a transition from an
@@ -2720,15 +2969,8 @@ IdleTimeBlockHandler(void *pCounter, void *wt)
         if (idle < *greater) {
             AdjustWaitForDelay(wt, *greater - idle);
         }
-        else {
-            for (list = counter->sync.pTriglist; list;
-                 list = list->next) {
-                trig = list->pTrigger;
-                if (trig->CheckTrigger(trig, old_idle)) {
-                    AdjustWaitForDelay(wt, 0);
-                    break;
-                }
-            }
+        else if (SyncCounterTriggerPending(counter, old_idle)) {
+            AdjustWaitForDelay(wt, 0);
         }
     }
 
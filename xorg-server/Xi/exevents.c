@@ -2822,6 +2822,9 @@ RecalculateDeviceDeliverableEvents(WindowPtr pWin)
             break;
         pChild = pChild->nextSib;
     }
+
+    /* update the per-window summaries of all selections */
+    RecalculateDeliverableEvents(pWin);
 }
 
 #ifdef _MSC_VER
@@ -2783,6 +2783,36 @@ EventIsDeliverable(DeviceIntPtr dev, int evtype, WindowPtr win)
     return rc;
 }
 
+/**
+ * Check if a given event may be deliverable on a given window or any of
+ * its ancestors, from the event masks each window caches for itself and
+ * the windows above it.  This errs on the side of TRUE; when it returns
+ * FALSE, EventIsDeliverable is zero for win and all of its ancestors.
+ *
+ * @param[in] dev The device this event is being sent for.
+ * @param[in] evtype The event type of the event that is to be sent.
+ * @param[in] win The current event window.
+ */
+static Bool
+EventMayPropagate(DeviceIntPtr dev, int evtype, WindowPtr win)
+{
+    int type;
+
+    if ((type = GetXI2Type(evtype)) != 0 &&
+        (win->deliverableXI2Events & ((uint64_t) 1 << type)))
+        return TRUE;
+
+    if ((type = GetXIType(evtype)) != 0 &&
+        (win->deliverableDeviceEvents & event_get_filter_from_type(dev, type)))
+        return TRUE;
+
+    if ((type = GetCoreType(evtype)) != 0 &&
+        (win->deliverableEvents & event_get_filter_from_type(dev, type)))
+        return TRUE;
+
+    return FALSE;
+}
+
 static int
 DeliverEvent(DeviceIntPtr dev, xEvent *xE, int count,
              WindowPtr win, Window child, GrabPtr grab)
@@ -2866,6 +2896,10 @@ DeliverDeviceEvents(WindowPtr pWin, InternalEvent *event, GrabPtr grab,
     verify_internal_event(event);
 
     while (pWin) {
+        /* nobody here or further up wants it */
+        if (!EventMayPropagate(dev, event->any.type, pWin))
+            break;
+
         if ((mask = EventIsDeliverable(dev, event->any.type, pWin))) {
             /* XI2 events first */
             if (mask & EVENT_XI2_MASK) {
@@ -4504,6 +4538,27 @@ FixKeyState(DeviceEvent *event, DeviceIntPtr keybd)
 #define ManagerMask \
 	(SubstructureRedirectMask | ResizeRedirectMask)
 
+/* XI2 event types selected in mask for any device */
+static uint64_t
+XI2MaskEvents(const XI2Mask *mask)
+{
+    unsigned char any[XI2MASKSIZE] = { 0 };
+    size_t size = min(xi2mask_mask_size(mask), XI2MASKSIZE);
+    uint64_t events = 0;
+    int i, j;
+
+    for (i = 0; i < xi2mask_num_masks(mask); i++) {
+        const unsigned char *m = xi2mask_get_one_mask(mask, i);
+
+        for (j = 0; j < size; j++)
+            any[j] |= m[j];
+    }
+    for (j = 0; j <= XI2LASTEVENT; j++)
+        if (BitIsOn(any, j))
+            events |= (uint64_t) 1 << j;
+    return events;
+}
+
 /**
  * Recalculate which events may be deliverable for the given window.
  * Recalculated mask is used for quicker determination which events may be
@@ -4514,13 +4569,20 @@ FixKeyState(DeviceEvent *event, DeviceIntPtr keybd)
  * deliverableEventMask is the combination of the eventMask and the
  * otherEventMask plus the events that may be propagated to the parent.
  *
+ * deliverableDeviceEvents and deliverableXI2Events likewise collect the
+ * XI and XI2 selections of all devices on the window and its ancestors,
+ * so DeliverDeviceEvents can stop walking up the tree once no window
+ * above could take the event.
+ *
  * Traverses to siblings and parents of the window.
  */
 void
 RecalculateDeliverableEvents(WindowPtr pWin)
 {
     OtherClients *others;
+    OtherInputMasks *inputMasks;
     WindowPtr pChild;
+    int i;
 
     pChild = pWin;
     while (1) {
@@ -4532,10 +4594,22 @@ RecalculateDeliverableEvents(WindowPtr pWin)
         }
         pChild->deliverableEvents = pChild->eventMask |
             wOtherEventMasks(pChild);
-        if (pChild->parent)
+        pChild->deliverableDeviceEvents = 0;
+        pChild->deliverableXI2Events = 0;
+        if ((inputMasks = wOtherInputMasks(pChild))) {
+            for (i = 0; i < EMASKSIZE; i++)
+                pChild->deliverableDeviceEvents |= inputMasks->inputEvents[i];
+            pChild->deliverableXI2Events = XI2MaskEvents(inputMasks->xi2mask);
+        }
+        if (pChild->parent) {
             pChild->deliverableEvents |=
                 (pChild->parent->deliverableEvents &
                  ~wDontPropagateMask(pChild) & PropagateMask);
+            pChild->deliverableDeviceEvents |=
+                pChild->parent->deliverableDeviceEvents;
+            pChild->deliverableXI2Events |=
+                pChild->parent->deliverableXI2Events;
+        }
         if (pChild->firstChild) {
             pChild = pChild->firstChild;
             continue;
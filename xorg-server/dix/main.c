@@ -348,6 +348,7 @@ dix_main(int argc, char *argv[], char *envp[])
         CloseInput();
 
         InputThreadFini();
+        WorkerPoolFini();
 
         for (i = 0; i < screenInfo.numScreens; i++)
             screenInfo.screens[i]->root = NullWindow;
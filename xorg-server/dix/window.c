@@ -122,7 +122,7 @@ Equipment Corporation.
 #endif
 #include "dixevents.h"
 #include "globals.h"
-#include "mi.h"                 /* miPaintWindow */
+#include "mi.h"                 /* miPaintWindow, miSpriteTrace* */
 #ifdef COMPOSITE
 #include "compint.h"
 #endif
@@ -497,6 +497,8 @@ SetWindowToDefaults(WindowPtr pWin)
 
     pWin->eventMask = 0;
     pWin->deliverableEvents = 0;
+    pWin->deliverableDeviceEvents = 0;
+    pWin->deliverableXI2Events = 0;
     pWin->dontPropagate = 0;
     pWin->redirectDraw = RedirectDrawNone;
     pWin->forcedBG = FALSE;
@@ -912,6 +914,7 @@ CreateWindow(Window wid, WindowPtr pParent, int x, int y, unsigned w,
             pParent->lastChild = pWin;
         pParent->firstChild = pWin;
     }
+    miSpriteTraceRestack(pWin);
 
     SetWinSize(pWin);
     SetBorderSize(pWin);
@@ -995,6 +998,7 @@ FreeWindowResources(WindowPtr pWin)
 {
     ScreenPtr pScreen = pWin->drawable.pScreen;
 
+    miSpriteTraceDestroy(pWin);
     DeleteWindowFromAnySaveSet(pWin);
     DeleteWindowFromAnySelections(pWin);
     DeleteWindowFromAnyEvents(pWin, TRUE);
@@ -1695,6 +1699,7 @@ MoveWindowInStack(WindowPtr pWin, WindowPtr pNextSib)
                     pFirstChange = pFirstChange->nextSib;
             }
         }
+        miSpriteTraceRestack(pWin);
         if (pWin->drawable.pScreen->RestackWindow)
             (*pWin->drawable.pScreen->RestackWindow) (pWin, pOldNextSib);
     }
@@ -1787,6 +1792,7 @@ SetBorderSize(WindowPtr pWin)
     else {
         RegionCopy(&pWin->borderSize, &pWin->winSize);
     }
+    miSpriteTraceUpdate(pWin);
 }
 
 /**
@@ -2540,6 +2546,7 @@ ReparentWindow(WindowPtr pWin, WindowPtr pParent,
     /* take out of sibling chain */
 
     pPriorParent = pPrev = pWin->parent;
+    miSpriteTraceRemove(pWin);
     if (pPrev->firstChild == pWin)
         pPrev->firstChild = pWin->nextSib;
     if (pPrev->lastChild == pWin)
@@ -2576,6 +2583,7 @@ ReparentWindow(WindowPtr pWin, WindowPtr pParent,
     pWin->origin.y = y + bw;
     pWin->drawable.x = x + bw + pParent->drawable.x;
     pWin->drawable.y = y + bw + pParent->drawable.y;
+    miSpriteTraceRestack(pWin);
 
     /* clip to parent */
     SetWinSize(pWin);
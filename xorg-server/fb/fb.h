@@ -37,6 +37,7 @@
 #include "servermd.h"
 #include "windowstr.h"
 #include "privates.h"
+#include "list.h"
 #include "mi.h"
 #include "migc.h"
 #include "picturestr.h"
@@ -402,6 +403,17 @@ typedef void (*FinishWrapProcPtr) (DrawablePtr pDraw);
 extern _X_EXPORT DevPrivateKey
 fbGetScreenPrivateKey(void);
 
+/* idle bits of window backing pixmaps, see fbpixmap.c */
+typedef struct {
+    struct xorg_list buffers;   /* most recently released first */
+    int count;
+    size_t bytes;
+    size_t max_bytes;
+    unsigned long reused;
+    unsigned long allocated;
+    unsigned long evicted;
+} FbPixmapPoolRec, *FbPixmapPoolPtr;
+
 /* private field of a screen */
 typedef struct {
 #ifdef FB_ACCESS_WRAPPER
@@ -410,6 +422,7 @@ typedef struct {
 #endif
     DevPrivateKeyRec    gcPrivateKeyRec;
     DevPrivateKeyRec    winPrivateKeyRec;
+    FbPixmapPoolRec     pixmapPool;
 } FbScreenPrivRec, *FbScreenPrivPtr;
 
 #define fbGetScreenPrivate(pScreen) ((FbScreenPrivPtr) \
@@ -966,6 +979,12 @@ fbCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
 extern _X_EXPORT Bool
  fbDestroyPixmap(PixmapPtr pPixmap);
 
+extern _X_EXPORT void
+fbInitPixmapPool(ScreenPtr pScreen, size_t max_bytes);
+
+extern _X_EXPORT void
+fbFiniPixmapPool(ScreenPtr pScreen);
+
 extern _X_EXPORT RegionPtr
  fbPixmapToRegion(PixmapPtr pPix);
 
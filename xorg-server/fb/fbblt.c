@@ -39,6 +39,185 @@
     } \
 }
 
+/*
+ * Byte aligned GXcopy and GXxor blts, which covers CopyArea and scrolling
+ * at 8, 16 and 32 bpp, are done with AVX2 when the CPU has it.  The access
+ * wrappers need every load and store to go through READ and WRITE, so
+ * wfb always takes the generic path.
+ */
+#if !defined(FB_ACCESS_WRAPPER) && !defined(FB_BLT_NO_SIMD)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FB_BLT_AVX2
+#define FB_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define FB_BLT_AVX2
+#define FB_AVX2_TARGET
+#endif
+#endif
+
+#ifdef FB_BLT_AVX2
+
+/* rows narrower than this are left to the generic code */
+#define FB_BLT_AVX2_MIN_BYTES   32
+
+/*
+ * Copies writing more than this much don't fit in the cache, so storing
+ * them there only evicts everything else; they use non-temporal stores.
+ */
+#define FB_BLT_STREAM_BYTES     (4 * 1024 * 1024)
+
+static Bool
+fbHaveAvx2(void)
+{
+#ifdef _MSC_VER
+    static int have = -1;
+
+    if (have < 0) {
+        int regs[4];
+
+        have = 0;
+        __cpuid(regs, 0);
+        if (regs[0] >= 7) {
+            __cpuid(regs, 1);
+            /* OSXSAVE, and the OS saves the YMM registers */
+            if ((regs[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6) {
+                __cpuidex(regs, 7, 0);
+                have = (regs[1] & (1 << 5)) != 0;
+            }
+        }
+    }
+    return have;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+/*
+ * Each row is done in 32 byte vectors, aligned on the destination, in the
+ * direction the caller asked for.  Like the generic code, that reads
+ * overlapping source bytes before they're overwritten when scrolling.  The
+ * ragged ends are done with a whole vector each, loaded before anything is
+ * stored and stored last; where they overlap the aligned vectors, they
+ * store the same values again.
+ */
+static inline FB_AVX2_TARGET __m256i
+fbBltAvx2Load(const CARD8 *src, const CARD8 *dst, Bool xor)
+{
+    __m256i s = _mm256_loadu_si256((const __m256i *) src);
+
+    if (xor)
+        s = _mm256_xor_si256(s, _mm256_loadu_si256((const __m256i *) dst));
+    return s;
+}
+
+static FB_AVX2_TARGET void
+fbBltAvx2Forward(const CARD8 *src, CARD8 *dst, int n, Bool xor)
+{
+    __m256i head = fbBltAvx2Load(src, dst, xor);
+    __m256i tail = fbBltAvx2Load(src + n - 32, dst + n - 32, xor);
+    int i = 32 - ((uintptr_t) dst & 31);
+
+    for (; i + 128 <= n; i += 128) {
+        __m256i v0 = fbBltAvx2Load(src + i, dst + i, xor);
+        __m256i v1 = fbBltAvx2Load(src + i + 32, dst + i + 32, xor);
+        __m256i v2 = fbBltAvx2Load(src + i + 64, dst + i + 64, xor);
+        __m256i v3 = fbBltAvx2Load(src + i + 96, dst + i + 96, xor);
+
+        _mm256_store_si256((__m256i *) (dst + i), v0);
+        _mm256_store_si256((__m256i *) (dst + i + 32), v1);
+        _mm256_store_si256((__m256i *) (dst + i + 64), v2);
+        _mm256_store_si256((__m256i *) (dst + i + 96), v3);
+    }
+    for (; i + 32 <= n; i += 32)
+        _mm256_store_si256((__m256i *) (dst + i),
+                           fbBltAvx2Load(src + i, dst + i, xor));
+    _mm256_storeu_si256((__m256i *) (dst + n - 32), tail);
+    _mm256_storeu_si256((__m256i *) dst, head);
+}
+
+static FB_AVX2_TARGET void
+fbBltAvx2Reverse(const CARD8 *src, CARD8 *dst, int n, Bool xor)
+{
+    __m256i head = fbBltAvx2Load(src, dst, xor);
+    __m256i tail = fbBltAvx2Load(src + n - 32, dst + n - 32, xor);
+    int i = n - 32 - ((uintptr_t) (dst + n) & 31);
+
+    if (i == n - 32)
+        i -= 32;
+    for (; i >= 96; i -= 128) {
+        __m256i v0 = fbBltAvx2Load(src + i, dst + i, xor);
+        __m256i v1 = fbBltAvx2Load(src + i - 32, dst + i - 32, xor);
+        __m256i v2 = fbBltAvx2Load(src + i - 64, dst + i - 64, xor);
+        __m256i v3 = fbBltAvx2Load(src + i - 96, dst + i - 96, xor);
+
+        _mm256_store_si256((__m256i *) (dst + i), v0);
+        _mm256_store_si256((__m256i *) (dst + i - 32), v1);
+        _mm256_store_si256((__m256i *) (dst + i - 64), v2);
+        _mm256_store_si256((__m256i *) (dst + i - 96), v3);
+    }
+    for (; i >= 0; i -= 32)
+        _mm256_store_si256((__m256i *) (dst + i),
+                           fbBltAvx2Load(src + i, dst + i, xor));
+    _mm256_storeu_si256((__m256i *) dst, head);
+    _mm256_storeu_si256((__m256i *) (dst + n - 32), tail);
+}
+
+/* GXcopy only, with no overlap between source and destination */
+static FB_AVX2_TARGET void
+fbBltAvx2Stream(const CARD8 *src, CARD8 *dst, int n)
+{
+    int i = 32 - ((uintptr_t) dst & 31);
+
+    _mm256_storeu_si256((__m256i *) dst,
+                        _mm256_loadu_si256((const __m256i *) src));
+    for (; i + 32 <= n; i += 32)
+        _mm256_stream_si256((__m256i *) (dst + i),
+                            _mm256_loadu_si256((const __m256i *) (src + i)));
+    _mm256_storeu_si256((__m256i *) (dst + n - 32),
+                        _mm256_loadu_si256((const __m256i *) (src + n - 32)));
+}
+
+static FB_AVX2_TARGET void
+fbBltAvx2(CARD8 *src, FbStride srcStride, CARD8 *dst, FbStride dstStride,
+          int width, int height, int alu, Bool reverse, Bool upsidedown)
+{
+    Bool xor = alu == GXxor;
+    Bool stream = FALSE;
+
+    if (!xor && (size_t) width * height >= FB_BLT_STREAM_BYTES) {
+        CARD8 *srcEnd = src + (height - 1) * srcStride + width;
+        CARD8 *dstEnd = dst + (height - 1) * dstStride + width;
+
+        stream = srcEnd <= dst || dstEnd <= src;
+    }
+
+    if (upsidedown) {
+        src += (height - 1) * srcStride;
+        dst += (height - 1) * dstStride;
+        srcStride = -srcStride;
+        dstStride = -dstStride;
+    }
+
+    while (height--) {
+        if (stream)
+            fbBltAvx2Stream(src, dst, width);
+        else if (reverse)
+            fbBltAvx2Reverse(src, dst, width, xor);
+        else
+            fbBltAvx2Forward(src, dst, width, xor);
+        src += srcStride;
+        dst += dstStride;
+    }
+
+    if (stream)
+        _mm_sfence();
+}
+
+#endif /* FB_BLT_AVX2 */
+
 void
 fbBlt(FbBits * srcLine,
       FbStride srcStride,
@@ -59,6 +238,19 @@ fbBlt(FbBits * srcLine,
 
     FbDeclareMergeRop();
 
+#ifdef FB_BLT_AVX2
+    if ((alu == GXcopy || alu == GXxor) && pm == FB_ALLONES &&
+        !(srcX & 7) && !(dstX & 7) && !(width & 7) &&
+        (width >> 3) >= FB_BLT_AVX2_MIN_BYTES && fbHaveAvx2()) {
+        fbBltAvx2((CARD8 *) srcLine + (srcX >> 3),
+                  srcStride << (FB_SHIFT - 3),
+                  (CARD8 *) dstLine + (dstX >> 3),
+                  dstStride << (FB_SHIFT - 3),
+                  width >> 3, height, alu, reverse, upsidedown);
+        return;
+    }
+#endif
+
     if (alu == GXcopy && pm == FB_ALLONES &&
         !(srcX & 7) && !(dstX & 7) && !(width & 7))
     {
@@ -26,6 +26,67 @@
 
 #include "fb.h"
 
+/*
+ * Solid spans, mostly from wide lines, arcs and polygons: look up the
+ * destination once for the whole call and go straight to fbSolid rather
+ * than through fbFill for each span.
+ */
+static void
+fbSolidSpans(DrawablePtr pDrawable,
+             GCPtr pGC, int n, DDXPointPtr ppt, int *pwidth)
+{
+    RegionPtr pClip = fbGetCompositeClip(pGC);
+    FbGCPrivPtr pPriv = fbGetGCPrivate(pGC);
+    BoxPtr pextent, pbox;
+    int nbox;
+    int fullX1, fullX2, fullY1;
+    int partX1, partX2;
+    FbBits *dst;
+    FbStride dstStride;
+    int dstBpp;
+    int dstXoff, dstYoff;
+
+    fbGetDrawable(pDrawable, dst, dstStride, dstBpp, dstXoff, dstYoff);
+    pextent = RegionExtents(pClip);
+    while (n--) {
+        fullX1 = ppt->x;
+        fullY1 = ppt->y;
+        fullX2 = fullX1 + (int) *pwidth;
+        ppt++;
+        pwidth++;
+
+        if (fullY1 < pextent->y1 || pextent->y2 <= fullY1)
+            continue;
+
+        fullX1 = max(fullX1, pextent->x1);
+        fullX2 = min(fullX2, pextent->x2);
+        if (fullX1 >= fullX2)
+            continue;
+
+        nbox = RegionNumRects(pClip);
+        if (nbox == 1) {
+            fbSolid(dst + (fullY1 + dstYoff) * dstStride, dstStride,
+                    (fullX1 + dstXoff) * dstBpp, dstBpp,
+                    (fullX2 - fullX1) * dstBpp, 1, pPriv->and, pPriv->xor);
+        }
+        else {
+            for (pbox = RegionRects(pClip); nbox--; pbox++) {
+                if (pbox->y1 <= fullY1 && fullY1 < pbox->y2) {
+                    partX1 = max(pbox->x1, fullX1);
+                    partX2 = min(pbox->x2, fullX2);
+                    if (partX2 > partX1)
+                        fbSolid(dst + (fullY1 + dstYoff) * dstStride,
+                                dstStride, (partX1 + dstXoff) * dstBpp,
+                                dstBpp, (partX2 - partX1) * dstBpp, 1,
+                                pPriv->and, pPriv->xor);
+                }
+            }
+        }
+    }
+    fbValidateDrawable(pDrawable);
+    fbFinishAccess(pDrawable);
+}
+
 void
 fbFillSpans(DrawablePtr pDrawable,
             GCPtr pGC, int n, DDXPointPtr ppt, int *pwidth, int fSorted)
@@ -37,6 +98,11 @@ fbFillSpans(DrawablePtr pDrawable,
     int fullX1, fullX2, fullY1;
     int partX1, partX2;
 
+    if (pGC->fillStyle == FillSolid) {
+        fbSolidSpans(pDrawable, pGC, n, ppt, pwidth);
+        return;
+    }
+
     pextent = RegionExtents(pClip);
     extentX1 = pextent->x1;
     extentY1 = pextent->y1;
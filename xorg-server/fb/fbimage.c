@@ -28,6 +28,92 @@
 
 #include "fb.h"
 
+/*
+ * ZPixmap images of at least this many bytes are copied in bands of rows
+ * spread over the server's worker threads, each band at least
+ * FB_IMAGE_BAND_BYTES.
+ */
+#define FB_PARALLEL_IMAGE_BYTES (256 * 1024)
+#define FB_IMAGE_BAND_BYTES     (64 * 1024)
+
+typedef struct {
+    FbStip *src;
+    FbStride srcStride;
+    int srcX;
+    FbStip *dst;
+    FbStride dstStride;
+    int dstX;
+    int width;
+    int height;
+    int alu;
+    FbBits pm;
+    int bpp;
+    FbBits mask;
+    int bands;
+} FbImageBandsRec;
+
+static void
+fbBltImageBand(void *data, int band)
+{
+    FbImageBandsRec *b = data;
+    int y1 = (int) ((long) b->height * band / b->bands);
+    int y2 = (int) ((long) b->height * (band + 1) / b->bands);
+
+    fbBltStip(b->src + y1 * b->srcStride, b->srcStride, b->srcX,
+              b->dst + y1 * b->dstStride, b->dstStride, b->dstX,
+              b->width, y2 - y1, b->alu, b->pm, b->bpp);
+
+    if (b->mask != FB_ALLONES) {
+        FbStip *dst = b->dst + y1 * b->dstStride;
+        FbStip *end = b->dst + y2 * b->dstStride;
+
+        while (dst < end)
+            *dst++ &= b->mask;
+    }
+}
+
+/*
+ * fbBltStip between an image and a drawable, optionally and'ing whole
+ * destination rows with mask afterwards.  Large images are split into
+ * bands of rows which don't share any destination bits, so the result is
+ * the same however they are scheduled.
+ */
+static void
+fbBltImage(FbStip * src, FbStride srcStride, int srcX,
+           FbStip * dst, FbStride dstStride, int dstX,
+           int width, int height, int alu, FbBits pm, int bpp, FbBits mask)
+{
+    FbImageBandsRec b = {
+        .src = src,
+        .srcStride = srcStride,
+        .srcX = srcX,
+        .dst = dst,
+        .dstStride = dstStride,
+        .dstX = dstX,
+        .width = width,
+        .height = height,
+        .alu = alu,
+        .pm = pm,
+        .bpp = bpp,
+        .mask = mask,
+        .bands = 1,
+    };
+#ifndef FB_ACCESS_WRAPPER
+    size_t bytes = (size_t) (width >> 3) * height;
+
+    /* the access wrappers may not be thread safe, and bands of
+     * overlapping images would see each other's results
+     */
+    if (bytes >= FB_PARALLEL_IMAGE_BYTES &&
+        (src + height * srcStride <= dst || dst + height * dstStride <= src)) {
+        b.bands = min(bytes / FB_IMAGE_BAND_BYTES, WorkerPoolThreads());
+        b.bands = min(b.bands, height);
+    }
+#endif
+
+    WorkerPoolRun(fbBltImageBand, &b, b.bands);
+}
+
 void
 fbPutImage(DrawablePtr pDrawable,
            GCPtr pGC,
@@ -108,13 +194,14 @@ fbPutZImage(DrawablePtr pDrawable,
             y2 = pbox->y2;
         if (x1 >= x2 || y1 >= y2)
             continue;
-        fbBltStip(src + (y1 - y) * srcStride,
-                  srcStride,
-                  (x1 - x) * dstBpp,
-                  dst + (y1 + dstYoff) * dstStride,
-                  dstStride,
-                  (x1 + dstXoff) * dstBpp,
-                  (x2 - x1) * dstBpp, (y2 - y1), alu, pm, dstBpp);
+        fbBltImage(src + (y1 - y) * srcStride,
+                   srcStride,
+                   (x1 - x) * dstBpp,
+                   dst + (y1 + dstYoff) * dstStride,
+                   dstStride,
+                   (x1 + dstXoff) * dstBpp,
+                   (x2 - x1) * dstBpp, (y2 - y1), alu, pm, dstBpp,
+                   FB_ALLONES);
     }
 
     fbFinishAccess(pDrawable);
@@ -234,15 +321,11 @@ fbGetImage(DrawablePtr pDrawable,
         pm = fbReplicatePixel(planeMask, srcBpp);
         dstStride = PixmapBytePad(w, pDrawable->depth);
         dstStride /= sizeof(FbStip);
-        fbBltStip((FbStip *) (src + (y + srcYoff) * srcStride),
-                  FbBitsStrideToStipStride(srcStride),
-                  (x + srcXoff) * srcBpp,
-                  dst, dstStride, 0, w * srcBpp, h, GXcopy, FB_ALLONES, srcBpp);
-
-        if (pm != FB_ALLONES) {
-            for (int i = 0; i < dstStride * h; i++)
-                dst[i] &= pm;
-        }
+        fbBltImage((FbStip *) (src + (y + srcYoff) * srcStride),
+                   FbBitsStrideToStipStride(srcStride),
+                   (x + srcXoff) * srcBpp,
+                   dst, dstStride, 0, w * srcBpp, h, GXcopy, FB_ALLONES,
+                   srcBpp, pm);
     }
     else {
         dstStride = BitmapBytePad(w) / sizeof(FbStip);
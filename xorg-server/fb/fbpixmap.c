@@ -28,11 +28,147 @@
 
 #include "fb.h"
 
+/*
+ * Composite gives every redirected window a pixmap of its own, created
+ * with CREATE_PIXMAP_USAGE_BACKING_PIXMAP, and replaces it with a new one
+ * each time the window changes size.  Interactively resizing a window
+ * under a compositing manager thus allocates and frees a window sized
+ * buffer for each motion event.  The bits of backing pixmaps are
+ * therefore allocated apart from the pixmap, and parked in a small per
+ * screen pool when the pixmap goes away so the next backing pixmap of
+ * about the same size can pick them up.  Buffers are allocated with some
+ * slack and rounded up to a size class, so a window that keeps growing
+ * still fits in the buffer released a step before.
+ */
+typedef struct _FbPixmapBuffer {
+    struct xorg_list entry;
+    size_t size;                /* bytes of bits following the header */
+} FbPixmapBufferRec, *FbPixmapBufferPtr;
+
+#define FB_PIXMAP_POOL_BUFFERS  4
+
+#define fbPixmapPoolInitialized(pool)   ((pool)->buffers.next != NULL)
+
+/* where backing pixmaps keep their buffer, in place of inline bits */
+static FbPixmapBufferPtr *
+fbPixmapBufferSlot(PixmapPtr pPixmap)
+{
+    int base = pPixmap->drawable.pScreen->totalPixmapSize;
+
+    return (FbPixmapBufferPtr *) ((char *) pPixmap + ((base + 7) & ~7));
+}
+
+/* round up to one of 8 to 16 size classes per power of two */
+static size_t
+fbPixmapBufferClass(size_t size)
+{
+    size_t step = 4096;
+
+    while (step * 16 <= size)
+        step <<= 1;
+    return (size + step - 1) & ~(step - 1);
+}
+
+static FbPixmapBufferPtr
+fbGetPixmapBuffer(ScreenPtr pScreen, size_t size)
+{
+    FbPixmapPoolPtr pool = &fbGetScreenPrivate(pScreen)->pixmapPool;
+    FbPixmapBufferPtr buffer, best = NULL;
+
+    /* the smallest idle buffer that fits without wasting half of it */
+    xorg_list_for_each_entry(buffer, &pool->buffers, entry) {
+        if (buffer->size >= size && buffer->size - size <= size / 2 &&
+            (!best || buffer->size < best->size))
+            best = buffer;
+    }
+
+    if (best) {
+        xorg_list_del(&best->entry);
+        pool->count--;
+        pool->bytes -= best->size;
+        pool->reused++;
+        return best;
+    }
+
+    size = fbPixmapBufferClass(size + size / 8);
+    buffer = malloc(sizeof(FbPixmapBufferRec) + size);
+    if (!buffer)
+        return NULL;
+    buffer->size = size;
+    pool->allocated++;
+    return buffer;
+}
+
+/* drop the least recently released buffers until within limits */
+static void
+fbTrimPixmapPool(FbPixmapPoolPtr pool)
+{
+    while (pool->count > FB_PIXMAP_POOL_BUFFERS ||
+           pool->bytes > pool->max_bytes) {
+        FbPixmapBufferPtr buffer =
+            xorg_list_last_entry(&pool->buffers, FbPixmapBufferRec, entry);
+
+        xorg_list_del(&buffer->entry);
+        pool->count--;
+        pool->bytes -= buffer->size;
+        pool->evicted++;
+        free(buffer);
+    }
+}
+
+static void
+fbPutPixmapBuffer(ScreenPtr pScreen, FbPixmapBufferPtr buffer)
+{
+    FbPixmapPoolPtr pool = &fbGetScreenPrivate(pScreen)->pixmapPool;
+
+    if (buffer->size > pool->max_bytes) {
+        free(buffer);
+        return;
+    }
+
+    xorg_list_add(&buffer->entry, &pool->buffers);
+    pool->count++;
+    pool->bytes += buffer->size;
+    fbTrimPixmapPool(pool);
+}
+
+void
+fbInitPixmapPool(ScreenPtr pScreen, size_t max_bytes)
+{
+    FbPixmapPoolPtr pool = &fbGetScreenPrivate(pScreen)->pixmapPool;
+
+    xorg_list_init(&pool->buffers);
+    pool->count = 0;
+    pool->bytes = 0;
+    pool->max_bytes = max_bytes;
+    pool->reused = pool->allocated = pool->evicted = 0;
+}
+
+void
+fbFiniPixmapPool(ScreenPtr pScreen)
+{
+    FbPixmapPoolPtr pool = &fbGetScreenPrivate(pScreen)->pixmapPool;
+
+    if (!fbPixmapPoolInitialized(pool))
+        return;
+
+    if (pool->allocated)
+        LogMessageVerb(X_INFO, 3, "fb: screen %d backing pixmap pool: "
+                       "%lu buffers allocated, %lu reused, %lu evicted\n",
+                       pScreen->myNum, pool->allocated, pool->reused,
+                       pool->evicted);
+
+    /* backing pixmaps still around free their bits when destroyed */
+    pool->max_bytes = 0;
+    fbTrimPixmapPool(pool);
+}
+
 PixmapPtr
 fbCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
                unsigned usage_hint)
 {
     PixmapPtr pPixmap;
+    FbPixmapBufferPtr buffer = NULL;
     size_t datasize;
     size_t paddedWidth;
     int adjust;
@@ -47,13 +183,25 @@ fbCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
     adjust = 0;
     if (base & 7)
         adjust = 8 - (base & 7);
+#ifndef FB_DEBUG
+    if (usage_hint == CREATE_PIXMAP_USAGE_BACKING_PIXMAP &&
+        fbPixmapPoolInitialized(&fbGetScreenPrivate(pScreen)->pixmapPool)) {
+        buffer = fbGetPixmapBuffer(pScreen, datasize);
+        if (!buffer)
+            return NullPixmap;
+        datasize = sizeof(FbPixmapBufferPtr);
+    }
+#endif
     datasize += adjust;
 #ifdef FB_DEBUG
     datasize += 2 * paddedWidth;
 #endif
     pPixmap = AllocatePixmap(pScreen, datasize);
-    if (!pPixmap)
+    if (!pPixmap) {
+        if (buffer)
+            fbPutPixmapBuffer(pScreen, buffer);
         return NullPixmap;
+    }
     pPixmap->drawable.type = DRAWABLE_PIXMAP;
     pPixmap->drawable.class = 0;
     pPixmap->drawable.pScreen = pScreen;
@@ -70,6 +218,11 @@ fbCreatePixmap(ScreenPtr pScreen, int width, int height, int depth,
     pPixmap->devPrivate.ptr = (void *) ((char *) pPixmap + base + adjust);
     pPixmap->primary_pixmap = NULL;
 
+    if (buffer) {
+        *fbPixmapBufferSlot(pPixmap) = buffer;
+        pPixmap->devPrivate.ptr = (void *) (buffer + 1);
+    }
+
 #ifdef FB_DEBUG
     pPixmap->devPrivate.ptr =
         (void *) ((char *) pPixmap->devPrivate.ptr + paddedWidth);
@@ -91,6 +244,14 @@ fbDestroyPixmap(PixmapPtr pPixmap)
 {
     if (--pPixmap->refcnt)
         return TRUE;
+#ifndef FB_DEBUG
+    if (pPixmap->usage_hint == CREATE_PIXMAP_USAGE_BACKING_PIXMAP) {
+        ScreenPtr pScreen = pPixmap->drawable.pScreen;
+
+        if (fbPixmapPoolInitialized(&fbGetScreenPrivate(pScreen)->pixmapPool))
+            fbPutPixmapBuffer(pScreen, *fbPixmapBufferSlot(pPixmap));
+    }
+#endif
     FreePixmap(pPixmap);
     return TRUE;
 }
@@ -33,6 +33,7 @@ fbCloseScreen(ScreenPtr pScreen)
     DepthPtr depths = pScreen->allowedDepths;
 
     fbDestroyGlyphCache();
+    fbFiniPixmapPool(pScreen);
     for (d = 0; d < pScreen->numDepths; d++)
         free(depths[d].vids);
     free(depths);
@@ -130,6 +131,9 @@ fbSetupScreen(ScreenPtr pScreen, void *pbits, /* pointer to screen bitmap */
     pScreen->GetWindowPixmap = _fbGetWindowPixmap;
     pScreen->SetWindowPixmap = _fbSetWindowPixmap;
 
+    /* enough to keep the bits of two screen sized windows around */
+    fbInitPixmapPool(pScreen, 2 * (size_t) width * ysize * bpp / 8);
+
     return TRUE;
 }
 
@@ -2120,6 +2120,23 @@ __glXDisp_Render(__GLXclientState * cl, GLbyte * pc)
         if (left < cmdlen)
             return BadLength;
 
+        /*
+         ** Draw a whole glBegin/glEnd pair from a vertex array if we can.
+         */
+        if (opcode == X_GLrop_Begin && !client->swapped) {
+            int done, batched;
+
+            done = __glXRenderBatchVertices(pc, left, &batched);
+            if (done > 0) {
+                if (glxc->profile)
+                    __glXProfileRenderCommands(glxc, pc, done);
+                pc += done;
+                left -= done;
+                commandsDone += batched;
+                continue;
+            }
+        }
+
         /*
          ** Check for core opcodes and grab entry data.
          */
@@ -2158,6 +2175,9 @@ __glXDisp_Render(__GLXclientState * cl, GLbyte * pc)
          ** the data towards lower memory (trashing the header) by 4 bytes
          ** and achieve the required alignment.
          */
+        if (glxc->profile)
+            __glXProfileRender(glxc, opcode, pc + __GLX_RENDER_HDR_SIZE,
+                               client->swapped);
         (*proc) (pc + __GLX_RENDER_HDR_SIZE);
         pc += cmdlen;
         left -= cmdlen;
@@ -2370,6 +2390,11 @@ __glXDisp_RenderLarge(__GLXclientState * cl, GLbyte * pc)
             /*
              ** Skip over the header and execute the command.
              */
+            if (glxc->profile)
+                __glXProfileRender(glxc, opcode,
+                                   glxc->largeCmdBuf +
+                                   __GLX_RENDER_LARGE_HDR_SIZE,
+                                   client->swapped);
             (*proc) (glxc->largeCmdBuf + __GLX_RENDER_LARGE_HDR_SIZE);
 
             /*
@@ -2424,6 +2449,9 @@ __glXDisp_VendorPrivateWithReply(__GLXclientState * cl, GLbyte * pc)
 
     REQUEST_AT_LEAST_SIZE(xGLXVendorPrivateReq);
 
+    if (vendorcode == X_GLXvop_QueryContextProfileVCXSRV)
+        return __glXDisp_QueryContextProfile(cl, pc);
+
     proc = (__GLXdispatchVendorPrivProcPtr)
         __glXGetProtocolDecodeFunction(&VendorPriv_dispatch_info,
                                        vendorcode, 0);
@@ -807,6 +807,9 @@ __glXDispSwap_VendorPrivateWithReply(__GLXclientState * cl, GLbyte * pc)
 
     vendorcode = req->vendorCode;
 
+    if (vendorcode == X_GLXvop_QueryContextProfileVCXSRV)
+        return __glXDisp_QueryContextProfile(cl, pc);
+
     proc = (__GLXdispatchVendorPrivProcPtr)
         __glXGetProtocolDecodeFunction(&VendorPriv_dispatch_info,
                                        vendorcode, 1);
@@ -127,6 +127,11 @@ struct __GLXcontext {
     GLbyte *largeCmdBuf;
     GLint largeCmdBufSize;
 
+    /*
+     ** Request counters, with +iglxprofile
+     */
+    __GLXprofile *profile;
+
     /*
      ** The drawable private this context is bound to
      */
@@ -43,6 +43,9 @@
 #include "scrnintstr.h"
 #include "pixmapstr.h"
 #include "gcstruct.h"
+#include "windowstr.h"
+#include "servermd.h"
+#include "damage.h"
 #include "os.h"
 
 #include "glxserver.h"
@@ -83,6 +86,12 @@ struct __GLXDRIdrawable {
     __GLXdrawable base;
     __DRIdrawable *driDrawable;
     __GLXDRIscreen *screen;
+
+    /* Copy statistics, logged when the drawable is destroyed */
+    unsigned long swaps;
+    unsigned long directPuts;
+    unsigned long fallbackPuts;
+    unsigned long long bytesCopied;
 };
 
 /* white lie */
@@ -94,6 +103,15 @@ __glXDRIdrawableDestroy(__GLXdrawable * drawable)
     __GLXDRIdrawable *private = (__GLXDRIdrawable *) drawable;
     const __DRIcoreExtension *core = private->screen->core;
 
+    if (private->swaps)
+        LogMessageVerb(X_INFO, 3,
+                       "IGLX: drawable 0x%lx: %lu swaps, %lu direct and "
+                       "%lu PutImage copies, %llu bytes (%llu per swap)\n",
+                       (unsigned long) drawable->drawId, private->swaps,
+                       private->directPuts, private->fallbackPuts,
+                       private->bytesCopied,
+                       private->bytesCopied / private->swaps);
+
     (*core->destroyDrawable) (private->driDrawable);
 
     __glXDrawableRelease(drawable);
@@ -299,69 +317,315 @@ swrastGetDrawableInfo(__DRIdrawable * draw,
     *h = pDraw->height;
 }
 
+/* Rows compared as one band when looking for what a frame changes */
+#define SWRAST_BAND_ROWS 16
+/* Bytes compared at a time when looking for the changed part of a row */
+#define SWRAST_SPAN_BYTES 64
+
+/*
+ * Widen [*first, *last) to take in the bytes of the len byte rows a and b
+ * that differ, to a precision of SWRAST_SPAN_BYTES.
+ */
 static void
-swrastPutImage(__DRIdrawable * draw, int op,
-               int x, int y, int w, int h, char *data, void *loaderPrivate)
+swrastRowChange(const char *a, const char *b, int len, int *first, int *last)
+{
+    int start, end;
+
+    for (start = 0; start < len; start += SWRAST_SPAN_BYTES)
+        if (memcmp(a + start, b + start, min(len - start, SWRAST_SPAN_BYTES)))
+            break;
+    if (start == len)
+        return;
+
+    for (end = len; end > start + SWRAST_SPAN_BYTES; end -= SWRAST_SPAN_BYTES)
+        if (memcmp(a + end - SWRAST_SPAN_BYTES, b + end - SWRAST_SPAN_BYTES,
+                   SWRAST_SPAN_BYTES))
+            break;
+
+    *first = min(*first, start);
+    *last = max(*last, end);
+}
+
+/*
+ * Add to pChanged the part of *pbox (in screen coordinates) where the
+ * frame at src, which starts at the top left corner of the box, differs
+ * from what the pixmap holds: per band of SWRAST_BAND_ROWS rows, the
+ * columns from the first to the last changed byte.
+ */
+static void
+swrastChangedBoxes(PixmapPtr pPixmap, const BoxRec *pbox, int xoff, int yoff,
+                   const char *src, int stride, int bpp, RegionPtr pChanged)
+{
+    int len = (pbox->x2 - pbox->x1) * bpp;
+    const char *dst = (const char *) pPixmap->devPrivate.ptr +
+        (pbox->y1 + yoff) * pPixmap->devKind + (pbox->x1 + xoff) * bpp;
+    RegionRec band;
+    BoxRec box;
+    int y, row;
+
+    for (y = pbox->y1; y < pbox->y2; y += SWRAST_BAND_ROWS) {
+        int first = len, last = 0;
+
+        box.y1 = y;
+        box.y2 = min(y + SWRAST_BAND_ROWS, pbox->y2);
+        for (row = box.y1; row < box.y2; row++) {
+            swrastRowChange(src, dst, len, &first, &last);
+            src += stride;
+            dst += pPixmap->devKind;
+        }
+        if (first >= last)
+            continue;
+
+        box.x1 = pbox->x1 + first / bpp;
+        box.x2 = pbox->x1 + (last + bpp - 1) / bpp;
+        RegionInit(&band, &box, 1);
+        RegionUnion(pChanged, pChanged, &band);
+        RegionUninit(&band);
+    }
+}
+
+/*
+ * Copy w x h ZPixmap pixels with the given stride straight into the memory
+ * of the pixmap backing pDraw, clipped to what is visible of the drawable,
+ * reporting it as damage.  This is what ValidateGC + PutImage on a
+ * scratch GC would do for an fb screen, minus the GC and the image walk.
+ *
+ * GLX swaps carry no damage, and softpipe hands over the whole back buffer
+ * on every swap, so only the bands of rows where the frame differs from
+ * the pixmap are copied and reported as damage.  A mostly static window
+ * then costs a compare instead of a copy, and the damage listeners (the
+ * compositor, the host window updates) only see what really changed.
+ *
+ * Returns the number of bytes copied, or -1 if the drawable's bits are not
+ * reachable through devPrivate.ptr and the caller has to use PutImage.
+ */
+static long
+swrastCopyToPixmap(DrawablePtr pDraw, int x, int y, int w, int h,
+                   int stride, const char *data)
+{
+    ScreenPtr pScreen = pDraw->pScreen;
+    PixmapPtr pPixmap;
+    RegionRec region, changed;
+    BoxRec box;
+    BoxPtr pbox;
+    int nbox, bpp, xoff = 0, yoff = 0;
+    long copied = 0;
+
+    if (pDraw->type == DRAWABLE_WINDOW)
+        pPixmap = (*pScreen->GetWindowPixmap) ((WindowPtr) pDraw);
+    else
+        pPixmap = (PixmapPtr) pDraw;
+
+    bpp = pDraw->bitsPerPixel;
+    if (!pPixmap || !pPixmap->devPrivate.ptr || bpp < 8 ||
+        pPixmap->drawable.bitsPerPixel != bpp)
+        return -1;
+    bpp >>= 3;
+
+#ifdef COMPOSITE
+    if (pDraw->type == DRAWABLE_WINDOW) {
+        xoff = -pPixmap->screen_x;
+        yoff = -pPixmap->screen_y;
+    }
+#endif
+
+    box.x1 = pDraw->x + max(x, 0);
+    box.y1 = pDraw->y + max(y, 0);
+    box.x2 = pDraw->x + min(x + w, pDraw->width);
+    box.y2 = pDraw->y + min(y + h, pDraw->height);
+    if (box.x1 >= box.x2 || box.y1 >= box.y2)
+        return 0;
+
+    RegionInit(&region, &box, 1);
+    if (pDraw->type == DRAWABLE_WINDOW)
+        RegionIntersect(&region, &region, &((WindowPtr) pDraw)->clipList);
+
+    /* Get e.g. a software cursor out of the way before reading the bits */
+    (*pScreen->SourceValidate) (pDraw, box.x1 - pDraw->x, box.y1 - pDraw->y,
+                                box.x2 - box.x1, box.y2 - box.y1,
+                                ClipByChildren);
+
+    RegionNull(&changed);
+    pbox = RegionRects(&region);
+    nbox = RegionNumRects(&region);
+    for (; nbox--; pbox++)
+        swrastChangedBoxes(pPixmap, pbox, xoff, yoff,
+                           data + (pbox->y1 - pDraw->y - y) * stride +
+                           (pbox->x1 - pDraw->x - x) * bpp, stride, bpp,
+                           &changed);
+    RegionUninit(&region);
+
+    if (!RegionNotEmpty(&changed)) {
+        RegionUninit(&changed);
+        return 0;
+    }
+
+    /* Report the damage up front like the GC wrappers do, so that e.g. a
+     * software cursor gets out of the way before the bits change.
+     */
+    DamageRegionAppend(pDraw, &changed);
+
+    pbox = RegionRects(&changed);
+    nbox = RegionNumRects(&changed);
+    for (; nbox--; pbox++) {
+        const char *src = data + (pbox->y1 - pDraw->y - y) * stride +
+            (pbox->x1 - pDraw->x - x) * bpp;
+        char *dst = (char *) pPixmap->devPrivate.ptr +
+            (pbox->y1 + yoff) * pPixmap->devKind + (pbox->x1 + xoff) * bpp;
+        int bytes = (pbox->x2 - pbox->x1) * bpp;
+        int rows = pbox->y2 - pbox->y1;
+
+        copied += (long) bytes * rows;
+        while (rows--) {
+            memcpy(dst, src, bytes);
+            src += stride;
+            dst += pPixmap->devKind;
+        }
+    }
+
+    DamageRegionProcessPending(pDraw);
+    RegionUninit(&changed);
+    return copied;
+}
+
+static void
+swrastPutImageStride(__GLXDRIdrawable *drawable, int op,
+                     int x, int y, int w, int h, int stride, char *data)
 {
-  __GLXDRIdrawable *drawable = loaderPrivate;
-  DrawablePtr pDraw = drawable->base.pDraw;
-  GCPtr gc;
-  __GLXcontext *cx = lastGLContext;
+    DrawablePtr pDraw = drawable->base.pDraw;
+    GCPtr gc;
+    __GLXcontext *cx = lastGLContext;
+    xRectangle rect;
+    Bool clip = FALSE;
+    long copied = -1;
+
+    if (op == __DRI_SWRAST_IMAGE_OP_SWAP)
+        drawable->swaps++;
 
 #ifdef PANORAMIX
-  if (drawable->base.pAll)
-  {
-    int j;
+    if (!drawable->base.pAll)
+#endif
+        copied = swrastCopyToPixmap(pDraw, x, y, w, h, stride, data);
 
-    for(j = screenInfo.numScreens - 1; j >= 0; j--)
+    if (copied >= 0) {
+        drawable->directPuts++;
+        drawable->bytesCopied += copied;
+        return;
+    }
+
+    /* PutImage wants rows padded to the image width, so send whole rows
+     * of the source and clip away the part beyond w.
+     */
+    if (stride != PixmapBytePad(w, pDraw->depth)) {
+        rect.x = x;
+        rect.y = y;
+        rect.width = w;
+        rect.height = h;
+        w = stride * 8 / BitsPerPixel(pDraw->depth);
+        clip = TRUE;
+    }
+
+    drawable->fallbackPuts++;
+    drawable->bytesCopied += (long) stride * h;
+
+#ifdef PANORAMIX
+    if (drawable->base.pAll)
     {
-      pDraw = drawable->base.pAll[j]->pDraw;
-      if ((gc = GetScratchGC(pDraw->depth, screenInfo.screens[j])))
-      {
+        int j;
+
+        for(j = screenInfo.numScreens - 1; j >= 0; j--)
+        {
+            pDraw = drawable->base.pAll[j]->pDraw;
+            if ((gc = GetScratchGC(pDraw->depth, screenInfo.screens[j])))
+            {
+                if (clip)
+                    SetClipRects(gc, 0, 0, 1, &rect, YXBanded);
+                ValidateGC(pDraw, gc);
+                gc->ops->PutImage(pDraw, gc, pDraw->depth, x, y, w, h, 0,
+                                  ZPixmap, data);
+                FreeScratchGC(gc);
+            }
+        }
+    }
+    else
+#endif
+    if ((gc = GetScratchGC(pDraw->depth, pDraw->pScreen))) {
+        if (clip)
+            SetClipRects(gc, 0, 0, 1, &rect, YXBanded);
         ValidateGC(pDraw, gc);
         gc->ops->PutImage(pDraw, gc, pDraw->depth, x, y, w, h, 0, ZPixmap,
                           data);
         FreeScratchGC(gc);
-      }
-    }
-  }
-  else
-#endif
-    if ((gc = GetScratchGC(pDraw->depth, pDraw->pScreen))) {
-      ValidateGC(pDraw, gc);
-      gc->ops->PutImage(pDraw, gc, pDraw->depth, x, y, w, h, 0, ZPixmap,
-                        data);
-      FreeScratchGC(gc);
     }
 
-  if (cx != lastGLContext) {
-    lastGLContext = cx;
-    cx->makeCurrent(cx);
-  }
+    if (cx != lastGLContext) {
+        lastGLContext = cx;
+        cx->makeCurrent(cx);
+    }
 }
 
 static void
-swrastGetImage(__DRIdrawable * draw,
+swrastPutImage(__DRIdrawable * draw, int op,
                int x, int y, int w, int h, char *data, void *loaderPrivate)
 {
     __GLXDRIdrawable *drawable = loaderPrivate;
+
+    swrastPutImageStride(drawable, op, x, y, w, h,
+                         PixmapBytePad(w, drawable->base.pDraw->depth), data);
+}
+
+static void
+swrastPutImage2(__DRIdrawable * draw, int op,
+                int x, int y, int w, int h, int stride, char *data,
+                void *loaderPrivate)
+{
+    swrastPutImageStride(loaderPrivate, op, x, y, w, h, stride, data);
+}
+
+static void
+swrastGetImage2(__DRIdrawable * draw,
+                int x, int y, int w, int h, int stride, char *data,
+                void *loaderPrivate)
+{
+    __GLXDRIdrawable *drawable = loaderPrivate;
     DrawablePtr pDraw = drawable->base.pDraw;
     ScreenPtr pScreen = pDraw->pScreen;
     __GLXcontext *cx = lastGLContext;
 
     pScreen->SourceValidate(pDraw, x, y, w, h, IncludeInferiors);
-    pScreen->GetImage(pDraw, x, y, w, h, ZPixmap, ~0L, data);
+    if (stride == PixmapBytePad(w, pDraw->depth)) {
+        pScreen->GetImage(pDraw, x, y, w, h, ZPixmap, ~0L, data);
+    }
+    else {
+        /* GetImage pads rows to the image width; fetch a row at a time */
+        for (; h > 0; h--, y++, data += stride)
+            pScreen->GetImage(pDraw, x, y, w, 1, ZPixmap, ~0L, data);
+    }
+
     if (cx != lastGLContext) {
         lastGLContext = cx;
         cx->makeCurrent(cx);
     }
 }
 
+static void
+swrastGetImage(__DRIdrawable * draw,
+               int x, int y, int w, int h, char *data, void *loaderPrivate)
+{
+    __GLXDRIdrawable *drawable = loaderPrivate;
+
+    swrastGetImage2(draw, x, y, w, h,
+                    PixmapBytePad(w, drawable->base.pDraw->depth), data,
+                    loaderPrivate);
+}
+
 static const __DRIswrastLoaderExtension swrastLoaderExtension = {
-    {__DRI_SWRAST_LOADER, 1},
-    swrastGetDrawableInfo,
-    swrastPutImage,
-    swrastGetImage
+    .base = {__DRI_SWRAST_LOADER, 3},
+    .getDrawableInfo = swrastGetDrawableInfo,
+    .putImage = swrastPutImage,
+    .getImage = swrastGetImage,
+    .putImage2 = swrastPutImage2,
+    .getImage2 = swrastGetImage2,
 };
 
 static const __DRIextension *loader_extensions[] = {
@@ -470,6 +734,12 @@ __glXDRIscreenProbe(ScreenPtr pScreen)
 
     __glXInitExtensionEnableBits(screen->base.glx_enable_bits);
 
+    /* Read by the driver when it creates its screen below */
+    if (enableIndirectGLXThread && !getenv("SOFTPIPE_THREADED")) {
+        putenv("SOFTPIPE_THREADED=true");
+        LogMessage(X_INFO, "IGLX: Rendering on a separate thread\n");
+    }
+
     screen->driver = glxProbeDriver(driverName,
                                     (void **) &screen->core,
                                     __DRI_CORE, __DRI_CORE_VERSION,
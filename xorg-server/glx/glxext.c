@@ -183,6 +183,7 @@ __glXFreeContext(__GLXcontext * cx)
     free(cx->feedbackBuf);
     free(cx->selectBuf);
     free(cx->largeCmdBuf);
+    __glXProfileDestroy(cx);
     if (cx == lastGLContext) {
         lastGLContext = NULL;
     }
@@ -626,6 +627,9 @@ __glXForceCurrent(__GLXclientState * cl, GLXContextTag tag, int *error)
     if (cx->wait && (*cx->wait) (cx, cl, error))
         return NULL;
 
+    if (enableIndirectGLXProfile)
+        __glXProfileMakeCurrent(cx);
+
     if (cx == lastGLContext && GET_DISPATCH()) {
         /* No need to re-bind */
         return cx;
@@ -735,8 +739,12 @@ __glXDispatch(ClientPtr client)
      */
     proc = __glXGetProtocolDecodeFunction(&Single_dispatch_info, opcode,
                                           client->swapped);
-    if (proc != NULL)
-        retval = (*proc) (cl, (GLbyte *) stuff);
+    if (proc != NULL) {
+        if (enableIndirectGLXProfile)
+            retval = __glXProfileDispatch(cl, proc, (GLbyte *) stuff);
+        else
+            retval = (*proc) (cl, (GLbyte *) stuff);
+    }
 
     return retval;
 }
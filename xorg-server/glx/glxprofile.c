@@ -0,0 +1,417 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Per context request profiling for indirect GLX.
+ *
+ * With +iglxprofile, every indirect context gets counters the first time a
+ * request makes it current:
+ *  - the GLX requests handled for it, by opcode, and the time spent in each
+ *    kind, which is mostly time spent in the GL driver
+ *  - the render commands decoded for it, by opcode
+ *  - the vertices sent with glVertex and glDrawArrays
+ *  - the pixels sent with glDrawPixels and glTex[Sub]Image and read back
+ *    with glReadPixels
+ *  - the buffer swaps
+ *
+ * The counters are written to the log when the context is destroyed, and
+ * can be read or logged at any time with a vendor private request:
+ *
+ *  VendorPrivateWithReply, vendorCode X_GLXvop_QueryContextProfileVCXSRV
+ *      CARD32  context     the context XID
+ *      CARD32  flags       GLX_PROFILE_LOG to also write to the log,
+ *                          GLX_PROFILE_RESET to clear the counters after
+ *  reply
+ *      retval              1 if the context has counters, else 0
+ *      size                number of opcode entries at the end
+ *      CARD32  requests, render commands
+ *      CARD32  vertices, pixels drawn, pixels read (64 bit, low word first)
+ *      CARD32  swaps
+ *      CARD32  microseconds (64 bit, low word first)
+ *      size times
+ *      CARD32  opcode, count, microseconds
+ *
+ * where the opcode of a render command is its rop opcode plus
+ * GLX_PROFILE_RENDER_COMMAND and its time is included in the Render or
+ * RenderLarge request it came in.
+ *
+ * Without +iglxprofile none of this runs, and the cost is a test of
+ * enableIndirectGLXProfile per request and of the context's counters per
+ * render command.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+#include "glheader.h"
+
+#include <stddef.h>
+#include <glxserver.h>
+#include <unpack.h>
+#include "opaque.h"
+#include "client.h"
+
+/* A little above the highest rop opcode; others are counted as opcode 0 */
+#define PROFILE_RENDER_OPCODES  4352
+
+struct __GLXprofile {
+    CARD32 requests[256];
+    CARD64 requestMicros[256];
+    CARD32 renderCommands[PROFILE_RENDER_OPCODES];
+    CARD64 vertices;
+    CARD64 pixelsDrawn;
+    CARD64 pixelsRead;
+    CARD32 swaps;
+};
+
+/* The context the request being dispatched made current, if any */
+static __GLXcontext *profileContext;
+
+void
+__glXProfileMakeCurrent(__GLXcontext * cx)
+{
+    if (cx->isDirect)
+        return;
+
+    if (!cx->profile)
+        cx->profile = calloc(1, sizeof(*cx->profile));
+    profileContext = cx;
+}
+
+int
+__glXProfileDispatch(__GLXclientState * cl, __GLXdispatchSingleProcPtr proc,
+                     GLbyte * pc)
+{
+    CARD8 opcode = ((xGLXSingleReq *) pc)->glxCode;
+    __GLXprofile *profile;
+    CARD64 start;
+    int retval;
+
+    profileContext = NULL;
+    start = GetTimeInMicros();
+    retval = (*proc) (cl, pc);
+    if (!profileContext || !profileContext->profile)
+        return retval;
+
+    profile = profileContext->profile;
+    profile->requests[opcode]++;
+    profile->requestMicros[opcode] += GetTimeInMicros() - start;
+    profileContext = NULL;
+
+    if (retval != Success)
+        return retval;
+
+    if (opcode == X_GLXSwapBuffers) {
+        profile->swaps++;
+    }
+    else if (opcode == X_GLsop_ReadPixels) {
+        /* The swapped dispatch has swapped these in place by now */
+        GLint width = *(GLint *) (pc + __GLX_SINGLE_HDR_SIZE + 8);
+        GLint height = *(GLint *) (pc + __GLX_SINGLE_HDR_SIZE + 12);
+
+        if (width > 0 && height > 0)
+            profile->pixelsRead += (CARD64) width * height;
+    }
+
+    return retval;
+}
+
+static CARD64
+image_size(const GLbyte * data, size_t width, size_t height, size_t depth,
+           Bool swapped)
+{
+    CARD32 size[3] = { 1, 1, 1 };
+
+    memcpy(&size[0], data + width, 4);
+    if (height)
+        memcpy(&size[1], data + height, 4);
+    if (depth)
+        memcpy(&size[2], data + depth, 4);
+    if (swapped) {
+        size[0] = bswap_32(size[0]);
+        size[1] = bswap_32(size[1]);
+        size[2] = bswap_32(size[2]);
+    }
+
+    /* Negative sizes are GL errors */
+    if ((INT32) size[0] <= 0 || (INT32) size[1] <= 0 || (INT32) size[2] <= 0)
+        return 0;
+    return (CARD64) size[0] * size[1] * size[2];
+}
+
+/* Whether a pixel command leaves out the image */
+static Bool
+null_image(const GLbyte * data, size_t offset)
+{
+    CARD32 null;
+
+    memcpy(&null, data + offset, 4);
+    return null != 0;
+}
+
+/*
+** Count a render command before it is executed.  data points past the
+** render header, and is in the client's byte order.
+*/
+void
+__glXProfileRender(__GLXcontext * cx, int opcode, const GLbyte * data,
+                   Bool swapped)
+{
+    __GLXprofile *profile = cx->profile;
+
+    profile->renderCommands[opcode < PROFILE_RENDER_OPCODES ? opcode : 0]++;
+
+    if (opcode >= X_GLrop_Vertex2dv && opcode <= X_GLrop_Vertex4sv) {
+        profile->vertices++;
+        return;
+    }
+
+    switch (opcode) {
+    case X_GLrop_DrawArrays:
+    case X_GLrop_DrawArraysEXT:
+        profile->vertices +=
+            image_size(data, offsetof(__GLXdispatchDrawArraysHeader,
+                                      numVertexes), 0, 0, swapped);
+        break;
+    case X_GLrop_DrawPixels:
+        profile->pixelsDrawn +=
+            image_size(data,
+                       offsetof(__GLXdispatchDrawPixelsHeader, width),
+                       offsetof(__GLXdispatchDrawPixelsHeader, height), 0,
+                       swapped);
+        break;
+    case X_GLrop_TexImage1D:
+        profile->pixelsDrawn +=
+            image_size(data,
+                       offsetof(__GLXdispatchTexImageHeader, width), 0, 0,
+                       swapped);
+        break;
+    case X_GLrop_TexImage2D:
+        profile->pixelsDrawn +=
+            image_size(data,
+                       offsetof(__GLXdispatchTexImageHeader, width),
+                       offsetof(__GLXdispatchTexImageHeader, height), 0,
+                       swapped);
+        break;
+    case X_GLrop_TexSubImage1D:
+    case X_GLrop_TexSubImage2D:
+        if (null_image(data, offsetof(__GLXdispatchTexSubImageHeader,
+                                      nullImage)))
+            break;
+        profile->pixelsDrawn +=
+            image_size(data,
+                       offsetof(__GLXdispatchTexSubImageHeader, width),
+                       opcode == X_GLrop_TexSubImage2D ?
+                       offsetof(__GLXdispatchTexSubImageHeader, height) : 0,
+                       0, swapped);
+        break;
+    case X_GLrop_TexImage3D:
+        if (null_image(data, offsetof(__GLXdispatchTexImage3DHeader,
+                                      nullimage)))
+            break;
+        profile->pixelsDrawn +=
+            image_size(data,
+                       offsetof(__GLXdispatchTexImage3DHeader, width),
+                       offsetof(__GLXdispatchTexImage3DHeader, height),
+                       offsetof(__GLXdispatchTexImage3DHeader, depth),
+                       swapped);
+        break;
+    case X_GLrop_TexSubImage3D:
+        if (null_image(data, offsetof(__GLXdispatchTexSubImage3DHeader,
+                                      nullImage)))
+            break;
+        profile->pixelsDrawn +=
+            image_size(data,
+                       offsetof(__GLXdispatchTexSubImage3DHeader, width),
+                       offsetof(__GLXdispatchTexSubImage3DHeader, height),
+                       offsetof(__GLXdispatchTexSubImage3DHeader, depth),
+                       swapped);
+        break;
+    }
+}
+
+/*
+** Count the render commands of a Begin/End pair that was batched.  Those
+** were checked and come from an unswapped client.
+*/
+void
+__glXProfileRenderCommands(__GLXcontext * cx, const GLbyte * pc, int bytes)
+{
+    const GLbyte *end = pc + bytes;
+
+    while (pc < end) {
+        const __GLXrenderHeader *hdr = (const __GLXrenderHeader *) pc;
+
+        __glXProfileRender(cx, hdr->opcode, pc + __GLX_RENDER_HDR_SIZE, FALSE);
+        pc += hdr->length;
+    }
+}
+
+static void
+profile_log(__GLXcontext * cx)
+{
+    __GLXprofile *profile = cx->profile;
+    int client = CLIENT_ID(cx->id);
+    const char *name = NULL;
+    CARD32 requests = 0, commands = 0;
+    CARD64 micros = 0;
+    int i;
+
+    if (client < currentMaxClients && clients[client])
+        name = GetClientCmdName(clients[client]);
+
+    for (i = 0; i < ARRAY_SIZE(profile->requests); i++) {
+        requests += profile->requests[i];
+        micros += profile->requestMicros[i];
+    }
+    for (i = 0; i < ARRAY_SIZE(profile->renderCommands); i++)
+        commands += profile->renderCommands[i];
+
+    LogMessage(X_INFO, "GLX: context 0x%x of client %d (%s): "
+               "%u requests in %.1f ms, %u render commands, "
+               "%llu vertices, %llu pixels drawn, %llu pixels read, "
+               "%u swaps\n", (unsigned) cx->id, client,
+               name ? name : "unknown", requests, micros / 1000.0, commands,
+               (unsigned long long) profile->vertices,
+               (unsigned long long) profile->pixelsDrawn,
+               (unsigned long long) profile->pixelsRead, profile->swaps);
+
+    for (i = 0; i < ARRAY_SIZE(profile->requests); i++) {
+        if (profile->requests[i])
+            LogMessageVerb(X_INFO, 3, "GLX:     request %d: %u, %.1f ms\n",
+                           i, profile->requests[i],
+                           profile->requestMicros[i] / 1000.0);
+    }
+    for (i = 0; i < ARRAY_SIZE(profile->renderCommands); i++) {
+        if (profile->renderCommands[i])
+            LogMessageVerb(X_INFO, 3, "GLX:     render command %d: %u\n",
+                           i, profile->renderCommands[i]);
+    }
+}
+
+void
+__glXProfileDestroy(__GLXcontext * cx)
+{
+    if (cx->profile)
+        profile_log(cx);
+
+    if (profileContext == cx)
+        profileContext = NULL;
+    free(cx->profile);
+    cx->profile = NULL;
+}
+
+int
+__glXDisp_QueryContextProfile(__GLXclientState * cl, GLbyte * pc)
+{
+    ClientPtr client = cl->client;
+    xGLXVendorPrivateWithReplyReq *req = (xGLXVendorPrivateWithReplyReq *) pc;
+    xGLXVendorPrivReply reply;
+    CARD32 *data = (CARD32 *) (req + 1);
+    CARD32 *buf = NULL, *p;
+    CARD64 micros = 0;
+    __GLXcontext *cx;
+    __GLXprofile *profile;
+    GLXContextID id;
+    CARD32 flags;
+    int err, i, n = 0, length = 0;
+
+    REQUEST_FIXED_SIZE(xGLXVendorPrivateWithReplyReq, 8);
+
+    id = data[0];
+    flags = data[1];
+    if (client->swapped) {
+        id = bswap_32(id);
+        flags = bswap_32(flags);
+    }
+
+    if (!validGlxContext(client, id, DixReadAccess, &cx, &err))
+        return err;
+
+    reply = (xGLXVendorPrivReply) {
+        .type = X_Reply,
+        .sequenceNumber = client->sequence,
+    };
+
+    profile = cx->profile;
+    if (profile) {
+        for (i = 0; i < ARRAY_SIZE(profile->requests); i++)
+            n += profile->requests[i] != 0;
+        for (i = 0; i < ARRAY_SIZE(profile->renderCommands); i++)
+            n += profile->renderCommands[i] != 0;
+
+        reply.retval = 1;
+        reply.size = n;
+        reply.length = length = 11 + 3 * n;
+        buf = p = calloc(length, 4);
+        if (!buf)
+            return BadAlloc;
+
+        p += 11;
+        for (i = 0; i < ARRAY_SIZE(profile->requests); i++) {
+            buf[0] += profile->requests[i];
+            micros += profile->requestMicros[i];
+            if (profile->requests[i]) {
+                *p++ = i;
+                *p++ = profile->requests[i];
+                *p++ = profile->requestMicros[i];
+            }
+        }
+        for (i = 0; i < ARRAY_SIZE(profile->renderCommands); i++) {
+            buf[1] += profile->renderCommands[i];
+            if (profile->renderCommands[i]) {
+                *p++ = GLX_PROFILE_RENDER_COMMAND + i;
+                *p++ = profile->renderCommands[i];
+                *p++ = 0;
+            }
+        }
+        buf[2] = profile->vertices;
+        buf[3] = profile->vertices >> 32;
+        buf[4] = profile->pixelsDrawn;
+        buf[5] = profile->pixelsDrawn >> 32;
+        buf[6] = profile->pixelsRead;
+        buf[7] = profile->pixelsRead >> 32;
+        buf[8] = profile->swaps;
+        buf[9] = micros;
+        buf[10] = micros >> 32;
+
+        if (flags & GLX_PROFILE_LOG)
+            profile_log(cx);
+        if (flags & GLX_PROFILE_RESET)
+            memset(profile, 0, sizeof(*profile));
+    }
+
+    if (client->swapped) {
+        __GLX_DECLARE_SWAP_VARIABLES;
+        __GLX_DECLARE_SWAP_ARRAY_VARIABLES;
+        __GLX_SWAP_INT_ARRAY((int *) buf, length);
+        __GLX_SWAP_SHORT(&reply.sequenceNumber);
+        __GLX_SWAP_INT(&reply.length);
+        __GLX_SWAP_INT(&reply.retval);
+        __GLX_SWAP_INT(&reply.size);
+    }
+    WriteToClient(client, sz_xGLXVendorPrivReply, &reply);
+    if (length)
+        WriteToClient(client, length << 2, buf);
+    free(buf);
+
+    return Success;
+}
@@ -63,6 +63,7 @@ typedef XID GLXDrawable;
 typedef struct __GLXclientStateRec __GLXclientState;
 typedef struct __GLXdrawable __GLXdrawable;
 typedef struct __GLXcontext __GLXcontext;
+typedef struct __GLXprofile __GLXprofile;
 
 #include "glxscreens.h"
 #include "glxdrawable.h"
@@ -201,6 +202,25 @@ safe_pad(int a)
 }
 
 extern int __glXTypeSize(GLenum enm);
+extern int __glXRenderBatchVertices(GLbyte * pc, int left, int *commands);
+
+/*
+** Per context request counters, see glxprofile.c
+*/
+#define X_GLXvop_QueryContextProfileVCXSRV  0x56435801
+#define GLX_PROFILE_LOG                     0x1
+#define GLX_PROFILE_RESET                   0x2
+#define GLX_PROFILE_RENDER_COMMAND          0x10000
+
+extern void __glXProfileMakeCurrent(__GLXcontext * cx);
+extern int __glXProfileDispatch(__GLXclientState * cl,
+                                __GLXdispatchSingleProcPtr proc, GLbyte * pc);
+extern void __glXProfileRender(__GLXcontext * cx, int opcode,
+                               const GLbyte * data, Bool swapped);
+extern void __glXProfileRenderCommands(__GLXcontext * cx, const GLbyte * pc,
+                                       int bytes);
+extern void __glXProfileDestroy(__GLXcontext * cx);
+extern int __glXDisp_QueryContextProfile(__GLXclientState * cl, GLbyte * pc);
 extern int __glXImageSize(GLenum format, GLenum type,
                           GLenum target, GLsizei w, GLsizei h, GLsizei d,
                           GLint imageHeight, GLint rowLength, GLint skipImages,
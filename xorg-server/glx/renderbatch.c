@@ -0,0 +1,335 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Immediate mode batching for glXRender.
+ *
+ * Legacy indirect clients send glBegin, a stream of glColor/glNormal/
+ * glTexCoord/glVertex commands and glEnd, one render command per call.
+ * Decoding and dispatching each of those separately costs more than the
+ * drawing itself, so a Begin/End pair that is complete within one Render
+ * request and only contains the commands below is decoded here into an
+ * interleaved float array and drawn with a single glDrawArrays.
+ *
+ * Anything else makes the batcher decline, and the request is executed
+ * command by command as before.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+#include "glheader.h"
+
+#include <glxserver.h>
+#include "indirect_dispatch.h"
+
+#include "glfunctions.h"
+
+/* Don't bother with the arrays for a handful of vertices */
+#define BATCH_MIN_VERTICES      4
+
+enum {
+    ATTR_POSITION,
+    ATTR_COLOR,
+    ATTR_NORMAL,
+    ATTR_TEXCOORD,
+};
+
+enum {
+    TYPE_BYTE,
+    TYPE_SHORT,
+    TYPE_INT,
+    TYPE_FLOAT,
+    TYPE_DOUBLE,
+};
+
+struct batch_command {
+    CARD16 opcode;
+    CARD16 length;              /* including the render header */
+    CARD8 attr;
+    CARD8 type;
+    CARD8 size;                 /* number of components sent */
+};
+
+static const struct batch_command batch_commands[] = {
+    { X_GLrop_Vertex2dv, 20, ATTR_POSITION, TYPE_DOUBLE, 2 },
+    { X_GLrop_Vertex2fv, 12, ATTR_POSITION, TYPE_FLOAT, 2 },
+    { X_GLrop_Vertex2iv, 12, ATTR_POSITION, TYPE_INT, 2 },
+    { X_GLrop_Vertex2sv, 8, ATTR_POSITION, TYPE_SHORT, 2 },
+    { X_GLrop_Vertex3dv, 28, ATTR_POSITION, TYPE_DOUBLE, 3 },
+    { X_GLrop_Vertex3fv, 16, ATTR_POSITION, TYPE_FLOAT, 3 },
+    { X_GLrop_Vertex3iv, 16, ATTR_POSITION, TYPE_INT, 3 },
+    { X_GLrop_Vertex3sv, 12, ATTR_POSITION, TYPE_SHORT, 3 },
+    { X_GLrop_Vertex4dv, 36, ATTR_POSITION, TYPE_DOUBLE, 4 },
+    { X_GLrop_Vertex4fv, 20, ATTR_POSITION, TYPE_FLOAT, 4 },
+    { X_GLrop_Vertex4iv, 20, ATTR_POSITION, TYPE_INT, 4 },
+    { X_GLrop_Vertex4sv, 12, ATTR_POSITION, TYPE_SHORT, 4 },
+    { X_GLrop_Color3fv, 16, ATTR_COLOR, TYPE_FLOAT, 3 },
+    { X_GLrop_Color4fv, 20, ATTR_COLOR, TYPE_FLOAT, 4 },
+    { X_GLrop_Color3ubv, 8, ATTR_COLOR, TYPE_BYTE, 3 },
+    { X_GLrop_Color4ubv, 8, ATTR_COLOR, TYPE_BYTE, 4 },
+    { X_GLrop_Normal3fv, 16, ATTR_NORMAL, TYPE_FLOAT, 3 },
+    { X_GLrop_TexCoord1fv, 8, ATTR_TEXCOORD, TYPE_FLOAT, 1 },
+    { X_GLrop_TexCoord2fv, 12, ATTR_TEXCOORD, TYPE_FLOAT, 2 },
+    { X_GLrop_TexCoord3fv, 16, ATTR_TEXCOORD, TYPE_FLOAT, 3 },
+    { X_GLrop_TexCoord4fv, 20, ATTR_TEXCOORD, TYPE_FLOAT, 4 },
+};
+
+/* opcode -> batch_commands index + 1, 0 for commands we don't batch */
+static CARD8 batch_lookup[X_GLrop_Vertex4sv + 1];
+
+/*
+ * Interleaved vertex layout.  Every attribute is stored with four
+ * components, the missing ones filled in with (0, 0, 0, 1) the way the
+ * immediate mode entry points do, except the normal which always has three.
+ */
+#define VERTEX_FLOATS   15
+
+static const int attr_offset[] = {
+    [ATTR_POSITION] = 0,
+    [ATTR_COLOR] = 4,
+    [ATTR_NORMAL] = 8,
+    [ATTR_TEXCOORD] = 11,
+};
+
+static GLfloat *batch_vertices;
+static int batch_vertices_size;
+
+static void
+batch_init_lookup(void)
+{
+    int i;
+
+    if (batch_lookup[X_GLrop_Vertex3fv])
+        return;
+
+    for (i = 0; i < ARRAY_SIZE(batch_commands); i++)
+        batch_lookup[batch_commands[i].opcode] = i + 1;
+}
+
+static void
+batch_decode(const struct batch_command *cmd, const GLbyte *pc,
+             GLfloat *dst)
+{
+    int i;
+
+    if (cmd->attr == ATTR_NORMAL) {
+        memcpy(dst, pc, 3 * sizeof(GLfloat));
+        return;
+    }
+
+    dst[0] = dst[1] = dst[2] = 0.0f;
+    dst[3] = 1.0f;
+
+    for (i = 0; i < cmd->size; i++) {
+        switch (cmd->type) {
+        case TYPE_BYTE:
+            /* divide rather than scale, so the result is bit for bit
+             * what glColor*ub would have made current */
+            dst[i] = ((const GLubyte *) pc)[i] / 255.0f;
+            break;
+        case TYPE_SHORT: {
+            GLshort v;
+
+            memcpy(&v, pc + i * sizeof(v), sizeof(v));
+            dst[i] = v;
+            break;
+        }
+        case TYPE_INT: {
+            GLint v;
+
+            memcpy(&v, pc + i * sizeof(v), sizeof(v));
+            dst[i] = v;
+            break;
+        }
+        case TYPE_FLOAT:
+            memcpy(&dst[i], pc + i * sizeof(GLfloat), sizeof(GLfloat));
+            break;
+        case TYPE_DOUBLE: {
+            GLdouble v;
+
+            /* doubles in a render buffer are only 4 byte aligned */
+            memcpy(&v, pc + i * sizeof(v), sizeof(v));
+            dst[i] = v;
+            break;
+        }
+        }
+    }
+}
+
+/*
+ * Scan the Begin/End pair starting at pc, which points at the header of a
+ * Begin command with left bytes of the request remaining.  Returns the
+ * number of vertices and sets *bytes, *commands and *attribs, or returns -1
+ * if the pair can't be batched.
+ *
+ * Every attribute used in the pair has to be set before its first vertex,
+ * so that no vertex depends on current state from outside the pair.
+ */
+static int
+batch_scan(const GLbyte *pc, int left, int *bytes, int *commands,
+           unsigned *attribs)
+{
+    const __GLXrenderHeader *hdr;
+    unsigned set = 0;
+    int vertices = 0, n = 0, offset = 0;
+
+    for (;;) {
+        const struct batch_command *cmd;
+        int index;
+
+        if (left - offset < (int) sizeof(__GLXrenderHeader))
+            return -1;
+        hdr = (const __GLXrenderHeader *) (pc + offset);
+        if (hdr->length < sizeof(__GLXrenderHeader) ||
+            hdr->length > left - offset)
+            return -1;
+
+        if (n == 0) {
+            if (hdr->opcode != X_GLrop_Begin || hdr->length != 8)
+                return -1;
+        }
+        else if (hdr->opcode == X_GLrop_End) {
+            if (hdr->length != 4)
+                return -1;
+            offset += 4;
+            n++;
+            break;
+        }
+        else {
+            index = hdr->opcode < ARRAY_SIZE(batch_lookup) ?
+                batch_lookup[hdr->opcode] : 0;
+            if (!index)
+                return -1;
+            cmd = &batch_commands[index - 1];
+            if (hdr->length != cmd->length)
+                return -1;
+
+            if (cmd->attr == ATTR_POSITION)
+                vertices++;
+            else if (vertices && !(set & (1 << cmd->attr)))
+                return -1;
+            else
+                set |= 1 << cmd->attr;
+        }
+
+        offset += hdr->length;
+        n++;
+    }
+
+    if (vertices < BATCH_MIN_VERTICES)
+        return -1;
+
+    *bytes = offset;
+    *commands = n;
+    *attribs = set;
+    return vertices;
+}
+
+/*
+ * Try to execute the Begin/End pair at pc as one vertex array draw.
+ * Returns the number of bytes of the request consumed, setting *commands to
+ * the number of render commands that covers, or 0 if nothing was done and
+ * the commands have to be dispatched one by one.
+ *
+ * The client must not be byte swapped.
+ */
+int
+__glXRenderBatchVertices(GLbyte * pc, int left, int *commands)
+{
+    GLfloat current[VERTEX_FLOATS], *v;
+    GLenum mode;
+    unsigned attribs;
+    int vertices, bytes, offset, stride;
+
+    batch_init_lookup();
+
+    vertices = batch_scan(pc, left, &bytes, commands, &attribs);
+    if (vertices < 0)
+        return 0;
+
+    if (vertices > batch_vertices_size) {
+        GLfloat *tmp = reallocarray(batch_vertices, vertices,
+                                    VERTEX_FLOATS * sizeof(GLfloat));
+
+        if (!tmp)
+            return 0;
+        batch_vertices = tmp;
+        batch_vertices_size = vertices;
+    }
+
+    memcpy(&mode, pc + sizeof(__GLXrenderHeader), sizeof(mode));
+    memset(current, 0, sizeof(current));
+
+    v = batch_vertices;
+    for (offset = 8; offset < bytes - 4;) {
+        const __GLXrenderHeader *hdr = (const __GLXrenderHeader *) (pc + offset);
+        const struct batch_command *cmd =
+            &batch_commands[batch_lookup[hdr->opcode] - 1];
+        GLfloat *dst = &current[attr_offset[cmd->attr]];
+
+        batch_decode(cmd, pc + offset + sizeof(__GLXrenderHeader), dst);
+        if (cmd->attr == ATTR_POSITION) {
+            memcpy(v, current, sizeof(current));
+            v += VERTEX_FLOATS;
+        }
+        offset += hdr->length;
+    }
+
+    stride = VERTEX_FLOATS * sizeof(GLfloat);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(4, GL_FLOAT, stride,
+                    batch_vertices + attr_offset[ATTR_POSITION]);
+    if (attribs & (1 << ATTR_COLOR)) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(4, GL_FLOAT, stride,
+                       batch_vertices + attr_offset[ATTR_COLOR]);
+    }
+    if (attribs & (1 << ATTR_NORMAL)) {
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glNormalPointer(GL_FLOAT, stride,
+                        batch_vertices + attr_offset[ATTR_NORMAL]);
+    }
+    if (attribs & (1 << ATTR_TEXCOORD)) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(4, GL_FLOAT, stride,
+                          batch_vertices + attr_offset[ATTR_TEXCOORD]);
+    }
+
+    glDrawArrays(mode, 0, vertices);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    /* The current values are undefined after drawing from an array, but
+     * after glEnd they have to be the last ones the client set.
+     */
+    if (attribs & (1 << ATTR_COLOR))
+        glColor4fv(&current[attr_offset[ATTR_COLOR]]);
+    if (attribs & (1 << ATTR_NORMAL))
+        glNormal3fv(&current[attr_offset[ATTR_NORMAL]]);
+    if (attribs & (1 << ATTR_TEXCOORD))
+        glTexCoord4fv(&current[attr_offset[ATTR_TEXCOORD]]);
+
+    return bytes;
+}
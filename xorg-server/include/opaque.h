@@ -53,6 +53,8 @@ extern _X_EXPORT Bool explicit_display;
 extern _X_EXPORT Bool disableBackingStore;
 extern _X_EXPORT Bool enableBackingStore;
 extern _X_EXPORT Bool enableIndirectGLX;
+extern _X_EXPORT Bool enableIndirectGLXThread;
+extern _X_EXPORT Bool enableIndirectGLXProfile;
 extern _X_EXPORT Bool PartialNetwork;
 extern _X_EXPORT Bool RunFromSigStopParent;
 
@@ -555,6 +555,20 @@ typedef struct {
 /* stuff for FlushCallback */
 extern _X_EXPORT CallbackListPtr FlushCallback;
 
+/* worker threads, os/workers.c */
+typedef void (*WorkerProcPtr) (void *data, int job);
+
+extern _X_EXPORT int WorkerPoolSize;
+
+extern _X_EXPORT int
+WorkerPoolThreads(void);
+
+extern _X_EXPORT void
+WorkerPoolRun(WorkerProcPtr proc, void *data, int numJobs);
+
+extern void
+WorkerPoolFini(void);
+
 enum ExitCode {
     EXIT_NO_ERROR = 0,
     EXIT_ERR_ABORT = 1,
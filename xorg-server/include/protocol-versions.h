@@ -77,7 +77,7 @@
 
 /* Record */
 #define SERVER_RECORD_MAJOR_VERSION		1
-#define SERVER_RECORD_MINOR_VERSION		13
+#define SERVER_RECORD_MINOR_VERSION		14
 
 /* Render */
 #define SERVER_RENDER_MAJOR_VERSION		0
@@ -141,6 +141,8 @@ typedef struct _Window {
     DDXPointRec origin;         /* position relative to parent */
     unsigned short borderWidth;
     unsigned long deliverableEvents;   /* all masks from all clients */
+    Mask deliverableDeviceEvents;      /* XI masks here or above, any device */
+    uint64_t deliverableXI2Events;     /* XI2 types selected here or above */
     Mask eventMask;             /* mask from the creating client */
     PixUnion background;
     PixUnion border;
@@ -492,6 +492,20 @@ extern _X_EXPORT void miMarkUnrealizedWindow(WindowPtr /*pChild */ ,
                                              Bool       /*fromConfigure */
     );
 
+extern _X_EXPORT Bool miSpriteTraceInit(void);
+
+extern _X_EXPORT void miSpriteTraceUpdate(WindowPtr /*pWin */
+    );
+
+extern _X_EXPORT void miSpriteTraceRestack(WindowPtr /*pWin */
+    );
+
+extern _X_EXPORT void miSpriteTraceRemove(WindowPtr /*pWin */
+    );
+
+extern _X_EXPORT void miSpriteTraceDestroy(WindowPtr /*pWin */
+    );
+
 extern _X_EXPORT WindowPtr miSpriteTrace(SpritePtr pSprite, int x, int y);
 
 extern _X_EXPORT WindowPtr miXYToWindow(ScreenPtr pScreen, SpritePtr pSprite, int x, int y);
@@ -288,6 +288,8 @@ miScreenInit(ScreenPtr pScreen, void *pbits,  /* pointer to screen bits */
     pScreen->SetShape = miSetShape;
     pScreen->MarkUnrealizedWindow = miMarkUnrealizedWindow;
     pScreen->XYToWindow = miXYToWindow;
+    if (!miSpriteTraceInit())
+        return FALSE;
 
     miSetZeroLineBias(pScreen, DEFAULTZEROLINEBIAS);
 
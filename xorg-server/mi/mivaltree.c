@@ -177,6 +177,66 @@ miShapedWindowIn(RegionPtr universe, RegionPtr bounding,
 				    HasBorder(w) && \
 				    (w)->backgroundState == ParentRelative)
 
+#ifdef COMPOSITE
+#define IsRedirected(w)		((w)->redirectDraw != RedirectDrawNone)
+#else
+#define IsRedirected(w)		FALSE
+#endif
+
+/*
+ * A marked window whose own geometry is untouched and which is handed
+ * exactly the universe it already clips to cannot end up with different
+ * clips, and neither can any of its inferiors: their geometry only changes
+ * when they are the window being configured, and validation of those
+ * starts at their parent.  Dragging a window over a dense stack marks
+ * every sibling below it, but most of those are covered by something else
+ * and keep the same universe, so this saves recomputing whole subtrees.
+ */
+static Bool
+miClipsUnchanged(WindowPtr pWin, RegionPtr universe, VTKind kind,
+                 int oldVis, int dx, int dy)
+{
+    return kind != VTBroken && !dx && !dy &&
+        !RegionBroken(&pWin->borderClip) && !RegionBroken(&pWin->clipList) &&
+        oldVis != VisibilityNotViewable &&
+        !pWin->valdata->before.resized &&
+        !pWin->valdata->before.borderVisible &&
+        !IsRedirected(pWin) &&
+        (RegionNotEmpty(universe) ?
+         RegionEqual(universe, &pWin->borderClip) :
+         !RegionNotEmpty(&pWin->borderClip));
+}
+
+/*
+ * Mark pParent and its marked inferiors as validated with nothing
+ * exposed, leaving their clips alone.
+ */
+static void
+miSkipClips(WindowPtr pParent)
+{
+    WindowPtr pChild = pParent;
+
+    while (1) {
+        if (pChild->viewable) {
+            if (pChild->valdata && pChild->valdata != UnmapValData) {
+                if (pChild->valdata->before.borderVisible)
+                    RegionDestroy(pChild->valdata->before.borderVisible);
+                RegionNull(&pChild->valdata->after.borderExposed);
+                RegionNull(&pChild->valdata->after.exposed);
+            }
+            if (pChild->firstChild) {
+                pChild = pChild->firstChild;
+                continue;
+            }
+        }
+        while (!pChild->nextSib && (pChild != pParent))
+            pChild = pChild->parent;
+        if (pChild == pParent)
+            break;
+        pChild = pChild->nextSib;
+    }
+}
+
 /*
  *-----------------------------------------------------------------------
  * miComputeClips --
@@ -281,6 +341,11 @@ miComputeClips(WindowPtr pParent,
     dx = pParent->drawable.x - pParent->valdata->before.oldAbsCorner.x;
     dy = pParent->drawable.y - pParent->valdata->before.oldAbsCorner.y;
 
+    if (miClipsUnchanged(pParent, universe, kind, oldVis, dx, dy)) {
+        miSkipClips(pParent);
+        return;
+    }
+
     /*
      * avoid computations when dealing with simple operations
      */
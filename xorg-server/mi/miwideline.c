@@ -91,10 +91,33 @@ typedef struct {
     int *widths;                /* pointer to list of widths        */
 } Spans;
 
+/*
+ * A span group collects the spans of a line before they are filled, so
+ * that each pixel is touched once even where the pieces of the line
+ * overlap.  Spans are accumulated per scanline: each row keeps a sorted
+ * list of disjoint intervals, and a new span is merged into its row as it
+ * is appended.  Filling the group then only has to walk the rows in order.
+ */
+
+typedef struct {
+    int x1, x2;
+} SpanInterval;
+
+#define SPAN_ROW_INLINE 2
+
+typedef struct {
+    int count;                  /* intervals on this row                */
+    int size;                   /* heap intervals, 0 while inline       */
+    SpanInterval *heap;
+    SpanInterval inline_spans[SPAN_ROW_INLINE];
+} SpanRow;
+
+#define SpanRowIntervals(row) \
+    ((row)->size ? (row)->heap : (row)->inline_spans)
+
 typedef struct {
-    int size;                   /* Total number of *Spans allocated     */
-    int count;                  /* Number of *Spans actually in group   */
-    Spans *group;               /* List of Spans                        */
+    SpanRow *rows;              /* rows for y in [ybase, ybase + nrows) */
+    int ybase, nrows;
     int ymin, ymax;             /* Min, max y values encountered        */
 } SpanGroup;
 
@@ -114,458 +137,252 @@ Written by Joel McCormack, Summer 1989.
 static void
 miInitSpanGroup(SpanGroup * spanGroup)
 {
-    spanGroup->size = 0;
-    spanGroup->count = 0;
-    spanGroup->group = NULL;
+    spanGroup->rows = NULL;
+    spanGroup->ybase = 0;
+    spanGroup->nrows = 0;
     spanGroup->ymin = MAXSHORT;
     spanGroup->ymax = MINSHORT;
 }                               /* InitSpanGroup */
 
-#define YMIN(spans) (spans->points[0].y)
-#define YMAX(spans)  (spans->points[spans->count-1].y)
-
-static void
-miSubtractSpans(SpanGroup * spanGroup, Spans * sub)
+/* make room for rows ymin through ymax */
+static Bool
+miSpanGroupRows(SpanGroup * spanGroup, int ymin, int ymax)
 {
-    int i, subCount, spansCount;
-    int ymin, ymax, xmin, xmax;
-    Spans *spans;
-    DDXPointPtr subPt, spansPt;
-    int *subWid, *spansWid;
-    int extra;
-
-    ymin = YMIN(sub);
-    ymax = YMAX(sub);
-    spans = spanGroup->group;
-    for (i = spanGroup->count; i; i--, spans++) {
-        if (YMIN(spans) <= ymax && ymin <= YMAX(spans)) {
-            subCount = sub->count;
-            subPt = sub->points;
-            subWid = sub->widths;
-            spansCount = spans->count;
-            spansPt = spans->points;
-            spansWid = spans->widths;
-            extra = 0;
-            for (;;) {
-                while (spansCount && spansPt->y < subPt->y) {
-                    spansPt++;
-                    spansWid++;
-                    spansCount--;
-                }
-                if (!spansCount)
-                    break;
-                while (subCount && subPt->y < spansPt->y) {
-                    subPt++;
-                    subWid++;
-                    subCount--;
-                }
-                if (!subCount)
-                    break;
-                if (subPt->y == spansPt->y) {
-                    xmin = subPt->x;
-                    xmax = xmin + *subWid;
-                    if (xmin >= spansPt->x + *spansWid || spansPt->x >= xmax) {
-                        ;
-                    }
-                    else if (xmin <= spansPt->x) {
-                        if (xmax >= spansPt->x + *spansWid) {
-                            memmove(spansPt, spansPt + 1,
-                                    sizeof *spansPt * (spansCount - 1));
-                            memmove(spansWid, spansWid + 1,
-                                    sizeof *spansWid * (spansCount - 1));
-                            spansPt--;
-                            spansWid--;
-                            spans->count--;
-                            extra++;
-                        }
-                        else {
-                            *spansWid = *spansWid - (xmax - spansPt->x);
-                            spansPt->x = xmax;
-                        }
-                    }
-                    else {
-                        if (xmax >= spansPt->x + *spansWid) {
-                            *spansWid = xmin - spansPt->x;
-                        }
-                        else {
-                            if (!extra) {
-                                DDXPointPtr newPt;
-                                int *newwid;
-
-#define EXTRA 8
-                                newPt = reallocarray(spans->points,
-                                                     spans->count + EXTRA,
-                                                     sizeof(DDXPointRec));
-                                if (!newPt)
-                                    break;
-                                spansPt = newPt + (spansPt - spans->points);
-                                spans->points = newPt;
-                                newwid = reallocarray(spans->widths,
-                                                      spans->count + EXTRA,
-                                                      sizeof(int));
-                                if (!newwid)
-                                    break;
-                                spansWid = newwid + (spansWid - spans->widths);
-                                spans->widths = newwid;
-                                extra = EXTRA;
-                            }
-                            memmove(spansPt + 1, spansPt,
-                                    sizeof *spansPt * (spansCount));
-                            memmove(spansWid + 1, spansWid,
-                                    sizeof *spansWid * (spansCount));
-                            spans->count++;
-                            extra--;
-                            *spansWid = xmin - spansPt->x;
-                            spansWid++;
-                            spansPt++;
-                            *spansWid = *spansWid - (xmax - spansPt->x);
-                            spansPt->x = xmax;
-                        }
-                    }
-                }
-                spansPt++;
-                spansWid++;
-                spansCount--;
-            }
-        }
+    int ybase, nrows, slack;
+    SpanRow *rows;
+
+    if (spanGroup->nrows) {
+        if (ymin >= spanGroup->ybase &&
+            ymax < spanGroup->ybase + spanGroup->nrows)
+            return TRUE;
+        /* grow by half again, as lines tend to keep going */
+        slack = spanGroup->nrows / 2;
+        ybase = min(ymin, spanGroup->ybase);
+        if (ybase < spanGroup->ybase)
+            ybase -= slack;
+        nrows = max(ymax + 1, spanGroup->ybase + spanGroup->nrows) - ybase;
+        if (ymax >= spanGroup->ybase + spanGroup->nrows)
+            nrows += slack;
+    }
+    else {
+        ybase = ymin;
+        nrows = ymax - ymin + 1;
     }
+
+    rows = xallocarray(nrows, sizeof(SpanRow));
+    if (!rows)
+        return FALSE;
+    memset(rows, 0, nrows * sizeof(SpanRow));
+    if (spanGroup->nrows) {
+        memcpy(rows + (spanGroup->ybase - ybase), spanGroup->rows,
+               spanGroup->nrows * sizeof(SpanRow));
+        free(spanGroup->rows);
+    }
+    spanGroup->rows = rows;
+    spanGroup->ybase = ybase;
+    spanGroup->nrows = nrows;
+    return TRUE;
 }
 
-static void
-miAppendSpans(SpanGroup * spanGroup, SpanGroup * otherGroup, Spans * spans)
+/* make room for one more interval at index i of row */
+static SpanInterval *
+miSpanRowInsert(SpanRow * row, int i)
 {
-    int ymin, ymax;
-    int spansCount;
+    SpanInterval *spans = SpanRowIntervals(row);
 
-    spansCount = spans->count;
-    if (spansCount > 0) {
-        if (spanGroup->size == spanGroup->count) {
-            spanGroup->size = (spanGroup->size + 8) * 2;
-            spanGroup->group =
-                reallocarray(spanGroup->group, sizeof(Spans), spanGroup->size);
-        }
+    if (row->count == (row->size ? row->size : SPAN_ROW_INLINE)) {
+        int size = row->count * 2;
+        SpanInterval *heap;
 
-        spanGroup->group[spanGroup->count] = *spans;
-        (spanGroup->count)++;
-        ymin = spans->points[0].y;
-        if (ymin < spanGroup->ymin)
-            spanGroup->ymin = ymin;
-        ymax = spans->points[spansCount - 1].y;
-        if (ymax > spanGroup->ymax)
-            spanGroup->ymax = ymax;
-        if (otherGroup && otherGroup->ymin < ymax && ymin < otherGroup->ymax) {
-            miSubtractSpans(otherGroup, spans);
-        }
-    }
-    else {
-        free(spans->points);
-        free(spans->widths);
+        if (row->size)
+            heap = reallocarray(row->heap, size, sizeof(SpanInterval));
+        else {
+            heap = xallocarray(size, sizeof(SpanInterval));
+            if (heap)
+                memcpy(heap, row->inline_spans, sizeof(row->inline_spans));
+        }
+        if (!heap)
+            return NULL;
+        row->heap = spans = heap;
+        row->size = size;
+    }
+    memmove(spans + i + 1, spans + i, (row->count - i) * sizeof(SpanInterval));
+    row->count++;
+    return spans + i;
+}
+
+/* index of the first interval of row ending at or after x */
+static int
+miSpanRowFind(SpanInterval * spans, int count, int x)
+{
+    int lo = 0, hi = count;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (spans[mid].x2 < x)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
-}                               /* AppendSpans */
+    return lo;
+}
 
 static void
-miFreeSpanGroup(SpanGroup * spanGroup)
+miSpanRowAdd(SpanRow * row, int x1, int x2)
 {
-    free(spanGroup->group);
+    SpanInterval *spans = SpanRowIntervals(row);
+    int i, j;
+
+    /* merge with every interval overlapping or touching [x1, x2) */
+    i = j = miSpanRowFind(spans, row->count, x1);
+    while (j < row->count && spans[j].x1 <= x2) {
+        x1 = min(x1, spans[j].x1);
+        x2 = max(x2, spans[j].x2);
+        j++;
+    }
+    if (i == j) {
+        SpanInterval *span = miSpanRowInsert(row, i);
+
+        if (span) {
+            span->x1 = x1;
+            span->x2 = x2;
+        }
+        return;
+    }
+    spans[i].x1 = x1;
+    spans[i].x2 = x2;
+    memmove(spans + i + 1, spans + j, (row->count - j) * sizeof(SpanInterval));
+    row->count -= j - i - 1;
 }
 
 static void
-QuickSortSpansX(DDXPointRec points[], int widths[], int numSpans)
+miSpanRowSubtract(SpanRow * row, int x1, int x2)
 {
-    int x;
-    int i, j, m;
-    DDXPointPtr r;
-
-/* Always called with numSpans > 1 */
-/* Sorts only by x, as all y should be the same */
-
-#define ExchangeSpans(a, b)				    \
-{							    \
-    DDXPointRec 	tpt;				    \
-    int    		tw;				    \
-							    \
-    tpt = points[a]; points[a] = points[b]; points[b] = tpt;    \
-    tw = widths[a]; widths[a] = widths[b]; widths[b] = tw;  \
-}
+    SpanInterval *spans = SpanRowIntervals(row);
+    int i, j;
 
-    do {
-        if (numSpans < 9) {
-            /* Do insertion sort */
-            int xprev;
-
-            xprev = points[0].x;
-            i = 1;
-            do {                /* while i != numSpans */
-                x = points[i].x;
-                if (xprev > x) {
-                    /* points[i] is out of order.  Move into proper location. */
-                    DDXPointRec tpt;
-                    int tw, k;
-
-                    for (j = 0; x >= points[j].x; j++) {
-                    }
-                    tpt = points[i];
-                    tw = widths[i];
-                    for (k = i; k != j; k--) {
-                        points[k] = points[k - 1];
-                        widths[k] = widths[k - 1];
-                    }
-                    points[j] = tpt;
-                    widths[j] = tw;
-                    x = points[i].x;
-                }               /* if out of order */
-                xprev = x;
-                i++;
-            } while (i != numSpans);
+    i = miSpanRowFind(spans, row->count, x1 + 1);
+    if (i == row->count || spans[i].x1 >= x2)
+        return;
+    if (spans[i].x1 < x1) {
+        if (spans[i].x2 > x2) {
+            /* punch a hole in the middle */
+            SpanInterval *span = miSpanRowInsert(row, i + 1);
+
+            if (span) {
+                spans = SpanRowIntervals(row);
+                span->x1 = x2;
+                span->x2 = spans[i].x2;
+                spans[i].x2 = x1;
+            }
             return;
         }
+        spans[i].x2 = x1;
+        i++;
+    }
+    for (j = i; j < row->count && spans[j].x2 <= x2; j++)
+        ;
+    if (j < row->count && spans[j].x1 < x2)
+        spans[j].x1 = x2;
+    memmove(spans + i, spans + j, (row->count - j) * sizeof(SpanInterval));
+    row->count -= j - i;
+}
 
-        /* Choose partition element, stick in location 0 */
-        m = numSpans / 2;
-        if (points[m].x > points[0].x)
-            ExchangeSpans(m, 0);
-        if (points[m].x > points[numSpans - 1].x)
-            ExchangeSpans(m, numSpans - 1);
-        if (points[m].x > points[0].x)
-            ExchangeSpans(m, 0);
-        x = points[0].x;
-
-        /* Partition array */
-        i = 0;
-        j = numSpans;
-        do {
-            r = &(points[i]);
-            do {
-                r++;
-                i++;
-            } while (i != numSpans && r->x < x);
-            r = &(points[j]);
-            do {
-                r--;
-                j--;
-            } while (x < r->x);
-            if (i < j)
-                ExchangeSpans(i, j);
-        } while (i < j);
-
-        /* Move partition element back to middle */
-        ExchangeSpans(0, j);
-
-        /* Recurse */
-        if (numSpans - j - 1 > 1)
-            QuickSortSpansX(&points[j + 1], &widths[j + 1], numSpans - j - 1);
-        numSpans = j;
-    } while (numSpans > 1);
-}                               /* QuickSortSpans */
-
-static int
-UniquifySpansX(Spans * spans, DDXPointRec * newPoints, int *newWidths)
+/*
+ * Add spans to spanGroup, taking them out of otherGroup: where the two
+ * colors of a double dashed line overlap, the piece drawn last wins.
+ */
+static void
+miAppendSpans(SpanGroup * spanGroup, SpanGroup * otherGroup, Spans * spans)
 {
-    int newx1, newx2, oldpt, i, y;
-    DDXPointRec *oldPoints;
-    int *oldWidths;
-    int *startNewWidths;
-
-/* Always called with numSpans > 1 */
-/* Uniquify the spans, and stash them into newPoints and newWidths.  Return the
-   number of unique spans. */
-
-    startNewWidths = newWidths;
-
-    oldPoints = spans->points;
-    oldWidths = spans->widths;
-
-    y = oldPoints->y;
-    newx1 = oldPoints->x;
-    newx2 = newx1 + *oldWidths;
-
-    for (i = spans->count - 1; i != 0; i--) {
-        oldPoints++;
-        oldWidths++;
-        oldpt = oldPoints->x;
-        if (oldpt > newx2) {
-            /* Write current span, start a new one */
-            newPoints->x = newx1;
-            newPoints->y = y;
-            *newWidths = newx2 - newx1;
-            newPoints++;
-            newWidths++;
-            newx1 = oldpt;
-            newx2 = oldpt + *oldWidths;
-        }
-        else {
-            /* extend current span, if old extends beyond new */
-            oldpt = oldpt + *oldWidths;
-            if (oldpt > newx2)
-                newx2 = oldpt;
-        }
-    }                           /* for */
-
-    /* Write final span */
-    newPoints->x = newx1;
-    *newWidths = newx2 - newx1;
-    newPoints->y = y;
+    int ymin, ymax;
+    int i;
 
-    return (newWidths - startNewWidths) + 1;
-}                               /* UniquifySpansX */
+    if (spans->count > 0) {
+        ymin = ymax = spans->points[0].y;
+        for (i = 1; i < spans->count; i++) {
+            ymin = min(ymin, spans->points[i].y);
+            ymax = max(ymax, spans->points[i].y);
+        }
+
+        if (miSpanGroupRows(spanGroup, ymin, ymax)) {
+            for (i = 0; i < spans->count; i++) {
+                int y = spans->points[i].y;
+                int x1 = spans->points[i].x;
+                int x2 = x1 + spans->widths[i];
+
+                if (x1 >= x2)
+                    continue;
+                miSpanRowAdd(&spanGroup->rows[y - spanGroup->ybase], x1, x2);
+                if (otherGroup && otherGroup->ymin <= y &&
+                    y <= otherGroup->ymax)
+                    miSpanRowSubtract(&otherGroup->rows[y - otherGroup->ybase],
+                                      x1, x2);
+            }
+            if (ymin < spanGroup->ymin)
+                spanGroup->ymin = ymin;
+            if (ymax > spanGroup->ymax)
+                spanGroup->ymax = ymax;
+        }
+    }
+    free(spans->points);
+    free(spans->widths);
+}                               /* AppendSpans */
 
 static void
-miDisposeSpanGroup(SpanGroup * spanGroup)
+miFreeSpanGroup(SpanGroup * spanGroup)
 {
     int i;
-    Spans *spans;
 
-    for (i = 0; i < spanGroup->count; i++) {
-        spans = spanGroup->group + i;
-        free(spans->points);
-        free(spans->widths);
-    }
+    for (i = 0; i < spanGroup->nrows; i++)
+        if (spanGroup->rows[i].size)
+            free(spanGroup->rows[i].heap);
+    free(spanGroup->rows);
 }
 
 static void
 miFillUniqueSpanGroup(DrawablePtr pDraw, GCPtr pGC, SpanGroup * spanGroup)
 {
-    int i;
-    Spans *spans;
-    Spans *yspans;
-    int *ysizes;
-    int ymin, ylength;
+    SpanRow *row;
+    int y, i;
 
     /* Outgoing spans for one big call to FillSpans */
     DDXPointPtr points;
     int *widths;
     int count;
 
-    if (spanGroup->count == 0)
+    if (spanGroup->ymin > spanGroup->ymax)
         return;
 
-    if (spanGroup->count == 1) {
-        /* Already should be sorted, unique */
-        spans = spanGroup->group;
-        (*pGC->ops->FillSpans)
-            (pDraw, pGC, spans->count, spans->points, spans->widths, TRUE);
-        free(spans->points);
-        free(spans->widths);
-    }
-    else {
-        /* Yuck.  Gross.  Radix sort into y buckets, then sort x and uniquify */
-        /* This seems to be the fastest thing to do.  I've tried sorting on
-           both x and y at the same time rather than creating into all those
-           y buckets, but it was somewhat slower. */
-
-        ymin = spanGroup->ymin;
-        ylength = spanGroup->ymax - ymin + 1;
-
-        /* Allocate Spans for y buckets */
-        yspans = xallocarray(ylength, sizeof(Spans));
-        ysizes = xallocarray(ylength, sizeof(int));
-
-        if (!yspans || !ysizes) {
-            free(yspans);
-            free(ysizes);
-            miDisposeSpanGroup(spanGroup);
-            return;
-        }
-
-        for (i = 0; i != ylength; i++) {
-            ysizes[i] = 0;
-            yspans[i].count = 0;
-            yspans[i].points = NULL;
-            yspans[i].widths = NULL;
-        }
+    count = 0;
+    for (y = spanGroup->ymin; y <= spanGroup->ymax; y++)
+        count += spanGroup->rows[y - spanGroup->ybase].count;
 
-        /* Go through every single span and put it into the correct bucket */
+    points = xallocarray(count, sizeof(DDXPointRec));
+    widths = xallocarray(count, sizeof(int));
+    if (points && widths) {
         count = 0;
-        for (i = 0, spans = spanGroup->group;
-             i != spanGroup->count; i++, spans++) {
-            int index;
-            int j;
-
-            for (j = 0, points = spans->points, widths = spans->widths;
-                 j != spans->count; j++, points++, widths++) {
-                index = points->y - ymin;
-                if (index >= 0 && index < ylength) {
-                    Spans *newspans = &(yspans[index]);
-
-                    if (newspans->count == ysizes[index]) {
-                        DDXPointPtr newpoints;
-                        int *newwidths;
-
-                        ysizes[index] = (ysizes[index] + 8) * 2;
-                        newpoints = reallocarray(newspans->points,
-                                                 ysizes[index],
-                                                 sizeof(DDXPointRec));
-                        newwidths = reallocarray(newspans->widths,
-                                                 ysizes[index], sizeof(int));
-                        if (!newpoints || !newwidths) {
-                            for (i = 0; i < ylength; i++) {
-                                free(yspans[i].points);
-                                free(yspans[i].widths);
-                            }
-                            free(yspans);
-                            free(ysizes);
-                            free(newpoints);
-                            free(newwidths);
-                            miDisposeSpanGroup(spanGroup);
-                            return;
-                        }
-                        newspans->points = newpoints;
-                        newspans->widths = newwidths;
-                    }
-                    newspans->points[newspans->count] = *points;
-                    newspans->widths[newspans->count] = *widths;
-                    (newspans->count)++;
-                }               /* if y value of span in range */
-            }                   /* for j through spans */
-            count += spans->count;
-            free(spans->points);
-            spans->points = NULL;
-            free(spans->widths);
-            spans->widths = NULL;
-        }                       /* for i thorough Spans */
-
-        /* Now sort by x and uniquify each bucket into the final array */
-        points = xallocarray(count, sizeof(DDXPointRec));
-        widths = xallocarray(count, sizeof(int));
-        if (!points || !widths) {
-            for (i = 0; i < ylength; i++) {
-                free(yspans[i].points);
-                free(yspans[i].widths);
+        for (y = spanGroup->ymin; y <= spanGroup->ymax; y++) {
+            SpanInterval *spans;
+
+            row = &spanGroup->rows[y - spanGroup->ybase];
+            spans = SpanRowIntervals(row);
+            for (i = 0; i < row->count; i++) {
+                points[count].x = spans[i].x1;
+                points[count].y = y;
+                widths[count] = spans[i].x2 - spans[i].x1;
+                count++;
             }
-            free(yspans);
-            free(ysizes);
-            free(points);
-            free(widths);
-            return;
         }
-        count = 0;
-        for (i = 0; i != ylength; i++) {
-            int ycount = yspans[i].count;
-
-            if (ycount > 0) {
-                if (ycount > 1) {
-                    QuickSortSpansX(yspans[i].points, yspans[i].widths, ycount);
-                    count += UniquifySpansX
-                        (&(yspans[i]), &(points[count]), &(widths[count]));
-                }
-                else {
-                    points[count] = yspans[i].points[0];
-                    widths[count] = yspans[i].widths[0];
-                    count++;
-                }
-                free(yspans[i].points);
-                free(yspans[i].widths);
-            }
-        }
-
-        (*pGC->ops->FillSpans) (pDraw, pGC, count, points, widths, TRUE);
-        free(points);
-        free(widths);
-        free(yspans);
-        free(ysizes);           /* use (DE)xalloc for these? */
+        if (count)
+            (*pGC->ops->FillSpans) (pDraw, pGC, count, points, widths, TRUE);
     }
+    free(points);
+    free(widths);
 
-    spanGroup->count = 0;
+    for (y = spanGroup->ymin; y <= spanGroup->ymax; y++)
+        spanGroup->rows[y - spanGroup->ybase].count = 0;
     spanGroup->ymin = MAXSHORT;
     spanGroup->ymax = MINSHORT;
 }
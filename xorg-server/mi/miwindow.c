@@ -746,46 +746,506 @@ miMarkUnrealizedWindow(WindowPtr pChild, WindowPtr pWin, Bool fromConfigure)
     }
 }
 
-WindowPtr
-miSpriteTrace(SpritePtr pSprite, int x, int y)
+/*
+ * Pointer hit-testing index.
+ *
+ * At every level of the tree miSpriteTrace looks for the topmost child
+ * under the pointer, which is a walk down the sibling list.  With a few
+ * hundred top-level windows that walk dominates motion processing, so
+ * parents with many children keep a coarse grid over their border box.
+ * Each cell lists, in stacking order, the children whose border box
+ * overlaps it, and only those need to be tested.
+ *
+ * The index caches nothing but child geometry and stacking order; mapping
+ * state, shapes and unhittable are still checked on the live window.  It
+ * is built the first time a trace passes through a parent and then kept
+ * current by dix: SetBorderSize() reports geometry changes through
+ * miSpriteTraceUpdate(), and the sibling list edits report through
+ * miSpriteTraceRestack() and miSpriteTraceRemove().  Stacking order is a
+ * sparse rank so that raising or lowering a window only touches that
+ * window's cells; when the ranks run out the index is simply dropped and
+ * rebuilt by the next trace.
+ */
+
+#define MI_TRACE_MIN_CHILDREN	16
+#define MI_TRACE_GRID		16
+#define MI_TRACE_RANK_GAP	1024
+
+typedef struct {
+    int x1, y1, x2, y2;
+} miTraceBoxRec, *miTraceBoxPtr;
+
+typedef struct {
+    WindowPtr pWin;             /* NULL once the child is gone */
+    int rank;                   /* lower is higher in the stack */
+    miTraceBoxRec box;          /* border box, relative to the parent origin */
+} miTraceEntryRec, *miTraceEntryPtr;
+
+typedef struct {
+    int *ids;                   /* entries, in rank order */
+    int num;
+    int size;
+} miTraceCellRec, *miTraceCellPtr;
+
+typedef struct {
+    int width, height, bw;      /* parent geometry the grid was laid out for */
+    int cellWidth, cellHeight;
+    int numEntries;
+    int sizeEntries;
+    int numFree;                /* entries whose child has gone */
+    miTraceEntryPtr entries;
+    miTraceCellRec cells[MI_TRACE_GRID * MI_TRACE_GRID];
+} miTraceIndexRec, *miTraceIndexPtr;
+
+typedef struct {
+    miTraceIndexPtr index;      /* index over this window's children */
+    int slot;                   /* this window's entry in its parent's index */
+} miTraceWindowRec, *miTraceWindowPtr;
+
+static DevPrivateKeyRec miTraceWindowKeyRec;
+
+/* marks parents with too few children to be worth indexing */
+static miTraceIndexRec miTraceTooFew;
+
+#define miTraceGetWindow(w) ((miTraceWindowPtr) \
+    dixLookupPrivate(&(w)->devPrivates, &miTraceWindowKeyRec))
+
+Bool
+miSpriteTraceInit(void)
+{
+    return dixRegisterPrivateKey(&miTraceWindowKeyRec, PRIVATE_WINDOW,
+                                 sizeof(miTraceWindowRec));
+}
+
+static void
+miTraceChildBox(WindowPtr pChild, miTraceBoxPtr box)
+{
+    int bw = wBorderWidth(pChild);
+
+    box->x1 = pChild->origin.x - bw;
+    box->y1 = pChild->origin.y - bw;
+    box->x2 = pChild->origin.x + (int) pChild->drawable.width + bw;
+    box->y2 = pChild->origin.y + (int) pChild->drawable.height + bw;
+}
+
+static Bool
+miTraceIndexStale(miTraceIndexPtr idx, WindowPtr pParent)
+{
+    return idx->width != pParent->drawable.width ||
+        idx->height != pParent->drawable.height ||
+        idx->bw != wBorderWidth(pParent);
+}
+
+/*
+ * Range of cells covered by box, inclusive.  Returns FALSE if the box lies
+ * entirely outside the parent's border box.
+ */
+static Bool
+miTraceCellRange(miTraceIndexPtr idx, miTraceBoxPtr box,
+                 int *cx1, int *cy1, int *cx2, int *cy2)
+{
+    int x1 = max(box->x1 + idx->bw, 0);
+    int y1 = max(box->y1 + idx->bw, 0);
+    int x2 = min(box->x2 + idx->bw, idx->width + 2 * idx->bw);
+    int y2 = min(box->y2 + idx->bw, idx->height + 2 * idx->bw);
+
+    if (x1 >= x2 || y1 >= y2)
+        return FALSE;
+    *cx1 = x1 / idx->cellWidth;
+    *cy1 = y1 / idx->cellHeight;
+    *cx2 = (x2 - 1) / idx->cellWidth;
+    *cy2 = (y2 - 1) / idx->cellHeight;
+    return TRUE;
+}
+
+/* first position in the cell not ranked above rank */
+static int
+miTraceCellFind(miTraceIndexPtr idx, miTraceCellPtr cell, int rank)
+{
+    int lo = 0, hi = cell->num;
+
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+
+        if (idx->entries[cell->ids[mid]].rank < rank)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static Bool
+miTraceCellInsert(miTraceIndexPtr idx, miTraceCellPtr cell, int id)
+{
+    int pos;
+
+    if (cell->num == cell->size) {
+        int size = cell->size ? cell->size * 2 : 8;
+        int *ids = reallocarray(cell->ids, size, sizeof(int));
+
+        if (!ids)
+            return FALSE;
+        cell->ids = ids;
+        cell->size = size;
+    }
+    pos = miTraceCellFind(idx, cell, idx->entries[id].rank);
+    memmove(cell->ids + pos + 1, cell->ids + pos,
+            (cell->num - pos) * sizeof(int));
+    cell->ids[pos] = id;
+    cell->num++;
+    return TRUE;
+}
+
+static void
+miTraceCellRemove(miTraceIndexPtr idx, miTraceCellPtr cell, int id)
+{
+    int pos = miTraceCellFind(idx, cell, idx->entries[id].rank);
+
+    if (pos < cell->num && cell->ids[pos] == id) {
+        cell->num--;
+        memmove(cell->ids + pos, cell->ids + pos + 1,
+                (cell->num - pos) * sizeof(int));
+    }
+}
+
+static Bool
+miTraceIndexAdd(miTraceIndexPtr idx, int id)
+{
+    int cx, cy, cx1, cy1, cx2, cy2;
+
+    if (!miTraceCellRange(idx, &idx->entries[id].box, &cx1, &cy1, &cx2, &cy2))
+        return TRUE;
+    for (cy = cy1; cy <= cy2; cy++)
+        for (cx = cx1; cx <= cx2; cx++)
+            if (!miTraceCellInsert(idx, &idx->cells[cy * MI_TRACE_GRID + cx],
+                                   id))
+                return FALSE;
+    return TRUE;
+}
+
+static void
+miTraceIndexRemove(miTraceIndexPtr idx, int id)
+{
+    int cx, cy, cx1, cy1, cx2, cy2;
+
+    if (!miTraceCellRange(idx, &idx->entries[id].box, &cx1, &cy1, &cx2, &cy2))
+        return;
+    for (cy = cy1; cy <= cy2; cy++)
+        for (cx = cx1; cx <= cx2; cx++)
+            miTraceCellRemove(idx, &idx->cells[cy * MI_TRACE_GRID + cx], id);
+}
+
+static void
+miTraceIndexFree(miTraceIndexPtr idx)
+{
+    int i;
+
+    if (!idx || idx == &miTraceTooFew)
+        return;
+    for (i = 0; i < MI_TRACE_GRID * MI_TRACE_GRID; i++)
+        free(idx->cells[i].ids);
+    free(idx->entries);
+    free(idx);
+}
+
+static miTraceIndexPtr
+miTraceIndexBuild(WindowPtr pParent)
+{
+    miTraceIndexPtr idx;
+    WindowPtr pChild;
+    int n = 0;
+
+    for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib)
+        n++;
+    if (n < MI_TRACE_MIN_CHILDREN)
+        return &miTraceTooFew;
+
+    idx = calloc(1, sizeof(miTraceIndexRec));
+    if (!idx)
+        return NULL;
+    idx->sizeEntries = n + n / 4;
+    idx->entries = calloc(idx->sizeEntries, sizeof(miTraceEntryRec));
+    if (!idx->entries) {
+        free(idx);
+        return NULL;
+    }
+    idx->width = pParent->drawable.width;
+    idx->height = pParent->drawable.height;
+    idx->bw = wBorderWidth(pParent);
+    idx->cellWidth = max((idx->width + 2 * idx->bw + MI_TRACE_GRID - 1) /
+                         MI_TRACE_GRID, 1);
+    idx->cellHeight = max((idx->height + 2 * idx->bw + MI_TRACE_GRID - 1) /
+                          MI_TRACE_GRID, 1);
+    idx->numEntries = n;
+
+    for (n = 0, pChild = pParent->firstChild; pChild;
+         n++, pChild = pChild->nextSib) {
+        idx->entries[n].pWin = pChild;
+        idx->entries[n].rank = n * MI_TRACE_RANK_GAP;
+        miTraceChildBox(pChild, &idx->entries[n].box);
+        miTraceGetWindow(pChild)->slot = n;
+        if (!miTraceIndexAdd(idx, n)) {
+            miTraceIndexFree(idx);
+            return NULL;
+        }
+    }
+    return idx;
+}
+
+static void
+miTraceIndexDrop(WindowPtr pParent)
+{
+    miTraceWindowPtr pTrace = miTraceGetWindow(pParent);
+
+    miTraceIndexFree(pTrace->index);
+    pTrace->index = NULL;
+}
+
+/*
+ * The index over pWin's parent, if there is one and it can be updated
+ * in place.
+ */
+static miTraceIndexPtr
+miTraceParentIndex(WindowPtr pWin)
+{
+    miTraceIndexPtr idx;
+
+    if (!pWin->parent || !dixPrivateKeyRegistered(&miTraceWindowKeyRec))
+        return NULL;
+    idx = miTraceGetWindow(pWin->parent)->index;
+    if (!idx || idx == &miTraceTooFew)
+        return NULL;
+    if (miTraceIndexStale(idx, pWin->parent)) {
+        /* let the next trace lay out the grid again */
+        miTraceIndexDrop(pWin->parent);
+        return NULL;
+    }
+    return idx;
+}
+
+static miTraceEntryPtr
+miTraceLookupEntry(miTraceIndexPtr idx, WindowPtr pWin)
+{
+    int slot = miTraceGetWindow(pWin)->slot;
+
+    if (slot < idx->numEntries && idx->entries[slot].pWin == pWin)
+        return &idx->entries[slot];
+    return NULL;
+}
+
+/*
+ * Bring pWin's entry in its parent's index up to date after its position,
+ * size or border width changed.
+ */
+void
+miSpriteTraceUpdate(WindowPtr pWin)
+{
+    miTraceIndexPtr idx = miTraceParentIndex(pWin);
+    miTraceEntryPtr entry;
+    miTraceBoxRec box;
+
+    if (!idx)
+        return;
+    if (!(entry = miTraceLookupEntry(idx, pWin))) {
+        /* not linked in yet, miSpriteTraceRestack will add it */
+        return;
+    }
+    miTraceChildBox(pWin, &box);
+    if (!memcmp(&box, &entry->box, sizeof(box)))
+        return;
+    miTraceIndexRemove(idx, entry - idx->entries);
+    entry->box = box;
+    if (!miTraceIndexAdd(idx, entry - idx->entries))
+        miTraceIndexDrop(pWin->parent);
+}
+
+/*
+ * pWin has been linked into its parent's child list, or moved within it.
+ */
+void
+miSpriteTraceRestack(WindowPtr pWin)
+{
+    miTraceIndexPtr idx;
+    miTraceEntryPtr entry, above = NULL, below = NULL;
+    int id, rank;
+
+    if (!pWin->parent || !dixPrivateKeyRegistered(&miTraceWindowKeyRec))
+        return;
+    if (miTraceGetWindow(pWin->parent)->index == &miTraceTooFew) {
+        /* there may be enough children now, count them again */
+        miTraceIndexDrop(pWin->parent);
+        return;
+    }
+    if (!(idx = miTraceParentIndex(pWin)))
+        return;
+    if ((pWin->prevSib && !(above = miTraceLookupEntry(idx, pWin->prevSib))) ||
+        (pWin->nextSib && !(below = miTraceLookupEntry(idx, pWin->nextSib))))
+        goto drop;
+
+    if (!above)
+        rank = below ? below->rank - MI_TRACE_RANK_GAP : 0;
+    else if (!below)
+        rank = above->rank + MI_TRACE_RANK_GAP;
+    else if (below->rank - above->rank > 1)
+        rank = above->rank + (below->rank - above->rank) / 2;
+    else
+        goto drop;
+    if (rank < INT_MIN / 2 || rank > INT_MAX / 2)
+        goto drop;
+
+    if ((entry = miTraceLookupEntry(idx, pWin)))
+        miTraceIndexRemove(idx, entry - idx->entries);
+    else {
+        if (idx->numEntries == idx->sizeEntries) {
+            int size = idx->sizeEntries * 2;
+            miTraceEntryPtr entries = reallocarray(idx->entries, size,
+                                                   sizeof(miTraceEntryRec));
+
+            if (!entries)
+                goto drop;
+            idx->entries = entries;
+            idx->sizeEntries = size;
+        }
+        entry = &idx->entries[idx->numEntries++];
+        entry->pWin = pWin;
+        miTraceChildBox(pWin, &entry->box);
+        miTraceGetWindow(pWin)->slot = entry - idx->entries;
+    }
+    id = entry - idx->entries;
+    entry->rank = rank;
+    if (miTraceIndexAdd(idx, id))
+        return;
+
+ drop:
+    miTraceIndexDrop(pWin->parent);
+}
+
+/*
+ * pWin is about to be unlinked from its parent's child list.
+ */
+void
+miSpriteTraceRemove(WindowPtr pWin)
+{
+    miTraceIndexPtr idx = miTraceParentIndex(pWin);
+    miTraceEntryPtr entry;
+
+    if (!idx || !(entry = miTraceLookupEntry(idx, pWin)))
+        return;
+    miTraceIndexRemove(idx, entry - idx->entries);
+    entry->pWin = NULL;
+    if (++idx->numFree > idx->numEntries / 2)
+        miTraceIndexDrop(pWin->parent);
+}
+
+/*
+ * pWin is being destroyed: take it out of its parent's index and free the
+ * index over its own children.
+ */
+void
+miSpriteTraceDestroy(WindowPtr pWin)
+{
+    if (!dixPrivateKeyRegistered(&miTraceWindowKeyRec))
+        return;
+    miSpriteTraceRemove(pWin);
+    miTraceIndexDrop(pWin);
+}
+
+static miTraceIndexPtr
+miTraceGetIndex(WindowPtr pParent)
+{
+    miTraceWindowPtr pTrace;
+
+    if (!dixPrivateKeyRegistered(&miTraceWindowKeyRec))
+        return NULL;
+    pTrace = miTraceGetWindow(pParent);
+    if (pTrace->index && pTrace->index != &miTraceTooFew &&
+        miTraceIndexStale(pTrace->index, pParent))
+        miTraceIndexDrop(pParent);
+    if (!pTrace->index)
+        pTrace->index = miTraceIndexBuild(pParent);
+    return pTrace->index == &miTraceTooFew ? NULL : pTrace->index;
+}
+
+static Bool
+miSpriteHit(WindowPtr pWin, int x, int y)
 {
-    WindowPtr pWin;
     BoxRec box;
 
-    pWin = DeepestSpriteWin(pSprite)->firstChild;
-    while (pWin) {
-        if ((pWin->mapped) &&
-            (x >= pWin->drawable.x - wBorderWidth(pWin)) &&
-            (x < pWin->drawable.x + (int) pWin->drawable.width +
-             wBorderWidth(pWin)) &&
-            (y >= pWin->drawable.y - wBorderWidth(pWin)) &&
-            (y < pWin->drawable.y + (int) pWin->drawable.height +
-             wBorderWidth(pWin))
-            /* When a window is shaped, a further check
-             * is made to see if the point is inside
-             * borderSize
-             */
-            && (!wBoundingShape(pWin) || PointInBorderSize(pWin, x, y))
-            && (!wInputShape(pWin) ||
-                RegionContainsPoint(wInputShape(pWin),
-                                    x - pWin->drawable.x,
-                                    y - pWin->drawable.y, &box))
-            /* In rootless mode windows may be offscreen, even when
-             * they're in X's stack. (E.g. if the native window system
-             * implements some form of virtual desktop system).
-             */
-            && !pWin->unhittable) {
-            if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
-                pSprite->spriteTraceSize += 10;
-                pSprite->spriteTrace = reallocarray(pSprite->spriteTrace,
-                                                    pSprite->spriteTraceSize,
-                                                    sizeof(WindowPtr));
+    return (pWin->mapped) &&
+        (x >= pWin->drawable.x - wBorderWidth(pWin)) &&
+        (x < pWin->drawable.x + (int) pWin->drawable.width +
+         wBorderWidth(pWin)) &&
+        (y >= pWin->drawable.y - wBorderWidth(pWin)) &&
+        (y < pWin->drawable.y + (int) pWin->drawable.height +
+         wBorderWidth(pWin))
+        /* When a window is shaped, a further check
+         * is made to see if the point is inside
+         * borderSize
+         */
+        && (!wBoundingShape(pWin) || PointInBorderSize(pWin, x, y))
+        && (!wInputShape(pWin) ||
+            RegionContainsPoint(wInputShape(pWin),
+                                x - pWin->drawable.x,
+                                y - pWin->drawable.y, &box))
+        /* In rootless mode windows may be offscreen, even when
+         * they're in X's stack. (E.g. if the native window system
+         * implements some form of virtual desktop system).
+         */
+        && !pWin->unhittable;
+}
+
+/* topmost child of pParent that takes input at x/y */
+static WindowPtr
+miSpriteTraceChild(WindowPtr pParent, int x, int y)
+{
+    miTraceIndexPtr idx = miTraceGetIndex(pParent);
+    WindowPtr pWin;
+
+    if (idx) {
+        int rx = x - pParent->drawable.x;
+        int ry = y - pParent->drawable.y;
+        int gx = rx + idx->bw;
+        int gy = ry + idx->bw;
+
+        if (gx >= 0 && gx < idx->width + 2 * idx->bw &&
+            gy >= 0 && gy < idx->height + 2 * idx->bw) {
+            miTraceCellPtr cell = &idx->cells[(gy / idx->cellHeight) *
+                                              MI_TRACE_GRID +
+                                              gx / idx->cellWidth];
+            int i;
+
+            for (i = 0; i < cell->num; i++) {
+                miTraceEntryPtr entry = &idx->entries[cell->ids[i]];
+
+                if (rx >= entry->box.x1 && rx < entry->box.x2 &&
+                    ry >= entry->box.y1 && ry < entry->box.y2 &&
+                    miSpriteHit(entry->pWin, x, y))
+                    return entry->pWin;
             }
-            pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
-            pWin = pWin->firstChild;
+            return NullWindow;
         }
-        else
-            pWin = pWin->nextSib;
+    }
+
+    for (pWin = pParent->firstChild; pWin; pWin = pWin->nextSib)
+        if (miSpriteHit(pWin, x, y))
+            return pWin;
+    return NullWindow;
+}
+
+WindowPtr
+miSpriteTrace(SpritePtr pSprite, int x, int y)
+{
+    WindowPtr pWin = DeepestSpriteWin(pSprite);
+
+    while ((pWin = miSpriteTraceChild(pWin, x, y))) {
+        if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
+            pSprite->spriteTraceSize += 10;
+            pSprite->spriteTrace = reallocarray(pSprite->spriteTrace,
+                                                pSprite->spriteTraceSize,
+                                                sizeof(WindowPtr));
+        }
+        pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
     }
     return DeepestSpriteWin(pSprite);
 }
@@ -47,10 +47,21 @@ struct _SyncObject {
     Bool beingDestroyed;        /* in process of going away */
 };
 
+/* Number of counter test types, XSyncPositiveTransition .. XSyncNegativeComparison */
+#define SYNC_NUM_TEST_TYPES	4
+
+/* A counter's triggers of one test type, sorted by test value */
+typedef struct _SyncTriggerIndex {
+    struct _SyncTriggerKey *keys;
+    int num;
+    int size;
+} SyncTriggerIndex;
+
 typedef struct _SyncCounter {
     SyncObject sync;            /* Common sync object data */
     int64_t value;              /* counter value */
     struct _SysCounterInfo *pSysCounterInfo; /* NULL if not a system counter */
+    SyncTriggerIndex triggers[SYNC_NUM_TEST_TYPES]; /* by test type */
 } SyncCounter;
 
 struct _SyncFence {
@@ -71,6 +82,8 @@ struct _SyncTrigger {
                          int64_t newval);
     void (*TriggerFired)(struct _SyncTrigger *pTrigger);
     void (*CounterDestroyed)(struct _SyncTrigger *pTrigger);
+    int indexed_type;           /* test type filed under in the counter, or -1 */
+    int64_t indexed_value;      /* test value filed under in the counter */
 };
 
 typedef struct _SyncTriggerList {
@@ -191,6 +191,8 @@ Bool noGEExtension = FALSE;
 Bool CoreDump;
 
 Bool enableIndirectGLX = TRUE;
+Bool enableIndirectGLXThread = FALSE;
+Bool enableIndirectGLXProfile = FALSE;
 
 #ifdef PANORAMIX
 Bool PanoramiXExtensionDisabledHack = FALSE;
@@ -567,6 +569,10 @@ UseMsg(void)
     ErrorF("-help                  prints message with these options\n");
     ErrorF("+iglx                  Allow creating indirect GLX contexts (default)\n");
     ErrorF("-iglx                  Prohibit creating indirect GLX contexts\n");
+    ErrorF("+iglxthread            Render indirect GLX on a separate thread\n");
+    ErrorF("-iglxthread            Render indirect GLX on the server thread (default)\n");
+    ErrorF("+iglxprofile           Count requests per indirect GLX context\n");
+    ErrorF("-iglxprofile           Don't count indirect GLX requests (default)\n");
     ErrorF("-I                     ignore all remaining arguments\n");
 #ifdef RLIMIT_DATA
     ErrorF("-ld int                limit data space to N Kb\n");
@@ -597,6 +603,7 @@ UseMsg(void)
     ErrorF("-terminate [delay]     terminate at server reset (optional delay in sec)\n");
     ErrorF("-tst                   disable testing extensions\n");
     ErrorF("-wr                    create root window with white background\n");
+    ErrorF("-workers int           number of threads for large image transfers\n");
 #ifdef PANORAMIX
     ErrorF("+xinerama              Enable XINERAMA extension\n");
     ErrorF("-xinerama              Disable XINERAMA extension\n");
@@ -840,6 +847,14 @@ ProcessCommandLine(int argc, char *argv[])
             enableIndirectGLX = TRUE;
         else if (strcmp(argv[i], "-iglx") == 0)
             enableIndirectGLX = FALSE;
+        else if (strcmp(argv[i], "+iglxthread") == 0)
+            enableIndirectGLXThread = TRUE;
+        else if (strcmp(argv[i], "-iglxthread") == 0)
+            enableIndirectGLXThread = FALSE;
+        else if (strcmp(argv[i], "+iglxprofile") == 0)
+            enableIndirectGLXProfile = TRUE;
+        else if (strcmp(argv[i], "-iglxprofile") == 0)
+            enableIndirectGLXProfile = FALSE;
         else if ((skip = XkbProcessArguments(argc, argv, i)) != 0) {
             if (skip > 0)
                 i += skip - 1;
@@ -1030,6 +1045,12 @@ ProcessCommandLine(int argc, char *argv[])
             SmartScheduleSignalEnable = FALSE;
 #endif
         }
+        else if (strcmp(argv[i], "-workers") == 0) {
+            if (++i < argc)
+                WorkerPoolSize = atoi(argv[i]);
+            else
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-schedInterval") == 0) {
             if (++i < argc) {
                 SmartScheduleInterval = atoi(argv[i]);
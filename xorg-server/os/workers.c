@@ -0,0 +1,228 @@
+/* workers.c -- Worker threads for splitting up large operations.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "os.h"
+
+/* Number of worker threads, set with -workers.  -1 picks one less than the
+ * number of CPUs, up to MAX_WORKERS; 0 runs all jobs on the calling thread.
+ */
+int WorkerPoolSize = -1;
+
+#if INPUTTHREAD
+
+#include <pthread.h>
+
+#define MAX_WORKERS 7
+
+/**
+ * The worker pool.  The threads are started the first time there is work
+ * to share, and wait on the work condition between batches.  Only one
+ * batch runs at a time; the thread that submitted it works on it too.
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    pthread_t threads[MAX_WORKERS];
+    int numThreads;
+    Bool started;
+    Bool exiting;
+    Bool busy;
+    WorkerProcPtr proc;
+    void *data;
+    int numJobs;
+    int nextJob;
+    int jobsDone;
+} workerPool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+/* run jobs of the current batch until there are none left; called and
+ * returns with the lock held
+ */
+static void
+WorkerPoolRunJobs(void)
+{
+    while (workerPool.nextJob < workerPool.numJobs) {
+        int job = workerPool.nextJob++;
+
+        pthread_mutex_unlock(&workerPool.lock);
+        (*workerPool.proc) (workerPool.data, job);
+        pthread_mutex_lock(&workerPool.lock);
+        if (++workerPool.jobsDone == workerPool.numJobs)
+            pthread_cond_signal(&workerPool.done);
+    }
+}
+
+static void *
+WorkerPoolDoWork(void *arg)
+{
+#ifdef SIG_BLOCK
+    sigset_t set;
+
+    /* Don't handle any signals on this thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+#endif
+
+#if defined(HAVE_PTHREAD_SETNAME_NP_WITH_TID)
+    pthread_setname_np (pthread_self(), "WorkerThread");
+#elif defined(HAVE_PTHREAD_SETNAME_NP_WITHOUT_TID)
+    pthread_setname_np ("WorkerThread");
+#endif
+
+    pthread_mutex_lock(&workerPool.lock);
+    while (!workerPool.exiting) {
+        WorkerPoolRunJobs();
+        pthread_cond_wait(&workerPool.work, &workerPool.lock);
+    }
+    pthread_mutex_unlock(&workerPool.lock);
+    return NULL;
+}
+
+static void
+WorkerPoolStart(void)
+{
+    int n = WorkerPoolSize;
+
+    workerPool.started = TRUE;
+    if (n < 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        n = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+#else
+        n = 0;
+#endif
+    }
+    if (n > MAX_WORKERS)
+        n = MAX_WORKERS;
+
+    for (workerPool.numThreads = 0; workerPool.numThreads < n;
+         workerPool.numThreads++) {
+        if (pthread_create(&workerPool.threads[workerPool.numThreads], NULL,
+                           WorkerPoolDoWork, NULL) != 0) {
+            ErrorF("workers: could only start %d of %d threads\n",
+                   workerPool.numThreads, n);
+            break;
+        }
+    }
+}
+
+/**
+ * The number of threads jobs submitted with WorkerPoolRun() are spread
+ * over, including the submitting thread.  Worth splitting work into at
+ * least this many jobs.
+ */
+int
+WorkerPoolThreads(void)
+{
+    if (!workerPool.started)
+        WorkerPoolStart();
+    return workerPool.numThreads + 1;
+}
+
+/**
+ * Call proc(data, job) for each job from 0 to numJobs - 1, spread over the
+ * worker threads and the calling thread, and return once all of them have
+ * finished.  Jobs may run in any order and at the same time, so they must
+ * not touch server state beyond what data points them at.
+ */
+void
+WorkerPoolRun(WorkerProcPtr proc, void *data, int numJobs)
+{
+    int job;
+
+    if (WorkerPoolThreads() == 1 || numJobs < 2)
+        goto serial;
+
+    pthread_mutex_lock(&workerPool.lock);
+    if (workerPool.busy) {
+        /* called from a job */
+        pthread_mutex_unlock(&workerPool.lock);
+        goto serial;
+    }
+    workerPool.busy = TRUE;
+    workerPool.proc = proc;
+    workerPool.data = data;
+    workerPool.numJobs = numJobs;
+    workerPool.nextJob = 0;
+    workerPool.jobsDone = 0;
+    pthread_cond_broadcast(&workerPool.work);
+
+    WorkerPoolRunJobs();
+    while (workerPool.jobsDone < workerPool.numJobs)
+        pthread_cond_wait(&workerPool.done, &workerPool.lock);
+    workerPool.busy = FALSE;
+    pthread_mutex_unlock(&workerPool.lock);
+    return;
+
+ serial:
+    for (job = 0; job < numJobs; job++)
+        (*proc) (data, job);
+}
+
+/**
+ * Stop the worker threads
+ *
+ * This function is supposed to be called at server shutdown time only.
+ */
+void
+WorkerPoolFini(void)
+{
+    int i;
+
+    pthread_mutex_lock(&workerPool.lock);
+    workerPool.exiting = TRUE;
+    pthread_cond_broadcast(&workerPool.work);
+    pthread_mutex_unlock(&workerPool.lock);
+
+    for (i = 0; i < workerPool.numThreads; i++)
+        pthread_join(workerPool.threads[i], NULL);
+
+    workerPool.numThreads = 0;
+    workerPool.started = FALSE;
+    workerPool.exiting = FALSE;
+}
+
+#else /* INPUTTHREAD */
+
+int WorkerPoolThreads(void) { return 1; }
+
+void WorkerPoolRun(WorkerProcPtr proc, void *data, int numJobs)
+{
+    int job;
+
+    for (job = 0; job < numJobs; job++)
+        (*proc) (data, job);
+}
+
+void WorkerPoolFini(void) {}
+
+#endif /* INPUTTHREAD */
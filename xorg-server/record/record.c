@@ -49,6 +49,12 @@ and Jim Haggerty of Metheus.
 #include <stdio.h>
 #include <assert.h>
 
+#ifdef MITSHM
+#include <X11/extensions/shmproto.h>
+#include "shmint.h"
+#include "list.h"
+#endif
+
 #ifdef PANORAMIX
 #include "globals.h"
 #include "panoramiX.h"
@@ -78,8 +84,55 @@ typedef struct {
     int numBufBytes;            /* number of bytes in replyBuffer */
     char replyBuffer[REPLY_BUF_SIZE];   /* buffered recorded protocol */
     int inFlush;                /*  are we inside RecordFlushReplyBuffer */
+    struct _RecordRing *pRing;  /* shared memory ring replacing the reply
+                                   stream, if enabled with EnableContextShm */
 } RecordContextRec, *RecordContextPtr;
 
+#ifdef MITSHM
+/*  Shared memory transport, new in RECORD 1.14.
+ *
+ *  EnableContextShm enables a context like EnableContext, but the byte
+ *  stream EnableContext would have sent to the recording client, from
+ *  StartOfData through EndOfData, is written into a ring in an MIT-SHM
+ *  segment (attached with ShmAttach or ShmAttachFd) instead.  The
+ *  connection only carries RingData replies, telling the client how far
+ *  the ring has been filled, and a final EndOfData reply once everything
+ *  is in the ring.  RingData replies are batched: one is sent before the
+ *  server sleeps if the ring has advanced, and another whenever notifyBytes
+ *  (if not zero) bytes have gone unannounced.
+ *
+ *  The ring is an xRecordRingHeader at offset in the segment followed by
+ *  size bytes of data.  head and tail count the bytes written by the server
+ *  and consumed by the client, modulo 2^32; byte n of the stream is at
+ *  data[n % size].  Unconsumed data is never overwritten: what doesn't fit
+ *  is held by the server until the client advances tail.
+ */
+
+/* how long to wait before retrying when the ring is full, in ms */
+#define RING_RETRY_DELAY 5
+
+typedef struct _RecordRing {
+    RecordContextPtr pContext;  /* enabled context, NULL once disabled */
+    ClientPtr pClient;          /* recording client */
+    ShmDescPtr pShmDesc;        /* segment holding the ring */
+    xRecordRingHeader *pHeader; /* ring header in the segment */
+    char *pData;                /* ring data in the segment */
+    CARD32 size;                /* bytes of ring data */
+    CARD32 head;                /* bytes written to the ring */
+    CARD32 notified;            /* head at the last notification */
+    CARD32 notifyBytes;         /* notify after this many new bytes */
+    char *pBacklog;             /* data waiting for room in the ring */
+    int numBacklogBytes;
+    int sizeBacklog;
+    struct xorg_list entry;     /* on drainingRings once disabled */
+} RecordRingRec, *RecordRingPtr;
+
+/* rings of disabled contexts still holding data the client hasn't had room
+ * for; their EndOfData is sent once the data is in the ring.
+ */
+static struct xorg_list drainingRings;
+#endif
+
 /*  RecordMinorOpRec - to hold minor opcode selections for extension requests
  *  and replies
  */
@@ -213,6 +266,162 @@ RecordFindContextOnAllContexts(RecordContextPtr pContext)
 
 /***************************************************************************/
 
+#ifdef MITSHM
+/* RecordRingCopy
+ *
+ * Arguments:
+ *	pRing is the ring to write to.
+ *	data is a pointer to the data, and len is its length in bytes.
+ *
+ * Returns: the number of bytes copied into the ring.
+ *
+ * Side Effects:
+ *	As much of the data as the client has made room for is copied into
+ *	the ring, and the ring's head is advanced past it.
+ */
+static int
+RecordRingCopy(RecordRingPtr pRing, const char *data, int len)
+{
+    CARD32 tail = __atomic_load_n(&pRing->pHeader->tail, __ATOMIC_ACQUIRE);
+    CARD32 room = pRing->size - (pRing->head - tail);
+    CARD32 pos = pRing->head % pRing->size;
+    int n, first;
+
+    /* a tail that isn't within size bytes behind head is garbage */
+    if (room > pRing->size)
+        return 0;
+    n = min(len, room);
+    if (!n)
+        return 0;
+    first = min(n, pRing->size - pos);
+    memcpy(pRing->pData + pos, data, first);
+    memcpy(pRing->pData, data + first, n - first);
+    pRing->head += n;
+    __atomic_store_n(&pRing->pHeader->head, pRing->head, __ATOMIC_RELEASE);
+    return n;
+}                               /* RecordRingCopy */
+
+/* RecordRingAppend
+ *
+ * Arguments:
+ *	pRing is the ring to write to.
+ *	data is a pointer to the data, and len is its length in bytes.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	The data is copied into the ring, behind any data already waiting for
+ *	room.  What doesn't fit is appended to the ring's backlog.  If the
+ *	backlog can't grow, the recording client is disconnected, as it
+ *	would be if WriteToClient failed to buffer the data.
+ */
+static void
+RecordRingAppend(RecordRingPtr pRing, const char *data, int len)
+{
+    int n = 0;
+
+    if (!pRing->numBacklogBytes)
+        n = RecordRingCopy(pRing, data, len);
+    if (n == len)
+        return;
+
+    if (pRing->numBacklogBytes + len - n > pRing->sizeBacklog) {
+        int size = max(pRing->sizeBacklog * 2,
+                       pRing->numBacklogBytes + len - n);
+        char *pBacklog = realloc(pRing->pBacklog, size);
+
+        if (!pBacklog) {
+            MarkClientException(pRing->pClient);
+            return;
+        }
+        pRing->pBacklog = pBacklog;
+        pRing->sizeBacklog = size;
+    }
+    memcpy(pRing->pBacklog + pRing->numBacklogBytes, data + n, len - n);
+    pRing->numBacklogBytes += len - n;
+}                               /* RecordRingAppend */
+
+/* RecordRingDrain
+ *
+ * Arguments:
+ *	pRing is the ring to write to.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	As much of the ring's backlog as the client has made room for is
+ *	moved into the ring.
+ */
+static void
+RecordRingDrain(RecordRingPtr pRing)
+{
+    int n;
+
+    if (!pRing->numBacklogBytes)
+        return;
+    n = RecordRingCopy(pRing, pRing->pBacklog, pRing->numBacklogBytes);
+    pRing->numBacklogBytes -= n;
+    memmove(pRing->pBacklog, pRing->pBacklog + n, pRing->numBacklogBytes);
+}                               /* RecordRingDrain */
+
+/* RecordRingNotify
+ *
+ * Arguments:
+ *	pRing is the ring whose client is to be notified.
+ *	category is XRecordRingData or XRecordEndOfData.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	A reply telling how far the ring has been filled is sent to the
+ *	recording client.
+ */
+static void
+RecordRingNotify(RecordRingPtr pRing, int category)
+{
+    xRecordRingNotifyReply rep = {
+        .type = X_Reply,
+        .category = category,
+        .sequenceNumber = pRing->pClient->sequence,
+        .length = 0,
+        .head = pRing->head
+    };
+
+    if (pRing->pClient->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.head);
+    }
+    WriteToClient(pRing->pClient, sizeof(rep), &rep);
+    pRing->notified = pRing->head;
+}                               /* RecordRingNotify */
+
+/* RecordRingWrite
+ *
+ * Arguments:
+ *	pRing is the ring to write to.
+ *	data is a pointer to the data, and len is its length in bytes.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	The data is added to the ring, padded to a multiple of 4 bytes as
+ *	WriteToClient would have.  The client is notified if notifyBytes
+ *	bytes have been written since the last notification.
+ */
+static void
+RecordRingWrite(RecordRingPtr pRing, const void *data, int len)
+{
+    static const char padBuffer[3];     /* as in FlushClient */
+
+    RecordRingAppend(pRing, data, len);
+    RecordRingAppend(pRing, padBuffer, padding_for_int32(len));
+    if (pRing->notifyBytes &&
+        pRing->head - pRing->notified >= pRing->notifyBytes)
+        RecordRingNotify(pRing, XRecordRingData);
+}                               /* RecordRingWrite */
+#endif
+
+
 /* RecordFlushReplyBuffer
  *
  * Arguments:
@@ -227,7 +436,8 @@ RecordFindContextOnAllContexts(RecordContextPtr pContext)
  *	to the recording client, and the number of buffered bytes is set to
  *	zero.  If len1 is not zero, data1/len1 are then written to the
  *	recording client, and similarly for data2/len2 (written after
- *	data1/len1).
+ *	data1/len1).  For a context enabled with EnableContextShm, all of
+ *	this is written to the context's ring instead.
  */
 static void
 RecordFlushReplyBuffer(RecordContextPtr pContext,
@@ -237,6 +447,20 @@ RecordFlushReplyBuffer(RecordContextPtr pContext,
         pContext->inFlush)
         return;
     ++pContext->inFlush;
+#ifdef MITSHM
+    if (pContext->pRing) {
+        if (pContext->numBufBytes)
+            RecordRingWrite(pContext->pRing, pContext->replyBuffer,
+                            pContext->numBufBytes);
+        pContext->numBufBytes = 0;
+        if (len1)
+            RecordRingWrite(pContext->pRing, data1, len1);
+        if (len2)
+            RecordRingWrite(pContext->pRing, data2, len2);
+        --pContext->inFlush;
+        return;
+    }
+#endif
     if (pContext->numBufBytes)
         WriteToClient(pContext->pRecordingClient, pContext->numBufBytes,
                       pContext->replyBuffer);
@@ -807,7 +1031,8 @@ RecordADeviceEvent(CallbackListPtr *pcbl, void *nulldata, void *calldata)
  *
  * Side Effects:
  *	All buffered reply data of all enabled contexts is written to
- *	the recording clients.
+ *	the recording clients.  Contexts writing to a ring are flushed by
+ *	RecordRingBlockHandler instead, which also notifies their clients.
  */
 static void
 RecordFlushAllContexts(CallbackListPtr *pcbl,
@@ -824,7 +1049,7 @@ RecordFlushAllContexts(CallbackListPtr *pcbl,
          * check before calling hoping to save the function call cost
          * most of the time.
          */
-        if (pContext->numBufBytes)
+        if (pContext->numBufBytes && !pContext->pRing)
             RecordFlushReplyBuffer(ppAllContexts[eci], NULL, 0, NULL, 0);
     }
 }                               /* RecordFlushAllContexts */
@@ -1825,6 +2050,9 @@ ProcRecordQueryVersion(ClientPtr client)
     rep.length = 0;
     rep.majorVersion = SERVER_RECORD_MAJOR_VERSION;
     rep.minorVersion = SERVER_RECORD_MINOR_VERSION;
+#ifndef MITSHM
+    rep.minorVersion = 13;      /* no EnableContextShm */
+#endif
     if (client->swapped) {
         swaps(&rep.sequenceNumber);
         swaps(&rep.majorVersion);
@@ -1866,6 +2094,7 @@ ProcRecordCreateContext(ClientPtr client)
     pContext->pBufClient = NULL;
     pContext->continuedReply = 0;
     pContext->inFlush = 0;
+    pContext->pRing = NULL;
 
     err = RecordRegisterClients(pContext, client,
                                 (xRecordRegisterClientsReq *) stuff);
@@ -2274,20 +2503,27 @@ ProcRecordGetContext(ClientPtr client)
     return err;
 }                               /* ProcRecordGetContext */
 
+/* RecordEnableContext
+ *
+ * Arguments:
+ *	client is the client enabling the context, which becomes its
+ *	  recording client.
+ *	pContext is the disabled context to enable.
+ *
+ * Returns: BadAlloc if a memory allocation error occurred, else Success.
+ *
+ * Side Effects:
+ *	Recording hooks for the context are installed, request processing
+ *	on the recording client is suspended, the context is moved to the
+ *	front part of the ppAllContexts array and a StartOfData message is
+ *	sent to the recording client.
+ */
 static int
-ProcRecordEnableContext(ClientPtr client)
+RecordEnableContext(ClientPtr client, RecordContextPtr pContext)
 {
-    RecordContextPtr pContext;
-
-    REQUEST(xRecordEnableContextReq);
     int i;
     RecordClientsAndProtocolPtr pRCAP;
 
-    REQUEST_SIZE_MATCH(xRecordGetContextReq);
-    VERIFY_CONTEXT(pContext, stuff->context, client);
-    if (pContext->pRecordingClient)
-        return BadMatch;        /* already enabled */
-
     /* install record hooks for each RCAP */
 
     for (pRCAP = pContext->pListOfRCAP; pRCAP; pRCAP = pRCAP->pNextRCAP) {
@@ -2332,8 +2568,185 @@ ProcRecordEnableContext(ClientPtr client)
     RecordAProtocolElement(pContext, NULL, XRecordStartOfData, NULL, 0, 0, 0);
     RecordFlushReplyBuffer(pContext, NULL, 0, NULL, 0);
     return Success;
+}                               /* RecordEnableContext */
+
+static int
+ProcRecordEnableContext(ClientPtr client)
+{
+    RecordContextPtr pContext;
+
+    REQUEST(xRecordEnableContextReq);
+
+    REQUEST_SIZE_MATCH(xRecordGetContextReq);
+    VERIFY_CONTEXT(pContext, stuff->context, client);
+    if (pContext->pRecordingClient)
+        return BadMatch;        /* already enabled */
+
+    return RecordEnableContext(client, pContext);
 }                               /* ProcRecordEnableContext */
 
+#ifdef MITSHM
+static void RecordRingBlockHandler(void *data, void *timeout);
+static void RecordRingWakeupHandler(void *data, int result);
+
+/* RecordRingFree
+ *
+ * Arguments:
+ *	pRing is the ring to free.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	The ring's block handler is removed, its reference on the segment
+ *	is dropped, and its memory is freed.
+ */
+static void
+RecordRingFree(RecordRingPtr pRing)
+{
+    RemoveBlockAndWakeupHandlers(RecordRingBlockHandler,
+                                 RecordRingWakeupHandler, pRing);
+    ShmReleaseSegment(pRing->pShmDesc);
+    free(pRing->pBacklog);
+    free(pRing);
+}                               /* RecordRingFree */
+
+/* RecordRingEnd
+ *
+ * Arguments:
+ *	pRing is the ring of a context that has been disabled, with its
+ *	  EndOfData already written.
+ *
+ * Returns: TRUE if the ring is still waiting for room, FALSE if it has
+ *	been freed.
+ *
+ * Side Effects:
+ *	If all the data is in the ring, an EndOfData reply is sent to the
+ *	recording client, request processing on it is resumed and the ring
+ *	is freed.  Otherwise the ring is put on drainingRings to wait for
+ *	the client to make room for the rest.
+ */
+static Bool
+RecordRingEnd(RecordRingPtr pRing)
+{
+    pRing->pContext = NULL;
+    if (!pRing->pClient->clientGone &&
+        pRing->pClient->clientState == ClientStateRunning) {
+        RecordRingDrain(pRing);
+        if (pRing->numBacklogBytes) {
+            xorg_list_append(&pRing->entry, &drainingRings);
+            return TRUE;
+        }
+        RecordRingNotify(pRing, XRecordEndOfData);
+    }
+    AttendClient(pRing->pClient);
+    RecordRingFree(pRing);
+    return FALSE;
+}                               /* RecordRingEnd */
+
+/* RecordRingBlockHandler
+ *
+ * Arguments:
+ *	data is the ring.
+ *	timeout is the time the server is going to wait for.
+ *
+ * Returns: nothing.
+ *
+ * Side Effects:
+ *	Before the server sleeps, buffered protocol of the ring's context
+ *	and as much of the backlog as fits are written to the ring, and the
+ *	client is notified if the ring has advanced.  While data is waiting
+ *	for room, the server wakes up every RING_RETRY_DELAY ms to retry.
+ *	This goes on after the context is disabled until the EndOfData
+ *	reply can be sent.
+ */
+static void
+RecordRingBlockHandler(void *data, void *timeout)
+{
+    RecordRingPtr pRing = data;
+
+    if (pRing->pContext && pRing->pContext->numBufBytes)
+        RecordFlushReplyBuffer(pRing->pContext, NULL, 0, NULL, 0);
+
+    if (!pRing->pContext) {
+        xorg_list_del(&pRing->entry);
+        if (!RecordRingEnd(pRing))
+            return;
+    }
+    else
+        RecordRingDrain(pRing);
+
+    if (pRing->head != pRing->notified)
+        RecordRingNotify(pRing, XRecordRingData);
+    if (pRing->numBacklogBytes)
+        AdjustWaitForDelay(timeout, RING_RETRY_DELAY);
+}                               /* RecordRingBlockHandler */
+
+static void
+RecordRingWakeupHandler(void *data, int result)
+{
+}                               /* RecordRingWakeupHandler */
+
+static int
+ProcRecordEnableContextShm(ClientPtr client)
+{
+    RecordContextPtr pContext;
+    RecordRingPtr pRing;
+    ShmDescPtr shmdesc;
+    int rc;
+
+    REQUEST(xRecordEnableContextShmReq);
+
+    REQUEST_SIZE_MATCH(xRecordEnableContextShmReq);
+    VERIFY_CONTEXT(pContext, stuff->context, client);
+    if (pContext->pRecordingClient)
+        return BadMatch;        /* already enabled */
+
+    rc = dixLookupResourceByType((void **) &shmdesc, stuff->shmseg,
+                                 ShmSegType, client, DixWriteAccess);
+    if (rc != Success)
+        return rc;
+    if (!shmdesc->writable)
+        return BadAccess;
+    if ((stuff->offset & 3) || !stuff->size || (stuff->size & 3) ||
+        stuff->size > INT_MAX ||
+        (unsigned long) stuff->offset + sz_xRecordRingHeader + stuff->size >
+        shmdesc->size) {
+        client->errorValue = stuff->size;
+        return BadValue;
+    }
+
+    pRing = calloc(1, sizeof(RecordRingRec));
+    if (!pRing)
+        return BadAlloc;
+    if (!RegisterBlockAndWakeupHandlers(RecordRingBlockHandler,
+                                        RecordRingWakeupHandler, pRing)) {
+        free(pRing);
+        return BadAlloc;
+    }
+    ShmReferenceSegment(shmdesc);
+    pRing->pContext = pContext;
+    pRing->pClient = client;
+    pRing->pShmDesc = shmdesc;
+    pRing->pHeader = (xRecordRingHeader *) (shmdesc->addr + stuff->offset);
+    pRing->pData = (char *) pRing->pHeader + sz_xRecordRingHeader;
+    pRing->size = stuff->size;
+    pRing->notifyBytes = stuff->notifyBytes;
+    xorg_list_init(&pRing->entry);
+
+    pRing->pHeader->size = pRing->size;
+    pRing->pHeader->tail = 0;
+    __atomic_store_n(&pRing->pHeader->head, 0, __ATOMIC_RELEASE);
+
+    pContext->pRing = pRing;
+    rc = RecordEnableContext(client, pContext);
+    if (rc != Success) {
+        pContext->pRing = NULL;
+        RecordRingFree(pRing);
+    }
+    return rc;
+}                               /* ProcRecordEnableContextShm */
+#endif
+
 /* RecordDisableContext
  *
  * Arguments:
@@ -2348,7 +2761,8 @@ ProcRecordEnableContext(ClientPtr client)
  *	this context are uninstalled.  The context is moved to the
  *	rear part of the ppAllContexts array.  numEnabledContexts is
  *	decremented.  Request processing for the formerly recording client
- *	is resumed.
+ *	is resumed, for a context writing to a ring once the client has
+ *	made room for all the data.
  */
 static void
 RecordDisableContext(RecordContextPtr pContext)
@@ -2362,6 +2776,14 @@ RecordDisableContext(RecordContextPtr pContext)
         RecordAProtocolElement(pContext, NULL, XRecordEndOfData, NULL, 0, 0, 0);
         RecordFlushReplyBuffer(pContext, NULL, 0, NULL, 0);
     }
+#ifdef MITSHM
+    /* Request processing resumes once the client has all the data. */
+    if (pContext->pRing) {
+        RecordRingEnd(pContext->pRing);
+        pContext->pRing = NULL;
+    }
+    else
+#endif
     /* Re-enable request processing on this connection. */
     AttendClient(pContext->pRecordingClient);
 
@@ -2481,6 +2903,10 @@ ProcRecordDispatch(ClientPtr client)
         return ProcRecordDisableContext(client);
     case X_RecordFreeContext:
         return ProcRecordFreeContext(client);
+#ifdef MITSHM
+    case X_RecordEnableContextShm:
+        return ProcRecordEnableContextShm(client);
+#endif
     default:
         return BadRequest;
     }
@@ -2605,6 +3031,23 @@ SProcRecordFreeContext(ClientPtr client)
     return ProcRecordFreeContext(client);
 }                               /* SProcRecordFreeContext */
 
+#ifdef MITSHM
+static int _X_COLD
+SProcRecordEnableContextShm(ClientPtr client)
+{
+    REQUEST(xRecordEnableContextShmReq);
+
+    swaps(&stuff->length);
+    REQUEST_SIZE_MATCH(xRecordEnableContextShmReq);
+    swapl(&stuff->context);
+    swapl(&stuff->shmseg);
+    swapl(&stuff->offset);
+    swapl(&stuff->size);
+    swapl(&stuff->notifyBytes);
+    return ProcRecordEnableContextShm(client);
+}                               /* SProcRecordEnableContextShm */
+#endif
+
 static int _X_COLD
 SProcRecordDispatch(ClientPtr client)
 {
@@ -2627,6 +3070,10 @@ SProcRecordDispatch(ClientPtr client)
         return SProcRecordDisableContext(client);
     case X_RecordFreeContext:
         return SProcRecordFreeContext(client);
+#ifdef MITSHM
+    case X_RecordEnableContextShm:
+        return SProcRecordEnableContextShm(client);
+#endif
     default:
         return BadRequest;
     }
@@ -2727,6 +3174,20 @@ RecordAClientStateChange(CallbackListPtr *pcbl, void *nulldata,
     case ClientStateGone:
     case ClientStateRetained:  /* client disconnected */
 
+#ifdef MITSHM
+        {
+            RecordRingPtr pRing, pNext;
+
+            xorg_list_for_each_entry_safe(pRing, pNext, &drainingRings,
+                                          entry) {
+                if (pRing->pClient == pClient) {
+                    xorg_list_del(&pRing->entry);
+                    RecordRingFree(pRing);
+                }
+            }
+        }
+#endif
+
         /* RecordDisableContext modifies contents of ppAllContexts. */
         if (!(numContextsCopy = numContexts))
             break;
@@ -2801,6 +3262,9 @@ RecordExtensionInit(void)
 
     ppAllContexts = NULL;
     numContexts = numEnabledContexts = numEnabledRCAPs = 0;
+#ifdef MITSHM
+    xorg_list_init(&drainingRings);
+#endif
 
     if (!AddCallback(&ClientStateCallback, RecordAClientStateChange, NULL))
         return;
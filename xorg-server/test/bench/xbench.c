@@ -0,0 +1,943 @@
+/*
+ * Copyright © 2024 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Server benchmark suite, meant to be run against Xvfb through
+ * simple-xinit (see "meson test --benchmark").
+ *
+ * Each workload issues a fixed sequence of requests in rounds of
+ * a few operations followed by a round trip.  The time of every round
+ * gives the latency distribution; the total gives the throughput.  One
+ * JSON object is printed per workload so runs of two builds can be
+ * compared with any JSON tool:
+ *
+ *   {"workload": "fill-rect", "ops": 20000, "ops_per_sec": 123456.7,
+ *    "p50_us": 7.1, "p90_us": 7.9, "p99_us": 12.3, "max_us": 80.2}
+ *
+ * Latencies are per operation, i.e. the round time divided by the number
+ * of operations in the round.  Usage:
+ *
+ *   xbench [-l] [-r rounds] [workload...]
+ *
+ * -l lists the workloads, -r scales the number of rounds, and naming
+ * workloads runs only those.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+#include <xcb/render.h>
+#include <xcb/xtest.h>
+#ifdef HAVE_XCB_GLX
+#include <xcb/glx.h>
+#endif
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+#define TARGET_SIZE     512
+
+struct bench {
+    xcb_connection_t *c;
+    xcb_screen_t *screen;
+    xcb_window_t window;        /* mapped, TARGET_SIZE square */
+    xcb_pixmap_t pixmap;        /* root depth, TARGET_SIZE square */
+    xcb_gcontext_t gc;
+    xcb_render_pictformat_t argb32, a8, rgb24;
+    xcb_render_picture_t dst;   /* on pixmap */
+    xcb_render_picture_t src;   /* argb32, TARGET_SIZE square */
+    xcb_render_glyphset_t glyphs;
+#ifdef HAVE_XCB_GLX
+    xcb_window_t glx_window;    /* double buffered GLX visual */
+    xcb_colormap_t glx_colormap;
+    xcb_glx_context_t glx_context;
+    xcb_glx_context_tag_t glx_tag;
+#endif
+    int skip;                   /* set by setup if the server can't run it */
+    int round;                  /* round being run */
+};
+
+struct workload {
+    const char *name;
+    int ops_per_round;
+    int rounds;
+    void (*setup) (struct bench *b);
+    void (*run) (struct bench *b, int ops);
+    void (*cleanup) (struct bench *b);
+};
+
+static void
+sync_with_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+static double
+now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* round trips */
+
+static void
+run_round_trip(struct bench *b, int ops)
+{
+    int i;
+
+    for (i = 0; i < ops; i++)
+        sync_with_server(b->c);
+}
+
+/* atoms */
+
+static void
+run_atoms(struct bench *b, int ops)
+{
+    xcb_intern_atom_cookie_t cookies[64];
+    char name[64];
+    int i;
+
+    assert(ops <= ARRAY_SIZE(cookies));
+    for (i = 0; i < ops; i++) {
+        int len = snprintf(name, sizeof(name), "XBENCH_ATOM_%d_%d",
+                           b->round, i);
+
+        cookies[i] = xcb_intern_atom(b->c, 0, len, name);
+    }
+    for (i = 0; i < ops; i++) {
+        xcb_intern_atom_reply_t *reply =
+            xcb_intern_atom_reply(b->c, cookies[i], NULL);
+
+        assert(reply && reply->atom != XCB_NONE);
+        free(xcb_get_atom_name_reply(b->c,
+                                     xcb_get_atom_name(b->c, reply->atom),
+                                     NULL));
+        free(reply);
+    }
+}
+
+/* properties */
+
+static uint32_t property_data[256];
+
+static void
+run_properties(struct bench *b, int ops)
+{
+    xcb_get_property_cookie_t cookies[64];
+    int i;
+
+    assert(ops <= ARRAY_SIZE(cookies));
+    for (i = 0; i < ops; i++) {
+        property_data[0] = b->round * ops + i;
+        xcb_change_property(b->c, XCB_PROP_MODE_REPLACE, b->window,
+                            XCB_ATOM_WM_NAME + i % 8, XCB_ATOM_CARDINAL, 32,
+                            ARRAY_SIZE(property_data), property_data);
+        cookies[i] = xcb_get_property(b->c, 0, b->window,
+                                      XCB_ATOM_WM_NAME + i % 8,
+                                      XCB_ATOM_CARDINAL, 0,
+                                      ARRAY_SIZE(property_data));
+    }
+    for (i = 0; i < ops; i++) {
+        xcb_get_property_reply_t *reply =
+            xcb_get_property_reply(b->c, cookies[i], NULL);
+
+        assert(reply);
+        assert(xcb_get_property_value_length(reply) ==
+               sizeof(property_data));
+        free(reply);
+    }
+}
+
+/* windows */
+
+static void
+run_window_churn(struct bench *b, int ops)
+{
+    xcb_window_t windows[64];
+    int i;
+
+    assert(ops <= ARRAY_SIZE(windows));
+    for (i = 0; i < ops; i++) {
+        windows[i] = xcb_generate_id(b->c);
+        xcb_create_window(b->c, XCB_COPY_FROM_PARENT, windows[i], b->window,
+                          (i * 37) % 400, (i * 53) % 400, 100, 80, 1,
+                          XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                          XCB_COPY_FROM_PARENT, 0, NULL);
+        xcb_map_window(b->c, windows[i]);
+    }
+    for (i = 0; i < ops; i++) {
+        uint32_t values[] = { (i * 41) % 400, (i * 29) % 400, 120, 90 };
+
+        xcb_configure_window(b->c, windows[i], XCB_CONFIG_WINDOW_X |
+                             XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH |
+                             XCB_CONFIG_WINDOW_HEIGHT, values);
+    }
+    for (i = 0; i < ops; i++)
+        xcb_destroy_window(b->c, windows[i]);
+}
+
+/* core drawing */
+
+static void
+run_fill_rect(struct bench *b, int ops)
+{
+    int i;
+
+    for (i = 0; i < ops; i++) {
+        xcb_rectangle_t rect = { (i * 7) % 400, (i * 11) % 400, 100, 100 };
+
+        xcb_poly_fill_rectangle(b->c, b->pixmap, b->gc, 1, &rect);
+    }
+}
+
+static void
+run_lines(struct bench *b, int ops)
+{
+    xcb_point_t points[100];
+    int i, j;
+
+    for (i = 0; i < ops; i++) {
+        for (j = 0; j < ARRAY_SIZE(points); j++) {
+            points[j].x = (j * 97 + i * 13) % TARGET_SIZE;
+            points[j].y = (j * 61 + i * 17) % TARGET_SIZE;
+        }
+        xcb_poly_line(b->c, XCB_COORD_MODE_ORIGIN, b->pixmap, b->gc,
+                      ARRAY_SIZE(points), points);
+    }
+}
+
+static void
+run_copy_area(struct bench *b, int ops)
+{
+    int i;
+
+    for (i = 0; i < ops; i++)
+        xcb_copy_area(b->c, b->pixmap, b->window, b->gc,
+                      (i * 7) % 256, (i * 3) % 256, (i * 5) % 256,
+                      (i * 11) % 256, 256, 256);
+}
+
+static void
+run_text(struct bench *b, int ops)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog";
+    int i;
+
+    for (i = 0; i < ops; i++)
+        xcb_image_text_8(b->c, sizeof(text) - 1, b->pixmap, b->gc,
+                         10, 20 + (i * 13) % 480, text);
+}
+
+/* images */
+
+static uint32_t image_data[128 * 128];
+
+static void
+run_put_image(struct bench *b, int ops)
+{
+    int i;
+
+    for (i = 0; i < ops; i++)
+        xcb_put_image(b->c, XCB_IMAGE_FORMAT_Z_PIXMAP, b->pixmap, b->gc,
+                      128, 128, (i * 7) % 384, (i * 5) % 384, 0,
+                      b->screen->root_depth, sizeof(image_data),
+                      (uint8_t *) image_data);
+}
+
+static void
+run_get_image(struct bench *b, int ops)
+{
+    xcb_get_image_cookie_t cookies[64];
+    int i;
+
+    assert(ops <= ARRAY_SIZE(cookies));
+    for (i = 0; i < ops; i++)
+        cookies[i] = xcb_get_image(b->c, XCB_IMAGE_FORMAT_Z_PIXMAP, b->pixmap,
+                                   (i * 7) % 384, (i * 5) % 384, 128, 128, ~0);
+    for (i = 0; i < ops; i++) {
+        xcb_get_image_reply_t *reply =
+            xcb_get_image_reply(b->c, cookies[i], NULL);
+
+        assert(reply);
+        free(reply);
+    }
+}
+
+/* render */
+
+static xcb_render_pictformat_t
+find_format(xcb_render_query_pict_formats_reply_t *formats, int depth,
+            int red_mask, int alpha_mask)
+{
+    xcb_render_pictforminfo_iterator_t i;
+
+    for (i = xcb_render_query_pict_formats_formats_iterator(formats);
+         i.rem; xcb_render_pictforminfo_next(&i)) {
+        if (i.data->type == XCB_RENDER_PICT_TYPE_DIRECT &&
+            i.data->depth == depth &&
+            i.data->direct.red_mask == red_mask &&
+            i.data->direct.alpha_mask == alpha_mask)
+            return i.data->id;
+    }
+    return XCB_NONE;
+}
+
+static void
+run_composite(struct bench *b, int ops)
+{
+    int i;
+
+    for (i = 0; i < ops; i++)
+        xcb_render_composite(b->c, XCB_RENDER_PICT_OP_OVER, b->src,
+                             XCB_NONE, b->dst, (i * 3) % 256, (i * 5) % 256,
+                             0, 0, (i * 7) % 384, (i * 11) % 384, 128, 128);
+}
+
+static void
+run_fill_rectangles(struct bench *b, int ops)
+{
+    xcb_render_color_t color = { 0x8000, 0x4000, 0x2000, 0x8000 };
+    xcb_rectangle_t rects[16];
+    int i, j;
+
+    for (i = 0; i < ops; i++) {
+        for (j = 0; j < ARRAY_SIZE(rects); j++) {
+            rects[j].x = (i * 7 + j * 31) % 448;
+            rects[j].y = (i * 11 + j * 23) % 448;
+            rects[j].width = rects[j].height = 64;
+        }
+        xcb_render_fill_rectangles(b->c, XCB_RENDER_PICT_OP_OVER, b->dst,
+                                   color, ARRAY_SIZE(rects), rects);
+    }
+}
+
+#define GLYPH_WIDTH     8
+#define GLYPH_HEIGHT    13
+#define GLYPH_STRIDE    ((GLYPH_WIDTH + 3) & ~3)
+
+static void
+setup_glyphs(struct bench *b)
+{
+    static uint8_t data[95 * GLYPH_STRIDE * GLYPH_HEIGHT];
+    xcb_render_glyphinfo_t info[95];
+    uint32_t ids[95];
+    int i;
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (i * 37) & 0xff;
+    for (i = 0; i < ARRAY_SIZE(ids); i++) {
+        ids[i] = ' ' + i;
+        info[i].width = GLYPH_WIDTH;
+        info[i].height = GLYPH_HEIGHT;
+        info[i].x = 0;
+        info[i].y = GLYPH_HEIGHT - 3;
+        info[i].x_off = GLYPH_WIDTH;
+        info[i].y_off = 0;
+    }
+
+    b->glyphs = xcb_generate_id(b->c);
+    xcb_render_create_glyph_set(b->c, b->glyphs, b->a8);
+    xcb_render_add_glyphs(b->c, b->glyphs, ARRAY_SIZE(ids), ids, info,
+                          sizeof(data), data);
+}
+
+static void
+cleanup_glyphs(struct bench *b)
+{
+    xcb_render_free_glyph_set(b->c, b->glyphs);
+}
+
+static void
+run_glyphs(struct bench *b, int ops)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog";
+    /* one glyph element: count, pad, dx, dy, then the glyph ids */
+    uint8_t cmds[8 + ((sizeof(text) - 1 + 3) & ~3)];
+    int i;
+
+    memset(cmds, 0, sizeof(cmds));
+    cmds[0] = sizeof(text) - 1;
+    memcpy(cmds + 8, text, sizeof(text) - 1);
+    for (i = 0; i < ops; i++) {
+        int16_t dx = 10, dy = 20 + (i * 13) % 480;
+
+        memcpy(cmds + 4, &dx, 2);
+        memcpy(cmds + 6, &dy, 2);
+        xcb_render_composite_glyphs_8(b->c, XCB_RENDER_PICT_OP_OVER,
+                                      b->src, b->dst, b->a8, b->glyphs, 0, 0,
+                                      sizeof(cmds), cmds);
+    }
+}
+
+#ifdef HAVE_XCB_GLX
+/* indirect GLX swaps, roughly one glxgears frame each */
+
+static int
+find_glx_visual(struct bench *b, xcb_visualid_t *visual, uint8_t *depth)
+{
+    xcb_glx_get_visual_configs_reply_t *reply;
+    xcb_depth_iterator_t di;
+    const uint32_t *props;
+    int i, found = 0;
+
+    reply = xcb_glx_get_visual_configs_reply(b->c,
+                xcb_glx_get_visual_configs(b->c, 0), NULL);
+    if (!reply)
+        return 0;
+
+    /* The first 18 properties of each visual are in a fixed order:
+     * visual, class, rgba, r/g/b/a sizes, accum r/g/b/a sizes,
+     * double buffer, ...
+     */
+    props = xcb_glx_get_visual_configs_property_list(reply);
+    for (i = 0; i < reply->num_visuals && !found; i++) {
+        const uint32_t *v = props + i * reply->num_properties;
+
+        if (v[1] != XCB_VISUAL_CLASS_TRUE_COLOR || !v[2] || !v[11])
+            continue;
+
+        for (di = xcb_screen_allowed_depths_iterator(b->screen);
+             di.rem && !found; xcb_depth_next(&di)) {
+            xcb_visualtype_iterator_t vi =
+                xcb_depth_visuals_iterator(di.data);
+
+            for (; vi.rem; xcb_visualtype_next(&vi)) {
+                if (vi.data->visual_id == v[0] &&
+                    di.data->depth == b->screen->root_depth) {
+                    *visual = v[0];
+                    *depth = di.data->depth;
+                    found = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    free(reply);
+    return found;
+}
+
+static void
+setup_glx_swap(struct bench *b)
+{
+    xcb_glx_make_current_reply_t *current;
+    xcb_visualid_t visual;
+    uint8_t depth;
+    uint32_t values[3];
+
+    if (!xcb_get_extension_data(b->c, &xcb_glx_id)->present ||
+        !find_glx_visual(b, &visual, &depth)) {
+        b->skip = 1;
+        return;
+    }
+
+    b->glx_colormap = xcb_generate_id(b->c);
+    xcb_create_colormap(b->c, XCB_COLORMAP_ALLOC_NONE, b->glx_colormap,
+                        b->screen->root, visual);
+
+    b->glx_window = xcb_generate_id(b->c);
+    values[0] = 0;
+    values[1] = 0;
+    values[2] = b->glx_colormap;
+    xcb_create_window(b->c, depth, b->glx_window, b->screen->root,
+                      0, 0, TARGET_SIZE, TARGET_SIZE, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, visual,
+                      XCB_CW_BACK_PIXEL | XCB_CW_BORDER_PIXEL |
+                      XCB_CW_COLORMAP, values);
+    xcb_map_window(b->c, b->glx_window);
+
+    /* fails with BadValue unless the server was started with +iglx */
+    b->glx_context = xcb_generate_id(b->c);
+    free(xcb_request_check(b->c,
+             xcb_glx_create_context_checked(b->c, b->glx_context, visual, 0,
+                                            0, 0)));
+    current = xcb_glx_make_current_reply(b->c,
+                  xcb_glx_make_current(b->c, b->glx_window, b->glx_context,
+                                       0), NULL);
+    if (!current) {
+        b->skip = 1;
+        b->glx_tag = 0;
+        return;
+    }
+    b->glx_tag = current->context_tag;
+    free(current);
+}
+
+static void
+put_rop(uint8_t **p, uint16_t opcode, const void *args, uint16_t size)
+{
+    uint16_t len = 4 + size;
+
+    memcpy(*p, &len, 2);
+    memcpy(*p + 2, &opcode, 2);
+    memcpy(*p + 4, args, size);
+    *p += len;
+}
+
+static void
+run_glx_swap(struct bench *b, int ops)
+{
+    static const float colors[3][3] = {
+        { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 },
+    };
+    uint8_t cmds[256], *p;
+    int i, j;
+
+    for (i = 0; i < ops; i++) {
+        float angle = (b->round * ops + i) * 0.05f;
+        float clear[4] = { 0, 0, (i & 7) / 8.0f, 1 };
+        uint32_t mask = 0x4000;         /* GL_COLOR_BUFFER_BIT */
+        uint32_t mode = 4;              /* GL_TRIANGLES */
+
+        p = cmds;
+        put_rop(&p, 130, clear, sizeof(clear));         /* ClearColor */
+        put_rop(&p, 127, &mask, sizeof(mask));          /* Clear */
+        put_rop(&p, 4, &mode, sizeof(mode));            /* Begin */
+        for (j = 0; j < 3; j++) {
+            float a = angle + j * 2.0944f;
+            float v[2] = { 0.9f * cosf(a), 0.9f * sinf(a) };
+
+            put_rop(&p, 8, colors[j], sizeof(colors[j])); /* Color3fv */
+            put_rop(&p, 66, v, sizeof(v));              /* Vertex2fv */
+        }
+        put_rop(&p, 23, NULL, 0);                       /* End */
+        assert(p <= cmds + sizeof(cmds));
+
+        xcb_glx_render(b->c, b->glx_tag, p - cmds, cmds);
+        xcb_glx_swap_buffers(b->c, b->glx_tag, b->glx_window);
+    }
+}
+
+/*
+ * One gear's worth of the render stream glxgears sends indirectly:
+ * a quad strip of glNormal3f/glVertex3f pairs around a ring.
+ */
+#define GEAR_VERTICES   512
+
+static uint8_t gear_cmds[8 + GEAR_VERTICES * 32 + 4];
+static int gear_cmds_len;
+
+static void
+setup_glx_immediate(struct bench *b)
+{
+    uint32_t mode = 8;                  /* GL_QUAD_STRIP */
+    uint8_t *p = gear_cmds;
+    int i;
+
+    setup_glx_swap(b);
+
+    put_rop(&p, 4, &mode, sizeof(mode));                /* Begin */
+    for (i = 0; i < GEAR_VERTICES; i++) {
+        float a = i * 2 * M_PI / GEAR_VERTICES;
+        float n[3] = { cosf(a), sinf(a), 0 };
+        float v[3] = { (i & 1 ? 0.5f : 0.9f) * n[0],
+                       (i & 1 ? 0.5f : 0.9f) * n[1], i & 2 ? 0.1f : -0.1f };
+
+        put_rop(&p, 30, n, sizeof(n));                  /* Normal3fv */
+        put_rop(&p, 70, v, sizeof(v));                  /* Vertex3fv */
+    }
+    put_rop(&p, 23, NULL, 0);                           /* End */
+    gear_cmds_len = p - gear_cmds;
+    assert(gear_cmds_len <= sizeof(gear_cmds));
+}
+
+static void
+run_glx_immediate(struct bench *b, int ops)
+{
+    int i;
+
+    for (i = 0; i < ops; i++)
+        xcb_glx_render(b->c, b->glx_tag, gear_cmds_len, gear_cmds);
+}
+
+/* the server's per context counters, see glx/glxprofile.c */
+#define X_GLXvop_QueryContextProfileVCXSRV 0x56435801
+
+/* print what the server counted for the context, with +iglxprofile */
+static void
+print_glx_profile(struct bench *b)
+{
+    xcb_glx_vendor_private_with_reply_reply_t *reply;
+    uint32_t data[2] = { b->glx_context, 0 };
+    uint32_t *counters;
+
+    reply = xcb_glx_vendor_private_with_reply_reply(b->c,
+                xcb_glx_vendor_private_with_reply(b->c,
+                    X_GLXvop_QueryContextProfileVCXSRV, 0, sizeof(data),
+                    (uint8_t *) data), NULL);
+    if (!reply)
+        return;
+
+    counters = (uint32_t *) xcb_glx_vendor_private_with_reply_data_2(reply);
+    if (reply->retval &&
+        xcb_glx_vendor_private_with_reply_data_2_length(reply) >= 44) {
+        printf("{\"glx_profile\": true, \"requests\": %u, "
+               "\"render_commands\": %u, \"vertices\": %llu, "
+               "\"pixels_drawn\": %llu, \"swaps\": %u, "
+               "\"server_ms\": %.1f}\n", counters[0], counters[1],
+               counters[2] | (unsigned long long) counters[3] << 32,
+               counters[4] | (unsigned long long) counters[5] << 32,
+               counters[8],
+               (counters[9] | (unsigned long long) counters[10] << 32) / 1e3);
+    }
+    free(reply);
+}
+
+static void
+cleanup_glx_swap(struct bench *b)
+{
+    if (b->glx_context)
+        print_glx_profile(b);
+    if (b->glx_tag)
+        free(xcb_glx_make_current_reply(b->c,
+                 xcb_glx_make_current(b->c, XCB_NONE, XCB_NONE, b->glx_tag),
+                 NULL));
+    if (b->glx_context)
+        xcb_glx_destroy_context(b->c, b->glx_context);
+    if (b->glx_window)
+        xcb_destroy_window(b->c, b->glx_window);
+    if (b->glx_colormap)
+        xcb_free_colormap(b->c, b->glx_colormap);
+    b->glx_tag = 0;
+    b->glx_context = b->glx_window = b->glx_colormap = 0;
+}
+
+/*
+ * Round trips of this client while another one renders indirect GLX
+ * frames as fast as the server takes them: how long the server leaves
+ * everyone else waiting while it rasterizes.  The GL client keeps one
+ * frame in flight, so it never queues more than a frame of work.
+ */
+#define CONTENTION_GEARS        8
+
+static struct bench gl_client;
+static unsigned int gl_frame_sequence;  /* reply ending the frame, or 0 */
+
+static void
+send_gl_frame(void)
+{
+    struct bench *gl = &gl_client;
+    float clear[4] = { 0, 0, 0, 1 };
+    uint32_t mask = 0x4000;             /* GL_COLOR_BUFFER_BIT */
+    uint8_t cmds[64], *p = cmds;
+    int i;
+
+    put_rop(&p, 130, clear, sizeof(clear));             /* ClearColor */
+    put_rop(&p, 127, &mask, sizeof(mask));              /* Clear */
+    xcb_glx_render(gl->c, gl->glx_tag, p - cmds, cmds);
+    for (i = 0; i < CONTENTION_GEARS; i++)
+        xcb_glx_render(gl->c, gl->glx_tag, gear_cmds_len, gear_cmds);
+    xcb_glx_swap_buffers(gl->c, gl->glx_tag, gl->glx_window);
+    gl_frame_sequence = xcb_get_input_focus(gl->c).sequence;
+    xcb_flush(gl->c);
+}
+
+static void
+pump_gl_client(void)
+{
+    void *reply = NULL;
+    xcb_generic_error_t *error = NULL;
+
+    if (!xcb_poll_for_reply(gl_client.c, gl_frame_sequence, &reply, &error))
+        return;
+    free(reply);
+    free(error);
+    send_gl_frame();
+}
+
+static void
+setup_glx_contention(struct bench *b)
+{
+    struct bench *gl = &gl_client;
+
+    memset(gl, 0, sizeof(*gl));
+    gl->c = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(gl->c)) {
+        b->skip = 1;
+        return;
+    }
+    gl->screen = b->screen;
+    setup_glx_immediate(gl);
+    if (gl->skip) {
+        b->skip = 1;
+        return;
+    }
+    send_gl_frame();
+}
+
+static void
+run_glx_contention(struct bench *b, int ops)
+{
+    int i;
+
+    for (i = 0; i < ops; i++) {
+        pump_gl_client();
+        sync_with_server(b->c);
+    }
+}
+
+static void
+cleanup_glx_contention(struct bench *b)
+{
+    struct bench *gl = &gl_client;
+
+    if (!gl->c)
+        return;
+    if (gl_frame_sequence)
+        free(xcb_wait_for_reply(gl->c, gl_frame_sequence, NULL));
+    gl_frame_sequence = 0;
+    cleanup_glx_swap(gl);
+    xcb_disconnect(gl->c);
+    gl->c = NULL;
+}
+#endif
+
+/* input */
+
+static void
+run_motion(struct bench *b, int ops)
+{
+    int i;
+
+    for (i = 0; i < ops; i++)
+        xcb_test_fake_input(b->c, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME,
+                            b->screen->root, 10 + (b->round + i) % 400,
+                            10 + (i * 7) % 400, XCB_NONE);
+}
+
+static const struct workload workloads[] = {
+    { "round-trip", 1, 5000, NULL, run_round_trip, NULL },
+    { "atoms", 16, 500, NULL, run_atoms, NULL },
+    { "properties", 16, 500, NULL, run_properties, NULL },
+    { "window-churn", 16, 500, NULL, run_window_churn, NULL },
+    { "fill-rect", 32, 1000, NULL, run_fill_rect, NULL },
+    { "poly-line", 8, 500, NULL, run_lines, NULL },
+    { "copy-area", 16, 500, NULL, run_copy_area, NULL },
+    { "image-text", 32, 500, NULL, run_text, NULL },
+    { "put-image", 8, 500, NULL, run_put_image, NULL },
+    { "get-image", 8, 500, NULL, run_get_image, NULL },
+    { "render-composite", 16, 500, NULL, run_composite, NULL },
+    { "render-fill", 8, 500, NULL, run_fill_rectangles, NULL },
+    { "render-glyphs", 16, 500, setup_glyphs, run_glyphs, cleanup_glyphs },
+    { "xtest-motion", 16, 500, NULL, run_motion, NULL },
+#ifdef HAVE_XCB_GLX
+    { "glx-swap", 4, 250, setup_glx_swap, run_glx_swap, cleanup_glx_swap },
+    { "glx-immediate", 8, 250, setup_glx_immediate, run_glx_immediate,
+      cleanup_glx_swap },
+    { "glx-contention", 1, 2000, setup_glx_contention, run_glx_contention,
+      cleanup_glx_contention },
+#endif
+};
+
+static int
+compare_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void
+run_workload(struct bench *b, const struct workload *w, double scale)
+{
+    int rounds = w->rounds * scale;
+    double *times, start, total = 0;
+    int i;
+
+    if (rounds < 1)
+        rounds = 1;
+    times = calloc(rounds, sizeof(double));
+    assert(times);
+
+    if (w->setup)
+        w->setup(b);
+    sync_with_server(b->c);
+
+    if (b->skip) {
+        if (w->cleanup)
+            w->cleanup(b);
+        printf("{\"workload\": \"%s\", \"skipped\": true}\n", w->name);
+        fflush(stdout);
+        free(times);
+        b->skip = 0;
+        return;
+    }
+
+    /* one round to warm up caches and allocations */
+    b->round = 0;
+    w->run(b, w->ops_per_round);
+    sync_with_server(b->c);
+
+    for (i = 0; i < rounds; i++) {
+        b->round = i + 1;
+        start = now_us();
+        w->run(b, w->ops_per_round);
+        sync_with_server(b->c);
+        times[i] = (now_us() - start) / w->ops_per_round;
+        total += times[i] * w->ops_per_round;
+    }
+
+    if (w->cleanup)
+        w->cleanup(b);
+    sync_with_server(b->c);
+
+    qsort(times, rounds, sizeof(double), compare_double);
+    printf("{\"workload\": \"%s\", \"ops\": %d, \"ops_per_sec\": %.1f, "
+           "\"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, "
+           "\"max_us\": %.2f}\n",
+           w->name, rounds * w->ops_per_round,
+           rounds * w->ops_per_round / (total / 1e6),
+           times[rounds / 2], times[rounds * 9 / 10],
+           times[rounds * 99 / 100], times[rounds - 1]);
+    fflush(stdout);
+    free(times);
+}
+
+static void
+setup(struct bench *b)
+{
+    xcb_render_query_pict_formats_reply_t *formats;
+    uint32_t values[2];
+    int i;
+
+    b->screen = xcb_setup_roots_iterator(xcb_get_setup(b->c)).data;
+
+    b->window = xcb_generate_id(b->c);
+    values[0] = b->screen->black_pixel;
+    xcb_create_window(b->c, XCB_COPY_FROM_PARENT, b->window, b->screen->root,
+                      0, 0, TARGET_SIZE, TARGET_SIZE, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
+                      XCB_CW_BACK_PIXEL, values);
+    xcb_map_window(b->c, b->window);
+
+    b->pixmap = xcb_generate_id(b->c);
+    xcb_create_pixmap(b->c, b->screen->root_depth, b->pixmap, b->screen->root,
+                      TARGET_SIZE, TARGET_SIZE);
+
+    b->gc = xcb_generate_id(b->c);
+    values[0] = b->screen->white_pixel;
+    values[1] = 0;
+    xcb_create_gc(b->c, b->gc, b->pixmap,
+                  XCB_GC_FOREGROUND | XCB_GC_GRAPHICS_EXPOSURES, values);
+
+    for (i = 0; i < ARRAY_SIZE(image_data); i++)
+        image_data[i] = i * 0x010101;
+
+    formats = xcb_render_query_pict_formats_reply(b->c,
+                  xcb_render_query_pict_formats(b->c), NULL);
+    assert(formats);
+    b->argb32 = find_format(formats, 32, 0xff, 0xff);
+    b->rgb24 = find_format(formats, 24, 0xff, 0);
+    b->a8 = find_format(formats, 8, 0, 0xff);
+    free(formats);
+    assert(b->argb32 && b->rgb24 && b->a8);
+
+    b->dst = xcb_generate_id(b->c);
+    xcb_render_create_picture(b->c, b->dst, b->pixmap, b->rgb24, 0, NULL);
+
+    b->src = xcb_generate_id(b->c);
+    {
+        xcb_pixmap_t pixmap = xcb_generate_id(b->c);
+        xcb_render_color_t color = { 0x4000, 0x8000, 0xc000, 0xc000 };
+        xcb_rectangle_t rect = { 0, 0, TARGET_SIZE, TARGET_SIZE };
+
+        xcb_create_pixmap(b->c, 32, pixmap, b->screen->root,
+                          TARGET_SIZE, TARGET_SIZE);
+        xcb_render_create_picture(b->c, b->src, pixmap, b->argb32, 0, NULL);
+        xcb_render_fill_rectangles(b->c, XCB_RENDER_PICT_OP_SRC, b->src,
+                                   color, 1, &rect);
+        xcb_free_pixmap(b->c, pixmap);
+    }
+
+    sync_with_server(b->c);
+}
+
+static void
+usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-l] [-r rounds] [workload...]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    struct bench b = { 0 };
+    double scale = 1.0;
+    int opt, i, j;
+
+    while ((opt = getopt(argc, argv, "lr:")) != -1) {
+        switch (opt) {
+        case 'l':
+            for (i = 0; i < ARRAY_SIZE(workloads); i++)
+                printf("%s\n", workloads[i].name);
+            return 0;
+        case 'r':
+            scale = atof(optarg);
+            if (scale <= 0)
+                usage(argv[0]);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    b.c = xcb_connect(NULL, NULL);
+    if (xcb_connection_has_error(b.c)) {
+        fprintf(stderr, "cannot connect to the X server\n");
+        return 1;
+    }
+    if (!xcb_get_extension_data(b.c, &xcb_render_id)->present ||
+        !xcb_get_extension_data(b.c, &xcb_test_id)->present) {
+        printf("RENDER or XTEST not supported\n");
+        xcb_disconnect(b.c);
+        return 77;
+    }
+    free(xcb_render_query_version_reply(b.c,
+             xcb_render_query_version(b.c, 0, 11), NULL));
+
+    setup(&b);
+
+    for (i = 0; i < ARRAY_SIZE(workloads); i++) {
+        if (optind < argc) {
+            for (j = optind; j < argc; j++)
+                if (strcmp(argv[j], workloads[i].name) == 0)
+                    break;
+            if (j == argc)
+                continue;
+        }
+        run_workload(&b, &workloads[i], scale);
+    }
+
+    xcb_disconnect(b.c);
+    return 0;
+}
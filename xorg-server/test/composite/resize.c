@@ -0,0 +1,161 @@
+/*
+ * Copyright © 2024 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Replays an interactive resize of a redirected window: the window grows
+ * and shrinks in small steps as it would under a window manager following
+ * the pointer, so Composite replaces its backing pixmap on every step.
+ * After each step the window is filled and read back, and now and then
+ * its pixmap is named and checked to be the size of the window.  The time
+ * per step is reported.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/composite.h>
+
+#define NUM_STEPS       400
+
+static void
+check_pixmap_size(xcb_connection_t *c, xcb_window_t w, int width, int height)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_get_geometry_reply_t *geom;
+
+    xcb_composite_name_window_pixmap(c, w, pixmap);
+    geom = xcb_get_geometry_reply(c, xcb_get_geometry(c, pixmap), NULL);
+    assert(geom);
+    assert(geom->width == width && geom->height == height);
+    free(geom);
+    xcb_free_pixmap(c, pixmap);
+}
+
+static void
+check_contents(xcb_connection_t *c, xcb_window_t w, int width, int height,
+               uint32_t pixel)
+{
+    xcb_get_image_reply_t *image;
+    uint32_t *data;
+    int i;
+
+    image = xcb_get_image_reply(c,
+                                xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, w,
+                                              0, 0, width, height, ~0),
+                                NULL);
+    assert(image);
+    assert(xcb_get_image_data_length(image) == 4 * width * height);
+    data = (uint32_t *) xcb_get_image_data(image);
+    for (i = 0; i < width * height; i++)
+        assert((data[i] & 0xffffff) == pixel);
+    free(image);
+}
+
+static double
+elapsed(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 +
+        (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    xcb_composite_query_version_reply_t *version;
+    xcb_window_t w = xcb_generate_id(c);
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    struct timespec start;
+    int width = 200, height = 150;
+    int max_width = screen->width_in_pixels - 10;
+    int max_height = screen->height_in_pixels - 10;
+    int dx = 7, dy = 5;
+    int i;
+
+    version = xcb_composite_query_version_reply(c,
+                  xcb_composite_query_version(c, 0, 2), NULL);
+    if (!version) {
+        printf("Composite not supported\n");
+        xcb_disconnect(c);
+        return 77;
+    }
+    free(version);
+
+    if (screen->root_depth != 24) {
+        printf("Need a depth 24 root\n");
+        xcb_disconnect(c);
+        return 77;
+    }
+
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, w, screen->root,
+                      0, 0, width, height, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      screen->root_visual, 0, NULL);
+    xcb_composite_redirect_window(c, w, XCB_COMPOSITE_REDIRECT_MANUAL);
+    xcb_map_window(c, w);
+    xcb_create_gc(c, gc, w, 0, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < NUM_STEPS; i++) {
+        uint32_t size[2];
+        uint32_t pixel = (i * 0x010203) & 0xffffff;
+        xcb_rectangle_t rect;
+
+        /* mostly growing, with the occasional change of direction */
+        if (width + dx > max_width || width + dx < 50 || rand() % 40 == 0)
+            dx = -dx;
+        if (height + dy > max_height || height + dy < 50 || rand() % 40 == 0)
+            dy = -dy;
+        width += dx;
+        height += dy;
+
+        size[0] = width;
+        size[1] = height;
+        xcb_configure_window(c, w, XCB_CONFIG_WINDOW_WIDTH |
+                             XCB_CONFIG_WINDOW_HEIGHT, size);
+
+        rect.x = rect.y = 0;
+        rect.width = width;
+        rect.height = height;
+        xcb_change_gc(c, gc, XCB_GC_FOREGROUND, &pixel);
+        xcb_poly_fill_rectangle(c, w, gc, 1, &rect);
+
+        check_contents(c, w, width, height, pixel);
+        if (i % 50 == 0)
+            check_pixmap_size(c, w, width, height);
+    }
+
+    printf("%d resize steps: %.3f ms per step\n", NUM_STEPS,
+           elapsed(&start) / NUM_STEPS);
+
+    xcb_disconnect(c);
+    return 0;
+}
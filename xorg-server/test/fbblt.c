@@ -0,0 +1,272 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fb.h"
+
+#include "tests-common.h"
+
+/*
+ * A second copy of fbBlt without the SIMD code, as the reference the
+ * server's fbBlt has to match bit for bit.
+ */
+void fbBltGeneric(FbBits *srcLine, FbStride srcStride, int srcX,
+                  FbBits *dstLine, FbStride dstStride, int dstX,
+                  int width, int height, int alu, FbBits pm, int bpp,
+                  Bool reverse, Bool upsidedown);
+void fbBltStipGeneric(FbStip *src, FbStride srcStride, int srcX,
+                      FbStip *dst, FbStride dstStride, int dstX,
+                      int width, int height, int alu, FbBits pm, int bpp);
+
+#define FB_BLT_NO_SIMD
+#define fbBlt fbBltGeneric
+#define fbBltStip fbBltStipGeneric
+#include "../fb/fbblt.c"
+#undef fbBlt
+#undef fbBltStip
+
+/*
+ * Copies and xors boxes between two surfaces and within one surface in
+ * every direction, as CopyArea and scrolling do, at 8, 16 and 32 bpp with
+ * fbBlt and with the generic code, and checks the results are identical.
+ * So are whole 1920x1080 surfaces scrolled, copied and xored, which at 16
+ * and 32 bpp are large enough for non-temporal stores.  The benchmark
+ * reports the time each takes to scroll and to copy surfaces of up to
+ * 3840x2160.
+ */
+
+#define SURFACE_WIDTH   1024
+#define SURFACE_HEIGHT  256
+#define NUM_BOXES       500
+#define NUM_REPEAT      8
+
+struct blt_times {
+    double scroll, scroll_generic;
+    double copy, copy_generic;
+};
+
+static double
+elapsed(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 +
+        (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void
+fill_random(void *data, size_t size)
+{
+    unsigned char *p = data;
+
+    while (size--)
+        *p++ = rand();
+}
+
+/* copy w x h pixels from (sx, sy) to (dx, dy) of the same surface */
+static void
+blt_within(FbBits *bits, FbStride stride, int bpp, int alu,
+           int sx, int sy, int dx, int dy, int w, int h, Bool generic)
+{
+    Bool reverse = sx < dx;
+    Bool upsidedown = sy < dy;
+
+    if (generic)
+        fbBltGeneric(bits + sy * stride, stride, sx * bpp,
+                     bits + dy * stride, stride, dx * bpp,
+                     w * bpp, h, alu, FB_ALLONES, bpp, reverse, upsidedown);
+    else
+        fbBlt(bits + sy * stride, stride, sx * bpp,
+              bits + dy * stride, stride, dx * bpp,
+              w * bpp, h, alu, FB_ALLONES, bpp, reverse, upsidedown);
+}
+
+static void
+fb_blt_boxes(int bpp)
+{
+    FbStride stride = SURFACE_WIDTH * bpp / FB_UNIT;
+    size_t size = stride * sizeof(FbBits) * SURFACE_HEIGHT;
+    FbBits *src = malloc(size), *a = malloc(size), *b = malloc(size);
+    int i;
+
+    assert(src && a && b);
+    fill_random(src, size);
+    fill_random(a, size);
+    memcpy(b, a, size);
+
+    for (i = 0; i < NUM_BOXES; i++) {
+        int alu = (i & 1) ? GXxor : GXcopy;
+        int w = 1 + rand() % (SURFACE_WIDTH / 2);
+        int h = 1 + rand() % (SURFACE_HEIGHT / 2);
+        int sx = rand() % (SURFACE_WIDTH - w);
+        int sy = rand() % (SURFACE_HEIGHT - h);
+        int dx, dy;
+
+        if (i % 4 < 2) {
+            /* between surfaces */
+            dx = rand() % (SURFACE_WIDTH - w);
+            dy = rand() % (SURFACE_HEIGHT - h);
+            fbBltGeneric(src + sy * stride, stride, sx * bpp,
+                         a + dy * stride, stride, dx * bpp,
+                         w * bpp, h, alu, FB_ALLONES, bpp, FALSE, FALSE);
+            fbBlt(src + sy * stride, stride, sx * bpp,
+                  b + dy * stride, stride, dx * bpp,
+                  w * bpp, h, alu, FB_ALLONES, bpp, FALSE, FALSE);
+        }
+        else {
+            /* overlapping, by less than a vector in some cases */
+            dx = sx + rand() % 81 - 40;
+            dy = sy + rand() % 9 - 4;
+            if (dx < 0)
+                dx = 0;
+            if (dx > SURFACE_WIDTH - w)
+                dx = SURFACE_WIDTH - w;
+            if (dy < 0)
+                dy = 0;
+            if (dy > SURFACE_HEIGHT - h)
+                dy = SURFACE_HEIGHT - h;
+            blt_within(a, stride, bpp, alu, sx, sy, dx, dy, w, h, TRUE);
+            blt_within(b, stride, bpp, alu, sx, sy, dx, dy, w, h, FALSE);
+        }
+        assert(memcmp(a, b, size) == 0);
+    }
+
+    free(src);
+    free(a);
+    free(b);
+}
+
+/*
+ * Scroll a whole surface, then copy and xor another onto it, repeat times
+ * each, adding up the times
+ */
+static void
+fb_blt_surface(int width, int height, int bpp, int repeat,
+               struct blt_times *t)
+{
+    FbStride stride = width * bpp / FB_UNIT;
+    size_t size = stride * sizeof(FbBits) * height;
+    FbBits *src = malloc(size), *a = malloc(size), *b = malloc(size);
+    struct timespec start;
+    int i;
+
+    assert(src && a && b);
+    fill_random(src, size);
+    fill_random(a, size);
+    memcpy(b, a, size);
+
+    /* scroll up and down a line, and left and right a few pixels */
+    for (i = 0; i < repeat; i++) {
+        int dy = (i & 1) ? 1 : -1;
+        int dx = (i & 2) ? 3 : -3;
+        int sy = dy < 0 ? 1 : 0, sx = dx < 0 ? 3 : 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        blt_within(a, stride, bpp, GXcopy, sx, sy, sx + dx, sy + dy,
+                   width - 3, height - 1, TRUE);
+        t->scroll_generic += elapsed(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        blt_within(b, stride, bpp, GXcopy, sx, sy, sx + dx, sy + dy,
+                   width - 3, height - 1, FALSE);
+        t->scroll += elapsed(&start);
+    }
+    assert(memcmp(a, b, size) == 0);
+
+    for (i = 0; i < repeat; i++) {
+        int alu = (i & 1) ? GXxor : GXcopy;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        fbBltGeneric(src, stride, 0, a, stride, 0, width * bpp, height,
+                     alu, FB_ALLONES, bpp, FALSE, FALSE);
+        t->copy_generic += elapsed(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        fbBlt(src, stride, 0, b, stride, 0, width * bpp, height,
+              alu, FB_ALLONES, bpp, FALSE, FALSE);
+        t->copy += elapsed(&start);
+    }
+    assert(memcmp(a, b, size) == 0);
+
+    free(src);
+    free(a);
+    free(b);
+}
+
+static const int bpps[] = { 8, 16, 32 };
+
+int
+fb_blt_test(void)
+{
+    int i;
+
+    srand(0x5eed);
+    for (i = 0; i < ARRAY_SIZE(bpps); i++) {
+        struct blt_times t = { 0 };
+
+        fb_blt_boxes(bpps[i]);
+        /* every scroll direction, copy and xor once */
+        fb_blt_surface(1920, 1080, bpps[i], 4, &t);
+    }
+
+    return 0;
+}
+
+int
+fb_blt_benchmark(void)
+{
+    static const struct {
+        int width, height;
+    } sizes[] = {
+        { 1920, 1080 },
+        { 3840, 2160 },
+    };
+    int i, j;
+
+    srand(0x5eed);
+    for (i = 0; i < ARRAY_SIZE(bpps); i++)
+        for (j = 0; j < ARRAY_SIZE(sizes); j++) {
+            struct blt_times t = { 0 };
+
+            fb_blt_surface(sizes[j].width, sizes[j].height, bpps[i],
+                           NUM_REPEAT, &t);
+            printf("scroll %dx%d %d bpp: %.3f ms, generic %.3f ms\n",
+                   sizes[j].width, sizes[j].height, bpps[i],
+                   t.scroll / NUM_REPEAT, t.scroll_generic / NUM_REPEAT);
+            printf("copy/xor %dx%d %d bpp: %.3f ms, generic %.3f ms\n",
+                   sizes[j].width, sizes[j].height, bpps[i],
+                   t.copy / NUM_REPEAT, t.copy_generic / NUM_REPEAT);
+        }
+
+    return 0;
+}
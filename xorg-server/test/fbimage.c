@@ -0,0 +1,279 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fb.h"
+
+#include "tests-common.h"
+
+/*
+ * Puts and gets ZPixmap images of a range of sizes and depths through
+ * fbPutZImage and fbGetImage, which split large images into bands over the
+ * worker threads, and checks the results against a single fbBltStip over
+ * the whole image.  The benchmark repeats that at up to 3840x2160 and
+ * reports the time taken by both.
+ */
+
+#define NUM_REPEAT      4
+
+struct image_times {
+    double put_band, put_serial;
+    double get_band, get_serial;
+};
+
+static const struct {
+    int width, height;
+} sizes[] = {
+    { 256, 256 },
+    { 1280, 1024 },
+    { 3840, 2160 },
+};
+
+static const struct {
+    int depth, bpp;
+} formats[] = {
+    { 8, 8 },
+    { 16, 16 },
+    { 24, 32 },
+};
+
+static double
+elapsed(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 +
+        (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void
+fill_random(void *data, size_t size)
+{
+    unsigned char *p = data;
+
+    while (size--)
+        *p++ = rand();
+}
+
+static void
+set_padding(int depth, int bpp)
+{
+    PaddingInfo *pad = &PixmapWidthPaddingInfo[depth];
+    int pixels = 32 / bpp;
+
+    pad->padRoundUp = pixels - 1;
+    for (pad->padPixelsLog2 = 0; (1 << pad->padPixelsLog2) < pixels;
+         pad->padPixelsLog2++);
+    pad->padBytesLog2 = 2;
+    pad->bitsPerPixel = bpp;
+    pad->notPower2 = 0;
+}
+
+/* put and get a width x height image repeat times, adding up the times */
+static void
+fb_image(int width, int height, int depth, int bpp, int repeat,
+         struct image_times *t)
+{
+    PixmapRec pixmap = { 0 };
+    int stride = PixmapBytePad(width, depth);
+    size_t size = (size_t) stride * height;
+    FbStip *bits = malloc(size), *expected = malloc(size);
+    FbStip *image = malloc(size), *got = malloc(size);
+    FbBits pm = fbReplicatePixel(0x7f7f7f, bpp);
+    BoxRec box = { 0, 0, width, height };
+    RegionRec clip;
+    struct timespec start;
+    int i;
+
+    assert(bits && expected && image && got);
+
+    pixmap.drawable.type = DRAWABLE_PIXMAP;
+    pixmap.drawable.depth = depth;
+    pixmap.drawable.bitsPerPixel = bpp;
+    pixmap.drawable.width = width;
+    pixmap.drawable.height = height;
+    pixmap.devKind = stride;
+    pixmap.devPrivate.ptr = bits;
+    RegionInit(&clip, &box, 1);
+
+    fill_random(bits, size);
+    fill_random(image, size);
+    memcpy(expected, bits, size);
+
+    for (i = 0; i < repeat; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        fbPutZImage(&pixmap.drawable, &clip, GXxor, pm, 0, 0, width, height,
+                    image, stride / sizeof(FbStip));
+        t->put_band += elapsed(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        fbBltStip(image, stride / sizeof(FbStip), 0,
+                  expected, stride / sizeof(FbStip), 0,
+                  width * bpp, height, GXxor, pm, bpp);
+        t->put_serial += elapsed(&start);
+    }
+    assert(memcmp(bits, expected, size) == 0);
+
+    for (i = 0; i < repeat; i++) {
+        int j;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        fbGetImage(&pixmap.drawable, 0, 0, width, height, ZPixmap, 0xff7fff,
+                   (char *) got);
+        t->get_band += elapsed(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        fbBltStip(bits, stride / sizeof(FbStip), 0,
+                  expected, stride / sizeof(FbStip), 0,
+                  width * bpp, height, GXcopy, FB_ALLONES, bpp);
+        for (j = 0; j < size / sizeof(FbStip); j++)
+            expected[j] &= fbReplicatePixel(0xff7fff, bpp);
+        t->get_serial += elapsed(&start);
+    }
+    assert(memcmp(got, expected, size) == 0);
+
+    RegionUninit(&clip);
+    free(bits);
+    free(expected);
+    free(image);
+    free(got);
+}
+
+/* a clip of many boxes, each banded on its own */
+static void
+fb_image_clipped(void)
+{
+    PixmapRec pixmap = { 0 };
+    int width = 2048, height = 1024;
+    int stride = PixmapBytePad(width, 24);
+    size_t size = (size_t) stride * height;
+    FbStip *bits = malloc(size), *expected = malloc(size), *image = malloc(size);
+    RegionRec clip, box_region;
+    int i;
+
+    assert(bits && expected && image);
+
+    pixmap.drawable.type = DRAWABLE_PIXMAP;
+    pixmap.drawable.depth = 24;
+    pixmap.drawable.bitsPerPixel = 32;
+    pixmap.drawable.width = width;
+    pixmap.drawable.height = height;
+    pixmap.devKind = stride;
+    pixmap.devPrivate.ptr = bits;
+
+    fill_random(bits, size);
+    fill_random(image, size);
+    memcpy(expected, bits, size);
+
+    RegionNull(&clip);
+    for (i = 0; i < 16; i++) {
+        BoxRec box = { rand() % width, rand() % height, 0, 0 };
+
+        box.x2 = box.x1 + rand() % (width - box.x1) + 1;
+        box.y2 = box.y1 + rand() % (height - box.y1) + 1;
+        RegionInit(&box_region, &box, 1);
+        RegionUnion(&clip, &clip, &box_region);
+        RegionUninit(&box_region);
+    }
+
+    fbPutZImage(&pixmap.drawable, &clip, GXcopy, FB_ALLONES, 0, 0,
+                width, height, image, stride / sizeof(FbStip));
+
+    for (i = 0; i < RegionNumRects(&clip); i++) {
+        BoxPtr box = RegionRects(&clip) + i;
+
+        fbBltStip(image + box->y1 * (stride / sizeof(FbStip)),
+                  stride / sizeof(FbStip), box->x1 * 32,
+                  expected + box->y1 * (stride / sizeof(FbStip)),
+                  stride / sizeof(FbStip), box->x1 * 32,
+                  (box->x2 - box->x1) * 32, box->y2 - box->y1,
+                  GXcopy, FB_ALLONES, 32);
+    }
+    assert(memcmp(bits, expected, size) == 0);
+
+    RegionUninit(&clip);
+    free(bits);
+    free(expected);
+    free(image);
+}
+
+int
+fb_image_test(void)
+{
+    struct image_times t = { 0 };
+    int i, j;
+
+    srand(0x5eed);
+    for (j = 0; j < ARRAY_SIZE(formats); j++)
+        set_padding(formats[j].depth, formats[j].bpp);
+
+    /* all but 3840x2160, which is banded the same way as 1280x1024 */
+    for (i = 0; i < ARRAY_SIZE(sizes) - 1; i++)
+        for (j = 0; j < ARRAY_SIZE(formats); j++)
+            fb_image(sizes[i].width, sizes[i].height,
+                     formats[j].depth, formats[j].bpp, 1, &t);
+    fb_image_clipped();
+    WorkerPoolFini();
+
+    return 0;
+}
+
+int
+fb_image_benchmark(void)
+{
+    int i, j;
+
+    srand(0x5eed);
+    for (j = 0; j < ARRAY_SIZE(formats); j++)
+        set_padding(formats[j].depth, formats[j].bpp);
+
+    printf("%d threads\n", WorkerPoolThreads());
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+        for (j = 0; j < ARRAY_SIZE(formats); j++) {
+            struct image_times t = { 0 };
+
+            fb_image(sizes[i].width, sizes[i].height,
+                     formats[j].depth, formats[j].bpp, NUM_REPEAT, &t);
+            printf("PutImage %dx%d depth %d: %.2f ms banded, "
+                   "%.2f ms serial\n", sizes[i].width, sizes[i].height,
+                   formats[j].depth, t.put_band / NUM_REPEAT,
+                   t.put_serial / NUM_REPEAT);
+            printf("GetImage %dx%d depth %d: %.2f ms banded, "
+                   "%.2f ms serial\n", sizes[i].width, sizes[i].height,
+                   formats[j].depth, t.get_band / NUM_REPEAT,
+                   t.get_serial / NUM_REPEAT);
+        }
+    WorkerPoolFini();
+
+    return 0;
+}
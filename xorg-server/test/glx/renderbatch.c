@@ -0,0 +1,457 @@
+/*
+ * Copyright © 2024 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Draws a set of indirect glBegin/glEnd pairs twice: once with the whole
+ * pair in one Render request, which the server draws as a single vertex
+ * array (glx/renderbatch.c), and once split after glBegin over two Render
+ * requests, which makes it dispatch every command on its own.  Checks that
+ * both leave the same pixels and the same current color, normal and
+ * texture coordinate behind.
+ *
+ * The pairs cover every attribute the batcher handles, ubyte colors,
+ * non-float vertices, lighting (so that normals show in the pixels) and a
+ * pair the batcher has to decline because it sets the color only after
+ * its first vertex.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+#include <xcb/glx.h>
+
+#define SIZE                    64
+
+#define X_GLrop_Begin           4
+#define X_GLrop_Color3fv        8
+#define X_GLrop_Color3ubv       11
+#define X_GLrop_Color4fv        16
+#define X_GLrop_Color4ubv       19
+#define X_GLrop_End             23
+#define X_GLrop_Normal3fv       30
+#define X_GLrop_TexCoord1fv     50
+#define X_GLrop_TexCoord2fv     54
+#define X_GLrop_TexCoord3fv     58
+#define X_GLrop_TexCoord4fv     62
+#define X_GLrop_Vertex2fv       66
+#define X_GLrop_Vertex2sv       68
+#define X_GLrop_Vertex3dv       69
+#define X_GLrop_Vertex3fv       70
+#define X_GLrop_Vertex4fv       74
+#define X_GLrop_Vertex4iv       75
+#define X_GLrop_Clear           127
+#define X_GLrop_ClearColor      130
+#define X_GLrop_Disable         138
+#define X_GLrop_Enable          139
+
+#define GL_TRIANGLES            0x0004
+#define GL_TRIANGLE_STRIP       0x0005
+#define GL_TRIANGLE_FAN         0x0006
+#define GL_QUAD_STRIP           0x0008
+#define GL_CURRENT_COLOR        0x0B00
+#define GL_CURRENT_NORMAL       0x0B02
+#define GL_CURRENT_TEXTURE_COORDS 0x0B03
+#define GL_LIGHTING             0x0B50
+#define GL_COLOR_MATERIAL       0x0B57
+#define GL_COLOR_BUFFER_BIT     0x4000
+#define GL_LIGHT0               0x4000
+#define GL_RGBA                 0x1908
+#define GL_UNSIGNED_BYTE        0x1401
+
+struct glx {
+    xcb_connection_t *c;
+    xcb_screen_t *screen;
+    xcb_glx_context_tag_t tag;
+};
+
+struct stream {
+    uint8_t cmds[4096];
+    int len;
+};
+
+/* what a pair left behind */
+struct result {
+    uint8_t pixels[SIZE * SIZE * 4];
+    float color[4], normal[3], texcoord[4];
+};
+
+static void
+put_rop(struct stream *s, uint16_t opcode, const void *args, uint16_t size)
+{
+    uint16_t len = 4 + size;
+
+    assert(s->len + len <= sizeof(s->cmds));
+    memcpy(s->cmds + s->len, &len, 2);
+    memcpy(s->cmds + s->len + 2, &opcode, 2);
+    memcpy(s->cmds + s->len + 4, args, size);
+    s->len += len;
+}
+
+static void
+put_enable(struct stream *s, uint16_t opcode, uint32_t cap)
+{
+    put_rop(s, opcode, &cap, sizeof(cap));
+}
+
+static int
+setup_glx(struct glx *g)
+{
+    xcb_glx_get_visual_configs_reply_t *configs;
+    xcb_glx_make_current_reply_t *current;
+    xcb_depth_iterator_t di;
+    xcb_visualid_t visual = 0;
+    xcb_colormap_t colormap;
+    xcb_window_t window;
+    xcb_glx_context_t context;
+    const uint32_t *props;
+    uint32_t values[3];
+    int i;
+
+    if (!xcb_get_extension_data(g->c, &xcb_glx_id)->present)
+        return 0;
+
+    /* a double buffered TrueColor RGBA visual of the root depth, the first
+     * 18 properties of each visual are in a fixed order */
+    configs = xcb_glx_get_visual_configs_reply(g->c,
+                  xcb_glx_get_visual_configs(g->c, 0), NULL);
+    if (!configs)
+        return 0;
+    props = xcb_glx_get_visual_configs_property_list(configs);
+    for (i = 0; i < configs->num_visuals && !visual; i++) {
+        const uint32_t *v = props + i * configs->num_properties;
+
+        if (v[1] != XCB_VISUAL_CLASS_TRUE_COLOR || !v[2] || !v[11])
+            continue;
+
+        for (di = xcb_screen_allowed_depths_iterator(g->screen);
+             di.rem && !visual; xcb_depth_next(&di)) {
+            xcb_visualtype_iterator_t vi =
+                xcb_depth_visuals_iterator(di.data);
+
+            for (; vi.rem; xcb_visualtype_next(&vi)) {
+                if (vi.data->visual_id == v[0] &&
+                    di.data->depth == g->screen->root_depth) {
+                    visual = v[0];
+                    break;
+                }
+            }
+        }
+    }
+    free(configs);
+    if (!visual)
+        return 0;
+
+    colormap = xcb_generate_id(g->c);
+    xcb_create_colormap(g->c, XCB_COLORMAP_ALLOC_NONE, colormap,
+                        g->screen->root, visual);
+    window = xcb_generate_id(g->c);
+    values[0] = 0;
+    values[1] = 0;
+    values[2] = colormap;
+    xcb_create_window(g->c, g->screen->root_depth, window, g->screen->root,
+                      0, 0, SIZE, SIZE, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      visual, XCB_CW_BACK_PIXEL | XCB_CW_BORDER_PIXEL |
+                      XCB_CW_COLORMAP, values);
+    xcb_map_window(g->c, window);
+
+    /* fails with BadValue unless the server was started with +iglx */
+    context = xcb_generate_id(g->c);
+    free(xcb_request_check(g->c,
+             xcb_glx_create_context_checked(g->c, context, visual, 0, 0, 0)));
+    current = xcb_glx_make_current_reply(g->c,
+                  xcb_glx_make_current(g->c, window, context, 0), NULL);
+    if (!current)
+        return 0;
+    g->tag = current->context_tag;
+    free(current);
+    return 1;
+}
+
+static void
+get_floats(struct glx *g, uint32_t pname, float *out, int n)
+{
+    xcb_glx_get_floatv_reply_t *reply;
+
+    reply = xcb_glx_get_floatv_reply(g->c,
+                xcb_glx_get_floatv(g->c, g->tag, pname), NULL);
+    assert(reply && reply->n == n);
+    if (n == 1)
+        out[0] = reply->datum;
+    else
+        memcpy(out, xcb_glx_get_floatv_data(reply), n * sizeof(float));
+    free(reply);
+}
+
+/*
+ * Clear, set known current values, draw the pair in pair->cmds as one
+ * Render request or split after its glBegin, and read back the results.
+ */
+static void
+draw(struct glx *g, const struct stream *setup, const struct stream *pair,
+     int split, struct result *r)
+{
+    static const float clear[4] = { 0, 0, 0.2f, 1 };
+    static const float color[4] = { 0.25f, 0.5f, 0.75f, 0.5f };
+    static const float normal[3] = { 0, 0, 1 };
+    static const float texcoord[4] = { 0.1f, 0.2f, 0.3f, 0.4f };
+    xcb_glx_read_pixels_reply_t *reply;
+    struct stream s = { .len = 0 };
+    uint32_t mask = GL_COLOR_BUFFER_BIT;
+
+    put_rop(&s, X_GLrop_ClearColor, clear, sizeof(clear));
+    put_rop(&s, X_GLrop_Clear, &mask, sizeof(mask));
+    put_rop(&s, X_GLrop_Color4fv, color, sizeof(color));
+    put_rop(&s, X_GLrop_Normal3fv, normal, sizeof(normal));
+    put_rop(&s, X_GLrop_TexCoord4fv, texcoord, sizeof(texcoord));
+    xcb_glx_render(g->c, g->tag, s.len, s.cmds);
+    if (setup->len)
+        xcb_glx_render(g->c, g->tag, setup->len, setup->cmds);
+
+    if (split) {
+        /* glBegin is the first 8 bytes */
+        xcb_glx_render(g->c, g->tag, 8, pair->cmds);
+        xcb_glx_render(g->c, g->tag, pair->len - 8, pair->cmds + 8);
+    }
+    else
+        xcb_glx_render(g->c, g->tag, pair->len, pair->cmds);
+
+    reply = xcb_glx_read_pixels_reply(g->c,
+                xcb_glx_read_pixels(g->c, g->tag, 0, 0, SIZE, SIZE, GL_RGBA,
+                                    GL_UNSIGNED_BYTE, 0, 0), NULL);
+    assert(reply);
+    assert(xcb_glx_read_pixels_data_length(reply) >= sizeof(r->pixels));
+    memcpy(r->pixels, xcb_glx_read_pixels_data(reply), sizeof(r->pixels));
+    free(reply);
+
+    get_floats(g, GL_CURRENT_COLOR, r->color, 4);
+    get_floats(g, GL_CURRENT_NORMAL, r->normal, 3);
+    get_floats(g, GL_CURRENT_TEXTURE_COORDS, r->texcoord, 4);
+}
+
+static int
+check_pair(struct glx *g, const char *name, const struct stream *setup,
+           const struct stream *pair)
+{
+    static struct result batched, unbatched;
+    int i, drawn = 0;
+
+    draw(g, setup, pair, 0, &batched);
+    draw(g, setup, pair, 1, &unbatched);
+
+    /* something other than the clear color, so an empty draw can't pass */
+    for (i = 0; i < SIZE * SIZE; i++)
+        drawn |= unbatched.pixels[i * 4] || unbatched.pixels[i * 4 + 1];
+
+    if (!drawn ||
+        memcmp(batched.pixels, unbatched.pixels, sizeof(batched.pixels)) ||
+        memcmp(batched.color, unbatched.color, sizeof(batched.color)) ||
+        memcmp(batched.normal, unbatched.normal, sizeof(batched.normal)) ||
+        memcmp(batched.texcoord, unbatched.texcoord,
+               sizeof(batched.texcoord))) {
+        printf("%s: batched and unbatched draws differ\n", name);
+        printf("  color %g %g %g %g vs %g %g %g %g\n",
+               batched.color[0], batched.color[1], batched.color[2],
+               batched.color[3], unbatched.color[0], unbatched.color[1],
+               unbatched.color[2], unbatched.color[3]);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+static int
+test_color3fv(struct glx *g)
+{
+    struct stream setup = { .len = 0 }, pair = { .len = 0 };
+    uint32_t mode = GL_TRIANGLES;
+    int i;
+
+    put_rop(&pair, X_GLrop_Begin, &mode, sizeof(mode));
+    for (i = 0; i < 12; i++) {
+        float c[3] = { (i % 3) / 2.0f, (i % 5) / 4.0f, (i % 7) / 6.0f };
+        float v[2] = { 0.9f * cosf(i * 1.3f), 0.9f * sinf(i * 2.1f) };
+
+        put_rop(&pair, X_GLrop_Color3fv, c, sizeof(c));
+        put_rop(&pair, X_GLrop_Vertex2fv, v, sizeof(v));
+    }
+    put_rop(&pair, X_GLrop_End, NULL, 0);
+
+    return check_pair(g, "Color3fv triangles", &setup, &pair);
+}
+
+/* ubyte colors, converted to float by the batcher */
+static int
+test_color_ubv(struct glx *g)
+{
+    struct stream setup = { .len = 0 }, pair = { .len = 0 };
+    uint32_t mode = GL_QUAD_STRIP;
+    int i, fail;
+
+    put_rop(&pair, X_GLrop_Begin, &mode, sizeof(mode));
+    for (i = 0; i < 16; i++) {
+        uint8_t c[4] = { i * 17, 255 - i * 13, i * 29, 200 };
+        float t[2] = { i * 0.1f, 1 - i * 0.05f };
+        float v[3] = { -0.9f + (i / 2) * 0.24f, i & 1 ? 0.8f : -0.8f, 0 };
+
+        put_rop(&pair, X_GLrop_Color4ubv, c, sizeof(c));
+        put_rop(&pair, X_GLrop_TexCoord2fv, t, sizeof(t));
+        put_rop(&pair, X_GLrop_Vertex3fv, v, sizeof(v));
+    }
+    put_rop(&pair, X_GLrop_End, NULL, 0);
+    fail = check_pair(g, "Color4ubv quad strip", &setup, &pair);
+
+    /* a color for every other vertex only */
+    pair.len = 0;
+    mode = GL_TRIANGLE_FAN;
+    put_rop(&pair, X_GLrop_Begin, &mode, sizeof(mode));
+    for (i = 0; i < 10; i++) {
+        uint8_t c[4] = { i * 25, 77, 255 - i * 20, 0 };
+        float v[2] = { 0.9f * cosf(i * 0.6f), 0.9f * sinf(i * 0.6f) };
+
+        if (!(i & 1))
+            put_rop(&pair, X_GLrop_Color3ubv, c, sizeof(c));
+        put_rop(&pair, X_GLrop_Vertex2fv, v, sizeof(v));
+    }
+    put_rop(&pair, X_GLrop_End, NULL, 0);
+    fail |= check_pair(g, "Color3ubv triangle fan", &setup, &pair);
+
+    return fail;
+}
+
+/* a lit ring, like glxgears, so that the normals show */
+static int
+test_normals(struct glx *g)
+{
+    struct stream setup = { .len = 0 }, pair = { .len = 0 };
+    struct stream teardown = { .len = 0 };
+    uint32_t mode = GL_QUAD_STRIP;
+    int i, fail;
+
+    put_enable(&setup, X_GLrop_Enable, GL_LIGHTING);
+    put_enable(&setup, X_GLrop_Enable, GL_LIGHT0);
+    put_enable(&setup, X_GLrop_Enable, GL_COLOR_MATERIAL);
+
+    put_rop(&pair, X_GLrop_Begin, &mode, sizeof(mode));
+    for (i = 0; i < 32; i++) {
+        float a = i * 2 * M_PI / 32;
+        float n[3] = { cosf(a), sinf(a), 0.3f };
+        float v[3] = { (i & 1 ? 0.5f : 0.9f) * n[0],
+                       (i & 1 ? 0.5f : 0.9f) * n[1], 0 };
+
+        put_rop(&pair, X_GLrop_Normal3fv, n, sizeof(n));
+        put_rop(&pair, X_GLrop_Vertex3fv, v, sizeof(v));
+    }
+    put_rop(&pair, X_GLrop_End, NULL, 0);
+    fail = check_pair(g, "lit Normal3fv quad strip", &setup, &pair);
+
+    put_enable(&teardown, X_GLrop_Disable, GL_LIGHTING);
+    put_enable(&teardown, X_GLrop_Disable, GL_LIGHT0);
+    put_enable(&teardown, X_GLrop_Disable, GL_COLOR_MATERIAL);
+    xcb_glx_render(g->c, g->tag, teardown.len, teardown.cmds);
+
+    return fail;
+}
+
+/* every vertex type and texture coordinate size */
+static int
+test_vertex_types(struct glx *g)
+{
+    static const float color[4] = { 1, 0.5f, 0, 1 };
+    static const float t1[1] = { 0.3f }, t3[3] = { 0.7f, 0.1f, 0.2f };
+    static const int16_t v2s[2] = { -1, -1 };
+    static const double v3d[3] = { 0.3, -0.9, 0 };
+    static const int32_t v4i[4] = { 0, 1, 0, 2 };
+    static const float v4f[4] = { 0.2f, 0.2f, 0, 1 };
+    static const float v3f[2][3] = { { 0.9f, 0.2f, 0 }, { 0.5f, 0.9f, 0 } };
+    struct stream setup = { .len = 0 }, pair = { .len = 0 };
+    uint32_t mode = GL_TRIANGLES;
+
+    put_rop(&pair, X_GLrop_Begin, &mode, sizeof(mode));
+    put_rop(&pair, X_GLrop_Color4fv, color, sizeof(color));
+    put_rop(&pair, X_GLrop_TexCoord1fv, t1, sizeof(t1));
+    put_rop(&pair, X_GLrop_Vertex2sv, v2s, sizeof(v2s));
+    put_rop(&pair, X_GLrop_Vertex3dv, v3d, sizeof(v3d));
+    put_rop(&pair, X_GLrop_Vertex4iv, v4i, sizeof(v4i));
+    put_rop(&pair, X_GLrop_Vertex4fv, v4f, sizeof(v4f));
+    put_rop(&pair, X_GLrop_TexCoord3fv, t3, sizeof(t3));
+    put_rop(&pair, X_GLrop_Vertex3fv, v3f[0], sizeof(v3f[0]));
+    put_rop(&pair, X_GLrop_Vertex3fv, v3f[1], sizeof(v3f[1]));
+    put_rop(&pair, X_GLrop_End, NULL, 0);
+
+    return check_pair(g, "mixed vertex types", &setup, &pair);
+}
+
+/* the first vertex uses the current color, so the batcher declines */
+static int
+test_late_attribute(struct glx *g)
+{
+    struct stream setup = { .len = 0 }, pair = { .len = 0 };
+    uint32_t mode = GL_TRIANGLE_STRIP;
+    int i;
+
+    put_rop(&pair, X_GLrop_Begin, &mode, sizeof(mode));
+    for (i = 0; i < 8; i++) {
+        float c[3] = { 1, i / 8.0f, 0 };
+        float v[2] = { -0.9f + i * 0.25f, i & 1 ? 0.7f : -0.7f };
+
+        if (i)
+            put_rop(&pair, X_GLrop_Color3fv, c, sizeof(c));
+        put_rop(&pair, X_GLrop_Vertex2fv, v, sizeof(v));
+    }
+    put_rop(&pair, X_GLrop_End, NULL, 0);
+
+    return check_pair(g, "color set after the first vertex", &setup, &pair);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct glx g = { 0 };
+    int fail = 0;
+
+    g.c = xcb_connect(NULL, NULL);
+    assert(!xcb_connection_has_error(g.c));
+    g.screen = xcb_setup_roots_iterator(xcb_get_setup(g.c)).data;
+
+    if (!setup_glx(&g)) {
+        printf("no indirect GLX context\n");
+        return 77;
+    }
+
+    fail |= test_color3fv(&g);
+    fail |= test_color_ubv(&g);
+    fail |= test_normals(&g);
+    fail |= test_vertex_types(&g);
+    fail |= test_late_attribute(&g);
+
+    xcb_disconnect(g.c);
+    return fail;
+}
@@ -0,0 +1,328 @@
+/*
+ * Copyright © 2024 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Pointer motion over a deep stack of nested windows where hardly anyone
+ * listens.  Motion is injected with XTest and the time to deliver it is
+ * reported, first with no listener at all and then with a single
+ * listener halfway up the tree.  Along the way this checks that the
+ * listener gets the events, reported relative to the right window, and
+ * that it stops getting them once a window below it blocks propagation
+ * or it deselects.
+ *
+ * The same is then checked for a listener that selects XI device motion
+ * events for the XTest pointer or XI2 motion events for the master
+ * pointer, which the server tracks in separate per-window summaries.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xinput.h>
+#include <xcb/xtest.h>
+
+#define DEPTH           200
+#define LISTENER        (DEPTH / 2)
+#define NUM_MOTION      2000
+
+static xcb_window_t windows[DEPTH];
+static uint8_t xi_opcode, xi_event_base;
+
+static void
+sync_with_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+static double
+elapsed(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 +
+        (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static double
+move_pointer(xcb_connection_t *c, xcb_screen_t *screen)
+{
+    struct timespec start;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < NUM_MOTION; i++)
+        xcb_test_fake_input(c, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME,
+                            screen->root, DEPTH + 10 + i % 2, DEPTH + 10,
+                            XCB_NONE);
+    sync_with_server(c);
+    return elapsed(&start);
+}
+
+/*
+ * count the core, XI or XI2 motion events on c, checking they are
+ * reported on window
+ */
+static int
+count_motion(xcb_connection_t *c, xcb_window_t window, xcb_window_t child)
+{
+    xcb_generic_event_t *ev;
+    int count = 0;
+
+    sync_with_server(c);
+    while ((ev = xcb_poll_for_event(c))) {
+        int type = ev->response_type & 0x7f;
+
+        if (type == XCB_MOTION_NOTIFY) {
+            xcb_motion_notify_event_t *motion =
+                (xcb_motion_notify_event_t *) ev;
+
+            assert(motion->event == window);
+            assert(motion->child == child);
+            count++;
+        }
+        else if (type == xi_event_base + XCB_INPUT_DEVICE_MOTION_NOTIFY) {
+            xcb_input_device_motion_notify_event_t *motion =
+                (xcb_input_device_motion_notify_event_t *) ev;
+
+            assert(motion->event == window);
+            assert(motion->child == child);
+            count++;
+        }
+        else if (type == XCB_GE_GENERIC) {
+            xcb_input_motion_event_t *motion = (xcb_input_motion_event_t *) ev;
+
+            assert(motion->extension == xi_opcode);
+            assert(motion->event_type == XCB_INPUT_MOTION);
+            assert(motion->event == window);
+            assert(motion->child == child);
+            count++;
+        }
+        else {
+            /* the valuators that follow an XI motion event */
+            assert(type == xi_event_base + XCB_INPUT_DEVICE_VALUATOR);
+        }
+        free(ev);
+    }
+    return count;
+}
+
+/* the slave device XTest motion comes from */
+static xcb_input_device_id_t
+find_xtest_pointer(xcb_connection_t *c)
+{
+    static const char name[] = "Virtual core XTEST pointer";
+    xcb_input_xi_query_device_reply_t *reply;
+    xcb_input_xi_device_info_iterator_t it;
+    xcb_input_device_id_t id = 0;
+
+    reply = xcb_input_xi_query_device_reply(c,
+                xcb_input_xi_query_device(c, XCB_INPUT_DEVICE_ALL), NULL);
+    assert(reply);
+    for (it = xcb_input_xi_query_device_infos_iterator(reply); it.rem;
+         xcb_input_xi_device_info_next(&it)) {
+        if (it.data->type == XCB_INPUT_DEVICE_TYPE_SLAVE_POINTER &&
+            it.data->name_len == strlen(name) &&
+            !memcmp(xcb_input_xi_device_info_name(it.data), name,
+                    it.data->name_len))
+            id = it.data->deviceid;
+    }
+    free(reply);
+    assert(id);
+    return id;
+}
+
+static void
+select_xi2_motion(xcb_connection_t *c, xcb_window_t window, uint32_t mask)
+{
+    struct {
+        xcb_input_event_mask_t head;
+        uint32_t mask;
+    } em = { { XCB_INPUT_DEVICE_ALL_MASTER, 1 }, mask };
+
+    xcb_input_xi_select_events(c, window, 1, &em.head);
+}
+
+/* XI2 motion on an ancestor, selected, deselected and selected again */
+static void
+test_xi2(xcb_connection_t *c, xcb_connection_t *listener,
+         xcb_screen_t *screen)
+{
+    double t;
+
+    free(xcb_input_xi_query_version_reply(listener,
+             xcb_input_xi_query_version(listener, 2, 0), NULL));
+
+    select_xi2_motion(listener, windows[LISTENER],
+                      XCB_INPUT_XI_EVENT_MASK_MOTION);
+    sync_with_server(listener);
+    t = move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) > 0);
+    printf("%d windows deep, XI2 listener at depth %d: %.2f us per motion event\n",
+           DEPTH, LISTENER, t * 1e3 / NUM_MOTION);
+
+    select_xi2_motion(listener, windows[LISTENER], 0);
+    move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) == 0);
+
+    select_xi2_motion(listener, windows[LISTENER],
+                      XCB_INPUT_XI_EVENT_MASK_MOTION);
+    move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) > 0);
+
+    select_xi2_motion(listener, windows[LISTENER], 0);
+    move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) == 0);
+}
+
+/*
+ * XI device motion on an ancestor, blocked by a device do-not-propagate
+ * list below it and then deselected.  XI has no way to select nothing for
+ * a device, so deselecting selects button presses instead.
+ */
+static void
+test_xi(xcb_connection_t *c, xcb_connection_t *listener,
+        xcb_screen_t *screen)
+{
+    xcb_input_device_id_t id = find_xtest_pointer(listener);
+    xcb_input_event_class_t class, button;
+    double t;
+
+    class = id << 8 | (xi_event_base + XCB_INPUT_DEVICE_MOTION_NOTIFY);
+    button = id << 8 | (xi_event_base + XCB_INPUT_DEVICE_BUTTON_PRESS);
+
+    xcb_input_select_extension_event(listener, windows[LISTENER], 1, &class);
+    sync_with_server(listener);
+    t = move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) > 0);
+    printf("%d windows deep, XI listener at depth %d: %.2f us per motion event\n",
+           DEPTH, LISTENER, t * 1e3 / NUM_MOTION);
+
+    xcb_input_change_device_dont_propagate_list(c, windows[DEPTH - 10], 1,
+        XCB_INPUT_PROPAGATE_MODE_ADD_TO_LIST, &class);
+    move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) == 0);
+
+    xcb_input_change_device_dont_propagate_list(c, windows[DEPTH - 10], 1,
+        XCB_INPUT_PROPAGATE_MODE_DELETE_FROM_LIST, &class);
+    move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) > 0);
+
+    xcb_input_select_extension_event(listener, windows[LISTENER], 1, &button);
+    move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) == 0);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_connection_t *listener = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    const xcb_query_extension_reply_t *xi;
+    xcb_window_t parent = screen->root;
+    uint32_t mask;
+    double t;
+    int i;
+
+    xi = xcb_get_extension_data(listener, &xcb_input_id);
+    if (!xcb_get_extension_data(c, &xcb_test_id)->present || !xi->present) {
+        printf("XTEST or XInputExtension not supported\n");
+        xcb_disconnect(c);
+        xcb_disconnect(listener);
+        return 77;
+    }
+
+    xi_opcode = xi->major_opcode;
+    xi_event_base = xi->first_event;
+
+    /* each window one pixel inside its parent */
+    for (i = 0; i < DEPTH; i++) {
+        windows[i] = xcb_generate_id(c);
+        xcb_create_window(c, XCB_COPY_FROM_PARENT, windows[i], parent,
+                          i ? 1 : 0, i ? 1 : 0, 2 * DEPTH + 20 - 2 * i,
+                          2 * DEPTH + 20 - 2 * i, 0,
+                          XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                          XCB_COPY_FROM_PARENT, 0, NULL);
+        parent = windows[i];
+    }
+    for (i = DEPTH - 2; i >= 0; i--)
+        xcb_map_subwindows(c, windows[i]);
+    xcb_map_window(c, windows[0]);
+    sync_with_server(c);
+
+    t = move_pointer(c, screen);
+    printf("%d windows deep, no listener: %.2f us per motion event\n",
+           DEPTH, t * 1e3 / NUM_MOTION);
+
+    mask = XCB_EVENT_MASK_POINTER_MOTION;
+    xcb_change_window_attributes(listener, windows[LISTENER],
+                                 XCB_CW_EVENT_MASK, &mask);
+    sync_with_server(listener);
+    t = move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) > 0);
+    printf("%d windows deep, listener at depth %d: %.2f us per motion event\n",
+           DEPTH, LISTENER, t * 1e3 / NUM_MOTION);
+
+    /* blocked on the way up */
+    xcb_change_window_attributes(c, windows[DEPTH - 10],
+                                 XCB_CW_DONT_PROPAGATE, &mask);
+    move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) == 0);
+
+    mask = 0;
+    xcb_change_window_attributes(c, windows[DEPTH - 10],
+                                 XCB_CW_DONT_PROPAGATE, &mask);
+    move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) > 0);
+
+    /* and gone again */
+    xcb_change_window_attributes(listener, windows[LISTENER],
+                                 XCB_CW_EVENT_MASK, &mask);
+    move_pointer(c, screen);
+    assert(count_motion(listener, windows[LISTENER],
+                        windows[LISTENER + 1]) == 0);
+
+    test_xi2(c, listener, screen);
+    test_xi(c, listener, screen);
+
+    xcb_disconnect(listener);
+    xcb_disconnect(c);
+    return 0;
+}
@@ -0,0 +1,388 @@
+/*
+ * Copyright © 2024 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Records a stream of ChangeProperty requests once over the recording
+ * client's connection and once into a shared memory ring, using the
+ * EnableContextShm request, and checks that both deliver the same
+ * requests in the order they were made.  The ring is much smaller than
+ * the recorded data, so it wraps and fills up along the way.  The ring
+ * is recorded into a second time without reading it until the context
+ * has been disabled, so the server is left holding most of the data and
+ * has to keep the client informed while it drains.  The time taken to
+ * make the requests is reported with no recording and with each
+ * transport.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/uio.h>
+#include <xcb/xcbext.h>
+#include <xcb/record.h>
+#include <xcb/shm.h>
+#include <X11/Xmd.h>
+#include <X11/extensions/recordproto.h>
+
+#define NUM_REQUESTS            20000
+#define BATCH                   100
+#define RING_SIZE               (64 * 1024)
+#define NOTIFY_BYTES            (16 * 1024)
+
+/* fields of xRecordRingHeader, in CARD32s */
+#define RING_HEAD               0
+#define RING_SIZE_FIELD         1
+#define RING_TAIL               16
+
+struct stream {
+    uint8_t *data;
+    size_t len, size;
+};
+
+struct transport {
+    xcb_connection_t *c;
+    unsigned int sequence;      /* of the EnableContext(Shm) request */
+    uint32_t *ring;             /* or NULL for the connection */
+    struct stream recorded;
+    int done;
+};
+
+static void
+sync_with_server(xcb_connection_t *c)
+{
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+}
+
+static double
+elapsed(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 +
+        (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void
+stream_append(struct stream *s, const void *data, size_t len)
+{
+    if (s->len + len > s->size) {
+        s->size = s->size * 2 + len;
+        s->data = realloc(s->data, s->size);
+        assert(s->data);
+    }
+    memcpy(s->data + s->len, data, len);
+    s->len += len;
+}
+
+static unsigned int
+enable_context_shm(xcb_connection_t *c, xcb_record_context_t context,
+                   xcb_shm_seg_t shmseg)
+{
+    static const xcb_protocol_request_t request = {
+        .count = 2,
+        .ext = &xcb_record_id,
+        .opcode = X_RecordEnableContextShm,
+        .isvoid = 0
+    };
+    xRecordEnableContextShmReq out = {
+        .context = context,
+        .shmseg = shmseg,
+        .offset = 0,
+        .size = RING_SIZE,
+        .notifyBytes = NOTIFY_BYTES
+    };
+    struct iovec parts[4];
+
+    parts[2].iov_base = &out;
+    parts[2].iov_len = sizeof(out);
+    parts[3].iov_base = NULL;
+    parts[3].iov_len = 0;
+    return xcb_send_request(c, 0, parts + 2, &request);
+}
+
+/* take in one reply of the recording client */
+static void
+handle_reply(struct transport *t, uint8_t *reply)
+{
+    if (t->ring) {
+        uint8_t *data = (uint8_t *) t->ring + sz_xRecordRingHeader;
+        uint32_t size = t->ring[RING_SIZE_FIELD];
+        uint32_t head = __atomic_load_n(&t->ring[RING_HEAD], __ATOMIC_ACQUIRE);
+        uint32_t tail = t->ring[RING_TAIL];
+
+        while (tail != head) {
+            uint32_t pos = tail % size;
+            uint32_t n = head - tail < size - pos ? head - tail : size - pos;
+
+            stream_append(&t->recorded, data + pos, n);
+            tail += n;
+        }
+        __atomic_store_n(&t->ring[RING_TAIL], tail, __ATOMIC_RELEASE);
+    }
+    else {
+        xcb_record_enable_context_reply_t *rep =
+            (xcb_record_enable_context_reply_t *) reply;
+
+        stream_append(&t->recorded, reply, 32 + rep->length * 4);
+    }
+    t->done = reply[1] == XRecordEndOfData;
+    free(reply);
+}
+
+static void
+poll_replies(struct transport *t)
+{
+    xcb_generic_error_t *error = NULL;
+    void *reply;
+
+    while (!t->done && xcb_poll_for_reply(t->c, t->sequence, &reply, &error)) {
+        assert(!error);
+        if (!reply)
+            break;
+        handle_reply(t, reply);
+    }
+}
+
+static void
+change_properties(xcb_connection_t *c, xcb_window_t root, xcb_atom_t atom,
+                  struct transport *t)
+{
+    uint32_t data[64];
+    int i, j;
+
+    for (i = 0; i < NUM_REQUESTS; i++) {
+        int n = 1 + i % 64;
+
+        data[0] = i;
+        for (j = 1; j < n; j++)
+            data[j] = i * 31 + j;
+        xcb_change_property(c, XCB_PROP_MODE_REPLACE, root, atom,
+                            XCB_ATOM_INTEGER, 32, n, data);
+        if (i % BATCH == BATCH - 1) {
+            sync_with_server(c);
+            if (t)
+                poll_replies(t);
+        }
+    }
+    sync_with_server(c);
+}
+
+/* the requests in a recorded stream, checking its framing */
+static void
+recorded_requests(struct stream *s, struct stream *requests)
+{
+    size_t off = 0;
+    int category = -1;
+
+    while (off < s->len) {
+        const uint8_t *rep = s->data + off;
+        size_t len;
+
+        assert(s->len - off >= 32);
+        assert(rep[0] == 1);      /* X_Reply */
+        len = *(const uint32_t *) (rep + 4) * 4;
+        assert(s->len - off - 32 >= len);
+        assert(category != -1 || rep[1] == XRecordStartOfData);
+        category = rep[1];
+        if (category == XRecordFromClient)
+            stream_append(requests, rep + 32, len);
+        off += 32 + len;
+    }
+    assert(category == XRecordEndOfData);
+}
+
+static void
+check_requests(struct stream *requests)
+{
+    size_t off = 0;
+    int i = 0;
+
+    while (off < requests->len) {
+        const uint8_t *req = requests->data + off;
+        const uint32_t *data = (const uint32_t *) (req + 24);
+
+        assert(req[0] == XCB_CHANGE_PROPERTY);
+        assert(*(const uint32_t *) (req + 20) == 1 + i % 64);
+        assert(data[0] == i);
+        off += *(const uint16_t *) (req + 2) * 4;
+        i++;
+    }
+    assert(off == requests->len);
+    assert(i == NUM_REQUESTS);
+}
+
+/* record the requests, reading the recorded data as they are made if
+ * consume is set, and only once the context is disabled otherwise
+ */
+static double
+record(xcb_connection_t *c, xcb_connection_t *control, xcb_record_context_t context,
+       xcb_window_t root, xcb_atom_t atom, struct transport *t, int consume)
+{
+    xcb_generic_error_t *error = NULL;
+    struct timespec start;
+    void *reply;
+
+    /* the first reply says recording has started */
+    reply = xcb_wait_for_reply(t->c, t->sequence, &error);
+    if (!reply) {
+        free(error);
+        return -1;
+    }
+    handle_reply(t, reply);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    change_properties(c, root, atom, consume ? t : NULL);
+    xcb_record_disable_context(control, context);
+    sync_with_server(control);
+    while (!t->done) {
+        reply = xcb_wait_for_reply(t->c, t->sequence, &error);
+        assert(reply && !error);
+        handle_reply(t, reply);
+    }
+    return elapsed(&start);
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_connection_t *control = xcb_connect(NULL, NULL);
+    xcb_connection_t *data = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    xcb_record_context_t context = xcb_generate_id(control);
+    xcb_record_client_spec_t spec = XCB_RECORD_CS_ALL_CLIENTS;
+    xcb_record_range_t range = {
+        .core_requests = { XCB_CHANGE_PROPERTY, XCB_CHANGE_PROPERTY }
+    };
+    struct transport classic = { .c = data }, ring = { .c = data };
+    struct transport backlog = { .c = data };
+    struct stream classic_requests = { 0 }, ring_requests = { 0 };
+    struct stream backlog_requests = { 0 };
+    xcb_record_query_version_reply_t *version;
+    xcb_intern_atom_reply_t *atom;
+    xcb_shm_seg_t shmseg;
+    double t_none, t_classic, t_ring;
+    struct timespec start;
+    int shmid;
+
+    if (!xcb_get_extension_data(control, &xcb_record_id)->present ||
+        !xcb_get_extension_data(data, &xcb_shm_id)->present) {
+        printf("RECORD or MIT-SHM not supported\n");
+        return 77;
+    }
+    version = xcb_record_query_version_reply(control,
+                                             xcb_record_query_version(control,
+                                                                      1, 14),
+                                             NULL);
+    assert(version);
+    if (version->major_version == 1 && version->minor_version < 14) {
+        printf("RECORD 1.14 (EnableContextShm) not supported\n");
+        return 77;
+    }
+    free(version);
+
+    shmid = shmget(IPC_PRIVATE, sz_xRecordRingHeader + RING_SIZE, IPC_CREAT | 0600);
+    if (shmid == -1) {
+        printf("shmget failed\n");
+        return 77;
+    }
+    ring.ring = shmat(shmid, NULL, 0);
+    assert(ring.ring != (void *) -1);
+    backlog.ring = ring.ring;
+    shmseg = xcb_generate_id(data);
+    if (xcb_request_check(data, xcb_shm_attach_checked(data, shmseg, shmid, 0))) {
+        printf("MIT-SHM segment can't be attached\n");
+        shmctl(shmid, IPC_RMID, NULL);
+        return 77;
+    }
+    shmctl(shmid, IPC_RMID, NULL);
+
+    atom = xcb_intern_atom_reply(c, xcb_intern_atom(c, 0, 11, "RECORD_TEST"),
+                                 NULL);
+    assert(atom);
+    assert(!xcb_request_check(control,
+                              xcb_record_create_context_checked(control, context,
+                                                                0, 1, 1,
+                                                                &spec,
+                                                                &range)));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    change_properties(c, screen->root, atom->atom, NULL);
+    t_none = elapsed(&start);
+
+    classic.sequence = xcb_record_enable_context(data, context).sequence;
+    t_classic = record(c, control, context, screen->root, atom->atom, &classic,
+                       1);
+    assert(t_classic >= 0);
+
+    ring.sequence = enable_context_shm(data, context, shmseg);
+    t_ring = record(c, control, context, screen->root, atom->atom, &ring, 1);
+    assert(t_ring >= 0);
+
+    /* the context is disabled with nearly all the data still in the
+     * server; EndOfData only comes if the server goes on telling the
+     * client how far the ring has been filled
+     */
+    backlog.sequence = enable_context_shm(data, context, shmseg);
+    assert(record(c, control, context, screen->root, atom->atom, &backlog,
+                  0) >= 0);
+
+    recorded_requests(&classic.recorded, &classic_requests);
+    recorded_requests(&ring.recorded, &ring_requests);
+    recorded_requests(&backlog.recorded, &backlog_requests);
+    check_requests(&classic_requests);
+    assert(ring_requests.len == classic_requests.len);
+    assert(!memcmp(ring_requests.data, classic_requests.data,
+                   classic_requests.len));
+    assert(backlog_requests.len == classic_requests.len);
+    assert(!memcmp(backlog_requests.data, classic_requests.data,
+                   classic_requests.len));
+
+    printf("%d ChangeProperty requests, %zu bytes recorded: %.1f ms "
+           "unrecorded, %.1f ms recorded over the connection, %.1f ms "
+           "recorded into a %d kB ring\n", NUM_REQUESTS,
+           classic_requests.len, t_none, t_classic, t_ring, RING_SIZE / 1024);
+
+    xcb_record_free_context(control, context);
+    xcb_shm_detach(data, shmseg);
+    shmdt(ring.ring);
+    free(atom);
+    free(classic.recorded.data);
+    free(ring.recorded.data);
+    free(backlog.recorded.data);
+    free(classic_requests.data);
+    free(ring_requests.data);
+    free(backlog_requests.data);
+    xcb_disconnect(data);
+    xcb_disconnect(control);
+    xcb_disconnect(c);
+    return 0;
+}
@@ -0,0 +1,404 @@
+/*
+ * Copyright © 2024 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "inputstr.h"
+#include "servermd.h"
+#include "mi.h"
+
+#include "tests-common.h"
+
+/*
+ * Drives synthetic pointer motion over a tree of 1000 top-level windows,
+ * with windows moving, restacking and (un)mapping underneath it, and checks
+ * that the indexed miSpriteTrace finds the same window as a plain walk of
+ * the sibling lists.  The tree is built and changed through CreateWindow,
+ * ConfigureWindow, MapWindow and UnmapWindow, so the index is kept up to
+ * date by the hooks in dix, and freed with the server client's resources.
+ * The benchmark does the same with ten times the motion and reports the
+ * time spent in both traces for comparison.
+ */
+
+#define NUM_TOPLEVEL    1000
+#define NUM_CHANGES     100
+#define MAX_STROKE      200
+#define SCREEN_WIDTH    1920
+#define SCREEN_HEIGHT   1080
+
+static ScreenRec screen;
+static ClientRec server_client;
+static WindowPtr toplevel[NUM_TOPLEVEL];
+
+static Bool
+window_hook(WindowPtr win)
+{
+    return TRUE;
+}
+
+static Bool
+change_window_attributes(WindowPtr win, unsigned long mask)
+{
+    return TRUE;
+}
+
+static Bool
+position_window(WindowPtr win, int x, int y)
+{
+    return TRUE;
+}
+
+static void
+copy_window(WindowPtr win, DDXPointRec origin, RegionPtr src)
+{
+}
+
+static void
+window_exposures(WindowPtr win, RegionPtr exposed)
+{
+}
+
+static void
+paint_window(WindowPtr win, RegionPtr region, int what)
+{
+}
+
+static Bool
+device_cursor_init(DeviceIntPtr dev, ScreenPtr pScreen)
+{
+    return TRUE;
+}
+
+static void
+device_cursor_cleanup(DeviceIntPtr dev, ScreenPtr pScreen)
+{
+}
+
+static Bool
+cursor_hook(DeviceIntPtr dev, ScreenPtr pScreen, CursorPtr cursor)
+{
+    return TRUE;
+}
+
+static void
+cursor_limits(DeviceIntPtr dev, ScreenPtr pScreen, CursorPtr cursor,
+              BoxPtr hot, BoxPtr limits)
+{
+    *limits = *hot;
+}
+
+static void
+constrain_cursor(DeviceIntPtr dev, ScreenPtr pScreen, BoxPtr box)
+{
+}
+
+static Bool
+set_cursor_position(DeviceIntPtr dev, ScreenPtr pScreen, int x, int y,
+                    Bool generate_event)
+{
+    return TRUE;
+}
+
+static WindowPtr
+sprite_trace_init_screen(void)
+{
+    CursorMetricRec cm;
+    XID cid;
+
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+    screenInfo.numPixmapFormats = 1;
+    screenInfo.formats[0].depth = 24;
+    screenInfo.formats[0].bitsPerPixel = 32;
+    screenInfo.formats[0].scanlinePad = 32;
+
+    screen.myNum = 0;
+    screen.id = 100;
+    screen.width = SCREEN_WIDTH;
+    screen.height = SCREEN_HEIGHT;
+    screen.rootDepth = 24;
+    screen.rootVisual = 0x21;
+    screen.defColormap = 0x20;
+
+    screen.CreateWindow = window_hook;
+    screen.DestroyWindow = window_hook;
+    screen.RealizeWindow = window_hook;
+    screen.UnrealizeWindow = window_hook;
+    screen.PositionWindow = position_window;
+    screen.CopyWindow = copy_window;
+    screen.WindowExposures = window_exposures;
+    screen.PaintWindow = paint_window;
+    screen.MoveWindow = miMoveWindow;
+    screen.GetLayerWindow = miGetLayerWindow;
+    screen.MarkWindow = miMarkWindow;
+    screen.MarkOverlappedWindows = miMarkOverlappedWindows;
+    screen.MarkUnrealizedWindow = miMarkUnrealizedWindow;
+    screen.ValidateTree = miValidateTree;
+    screen.HandleExposures = miHandleValidateExposures;
+    screen.ChangeWindowAttributes = change_window_attributes;
+    screen.XYToWindow = miXYToWindow;
+    screen.DeviceCursorInitialize = device_cursor_init;
+    screen.DeviceCursorCleanup = device_cursor_cleanup;
+    screen.RealizeCursor = cursor_hook;
+    screen.UnrealizeCursor = cursor_hook;
+    screen.DisplayCursor = cursor_hook;
+    screen.CursorLimits = cursor_limits;
+    screen.ConstrainCursor = constrain_cursor;
+    screen.SetCursorPosition = set_cursor_position;
+
+    dixResetPrivates();
+    assert(miSpriteTraceInit());
+
+    serverClient = &server_client;
+    InitClient(serverClient, 0, (void *) NULL);
+    assert(InitClientResources(serverClient));
+
+    /* the root window and core devices, in the order dix main sets them up */
+    InitAtoms();
+    SyncExtensionInit();
+    assert(CreateRootWindow(&screen));
+    cid = FakeClientID(0);
+    cm.width = cm.height = 1;
+    cm.xhot = cm.yhot = 0;
+    assert(AllocARGBCursor(calloc(1, BitmapBytePad(1)),
+                           calloc(1, BitmapBytePad(1)), NULL, &cm,
+                           0, 0, 0, ~0, ~0, ~0, &rootCursor, serverClient,
+                           cid) == Success);
+    assert(AddResource(cid, RT_CURSOR, rootCursor));
+    InitRootWindow(screen.root);
+    InitCoreDevices();
+
+    return screen.root;
+}
+
+static WindowPtr
+create_window(WindowPtr parent, int x, int y, int w, int h, int bw)
+{
+    XID id = FakeClientID(0);
+    WindowPtr win;
+    int rc;
+
+    win = CreateWindow(id, parent, x, y, w, h, bw, CopyFromParent, 0, NULL,
+                       0, serverClient, CopyFromParent, &rc);
+    assert(win && rc == Success);
+    assert(AddResource(id, RT_WINDOW, win));
+    return win;
+}
+
+static void
+move_window(WindowPtr win, int x, int y)
+{
+    XID vlist[2] = { x, y };
+
+    assert(ConfigureWindow(win, CWX | CWY, vlist, serverClient) == Success);
+}
+
+/* as XRaiseWindow, XLowerWindow or XRestackWindows with a sibling */
+static void
+restack_window(WindowPtr win, WindowPtr sibling, int mode)
+{
+    XID vlist[2];
+    Mask mask = CWStackMode;
+    int n = 0;
+
+    if (sibling) {
+        if (sibling == win)
+            return;
+        vlist[n++] = sibling->drawable.id;
+        mask |= CWSibling;
+    }
+    vlist[n++] = mode;
+    assert(ConfigureWindow(win, mask, vlist, serverClient) == Success);
+}
+
+/* miSpriteTrace as it was before the index, minus shapes */
+static WindowPtr
+reference_trace(WindowPtr root, int x, int y)
+{
+    WindowPtr win = root->firstChild;
+    WindowPtr found = root;
+
+    while (win) {
+        int bw = wBorderWidth(win);
+
+        if (win->mapped &&
+            x >= win->drawable.x - bw &&
+            x < win->drawable.x + (int) win->drawable.width + bw &&
+            y >= win->drawable.y - bw &&
+            y < win->drawable.y + (int) win->drawable.height + bw) {
+            found = win;
+            win = win->firstChild;
+        }
+        else
+            win = win->nextSib;
+    }
+    return found;
+}
+
+static double
+elapsed(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 +
+        (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/*
+ * Change the tree NUM_CHANGES times, each time followed by a stroke of
+ * motion events, and check that both traces agree.  The time spent in
+ * each trace is added to t_index and t_linear.
+ */
+static void
+sprite_trace_motion(int stroke, double *t_index, double *t_linear)
+{
+    SpriteRec sprite = { 0 };
+    WindowPtr root, expected[MAX_STROKE], got[MAX_STROKE];
+    int px[MAX_STROKE], py[MAX_STROKE];
+    struct timespec start;
+    int i, j;
+
+    assert(stroke <= MAX_STROKE);
+
+    root = sprite_trace_init_screen();
+    srand(0x5eed);
+
+    for (i = 0; i < NUM_TOPLEVEL; i++) {
+        WindowPtr win = create_window(root,
+                                      rand() % SCREEN_WIDTH - 100,
+                                      rand() % SCREEN_HEIGHT - 100,
+                                      40 + rand() % 400, 40 + rand() % 300,
+                                      rand() % 3);
+
+        /* a title bar and a client window, like a reparenting WM */
+        create_window(win, 0, 0, win->drawable.width, 20, 0);
+        create_window(win, 0, 20, win->drawable.width,
+                      win->drawable.height - 20, 0);
+        toplevel[i] = win;
+    }
+    /* and one toplevel with enough children to be indexed itself */
+    for (i = 0; i < 64; i++)
+        create_window(toplevel[0], (i % 8) * 30, (i / 8) * 30, 25, 25, 1);
+    for (i = 0; i < NUM_TOPLEVEL; i++) {
+        MapSubwindows(toplevel[i], serverClient);
+        MapWindow(toplevel[i], serverClient);
+    }
+    move_window(toplevel[0], 100, 100);
+    restack_window(toplevel[0], NULL, Above);
+
+    sprite.spriteTraceSize = 10;
+    sprite.spriteTrace = calloc(sprite.spriteTraceSize, sizeof(WindowPtr));
+    sprite.spriteTrace[0] = root;
+
+    for (i = 0; i < NUM_CHANGES; i++) {
+        WindowPtr win = toplevel[rand() % NUM_TOPLEVEL];
+
+        /* change the tree underneath the pointer */
+        switch (rand() % 5) {
+        case 0:
+            move_window(win, rand() % SCREEN_WIDTH - 100,
+                        rand() % SCREEN_HEIGHT - 100);
+            break;
+        case 1:
+            restack_window(win, NULL, Above);
+            break;
+        case 2:
+            restack_window(win, NULL, Below);
+            break;
+        case 3:
+            restack_window(win, toplevel[rand() % NUM_TOPLEVEL], Above);
+            break;
+        case 4:
+            if (win->mapped)
+                UnmapWindow(win, FALSE);
+            else
+                MapWindow(win, serverClient);
+            break;
+        }
+
+        /* a short stroke of motion events */
+        px[0] = rand() % SCREEN_WIDTH;
+        py[0] = rand() % SCREEN_HEIGHT;
+        for (j = 1; j < stroke; j++) {
+            px[j] = max(0, min(SCREEN_WIDTH - 1, px[j - 1] + rand() % 21 - 10));
+            py[j] = max(0, min(SCREEN_HEIGHT - 1, py[j - 1] + rand() % 21 - 10));
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < stroke; j++) {
+            sprite.spriteTraceGood = 1;
+            got[j] = miSpriteTrace(&sprite, px[j], py[j]);
+        }
+        *t_index += elapsed(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < stroke; j++)
+            expected[j] = reference_trace(root, px[j], py[j]);
+        *t_linear += elapsed(&start);
+
+        for (j = 0; j < stroke; j++)
+            assert(got[j] == expected[j]);
+    }
+
+    free(sprite.spriteTrace);
+
+    /* destroys the root, every window in the tree and the root cursor */
+    FreeClientResources(serverClient);
+    assert(!screen.root);
+    CloseDownDevices();
+}
+
+int
+sprite_trace_test(void)
+{
+    double t_index = 0, t_linear = 0;
+
+    sprite_trace_motion(MAX_STROKE / 10, &t_index, &t_linear);
+
+    return 0;
+}
+
+int
+sprite_trace_benchmark(void)
+{
+    double t_index = 0, t_linear = 0;
+
+    sprite_trace_motion(MAX_STROKE, &t_index, &t_linear);
+    printf("%d motion events over %d windows: %.2f ms indexed, "
+           "%.2f ms linear\n", NUM_CHANGES * MAX_STROKE, NUM_TOPLEVEL,
+           t_index, t_linear);
+
+    return 0;
+}
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <time.h>
 #include <xcb/sync.h>
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
@@ -281,6 +282,86 @@ test_change_alarm_delta(xcb_connection_t *c)
     }
 }
 
+/* Puts a few thousand alarms on one counter and steps the counter through
+ * them, checking that each step fires exactly the alarm whose value was
+ * crossed.  The time taken is reported, as compositors and frame timing
+ * clients put this many alarms on the same counter.
+ */
+static void
+test_many_alarms(xcb_connection_t *c, const xcb_query_extension_reply_t *ext)
+{
+    enum { num_alarms = 10000, num_changes = 2 * num_alarms };
+    xcb_sync_counter_t counter = xcb_generate_id(c);
+    static xcb_sync_alarm_t alarms[num_alarms];
+    xcb_generic_event_t *ev;
+    struct timespec start, end;
+    int events = 0;
+
+    xcb_sync_create_counter(c, counter, sync_value(0));
+
+    for (int i = 0; i < num_alarms; i++) {
+        uint32_t values[] = {
+            counter,
+            XCB_SYNC_VALUETYPE_ABSOLUTE,
+            0, i + 1,
+            XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON,
+            0, num_alarms,
+            1,
+        };
+
+        alarms[i] = xcb_generate_id(c);
+        xcb_sync_create_alarm(c, alarms[i],
+                              XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE |
+                              XCB_SYNC_CA_VALUE | XCB_SYNC_CA_TEST_TYPE |
+                              XCB_SYNC_CA_DELTA | XCB_SYNC_CA_EVENTS,
+                              values);
+    }
+    free(xcb_sync_query_counter_reply(c,
+                                      xcb_sync_query_counter(c, counter),
+                                      NULL));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_changes; i++)
+        xcb_sync_change_counter(c, counter, sync_value(1));
+    if (counter_value(c, xcb_sync_query_counter(c, counter)) != num_changes) {
+        fprintf(stderr, "Counter with many alarms lost changes\n");
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("%d counter changes with %d alarms: %.1f ms\n",
+           num_changes, num_alarms,
+           (end.tv_sec - start.tv_sec) * 1e3 +
+           (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    while ((ev = xcb_poll_for_queued_event(c))) {
+        xcb_sync_alarm_notify_event_t *notify =
+            (xcb_sync_alarm_notify_event_t *) ev;
+
+        if ((ev->response_type & 0x7f) !=
+            ext->first_event + XCB_SYNC_ALARM_NOTIFY) {
+            free(ev);
+            continue;
+        }
+
+        /* change i crosses the value of alarm i % num_alarms */
+        if (notify->alarm != alarms[events % num_alarms] ||
+            pack_sync_value(notify->counter_value) != events + 1) {
+            fprintf(stderr, "Alarm notify %d for the wrong alarm or value\n",
+                    events);
+            exit(1);
+        }
+        events++;
+        free(ev);
+    }
+
+    if (events != num_changes) {
+        fprintf(stderr, "%d counter changes fired %d alarms\n",
+                num_changes, events);
+        exit(1);
+    }
+}
+
 int main(int argc, char **argv)
 {
     int screen;
@@ -298,6 +379,7 @@ int main(int argc, char **argv)
     test_change_counter_overflow(c);
     test_change_alarm_value(c);
     test_change_alarm_delta(c);
+    test_many_alarms(c, ext);
 
     xcb_disconnect(c);
     exit(0);
@@ -2,18 +2,39 @@
 #include "tests.h"
 #include "tests-common.h"
 
+/* timings, run by meson benchmark rather than meson test */
+static void
+run_benchmarks(void)
+{
+#ifdef XORG_TESTS
+    run_test(fb_blt_benchmark);
+    run_test(fb_image_benchmark);
+    run_test(sprite_trace_benchmark);
+    run_test(validate_tree_benchmark);
+#endif
+}
+
 int
 main(int argc, char **argv)
 {
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        run_benchmarks();
+        return 0;
+    }
+
     run_test(list_test);
     run_test(string_test);
 
 #ifdef XORG_TESTS
+    run_test(fb_blt_test);
+    run_test(fb_image_test);
     run_test(fixes_test);
     run_test(input_test);
     run_test(misc_test);
     run_test(signal_logging_test);
+    run_test(sprite_trace_test);
     run_test(touch_test);
+    run_test(validate_tree_test);
     run_test(xfree86_test);
     run_test(xkb_test);
     run_test(xtest_test);
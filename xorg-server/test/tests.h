@@ -1,18 +1,27 @@
 #ifndef TESTS_H
 #define TESTS_H
 
+int fb_blt_test(void);
+int fb_image_test(void);
 int fixes_test(void);
 int hashtabletest_test(void);
 int input_test(void);
 int list_test(void);
 int misc_test(void);
 int signal_logging_test(void);
+int sprite_trace_test(void);
 int string_test(void);
 int touch_test(void);
+int validate_tree_test(void);
 int xfree86_test(void);
 int xkb_test(void);
 int xtest_test(void);
 
+int fb_blt_benchmark(void);
+int fb_image_benchmark(void);
+int sprite_trace_benchmark(void);
+int validate_tree_benchmark(void);
+
 int protocol_xchangedevicecontrol_test(void);
 
 int protocol_xiqueryversion_test(void);
@@ -0,0 +1,344 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "mi.h"
+#include "mivalidate.h"
+#include "regionstr.h"
+
+#include "tests-common.h"
+
+/*
+ * A second copy of miValidateTree that counts the region operations it
+ * does: intersections, unions, subtractions and the validation of
+ * appended regions.
+ */
+int countedValidateTree(WindowPtr pParent, WindowPtr pChild, VTKind kind);
+int countedShapedWindowIn(RegionPtr universe, RegionPtr bounding,
+                          BoxPtr rect, int x, int y);
+
+static int region_op_count;
+
+static Bool
+counted_intersect(RegionPtr dst, RegionPtr a, RegionPtr b)
+{
+    region_op_count++;
+    return RegionIntersect(dst, a, b);
+}
+
+static Bool
+counted_union(RegionPtr dst, RegionPtr a, RegionPtr b)
+{
+    region_op_count++;
+    return RegionUnion(dst, a, b);
+}
+
+static Bool
+counted_subtract(RegionPtr dst, RegionPtr a, RegionPtr b)
+{
+    region_op_count++;
+    return RegionSubtract(dst, a, b);
+}
+
+static Bool
+counted_validate(RegionPtr region, Bool *overlap)
+{
+    region_op_count++;
+    return RegionValidate(region, overlap);
+}
+
+#define RegionIntersect counted_intersect
+#define RegionUnion counted_union
+#define RegionSubtract counted_subtract
+#define RegionValidate counted_validate
+#define miValidateTree countedValidateTree
+#define miShapedWindowIn countedShapedWindowIn
+#include "../mi/mivaltree.c"
+#undef RegionIntersect
+#undef RegionUnion
+#undef RegionSubtract
+#undef RegionValidate
+#undef miValidateTree
+#undef miShapedWindowIn
+
+/*
+ * Drags windows across a dense stack through miMoveWindow, the path
+ * ConfigureWindow takes, and checks after every step that each window's
+ * clipList and borderClip match clips computed from scratch.  The
+ * benchmark drags them further and reports, per move, the number of
+ * windows whose clips were recomputed (ClipNotify calls), the region
+ * operations miValidateTree did and the time taken.
+ */
+
+#define NUM_TOPLEVEL    300
+#define NUM_STEPS       100
+#define SCREEN_WIDTH    1920
+#define SCREEN_HEIGHT   1080
+
+struct drag_stats {
+    int clipped;
+    int region_ops;
+    double ms;
+};
+
+static int clip_notify_count;
+
+static void
+count_clip_notify(WindowPtr win, int dx, int dy)
+{
+    clip_notify_count++;
+}
+
+static Bool
+position_window(WindowPtr win, int x, int y)
+{
+    return TRUE;
+}
+
+static void
+copy_window(WindowPtr win, DDXPointRec origin, RegionPtr src)
+{
+}
+
+static void
+window_exposures(WindowPtr win, RegionPtr exposed)
+{
+}
+
+static void
+paint_window(WindowPtr win, RegionPtr region, int what)
+{
+}
+
+static WindowPtr
+create_window(ScreenPtr screen, WindowPtr parent,
+              int x, int y, int w, int h, int bw)
+{
+    WindowPtr win = dixAllocateObjectWithPrivates(WindowRec, PRIVATE_WINDOW);
+
+    assert(win);
+    win->drawable.pScreen = screen;
+    win->drawable.type = DRAWABLE_WINDOW;
+    win->parent = parent;
+    win->borderWidth = bw;
+    win->borderIsPixel = TRUE;
+    win->drawable.width = w;
+    win->drawable.height = h;
+    win->origin.x = x + bw;
+    win->origin.y = y + bw;
+    win->drawable.x = (parent ? parent->drawable.x : 0) + x + bw;
+    win->drawable.y = (parent ? parent->drawable.y : 0) + y + bw;
+    win->mapped = win->viewable = TRUE;
+    win->visibility = VisibilityNotViewable;
+    RegionNull(&win->clipList);
+    RegionNull(&win->borderClip);
+    RegionNull(&win->winSize);
+    RegionNull(&win->borderSize);
+
+    if (parent) {
+        win->nextSib = parent->firstChild;
+        if (parent->firstChild)
+            parent->firstChild->prevSib = win;
+        else
+            parent->lastChild = win;
+        parent->firstChild = win;
+        SetWinSize(win);
+        SetBorderSize(win);
+    }
+    return win;
+}
+
+static Bool
+same_region(RegionPtr a, RegionPtr b)
+{
+    if (!RegionNotEmpty(a))
+        return !RegionNotEmpty(b);
+    return RegionEqual(a, b);
+}
+
+/* clips of win and its inferiors as they should be, given its borderClip */
+static void
+check_clips(WindowPtr win, RegionPtr universe)
+{
+    RegionRec clip, child_universe;
+    WindowPtr child;
+
+    assert(same_region(universe, &win->borderClip));
+
+    RegionNull(&clip);
+    RegionNull(&child_universe);
+    RegionIntersect(&clip, universe, &win->winSize);
+    for (child = win->firstChild; child; child = child->nextSib) {
+        if (!child->viewable)
+            continue;
+        RegionIntersect(&child_universe, &clip, &child->borderSize);
+        check_clips(child, &child_universe);
+        RegionSubtract(&clip, &clip, &child->borderSize);
+    }
+    assert(same_region(&clip, &win->clipList));
+    RegionUninit(&child_universe);
+    RegionUninit(&clip);
+}
+
+static double
+elapsed(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 +
+        (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/* drag win right and down and back again in steps moves */
+static void
+drag_window(WindowPtr root, WindowPtr win, int steps,
+            struct drag_stats *stats)
+{
+    struct timespec start;
+    int i;
+
+    for (i = 0; i < steps; i++) {
+        int x = win->origin.x - wBorderWidth(win) + (i < steps / 2 ? 7 : -7);
+        int y = win->origin.y - wBorderWidth(win) + (i < steps / 2 ? 4 : -4);
+
+        clip_notify_count = 0;
+        region_op_count = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        miMoveWindow(win, x, y, win->nextSib, VTMove);
+        stats->ms += elapsed(&start);
+        stats->clipped += clip_notify_count;
+        stats->region_ops += region_op_count;
+
+        check_clips(root, &root->winSize);
+    }
+}
+
+/*
+ * Drag the top, a middle and the bottom window of the stack, steps moves
+ * each, and add up what that took in stats.
+ */
+static void
+validate_tree_drag(int steps, struct drag_stats stats[3])
+{
+    ScreenRec screen = { 0 };
+    WindowPtr root, win;
+    BoxRec box = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+    int i;
+
+    dixResetPrivates();
+    srand(0x5eed);
+
+    screen.MarkWindow = miMarkWindow;
+    screen.MarkOverlappedWindows = miMarkOverlappedWindows;
+    screen.ValidateTree = countedValidateTree;
+    screen.HandleExposures = miHandleValidateExposures;
+    screen.PositionWindow = position_window;
+    screen.CopyWindow = copy_window;
+    screen.WindowExposures = window_exposures;
+    screen.PaintWindow = paint_window;
+    screen.ClipNotify = count_clip_notify;
+
+    root = create_window(&screen, NULL, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+    RegionReset(&root->winSize, &box);
+    RegionCopy(&root->borderSize, &root->winSize);
+    RegionCopy(&root->borderClip, &root->winSize);
+    RegionCopy(&root->clipList, &root->winSize);
+
+    /* a dense stack of decorated windows, each with a few widgets */
+    for (i = 0; i < NUM_TOPLEVEL; i++) {
+        WindowPtr client;
+        int j;
+
+        win = create_window(&screen, root,
+                            rand() % (SCREEN_WIDTH - 400),
+                            rand() % (SCREEN_HEIGHT - 300),
+                            300 + rand() % 400, 200 + rand() % 300,
+                            rand() % 3);
+        create_window(&screen, win, 0, 0, win->drawable.width, 20, 0);
+        client = create_window(&screen, win, 0, 20, win->drawable.width,
+                               win->drawable.height - 20, 0);
+        for (j = 0; j < 8; j++)
+            create_window(&screen, client, 4 + j * 36, 4, 32, 24, 1);
+    }
+
+    /* map everything at once, as MapSubwindows would */
+    for (win = root; win;) {
+        miMarkWindow(win);
+        if (win->firstChild)
+            win = win->firstChild;
+        else {
+            while (win && !win->nextSib)
+                win = win->parent;
+            if (win)
+                win = win->nextSib;
+        }
+    }
+    countedValidateTree(root, NullWindow, VTMap);
+    miHandleValidateExposures(root);
+    check_clips(root, &root->winSize);
+
+    drag_window(root, root->firstChild, steps, &stats[0]);
+    for (win = root->firstChild, i = 0; i < NUM_TOPLEVEL / 2; i++)
+        win = win->nextSib;
+    drag_window(root, win, steps, &stats[1]);
+    drag_window(root, root->lastChild, steps, &stats[2]);
+}
+
+int
+validate_tree_test(void)
+{
+    struct drag_stats stats[3] = { 0 };
+
+    validate_tree_drag(NUM_STEPS / 5, stats);
+
+    return 0;
+}
+
+int
+validate_tree_benchmark(void)
+{
+    static const char *what[3] = { "top", "middle", "bottom" };
+    struct drag_stats stats[3] = { 0 };
+    int i;
+
+    validate_tree_drag(NUM_STEPS, stats);
+    for (i = 0; i < 3; i++)
+        printf("dragging the %s window: %.1f windows re-clipped, "
+               "%.1f region operations, %.3f ms per move\n", what[i],
+               (double) stats[i].clipped / NUM_STEPS,
+               (double) stats[i].region_ops / NUM_STEPS,
+               stats[i].ms / NUM_STEPS);
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright © 2024 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Wide line rendering, in the style of x11perf's -wline and -wdline tests.
+ *
+ * Every variant first checks the touch-each-pixel-once rule: a polyline
+ * drawn with GXxor over a cleared pixmap, which goes through the span
+ * groups in mi, must come out the same as one drawn with GXcopy, where
+ * each piece of the line is filled as it is generated and the last piece
+ * drawn wins.  The variant is then timed with both rops.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/xcb.h>
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+#define CHECK_SIZE      256
+#define CHECK_LINES     20
+#define BENCH_SIZE      600
+#define BENCH_POINTS    100
+#define BENCH_LINES     200
+
+struct variant {
+    const char *name;
+    int width;
+    uint32_t style;
+    uint32_t cap;
+    uint32_t join;
+};
+
+static const struct variant variants[] = {
+    { "wline3", 3, XCB_LINE_STYLE_SOLID, XCB_CAP_STYLE_BUTT, XCB_JOIN_STYLE_MITER },
+    { "wline10", 10, XCB_LINE_STYLE_SOLID, XCB_CAP_STYLE_BUTT, XCB_JOIN_STYLE_MITER },
+    { "wline10 round", 10, XCB_LINE_STYLE_SOLID, XCB_CAP_STYLE_ROUND, XCB_JOIN_STYLE_ROUND },
+    { "wline100", 100, XCB_LINE_STYLE_SOLID, XCB_CAP_STYLE_PROJECTING, XCB_JOIN_STYLE_BEVEL },
+    { "wdline10", 10, XCB_LINE_STYLE_ON_OFF_DASH, XCB_CAP_STYLE_BUTT, XCB_JOIN_STYLE_MITER },
+    { "wdline10 round", 10, XCB_LINE_STYLE_ON_OFF_DASH, XCB_CAP_STYLE_ROUND, XCB_JOIN_STYLE_ROUND },
+    { "wddline10", 10, XCB_LINE_STYLE_DOUBLE_DASH, XCB_CAP_STYLE_BUTT, XCB_JOIN_STYLE_MITER },
+    { "wddline10 proj", 10, XCB_LINE_STYLE_DOUBLE_DASH, XCB_CAP_STYLE_PROJECTING, XCB_JOIN_STYLE_BEVEL },
+};
+
+static const uint8_t dashes[] = { 20, 7, 5, 7 };
+
+static void
+random_points(xcb_point_t *points, int n, int size)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        points[i].x = rand() % (size + 40) - 20;
+        points[i].y = rand() % (size + 40) - 20;
+    }
+}
+
+static xcb_gcontext_t
+create_gc(xcb_connection_t *c, xcb_drawable_t d, const struct variant *v,
+          uint32_t function)
+{
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    uint32_t values[] = {
+        function, 1, 2, v->width, v->style, v->cap, v->join, 0,
+    };
+
+    xcb_create_gc(c, gc, d, XCB_GC_FUNCTION | XCB_GC_FOREGROUND |
+                  XCB_GC_BACKGROUND | XCB_GC_LINE_WIDTH | XCB_GC_LINE_STYLE |
+                  XCB_GC_CAP_STYLE | XCB_GC_JOIN_STYLE |
+                  XCB_GC_GRAPHICS_EXPOSURES, values);
+    xcb_set_dashes(c, gc, 0, ARRAY_SIZE(dashes), dashes);
+    return gc;
+}
+
+static void
+clear(xcb_connection_t *c, xcb_pixmap_t pixmap, xcb_gcontext_t gc, int size)
+{
+    xcb_rectangle_t rect = { 0, 0, size, size };
+
+    xcb_poly_fill_rectangle(c, pixmap, gc, 1, &rect);
+}
+
+static xcb_get_image_reply_t *
+get_image(xcb_connection_t *c, xcb_pixmap_t pixmap, int size)
+{
+    xcb_get_image_reply_t *image =
+        xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                             pixmap, 0, 0, size, size, ~0),
+                            NULL);
+
+    assert(image);
+    return image;
+}
+
+static void
+check_variant(xcb_connection_t *c, xcb_screen_t *screen,
+              const struct variant *v)
+{
+    xcb_pixmap_t copy = xcb_generate_id(c), xor = xcb_generate_id(c);
+    xcb_gcontext_t copy_gc, xor_gc, clear_gc = xcb_generate_id(c);
+    xcb_point_t points[8];
+    uint32_t zero = 0;
+    int i;
+
+    xcb_create_pixmap(c, screen->root_depth, copy, screen->root,
+                      CHECK_SIZE, CHECK_SIZE);
+    xcb_create_pixmap(c, screen->root_depth, xor, screen->root,
+                      CHECK_SIZE, CHECK_SIZE);
+    xcb_create_gc(c, clear_gc, copy, XCB_GC_FOREGROUND, &zero);
+    copy_gc = create_gc(c, copy, v, XCB_GX_COPY);
+    xor_gc = create_gc(c, xor, v, XCB_GX_XOR);
+
+    for (i = 0; i < CHECK_LINES; i++) {
+        xcb_get_image_reply_t *a, *b;
+        /* two point lines with square caps skip the span groups */
+        int n = 3 + i % (ARRAY_SIZE(points) - 2);
+
+        random_points(points, n, CHECK_SIZE);
+        clear(c, copy, clear_gc, CHECK_SIZE);
+        clear(c, xor, clear_gc, CHECK_SIZE);
+        xcb_poly_line(c, XCB_COORD_MODE_ORIGIN, copy, copy_gc, n, points);
+        xcb_poly_line(c, XCB_COORD_MODE_ORIGIN, xor, xor_gc, n, points);
+
+        a = get_image(c, copy, CHECK_SIZE);
+        b = get_image(c, xor, CHECK_SIZE);
+        assert(xcb_get_image_data_length(a) == xcb_get_image_data_length(b));
+        if (memcmp(xcb_get_image_data(a), xcb_get_image_data(b),
+                   xcb_get_image_data_length(a)) != 0) {
+            printf("%s: GXxor and GXcopy differ for line %d\n", v->name, i);
+            exit(1);
+        }
+        free(a);
+        free(b);
+    }
+
+    xcb_free_gc(c, copy_gc);
+    xcb_free_gc(c, xor_gc);
+    xcb_free_gc(c, clear_gc);
+    xcb_free_pixmap(c, copy);
+    xcb_free_pixmap(c, xor);
+}
+
+static double
+elapsed(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e3 +
+        (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static double
+time_variant(xcb_connection_t *c, xcb_screen_t *screen,
+             const struct variant *v, uint32_t function)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_gcontext_t gc;
+    xcb_point_t points[BENCH_POINTS];
+    struct timespec start;
+    double t;
+    int i;
+
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      BENCH_SIZE, BENCH_SIZE);
+    gc = create_gc(c, pixmap, v, function);
+    random_points(points, BENCH_POINTS, BENCH_SIZE);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_LINES; i++)
+        xcb_poly_line(c, XCB_COORD_MODE_ORIGIN, pixmap, gc,
+                      BENCH_POINTS, points);
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+    t = elapsed(&start);
+
+    xcb_free_gc(c, gc);
+    xcb_free_pixmap(c, pixmap);
+    return t;
+}
+
+int main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    int i;
+
+    srand(0x5eed);
+    for (i = 0; i < ARRAY_SIZE(variants); i++) {
+        const struct variant *v = &variants[i];
+        double copy, xor;
+
+        check_variant(c, screen, v);
+        copy = time_variant(c, screen, v, XCB_GX_COPY);
+        xor = time_variant(c, screen, v, XCB_GX_XOR);
+        printf("%-16s %d-point lines: %8.3f ms copy, %8.3f ms xor\n",
+               v->name, BENCH_POINTS, copy / BENCH_LINES, xor / BENCH_LINES);
+    }
+
+    xcb_disconnect(c);
+    return 0;
+}
@@ -6,6 +6,7 @@
 /* @(#) $Id$ */
 
 #include "zutil.h"
+#include "cpu_features.h"
 
 local uLong adler32_combine_ OF((uLong adler1, uLong adler2, z_off64_t len2));
 
@@ -87,6 +88,26 @@ uLong ZEXPORT adler32_z(adler, buf, len)
     if (buf == Z_NULL)
         return 1L;
 
+#ifdef X86_SIMD
+    /* do whole 32-byte blocks with SIMD, the tail below */
+    if (len >= 64) {
+        cpu_check_features();
+        if (x86_cpu_has_ssse3) {
+            z_size_t chunk = len & ~(z_size_t)31;
+
+            adler |= sum2 << 16;
+            adler = x86_cpu_has_avx2 ? adler32_avx2(adler, buf, chunk) :
+                                       adler32_ssse3(adler, buf, chunk);
+            buf += chunk;
+            len -= chunk;
+            sum2 = (adler >> 16) & 0xffff;
+            adler &= 0xffff;
+            if (len == 0)
+                return adler | (sum2 << 16);
+        }
+    }
+#endif /* X86_SIMD */
+
     /* in case short lengths are provided, keep it somewhat fast */
     if (len < 16) {
         while (len--) {
@@ -0,0 +1,79 @@
+/* cpu_features.c -- runtime CPU feature detection for the SIMD kernels
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* @(#) $Id$ */
+
+#include "zutil.h"
+#include "cpu_features.h"
+
+#ifdef X86_SIMD
+
+#ifdef _MSC_VER
+#  include <intrin.h>
+#else
+#  include <cpuid.h>
+#endif
+
+int ZLIB_INTERNAL x86_cpu_has_pclmul = 0;
+int ZLIB_INTERNAL x86_cpu_has_ssse3 = 0;
+int ZLIB_INTERNAL x86_cpu_has_avx2 = 0;
+
+local volatile int cpu_checked = 0;
+
+local void cpuid OF((unsigned leaf, unsigned regs[4]));
+local unsigned long xgetbv0 OF((void));
+
+local void cpuid(leaf, regs)
+    unsigned leaf;
+    unsigned regs[4];
+{
+#ifdef _MSC_VER
+    __cpuidex((int *)regs, (int)leaf, 0);
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* the OS must save the YMM registers on context switches for AVX2 to be
+   usable; only call this when CPUID reports OSXSAVE */
+local unsigned long xgetbv0()
+{
+#ifdef _MSC_VER
+    return (unsigned long)_xgetbv(0);
+#else
+    unsigned eax, edx;
+
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0"  /* xgetbv */
+                          : "=a" (eax), "=d" (edx) : "c" (0));
+    return eax;
+#endif
+}
+
+/* ========================================================================= */
+void ZLIB_INTERNAL cpu_check_features()
+{
+    unsigned regs[4];
+    unsigned max_leaf;
+    int has_avx = 0;
+
+    if (cpu_checked)
+        return;
+
+    cpuid(0, regs);
+    max_leaf = regs[0];
+    if (max_leaf >= 1) {
+        cpuid(1, regs);
+        x86_cpu_has_ssse3 = (regs[2] >> 9) & 1;
+        x86_cpu_has_pclmul = (regs[2] >> 1) & 1;
+        if ((regs[2] >> 27) & 1)                /* OSXSAVE */
+            has_avx = ((regs[2] >> 28) & 1) && (xgetbv0() & 6) == 6;
+    }
+    if (max_leaf >= 7 && has_avx) {
+        cpuid(7, regs);
+        x86_cpu_has_avx2 = (regs[1] >> 5) & 1;
+    }
+    cpu_checked = 1;
+}
+
+#endif /* X86_SIMD */
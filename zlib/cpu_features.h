@@ -0,0 +1,54 @@
+/* cpu_features.h -- runtime CPU feature detection for the SIMD kernels
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* WARNING: this file should *not* be used by applications. It is
+   part of the implementation of the compression library and is
+   subject to change. Applications should only use zlib.h.
+ */
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+/* The x86 kernels are compiled on every x86 target and only selected at
+   run time, so the library still runs on processors without them.  Define
+   NO_SIMD to build the portable code only. */
+#if !defined(NO_SIMD) && \
+    (defined(__x86_64__) || defined(__i386__) || \
+     defined(_M_X64) || defined(_M_AMD64) || defined(_M_IX86)) && \
+    (defined(_MSC_VER) || defined(__GNUC__))
+#  define X86_SIMD
+#endif
+
+#ifdef X86_SIMD
+
+/* gcc and clang only allow the intrinsics in functions compiled for the
+   matching instruction set; MSVC allows them anywhere */
+#ifdef __GNUC__
+#  define Z_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define Z_TARGET(isa)
+#endif
+
+extern int ZLIB_INTERNAL x86_cpu_has_pclmul;    /* PCLMULQDQ */
+extern int ZLIB_INTERNAL x86_cpu_has_ssse3;
+extern int ZLIB_INTERNAL x86_cpu_has_avx2;
+
+/* Fill in the flags above.  Safe to call from several threads at once:
+   every caller stores the same values. */
+void ZLIB_INTERNAL cpu_check_features OF((void));
+
+/* crc32_simd.c: raw (not pre- or post-conditioned) CRC-32 register update
+   over len bytes, len >= 64 and a multiple of 16 */
+unsigned long ZLIB_INTERNAL crc32_pclmul OF((unsigned long crc,
+                                const unsigned char FAR *buf, z_size_t len));
+
+/* adler32_simd.c: Adler-32 update over len bytes, len a multiple of 32 */
+uLong ZLIB_INTERNAL adler32_ssse3 OF((uLong adler, const Bytef *buf,
+                                      z_size_t len));
+uLong ZLIB_INTERNAL adler32_avx2 OF((uLong adler, const Bytef *buf,
+                                     z_size_t len));
+
+#endif /* X86_SIMD */
+
+#endif /* CPU_FEATURES_H */
@@ -31,6 +31,7 @@
 #endif /* MAKECRCH */
 
 #include "zutil.h"      /* for STDC and FAR definitions */
+#include "cpu_features.h"
 
 /* Definitions for doing the crc four data bytes at a time. */
 #if !defined(NOBYFOUR) && defined(Z_U4)
@@ -213,6 +214,22 @@ unsigned long ZEXPORT crc32_z(crc, buf, len)
         make_crc_table();
 #endif /* DYNAMIC_CRC_TABLE */
 
+#ifdef X86_SIMD
+    /* fold all whole 16-byte blocks, leave the tail to the tables */
+    if (len >= 64) {
+        cpu_check_features();
+        if (x86_cpu_has_pclmul) {
+            z_size_t chunk = len & ~(z_size_t)15;
+
+            crc = crc32_pclmul(crc ^ 0xffffffffUL, buf, chunk) ^ 0xffffffffUL;
+            buf += chunk;
+            len -= chunk;
+            if (len == 0)
+                return crc;
+        }
+    }
+#endif /* X86_SIMD */
+
 #ifdef BYFOUR
     if (sizeof(void *) == sizeof(ptrdiff_t)) {
         z_crc_t endian;
@@ -155,6 +155,9 @@
    twice this must be able to fit in an unsigned type) */
 #define GZBUFSIZE 8192
 
+/* default uncompressed block size for gzsetparallel() */
+#define GZPARBLOCK 131072U
+
 /* gzip modes, also provide a little integrity check on the passed structure */
 #define GZ_NONE 0
 #define GZ_READ 7247
@@ -190,6 +193,7 @@ typedef struct {
         /* just for writing */
     int level;              /* compression level */
     int strategy;           /* compression strategy */
+    struct gz_par_s *par;   /* parallel compression state, or NULL */
         /* seek request */
     z_off64_t skip;         /* amount to skip (already rewound if backwards) */
     int seek;               /* true if seek request pending */
@@ -206,6 +210,9 @@ void ZLIB_INTERNAL gz_error OF((gz_statep, int, const char *));
 #if defined UNDER_CE
 char ZLIB_INTERNAL *gz_strwinerror OF((DWORD error));
 #endif
+int ZLIB_INTERNAL gz_par_init OF((gz_statep, int, unsigned));
+int ZLIB_INTERNAL gz_par_comp OF((gz_statep, int));
+void ZLIB_INTERNAL gz_par_free OF((gz_statep));
 
 /* GT_OFF(x), where x is an unsigned value, is true if x > maximum z_off64_t
    value -- needed when comparing unsigned to z_off64_t, which is signed
@@ -120,6 +120,7 @@ local gzFile gz_open(path, fd, mode)
     state->level = Z_DEFAULT_COMPRESSION;
     state->strategy = Z_DEFAULT_STRATEGY;
     state->direct = 0;
+    state->par = NULL;
     while (*mode) {
         if (*mode >= '0' && *mode <= '9')
             state->level = *mode - '0';
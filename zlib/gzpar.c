@@ -0,0 +1,369 @@
+/* gzpar.c -- block-parallel compression for gzip files being written
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/* The input is cut into blocks of a fixed size that are compressed
+   independently, several at a time, each one primed with the 32K of input
+   that precedes it as a preset dictionary.  Every block but the last of a
+   member ends with a sync flush, so the compressed blocks can simply be
+   concatenated into one deflate stream, and the per-block CRCs combined
+   with crc32_combine().  The result is a single ordinary gzip member.
+
+   The output only depends on the block size, the level and the strategy,
+   not on the number of threads.  Threads are started for each batch of
+   blocks and joined before the batch is written; if a thread cannot be
+   started its block is compressed by the calling thread instead. */
+
+#include "gzguts.h"
+#include "zutil.h"      /* OS_CODE */
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <process.h>
+#else
+#  include <pthread.h>
+#endif
+
+#define GZ_PAR_DICT 32768U          /* deflate window, dictionary size */
+#define GZ_PAR_MAX_THREADS 64
+
+/* one block of a batch, and the deflate state it is compressed with */
+typedef struct {
+    z_stream strm;          /* raw deflate stream, initialized on first use */
+    int init;               /* true if strm is initialized */
+    int level;              /* parameters strm is currently set up for */
+    int strategy;
+    const unsigned char *in;    /* block input */
+    unsigned len;               /* block input length */
+    unsigned dict;              /* bytes of dictionary before in */
+    int flush;                  /* Z_SYNC_FLUSH or Z_FINISH */
+    unsigned char *out;         /* compressed output */
+    unsigned size;              /* allocated size of out */
+    unsigned have;              /* compressed length */
+    uLong crc;                  /* CRC-32 of the block input */
+    int ret;                    /* Z_OK or an error code */
+} gz_job;
+
+struct gz_par_s {
+    int threads;            /* number of blocks compressed at once */
+    unsigned block;         /* uncompressed block size */
+    unsigned char *buf;     /* dictionary carry-over + threads blocks */
+    unsigned dict;          /* valid dictionary bytes before the blocks */
+    unsigned fill;          /* input bytes buffered after the dictionary */
+    int started;            /* true if the member header was written */
+    uLong crc;              /* CRC-32 of the member so far */
+    uLong total;            /* member length so far, modulo 2^32 */
+    gz_job *jobs;           /* one per thread */
+};
+
+/* Compress one block.  Runs on a worker thread. */
+local void gz_job_run(job)
+    gz_job *job;
+{
+    z_streamp strm = &job->strm;
+    int ret;
+
+    job->crc = crc32(0L, job->in, job->len);
+
+    if (deflateReset(strm) != Z_OK) {
+        job->ret = Z_STREAM_ERROR;
+        return;
+    }
+    if (job->dict &&
+        deflateSetDictionary(strm, job->in - job->dict, job->dict) != Z_OK) {
+        job->ret = Z_STREAM_ERROR;
+        return;
+    }
+    strm->next_in = (z_const Bytef *)job->in;
+    strm->avail_in = job->len;
+    strm->next_out = job->out;
+    strm->avail_out = job->size;
+    ret = deflate(strm, job->flush);
+    if (strm->avail_in != 0 ||
+        (job->flush == Z_FINISH ? ret != Z_STREAM_END : ret != Z_OK)) {
+        job->ret = Z_BUF_ERROR;
+        return;
+    }
+    job->have = job->size - strm->avail_out;
+    job->ret = Z_OK;
+}
+
+#ifdef _WIN32
+local unsigned __stdcall gz_job_thread(void *arg)
+{
+    gz_job_run((gz_job *)arg);
+    return 0;
+}
+#else
+local void *gz_job_thread(void *arg)
+{
+    gz_job_run((gz_job *)arg);
+    return NULL;
+}
+#endif
+
+/* Make sure job can compress len bytes with the current parameters.
+   Return 0 on success, -1 on a memory allocation failure. */
+local int gz_job_prepare(state, job, len)
+    gz_statep state;
+    gz_job *job;
+    unsigned len;
+{
+    z_streamp strm = &job->strm;
+    unsigned need;
+
+    if (!job->init) {
+        strm->zalloc = Z_NULL;
+        strm->zfree = Z_NULL;
+        strm->opaque = Z_NULL;
+        if (deflateInit2(strm, state->level, Z_DEFLATED, -MAX_WBITS,
+                         DEF_MEM_LEVEL, state->strategy) != Z_OK)
+            return -1;
+        job->init = 1;
+        job->level = state->level;
+        job->strategy = state->strategy;
+    }
+    else if (job->level != state->level || job->strategy != state->strategy) {
+        /* nothing is pending after the last block, so this can't fail */
+        deflateReset(strm);
+        deflateParams(strm, state->level, state->strategy);
+        job->level = state->level;
+        job->strategy = state->strategy;
+    }
+
+    /* room for the worst case plus the sync or final empty block */
+    need = (unsigned)deflateBound(strm, len) + 16;
+    if (job->size < need) {
+        free(job->out);
+        job->out = (unsigned char *)malloc(need);
+        if (job->out == NULL) {
+            job->size = 0;
+            return -1;
+        }
+        job->size = need;
+    }
+    return 0;
+}
+
+/* Write len bytes from buf to the file.  Return -1 on error, 0 on success. */
+local int gz_par_put(state, buf, len)
+    gz_statep state;
+    const unsigned char *buf;
+    unsigned len;
+{
+    int writ;
+    unsigned put, max = ((unsigned)-1 >> 2) + 1;
+
+    while (len) {
+        put = len > max ? max : len;
+        writ = write(state->fd, buf, put);
+        if (writ < 0) {
+            gz_error(state, Z_ERRNO, zstrerror());
+            return -1;
+        }
+        buf += writ;
+        len -= (unsigned)writ;
+    }
+    return 0;
+}
+
+/* Compress and write the buffered input.  flush is Z_NO_FLUSH for a full
+   batch, Z_FINISH to end the member, or any other flush value to end on a
+   byte boundary.  Return -1 on error, 0 on success. */
+local int gz_par_batch(state, flush)
+    gz_statep state;
+    int flush;
+{
+    struct gz_par_s *par = state->par;
+    unsigned char *in = par->buf + GZ_PAR_DICT;
+    unsigned char trailer[8];
+    unsigned off, keep;
+    int n, i, started[GZ_PAR_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE thread[GZ_PAR_MAX_THREADS];
+#else
+    pthread_t thread[GZ_PAR_MAX_THREADS];
+#endif
+
+    /* write the gzip header before the first block of a member */
+    if (!par->started) {
+        unsigned char head[10] = {31, 139, 8, 0, 0, 0, 0, 0, 0, OS_CODE};
+
+        /* the same extra flags and OS as the gzip header deflate writes */
+        if (state->level == 9)
+            head[8] = 2;
+        else if (state->level == 0 || state->level == 1 ||
+                 state->strategy >= Z_HUFFMAN_ONLY)
+            head[8] = 4;
+        if (gz_par_put(state, head, 10) == -1)
+            return -1;
+        par->started = 1;
+    }
+
+    /* cut the buffered input into blocks, with at least one (possibly
+       empty) block to carry the final bit */
+    n = (int)((par->fill + par->block - 1) / par->block);
+    if (n == 0 && flush == Z_FINISH)
+        n = 1;
+    for (i = 0, off = 0; i < n; i++, off += par->block) {
+        gz_job *job = par->jobs + i;
+
+        job->in = in + off;
+        job->len = par->fill - off < par->block ? par->fill - off : par->block;
+        job->dict = off + par->dict < GZ_PAR_DICT ? off + par->dict :
+                                                    GZ_PAR_DICT;
+        job->flush = flush == Z_FINISH && i == n - 1 ? Z_FINISH :
+                                                       Z_SYNC_FLUSH;
+        if (gz_job_prepare(state, job, job->len) == -1) {
+            gz_error(state, Z_MEM_ERROR, "out of memory");
+            return -1;
+        }
+    }
+
+    /* compress the blocks, the first one on this thread */
+    for (i = 1; i < n; i++) {
+#ifdef _WIN32
+        thread[i] = (HANDLE)_beginthreadex(NULL, 0, gz_job_thread,
+                                           par->jobs + i, 0, NULL);
+        started[i] = thread[i] != 0;
+#else
+        started[i] = pthread_create(&thread[i], NULL, gz_job_thread,
+                                    par->jobs + i) == 0;
+#endif
+    }
+    if (n)
+        gz_job_run(par->jobs);
+    for (i = 1; i < n; i++) {
+        if (started[i]) {
+#ifdef _WIN32
+            WaitForSingleObject(thread[i], INFINITE);
+            CloseHandle(thread[i]);
+#else
+            pthread_join(thread[i], NULL);
+#endif
+        }
+        else
+            gz_job_run(par->jobs + i);
+    }
+
+    /* write the blocks in order */
+    for (i = 0; i < n; i++) {
+        gz_job *job = par->jobs + i;
+
+        if (job->ret != Z_OK) {
+            gz_error(state, Z_STREAM_ERROR,
+                     "internal error: deflate stream corrupt");
+            return -1;
+        }
+        if (gz_par_put(state, job->out, job->have) == -1)
+            return -1;
+        par->crc = crc32_combine(par->crc, job->crc, job->len);
+        par->total += job->len;
+    }
+
+    /* keep the end of this input as the dictionary for the next batch,
+       unless the caller asked for a point to restart decompression from */
+    keep = par->fill + par->dict < GZ_PAR_DICT ? par->fill + par->dict :
+                                                 GZ_PAR_DICT;
+    if (flush == Z_FULL_FLUSH || flush == Z_FINISH)
+        keep = 0;
+    memmove(par->buf + GZ_PAR_DICT - keep, in + par->fill - keep, keep);
+    par->dict = keep;
+    par->fill = 0;
+
+    /* end the member, and allow another one to start */
+    if (flush == Z_FINISH) {
+        for (i = 0; i < 4; i++) {
+            trailer[i] = (unsigned char)(par->crc >> (8 * i));
+            trailer[i + 4] = (unsigned char)(par->total >> (8 * i));
+        }
+        if (gz_par_put(state, trailer, 8) == -1)
+            return -1;
+        par->started = 0;
+        par->crc = crc32(0L, Z_NULL, 0);
+        par->total = 0;
+    }
+    return 0;
+}
+
+/* Set up parallel compression for state.  Return -1 on a memory allocation
+   failure, or 0 on success. */
+int ZLIB_INTERNAL gz_par_init(state, threads, block)
+    gz_statep state;
+    int threads;
+    unsigned block;
+{
+    struct gz_par_s *par;
+
+    if (threads > GZ_PAR_MAX_THREADS)
+        threads = GZ_PAR_MAX_THREADS;
+    if (block < GZ_PAR_DICT)
+        block = GZ_PAR_DICT;
+    if (block > ((unsigned)-1 >> 2) / (unsigned)threads)
+        block = ((unsigned)-1 >> 2) / (unsigned)threads;
+
+    par = (struct gz_par_s *)calloc(1, sizeof(struct gz_par_s));
+    if (par == NULL)
+        return -1;
+    par->threads = threads;
+    par->block = block;
+    par->crc = crc32(0L, Z_NULL, 0);
+    par->buf = (unsigned char *)malloc(GZ_PAR_DICT + block * threads);
+    par->jobs = (gz_job *)calloc((unsigned)threads, sizeof(gz_job));
+    if (par->buf == NULL || par->jobs == NULL) {
+        free(par->jobs);
+        free(par->buf);
+        free(par);
+        return -1;
+    }
+    state->par = par;
+    return 0;
+}
+
+/* Take the input at strm->next_in, compressing full batches as they fill
+   up, then everything buffered if flush is not Z_NO_FLUSH.  This is what
+   gz_comp() does when parallel compression is enabled, and has the same
+   return values. */
+int ZLIB_INTERNAL gz_par_comp(state, flush)
+    gz_statep state;
+    int flush;
+{
+    struct gz_par_s *par = state->par;
+    z_streamp strm = &(state->strm);
+    unsigned room, copy, batch = par->block * (unsigned)par->threads;
+
+    while (strm->avail_in) {
+        room = batch - par->fill;
+        copy = strm->avail_in < room ? strm->avail_in : room;
+        memcpy(par->buf + GZ_PAR_DICT + par->fill, strm->next_in, copy);
+        par->fill += copy;
+        strm->next_in += copy;
+        strm->avail_in -= copy;
+        if (par->fill == batch && gz_par_batch(state, Z_NO_FLUSH) == -1)
+            return -1;
+    }
+    if (flush != Z_NO_FLUSH && (par->fill || flush == Z_FINISH) &&
+        gz_par_batch(state, flush) == -1)
+        return -1;
+    return 0;
+}
+
+/* Free everything allocated by gz_par_init(). */
+void ZLIB_INTERNAL gz_par_free(state)
+    gz_statep state;
+{
+    struct gz_par_s *par = state->par;
+    int i;
+
+    if (par == NULL)
+        return;
+    for (i = 0; i < par->threads; i++) {
+        if (par->jobs[i].init)
+            (void)deflateEnd(&par->jobs[i].strm);
+        free(par->jobs[i].out);
+    }
+    free(par->jobs);
+    free(par->buf);
+    free(par);
+    state->par = NULL;
+}
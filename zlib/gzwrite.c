@@ -27,8 +27,9 @@ local int gz_init(state)
         return -1;
     }
 
-    /* only need output buffer and deflate state if compressing */
-    if (!state->direct) {
+    /* only need output buffer and deflate state if compressing serially --
+       parallel compression keeps its own */
+    if (!state->direct && state->par == NULL) {
         /* allocate output buffer */
         state->out = (unsigned char *)malloc(state->want);
         if (state->out == NULL) {
@@ -55,8 +56,8 @@ local int gz_init(state)
     /* mark state as initialized */
     state->size = state->want;
 
-    /* initialize write buffer if compressing */
-    if (!state->direct) {
+    /* initialize write buffer if compressing serially */
+    if (!state->direct && state->par == NULL) {
         strm->avail_out = state->size;
         strm->next_out = state->out;
         state->x.next = strm->next_out;
@@ -97,6 +98,10 @@ local int gz_comp(state, flush)
         return 0;
     }
 
+    /* hand off to the block-parallel compressor if requested */
+    if (state->par != NULL)
+        return gz_par_comp(state, flush);
+
     /* run deflate() on provided input until it produces no more output */
     ret = Z_OK;
     do {
@@ -614,15 +619,54 @@ int ZEXPORT gzsetparams(file, level, strategy)
     /* change compression parameters for subsequent input */
     if (state->size) {
         /* flush previous input with previous parameters before changing */
-        if (strm->avail_in && gz_comp(state, Z_BLOCK) == -1)
-            return state->err;
-        deflateParams(strm, level, strategy);
+        if (state->par != NULL) {
+            /* the parallel compressor may have input buffered, and picks up
+               the new parameters from state for its next blocks */
+            if (gz_comp(state, Z_BLOCK) == -1)
+                return state->err;
+        }
+        else {
+            if (strm->avail_in && gz_comp(state, Z_BLOCK) == -1)
+                return state->err;
+            deflateParams(strm, level, strategy);
+        }
     }
     state->level = level;
     state->strategy = strategy;
     return Z_OK;
 }
 
+/* -- see zlib.h -- */
+int ZEXPORT gzsetparallel(file, threads, block)
+    gzFile file;
+    int threads;
+    unsigned block;
+{
+    gz_statep state;
+
+    /* get internal structure */
+    if (file == NULL)
+        return Z_STREAM_ERROR;
+    state = (gz_statep)file;
+
+    /* check that we're writing, that there's no error, and that nothing has
+       been compressed yet */
+    if (state->mode != GZ_WRITE || state->err != Z_OK || state->size != 0)
+        return Z_STREAM_ERROR;
+
+    /* check and default the parameters */
+    if (threads < 0)
+        return Z_STREAM_ERROR;
+    if (block == 0)
+        block = GZPARBLOCK;
+
+    /* replace any previous setting, nothing to do if writing directly */
+    gz_par_free(state);
+    if (threads > 1 && !state->direct && gz_par_init(state, threads, block))
+        return Z_MEM_ERROR;
+    return Z_OK;
+}
+
 /* -- see zlib.h -- */
 int ZEXPORT gzclose_w(file)
     gzFile file;
@@ -650,12 +694,16 @@ int ZEXPORT gzclose_w(file)
     if (gz_comp(state, Z_FINISH) == -1)
         ret = state->err;
     if (state->size) {
-        if (!state->direct) {
+        if (state->par != NULL)
+            gz_par_free(state);
+        else if (!state->direct) {
             (void)deflateEnd(&(state->strm));
             free(state->out);
         }
         free(state->in);
     }
+    else
+        gz_par_free(state);
     gz_error(state, Z_OK, NULL);
     free(state->path);
     if (close(state->fd) == -1)
@@ -13,6 +13,10 @@
 #  pragma message("Assembler code may have bugs -- use at your own risk")
 #else
 
+/* bytes per step of the chunked match copy; define NO_INFLATE_CHUNK_COPY
+   to copy matches a byte at a time */
+#define INFLATE_CHUNK 16
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -251,6 +255,26 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                 }
                 else {
                     from = out - dist;          /* copy direct from output */
+#ifndef NO_INFLATE_CHUNK_COPY
+                    /* Copy whole chunks when they can't overlap their own
+                       source.  This may write up to INFLATE_CHUNK - 1 bytes
+                       past the match; with out at least INFLATE_CHUNK bytes
+                       before end, that still lands inside the 257 bytes of
+                       slack inflate_fast() keeps after end, and the bytes
+                       are overwritten by later output. */
+                    if (dist >= INFLATE_CHUNK &&
+                        (unsigned)(end - out) >= INFLATE_CHUNK) {
+                        unsigned char FAR *stop = out + len;
+
+                        do {
+                            zmemcpy(out, from, INFLATE_CHUNK);
+                            out += INFLATE_CHUNK;
+                            from += INFLATE_CHUNK;
+                        } while (out < stop);
+                        out = stop;
+                        continue;
+                    }
+#endif
                     do {                        /* minimum length is three */
                         *out++ = *from++;
                         *out++ = *from++;
@@ -45,6 +45,7 @@ void test_flush         OF((Byte *compr, uLong *comprLen));
 void test_sync          OF((Byte *compr, uLong comprLen,
                             Byte *uncompr, uLong uncomprLen));
 void test_dict_deflate  OF((Byte *compr, uLong comprLen));
+void test_checksums     OF((Byte *buf, uLong len));
 void test_dict_inflate  OF((Byte *compr, uLong comprLen,
                             Byte *uncompr, uLong uncomprLen));
 int  main               OF((int argc, char *argv[]));
@@ -81,6 +82,7 @@ void test_compress      OF((Byte *compr, uLong comprLen,
                             Byte *uncompr, uLong uncomprLen));
 void test_gzio          OF((const char *fname,
                             Byte *uncompr, uLong uncomprLen));
+void test_gzpar         OF((const char *fname));
 
 /* ===========================================================================
  * Test compress() and uncompress()
@@ -192,6 +194,72 @@ void test_gzio(fname, uncompr, uncomprLen)
 #endif
 }
 
+/* ===========================================================================
+ * Test writing a .gz file in parallel blocks and reading it back
+ */
+void test_gzpar(fname)
+    const char *fname; /* compressed file name */
+{
+#ifdef NO_GZCOMPRESS
+    fprintf(stderr, "NO_GZCOMPRESS -- gz* functions cannot compress\n");
+#else
+    int err;
+    unsigned i, len = 300000;
+    Byte *buf, *back;
+    gzFile file;
+
+    buf = (Byte*)malloc(len);
+    back = (Byte*)malloc(len);
+    if (buf == Z_NULL || back == Z_NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < len; i++)
+        buf[i] = (Byte)("hello, hello! "[i % 14] + (i / 1000) % 7);
+
+    file = gzopen(fname, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    err = gzsetparallel(file, 3, 32768);
+    CHECK_ERR(err, "gzsetparallel");
+    if (gzwrite(file, buf, 100000) != 100000) {
+        fprintf(stderr, "gzwrite err: %s\n", gzerror(file, &err));
+        exit(1);
+    }
+    err = gzflush(file, Z_SYNC_FLUSH);
+    CHECK_ERR(err, "gzflush");
+    err = gzsetparams(file, 9, Z_DEFAULT_STRATEGY);
+    CHECK_ERR(err, "gzsetparams");
+    if (gzwrite(file, buf + 100000, len - 100000) != (int)(len - 100000)) {
+        fprintf(stderr, "gzwrite err: %s\n", gzerror(file, &err));
+        exit(1);
+    }
+    if (gzsetparallel(file, 2, 0) != Z_STREAM_ERROR) {
+        fprintf(stderr, "gzsetparallel should fail after writing\n");
+        exit(1);
+    }
+    gzclose(file);
+
+    file = gzopen(fname, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    if (gzread(file, back, len) != (int)len || memcmp(buf, back, len)) {
+        fprintf(stderr, "bad gzread after gzsetparallel\n");
+        exit(1);
+    } else {
+        printf("gzsetparallel(): read back %u bytes\n", len);
+    }
+    gzclose(file);
+
+    free(buf);
+    free(back);
+#endif
+}
+
 #endif /* Z_SOLO */
 
 /* ===========================================================================
@@ -538,6 +606,39 @@ void test_dict_inflate(compr, comprLen, uncompr, uncomprLen)
     }
 }
 
+/* ===========================================================================
+ * Test that crc32() and adler32() give the same result in one call, which
+ * may take the SIMD paths, as when fed a byte at a time
+ */
+void test_checksums(buf, len)
+    Byte *buf;
+    uLong len;
+{
+    uLong i, n, off;
+    uLong crc, crc1, adler, adler1;
+
+    for (i = 0; i < len; i++)
+        buf[i] = (Byte)((i * 2654435761UL) >> 13);
+
+    for (off = 0; off < 16; off += 5) {
+        for (n = 0; n + off <= len; n = n < 300 ? n + 1 : n * 2) {
+            crc = crc32(0L, buf + off, (uInt)n);
+            adler = adler32(1L, buf + off, (uInt)n);
+            crc1 = crc32(0L, Z_NULL, 0);
+            adler1 = adler32(0L, Z_NULL, 0);
+            for (i = 0; i < n; i++) {
+                crc1 = crc32(crc1, buf + off + i, 1);
+                adler1 = adler32(adler1, buf + off + i, 1);
+            }
+            if (crc != crc1 || adler != adler1) {
+                fprintf(stderr, "bad checksum for length %lu\n", n);
+                exit(1);
+            }
+        }
+    }
+    printf("crc32 and adler32: ok\n");
+}
+
 /* ===========================================================================
  * Usage:  example [output.gz  [input.gz]]
  */
@@ -580,6 +681,7 @@ int main(argc, argv)
 
     test_gzio((argc > 1 ? argv[1] : TESTFILE),
               uncompr, uncomprLen);
+    test_gzpar(argc > 1 ? argv[1] : TESTFILE);
 #endif
 
     test_deflate(compr, comprLen);
@@ -595,6 +697,8 @@ int main(argc, argv)
     test_dict_deflate(compr, comprLen);
     test_dict_inflate(compr, comprLen, uncompr, uncomprLen);
 
+    test_checksums(compr, comprLen);
+
     free(compr);
     free(uncompr);
 
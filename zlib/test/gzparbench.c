@@ -0,0 +1,219 @@
+/* gzparbench.c -- time gzwrite() with gzsetparallel() over thread counts
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/*
+ * Usage: gzparbench [-n rounds] [-l level] [-t threads] [-b block] file ...
+ *
+ * gzparbench reads the given files into memory as one input, the way a
+ * font archive or a log would be written, and writes it with gzwrite()
+ * `rounds' times (3 by default) to a temporary gzip file: first with
+ * serial compression, then with gzsetparallel() at 2, 4, 8, ... up to
+ * `threads' threads (8 by default), since one thread is serial
+ * compression.  For each it prints the input rate in wall clock time, the
+ * speedup over serial compression and the compressed size.  Every output is read back and compared with the input, and the
+ * parallel outputs are checked to be byte for byte the same, since they
+ * only depend on the block size and the level.
+ */
+
+/* @(#) $Id$ */
+
+#include "zlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
+
+#define OUTFILE "gzparbench.gz"
+#define CHUNK 65536U
+
+static void fail OF((const char *name, const char *msg));
+static unsigned char *read_file OF((const char *name, unsigned char *data,
+                                    unsigned long *len));
+static double now OF((void));
+static double write_gz OF((const unsigned char *data, unsigned long len,
+                           int level, int threads, unsigned block));
+static void check_gz OF((const unsigned char *data, unsigned long len));
+int main OF((int argc, char *argv[]));
+
+static void fail(name, msg)
+    const char *name;
+    const char *msg;
+{
+    fprintf(stderr, "gzparbench: %s: %s\n", name, msg);
+    remove(OUTFILE);
+    exit(1);
+}
+
+/* append the contents of name to data, which holds len bytes */
+static unsigned char *read_file(name, data, len)
+    const char *name;
+    unsigned char *data;
+    unsigned long *len;
+{
+    FILE *in;
+    long size;
+
+    in = fopen(name, "rb");
+    if (in == NULL)
+        fail(name, "can't open");
+    if (fseek(in, 0, SEEK_END) != 0 || (size = ftell(in)) < 0 ||
+        fseek(in, 0, SEEK_SET) != 0)
+        fail(name, "can't seek");
+    data = (unsigned char *)realloc(data, *len + (size_t)size + 1);
+    if (data == NULL)
+        fail(name, "out of memory");
+    if (fread(data + *len, 1, (size_t)size, in) != (size_t)size)
+        fail(name, "read error");
+    fclose(in);
+    *len += (unsigned long)size;
+    return data;
+}
+
+/* wall clock seconds; clock() would add up the time of all threads */
+static double now()
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+#endif
+}
+
+/* write data to OUTFILE, in parallel if threads is not zero, and return
+   the seconds taken */
+static double write_gz(data, len, level, threads, block)
+    const unsigned char *data;
+    unsigned long len;
+    int level;
+    int threads;
+    unsigned block;
+{
+    char mode[4];
+    gzFile file;
+    unsigned long off;
+    double start = now();
+
+    sprintf(mode, "wb%d", level);
+    file = gzopen(OUTFILE, mode);
+    if (file == NULL)
+        fail(OUTFILE, "can't open for writing");
+    if (threads && gzsetparallel(file, threads, block) != Z_OK)
+        fail(OUTFILE, "gzsetparallel failed");
+    for (off = 0; off < len; off += CHUNK) {
+        unsigned n = len - off < CHUNK ? (unsigned)(len - off) : CHUNK;
+
+        if (gzwrite(file, data + off, n) != (int)n)
+            fail(OUTFILE, "gzwrite failed");
+    }
+    if (gzclose(file) != Z_OK)
+        fail(OUTFILE, "gzclose failed");
+    return now() - start;
+}
+
+/* check that OUTFILE holds data */
+static void check_gz(data, len)
+    const unsigned char *data;
+    unsigned long len;
+{
+    unsigned char buf[CHUNK];
+    gzFile file;
+    unsigned long off = 0;
+    int n;
+
+    file = gzopen(OUTFILE, "rb");
+    if (file == NULL)
+        fail(OUTFILE, "can't open for reading");
+    while ((n = gzread(file, buf, sizeof(buf))) > 0) {
+        if (off + n > len || memcmp(buf, data + off, n) != 0)
+            fail(OUTFILE, "output differs from the input");
+        off += n;
+    }
+    if (n < 0 || off != len)
+        fail(OUTFILE, "output is truncated");
+    gzclose(file);
+}
+
+int main(argc, argv)
+    int argc;
+    char *argv[];
+{
+    unsigned char *data = NULL, *first = NULL, *out;
+    unsigned long len = 0, first_len = 0, out_len;
+    int rounds = 3, level = 6, max_threads = 8;
+    unsigned block = 0;
+    double serial = 0, t;
+    int threads, r;
+
+    argc--, argv++;
+    while (argc >= 2 && argv[0][0] == '-') {
+        if (strcmp(*argv, "-n") == 0)
+            rounds = atoi(argv[1]);
+        else if (strcmp(*argv, "-l") == 0)
+            level = atoi(argv[1]);
+        else if (strcmp(*argv, "-t") == 0)
+            max_threads = atoi(argv[1]);
+        else if (strcmp(*argv, "-b") == 0)
+            block = (unsigned)strtoul(argv[1], NULL, 10);
+        else
+            break;
+        argc -= 2, argv += 2;
+    }
+    if (argc < 1 || argv[0][0] == '-' || rounds < 1 || level < 0 ||
+        level > 9 || max_threads < 1) {
+        fprintf(stderr, "usage: gzparbench [-n rounds] [-l level]"
+                        " [-t threads] [-b block] file ...\n");
+        return 2;
+    }
+
+    for (; argc; argc--, argv++)
+        data = read_file(*argv, data, &len);
+    printf("%lu bytes, level %d, %d rounds\n", len, level, rounds);
+
+    /* serial first, then 2, 4, 8, ... threads */
+    for (threads = 0; threads <= max_threads;
+         threads = threads ? threads * 2 : 2) {
+        t = 0;
+        for (r = 0; r < rounds; r++)
+            t += write_gz(data, len, level, threads, block);
+        check_gz(data, len);
+
+        out_len = 0;
+        out = read_file(OUTFILE, NULL, &out_len);
+        if (threads == 0) {
+            serial = t;
+            printf("serial:     %8.1f MB/s          %lu bytes\n",
+                   len * (double)rounds / t / 1e6, out_len);
+            free(out);
+            continue;
+        }
+        printf("%2d threads: %8.1f MB/s %5.2fx   %lu bytes\n", threads,
+               len * (double)rounds / t / 1e6, serial / t, out_len);
+        if (first == NULL) {
+            first = out;
+            first_len = out_len;
+        }
+        else {
+            if (out_len != first_len || memcmp(out, first, out_len) != 0)
+                fail(OUTFILE, "output depends on the number of threads");
+            free(out);
+        }
+    }
+
+    remove(OUTFILE);
+    free(first);
+    free(data);
+    return 0;
+}
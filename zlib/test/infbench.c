@@ -0,0 +1,210 @@
+/* infbench.c -- time gzip inflation and checksums over a set of files
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/*
+ * Usage: infbench [-n rounds] file ...
+ *
+ * infbench reads the given files into memory and inflates every one of
+ * them `rounds' times (20 by default) as a gzip stream, as the X server
+ * does with .pcf.gz fonts, including the check of the trailing CRC.  It
+ * then runs crc32() and adler32() over the inflated data the same number
+ * of times.  The output rate of each is printed along with the checksum
+ * of all the data, so that builds with and without NO_SIMD and
+ * NO_INFLATE_CHUNK_COPY can be compared.
+ *
+ * Files that are not gzip streams, such as plain .pcf or .bdf fonts, are
+ * compressed with deflate level 9 first, as gzip -9 would.
+ */
+
+/* @(#) $Id$ */
+
+#include "zlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    const char *name;
+    Bytef *gz;          /* gzip stream */
+    uLong gz_len;
+    Bytef *out;         /* inflated data */
+    uLong out_len;
+} bench_file;
+
+static void fail OF((const char *name, const char *msg));
+static Bytef *read_file OF((const char *name, uLong *len));
+static void gzip_file OF((bench_file *f, Bytef *data, uLong len));
+static void load_file OF((bench_file *f, const char *name));
+static double seconds OF((clock_t start));
+int main OF((int argc, char *argv[]));
+
+static void fail(name, msg)
+    const char *name;
+    const char *msg;
+{
+    fprintf(stderr, "infbench: %s: %s\n", name, msg);
+    exit(1);
+}
+
+static Bytef *read_file(name, len)
+    const char *name;
+    uLong *len;
+{
+    FILE *in;
+    Bytef *data;
+    long size;
+
+    in = fopen(name, "rb");
+    if (in == NULL)
+        fail(name, "can't open");
+    if (fseek(in, 0, SEEK_END) != 0 || (size = ftell(in)) < 0 ||
+        fseek(in, 0, SEEK_SET) != 0)
+        fail(name, "can't seek");
+    data = (Bytef *)malloc(size ? (size_t)size : 1);
+    if (data == NULL)
+        fail(name, "out of memory");
+    if (fread(data, 1, (size_t)size, in) != (size_t)size)
+        fail(name, "read error");
+    fclose(in);
+    *len = (uLong)size;
+    return data;
+}
+
+/* compress data into f->gz as gzip -9 would */
+static void gzip_file(f, data, len)
+    bench_file *f;
+    Bytef *data;
+    uLong len;
+{
+    z_stream strm;
+
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, 9, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY) !=
+        Z_OK)
+        fail(f->name, "deflateInit2 failed");
+    f->gz_len = deflateBound(&strm, len);
+    f->gz = (Bytef *)malloc(f->gz_len);
+    if (f->gz == NULL)
+        fail(f->name, "out of memory");
+    strm.next_in = data;
+    strm.avail_in = (uInt)len;
+    strm.next_out = f->gz;
+    strm.avail_out = (uInt)f->gz_len;
+    if (deflate(&strm, Z_FINISH) != Z_STREAM_END)
+        fail(f->name, "deflate failed");
+    f->gz_len = strm.total_out;
+    deflateEnd(&strm);
+}
+
+static void load_file(f, name)
+    bench_file *f;
+    const char *name;
+{
+    Bytef *data;
+    uLong len;
+
+    f->name = name;
+    data = read_file(name, &len);
+    if (len >= 18 && data[0] == 0x1f && data[1] == 0x8b) {
+        f->gz = data;
+        f->gz_len = len;
+        /* the uncompressed length modulo 2^32 ends the stream */
+        f->out_len = (uLong)data[len - 4] | (uLong)data[len - 3] << 8 |
+                     (uLong)data[len - 2] << 16 | (uLong)data[len - 1] << 24;
+    }
+    else {
+        gzip_file(f, data, len);
+        f->out_len = len;
+        free(data);
+    }
+    f->out = (Bytef *)malloc(f->out_len ? f->out_len : 1);
+    if (f->out == NULL)
+        fail(name, "out of memory");
+}
+
+static double seconds(start)
+    clock_t start;
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(argc, argv)
+    int argc;
+    char *argv[];
+{
+    bench_file *files;
+    z_stream strm;
+    int rounds = 20;
+    int num_files, i, r;
+    uLong gz_total = 0, out_total = 0;
+    uLong crc = crc32(0L, Z_NULL, 0), adler = adler32(0L, Z_NULL, 0);
+    double bytes, t;
+    clock_t start;
+
+    argc--, argv++;
+    if (argc >= 2 && strcmp(*argv, "-n") == 0) {
+        rounds = atoi(argv[1]);
+        argc -= 2, argv += 2;
+    }
+    if (argc < 1 || rounds < 1) {
+        fprintf(stderr, "usage: infbench [-n rounds] file ...\n");
+        return 2;
+    }
+
+    num_files = argc;
+    files = (bench_file *)calloc((size_t)num_files, sizeof(bench_file));
+    if (files == NULL)
+        fail("infbench", "out of memory");
+    for (i = 0; i < num_files; i++) {
+        load_file(&files[i], argv[i]);
+        gz_total += files[i].gz_len;
+        out_total += files[i].out_len;
+    }
+    bytes = (double)out_total * rounds;
+    printf("%d files, %lu bytes compressed, %lu bytes inflated, %d rounds\n",
+           num_files, gz_total, out_total, rounds);
+
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, 31) != Z_OK)
+        fail("infbench", "inflateInit2 failed");
+    start = clock();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < num_files; i++) {
+            bench_file *f = &files[i];
+
+            inflateReset(&strm);
+            strm.next_in = f->gz;
+            strm.avail_in = (uInt)f->gz_len;
+            strm.next_out = f->out;
+            strm.avail_out = (uInt)f->out_len;
+            if (inflate(&strm, Z_FINISH) != Z_STREAM_END ||
+                strm.total_out != f->out_len)
+                fail(f->name, "inflate failed");
+        }
+    t = seconds(start);
+    inflateEnd(&strm);
+    printf("inflate: %8.1f MB/s\n", bytes / t / 1e6);
+
+    start = clock();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < num_files; i++)
+            crc = crc32(crc, files[i].out, (uInt)files[i].out_len);
+    t = seconds(start);
+    printf("crc32:   %8.1f MB/s (%08lx)\n", bytes / t / 1e6, crc);
+
+    start = clock();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < num_files; i++)
+            adler = adler32(adler, files[i].out, (uInt)files[i].out_len);
+    t = seconds(start);
+    printf("adler32: %8.1f MB/s (%08lx)\n", bytes / t / 1e6, adler);
+
+    for (i = 0; i < num_files; i++) {
+        free(files[i].gz);
+        free(files[i].out);
+    }
+    free(files);
+    return 0;
+}
@@ -1387,6 +1387,29 @@ ZEXTERN int ZEXPORT gzsetparams OF((gzFile file, int level, int strategy));
    or Z_MEM_ERROR if there is a memory allocation error.
 */
 
+ZEXTERN int ZEXPORT gzsetparallel OF((gzFile file, int threads,
+                                      unsigned block));
+/*
+     Compress the data written to file using up to threads threads.  The input
+   is cut into blocks of block bytes (128K if block is zero) that are
+   compressed independently, each using the 32K of data before it as a preset
+   dictionary, and then written in order as a single gzip member.  This trades
+   a slightly worse compression ratio for speed on large files.  The output
+   depends on block, but not on threads.  A threads value of 0 or 1 reverts to
+   normal, serial compression.  This has no effect on a file opened for
+   transparent writing with "T".
+
+     gzsetparallel must be called after gzopen() or gzdopen() and before any
+   other function that writes to or flushes the file.  gzflush() and
+   gzsetparams() still work as documented, but cost a batch of blocks each,
+   so should not be called often.  Threads are used only while a batch of
+   blocks is being compressed, from within the call that fills or flushes it.
+
+     gzsetparallel returns Z_OK on success, Z_STREAM_ERROR if the file was not
+   opened for writing, if it was called too late or threads is negative, or
+   Z_MEM_ERROR if there is a memory allocation error.
+*/
+
 ZEXTERN int ZEXPORT gzread OF((gzFile file, voidp buf, unsigned len));
 /*
      Reads the given number of uncompressed bytes from the compressed file.  If